@@ -2523,6 +2523,237 @@ ACVP_RESULT acvp_set_certkey(ACVP_CTX *ctx, char *cert_file, char *key_file);
  */
 ACVP_RESULT acvp_mark_as_sample(ACVP_CTX *ctx);
 
+/*! @brief acvp_set_worker_count() sets the number of threads used by
+       acvp_process_tests() to process vector sets in parallel.
+
+    By default the vector sets are downloaded, processed and uploaded
+    one at a time.  When the worker count is greater than one,
+    acvp_process_tests() spawns that many threads, each of which pulls
+    the next vector set from the test session and runs it to completion
+    using its own transport buffer and response data.  The crypto
+    handlers registered with libacvp, as well as the logging callback,
+    must be safe to invoke concurrently when this is enabled.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param worker_count Number of worker threads, between 1 and 32.
+        A value of 1 restores the serial behavior.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_worker_count(ACVP_CTX *ctx, int worker_count);
+
+/*! @brief acvp_set_pipeline_depth() enables pipelined processing of
+       the vector sets in acvp_process_tests().
+
+    In pipelined mode the test session is split into three stages that
+    run at the same time: one downloads the upcoming vector sets, one
+    runs the crypto handlers (on as many threads as were set with
+    acvp_set_worker_count()) and one uploads the finished responses.
+    The stages are connected by queues that hold at most depth vector
+    sets each, which bounds the memory used by vector sets in flight.
+    This hides most of the transport latency behind the crypto work.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param depth Number of vector sets queued between stages, between
+        1 and 16.  A value of 0 disables pipelining.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_pipeline_depth(ACVP_CTX *ctx, int depth);
+
+/*! @brief acvp_set_async_requests() makes acvp_process_tests() keep
+       several vector sets in flight without using extra threads.
+
+    The requests are driven by the curl multi interface, or its murl
+    counterpart, on the calling thread.  Up to limit vector sets are
+    being downloaded or uploaded at once, and the crypto handler for
+    each one runs as soon as its download completes.  When result
+    concurrency is set with acvp_set_result_concurrency(),
+    acvp_check_test_results() fetches the results the same way.  This
+    mode takes precedence over the worker threads and the pipeline.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param limit Number of vector sets in flight, between 1 and 64.
+        A value of 0 goes back to blocking requests.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_async_requests(ACVP_CTX *ctx, int limit);
+
+/*! @brief acvp_set_compression() enables compressed transfers.
+
+    When enabled, the vector set responses uploaded to the server are
+    sent gzip compressed with a "Content-Encoding: gzip" header, and
+    every request tells the server it may compress its answer.  The
+    vector sets are mostly hex strings, so this typically cuts the
+    bytes on the wire by more than half.  The ratio achieved is logged
+    at the info level.  The server must accept gzip request bodies.
+    With libcurl, compressed bodies are sent with chunked transfer
+    encoding since their size is only known once they are sent, while
+    plain bodies always carry a Content-Length.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to compress, 0 to send and receive plain JSON.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_compression(ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_set_json_arena() allocates the JSON of each vector set
+        from an arena.
+
+    When enabled, the vector set downloaded from the server and the
+    responses built for it are carved out of large blocks that belong
+    to the vector set, instead of taking a malloc() and free() for
+    every value, name and string.  The blocks are released in one step
+    once the responses have been submitted.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to use an arena per vector set, 0 for the heap.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_json_arena(ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_set_vs_reader() reads the test groups of each vector set
+        one at a time.
+
+    When enabled, a vector set downloaded from the server is not turned
+    into a JSON tree all at once.  Everything but the test groups is
+    parsed up front, and the handlers that support it parse one test
+    group, and one test of that group, at a time from the JSON text,
+    freeing each as they move on.  The memory taken by a large vector
+    set then stays close to the size of its text.  Vector sets for the
+    other handlers are parsed in full as before.  The responses are no
+    longer parsed while they are received.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to read the test groups one at a time, 0 to parse
+        each vector set in full.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_vs_reader(ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_set_net_log_preview() limits how much of each server
+        response is logged.
+
+    Every request logs the response from the server at the status
+    level, and vector sets can be megabytes long.  With a preview
+    size set, only the start of each response is logged, followed by
+    the number of bytes left out.  Nothing is formatted when the log
+    level filters the message out.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param preview_len Number of bytes of each response to log, or 0
+        to log responses in full.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_net_log_preview(ACVP_CTX *ctx, int preview_len);
+
+/*! @brief acvp_set_net_log_file() writes every server response in
+        full to a file.
+
+    The responses are appended to the file as they are received,
+    whatever the log level and preview size, so the log itself can
+    stay short.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename File to append the responses to, or NULL to stop
+        writing them.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_net_log_file(ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_set_net_record_file() captures every request sent to
+        the server along with its response.
+
+    Each request is appended to the file with its URL path, its body,
+    the HTTP status and the body of the response, failed attempts
+    included.  The capture can be served back by
+    acvp_set_net_replay_file() to run the same session again without
+    the server.  It holds the credentials and access token of the
+    session, so it should be kept private.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename File to append the capture to, or NULL to stop
+        recording.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_net_record_file(ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_set_net_replay_file() answers every request from a
+        capture instead of the server.
+
+    The capture is one written by acvp_set_net_record_file().  Each
+    request is answered with the first response recorded for the same
+    method and URL path that has not been served yet, so the requests
+    may come in a different order, e.g. with worker threads.  The
+    waits the server asked for with "retry" and the delays of the
+    retry policy are skipped.  This makes a replayed session a
+    deterministic benchmark of the handlers, the JSON processing and
+    the crypto callbacks.  Request bodies that differ from the
+    recorded ones are logged at the info level.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename Capture to read, or NULL to go back to the server.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_net_replay_file(ACVP_CTX *ctx, const char *filename);
+
+#define ACVP_RETRY_ATTEMPTS_MAX 10
+#define ACVP_RETRY_DELAY_MAX_MS 300000
+
+/*! @struct ACVP_RETRY_POLICY
+ * @brief How requests that failed for a transient reason are resent.
+ *
+ * Requests that received no response (connection reset, timeout),
+ * HTTP 429 or a 5xx error are resent.  The delay before retry n is
+ * a random value between half and all of base_delay_ms * 2^(n-1),
+ * capped at max_delay_ms, so that requests which failed together
+ * do not all come back at once.
+ */
+typedef struct acvp_retry_policy_t {
+    int max_attempts;   /**< Attempts per request, 1 disables retries */
+    int base_delay_ms;  /**< Delay before the first retry */
+    int max_delay_ms;   /**< Longest delay between two attempts */
+    int deadline_ms;    /**< Time allowed for a request and its retries, 0 = no limit */
+    int budget;         /**< Retries allowed over the whole session, 0 = no limit */
+} ACVP_RETRY_POLICY;
+
+/*! @brief acvp_set_retry_policy() makes the transport resend
+        requests that failed for a transient reason.
+
+    By default a request is only resent after the JWT has been
+    refreshed, and any other failure fails the vector set.  The policy
+    applies to every kind of request, including those of worker
+    threads and asynchronous requests.  The number of retries of each
+    kind of request is reported by acvp_get_net_stats().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param policy The retry policy, which is copied.  max_attempts
+        must be between 1 and ACVP_RETRY_ATTEMPTS_MAX, and the delays
+        must not exceed ACVP_RETRY_DELAY_MAX_MS.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_retry_policy(ACVP_CTX *ctx, const ACVP_RETRY_POLICY *policy);
+
 /*! @brief acvp_register() registers the DUT with the ACVP server.
 
     This function is used to register the DUT with the server.
@@ -2632,6 +2863,165 @@ ACVP_RESULT acvp_add_oe_dependency(ACVP_CTX *ctx,
  */
 ACVP_RESULT acvp_check_test_results(ACVP_CTX *ctx);
 
+/*! @brief acvp_set_result_concurrency() switches acvp_check_test_results()
+        to fetching the results of each vector set individually.
+
+    By default acvp_check_test_results() polls the results of the whole
+    test session until every vector set has been graded.  When a limit
+    is set, the results of up to that many vector sets (and, for sample
+    sessions, the expected answers of those that failed) are fetched at
+    the same time.  Each one is passed to the callback registered with
+    acvp_set_result_callback() as soon as it is available.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param limit Number of vector sets to fetch at once, between 1 and 32.
+        A value of 0 restores polling of the session results.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_result_concurrency(ACVP_CTX *ctx, int limit);
+
+/*! @brief acvp_set_result_callback() sets a callback function which
+        receives the results of each vector set.
+
+    The callback is invoked by acvp_check_test_results() when result
+    concurrency is enabled, once for every vector set as soon as the
+    server has graded it.  It may be invoked from several threads at
+    the same time.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param result_cb Function that receives the vector set URL, its
+        disposition (e.g. "passed"), the JSON results returned by the
+        server and, for sample sessions where the vector set did not
+        pass, the JSON expected answers (NULL otherwise).
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_result_callback(ACVP_CTX *ctx,
+                                     ACVP_RESULT (*result_cb)(const char *vsid_url,
+                                                              const char *disposition,
+                                                              const char *results,
+                                                              const char *expected));
+
+/*! @brief acvp_get_connection_stats() reports how well the connection
+        to the ACVP server is being reused.
+
+    The transport handle of a test session stays open between requests,
+    so requests normally go over a connection (and TLS session) that is
+    already established.  This returns the number of requests sent so
+    far, including those sent by worker threads, and how many of them
+    did not need a new connection.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param requests Receives the number of requests sent.
+    @param reused Receives the number of requests that reused an
+        open connection.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_get_connection_stats(ACVP_CTX *ctx, unsigned int *requests, unsigned int *reused);
+
+/*! @enum ACVP_NET_ACTION
+ * @brief The kinds of requests sent to the ACVP server, used to
+ * report transport timings per kind of request.
+ */
+typedef enum acvp_net_action {
+    ACVP_NET_GET = 1, /**< Generic (get) */
+    ACVP_NET_GET_VS, /**< Vector Set (get) */
+    ACVP_NET_GET_VS_RESULT, /**< Vector Set result (get) */
+    ACVP_NET_GET_VS_SAMPLE, /**< Sample (get) */
+    ACVP_NET_POST, /**< Generic (post) */
+    ACVP_NET_POST_LOGIN, /**< Login (post) */
+    ACVP_NET_POST_REG, /**< Registration (post) */
+    ACVP_NET_POST_VS_RESP, /**< Vector set response (post) */
+    ACVP_NET_ACTION_MAX
+} ACVP_NET_ACTION;
+
+/*! @struct ACVP_NET_TIMING
+ * @brief Timings of a single request sent to the ACVP server.
+ *
+ * Times are in microseconds from the start of the request, so each
+ * one includes the ones before it.  The connect times are close to
+ * 0 when the request went over a connection that was already open.
+ */
+typedef struct acvp_net_timing_t {
+    ACVP_NET_ACTION action;
+    long http_code;          /**< HTTP status, 0 when no response was received */
+    long long namelookup_us; /**< Host name resolved */
+    long long connect_us;    /**< TCP connection established */
+    long long appconnect_us; /**< TLS handshake completed */
+    long long ttfb_us;       /**< First byte of the response received */
+    long long total_us;      /**< Request completed */
+    long long bytes_up;      /**< Request body bytes sent */
+    long long bytes_down;    /**< Response body bytes received, before decompression */
+} ACVP_NET_TIMING;
+
+#define ACVP_NET_HIST_BUCKETS 16
+
+/*! @struct ACVP_NET_STATS
+ * @brief Timings of all the requests of one ACVP_NET_ACTION sent
+ * during a test session.
+ *
+ * The times are sums over the requests, divide by count for the
+ * average.  Bucket 0 of the histograms counts the requests that
+ * took less than 1 ms, bucket i those that took at least 2^(i-1) ms
+ * and less than 2^i ms.  The last bucket also counts anything slower.
+ */
+typedef struct acvp_net_stats_t {
+    unsigned int count;      /**< Requests sent */
+    unsigned int failed;     /**< Requests that received no response */
+    unsigned int retries;    /**< Requests resent by the retry policy */
+    long long namelookup_us;
+    long long connect_us;
+    long long appconnect_us;
+    long long ttfb_us;
+    long long total_us;
+    long long max_total_us;  /**< Slowest request */
+    long long bytes_up;
+    long long bytes_down;
+    unsigned int ttfb_hist[ACVP_NET_HIST_BUCKETS];
+    unsigned int total_hist[ACVP_NET_HIST_BUCKETS];
+} ACVP_NET_STATS;
+
+/*! @brief acvp_set_net_timing_callback() sets a callback function
+        which receives the timings of every request sent to the
+        ACVP server.
+
+    This shows where the time of a slow session goes: name lookup,
+    connection setup, TLS handshake, server think time or the body
+    transfer.  The callback may be invoked from several threads at
+    the same time when worker threads are used.  Requests answered
+    from a capture, see acvp_set_net_replay_file(), are reported with
+    the recorded status and sizes and times of 0.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param timing_cb Function that receives the timings, which are
+        only valid for the duration of the call.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_net_timing_callback(ACVP_CTX *ctx, void (*timing_cb)(const ACVP_NET_TIMING *timing));
+
+/*! @brief acvp_get_net_stats() returns the aggregated timings of
+        the requests of one kind sent so far.
+
+    Requests sent by worker threads are included once the threads
+    are done.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param action Kind of request, from ACVP_NET_GET to
+        ACVP_NET_POST_VS_RESP.
+    @param stats Receives the timings.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_get_net_stats(ACVP_CTX *ctx, ACVP_NET_ACTION action, ACVP_NET_STATS *stats);
+
 /*! @brief acvp_set_2fa_callback() sets a callback function which
     will create or obtain a TOTP password for the second part of
     the two-factor authentication.
@@ -10,6 +10,7 @@
 #ifndef acvp_lcl_h
 #define acvp_lcl_h
 
+#include <stdio.h>
 #include "parson.h"
 
 #define ACVP_VERSION    "1.0"
@@ -71,8 +72,30 @@
 #endif
 #endif
 
+/* Pretty prints value at INFO, serializing it only when the level keeps it */
+#define ACVP_LOG_INFO_JSON(value) acvp_log_json(ctx, __func__, __LINE__, (value))
+
+/* Same, but as one INFO message after format, through the log callback at every level */
+#ifdef WIN32
+#define ACVP_LOG_INFO_JSON_MSG(value, format, ...) \
+        acvp_log_json_msg(ctx, __func__, __LINE__, (value), format, __VA_ARGS__)
+#else
+#define ACVP_LOG_INFO_JSON_MSG(value, format, args ...) \
+        acvp_log_json_msg(ctx, __func__, __LINE__, (value), format, ##args)
+#endif
+
 #define ACVP_BIT2BYTE(x) ((x + 7) >> 3) /**< Convert bit length (x, of type integer) into byte length */
 
+/*
+ * File-scope scratch space used by the handlers must not be shared
+ * between the worker threads of acvp_process_tests()
+ */
+#ifdef WIN32
+#define ACVP_THREAD_LOCAL __declspec(thread)
+#else
+#define ACVP_THREAD_LOCAL __thread
+#endif
+
 #define ACVP_ALG_MAX ACVP_CIPHER_END - 1  /* Used by alg_tbl[] */
 
 /********************************************************
@@ -646,10 +669,16 @@
  * END RSA
  */
 
-#define ACVP_CURL_BUF_MAX       (1024 * 1024 * 16) /**< 16 MB */
+#define ACVP_CURL_BUF_INIT      4096 /**< Initial size of a receive buffer, grows as needed */
 #define ACVP_RETRY_TIME_MAX     60 /* seconds */
+#define ACVP_RETRY_BACKOFF_SHIFT_MAX 4 /* retry period doubles at most this many times */
+#define ACVP_RESULT_RETRY_TIME  5 /* seconds between polls of an ungraded vector set */
 #define ACVP_JWT_TOKEN_MAX      1024
 #define ACVP_ATTR_URL_MAX       2083 /* MS IE's limit - arbitrary */
+#define ACVP_WORKER_COUNT_MAX   32
+#define ACVP_PIPELINE_DEPTH_MAX 16
+#define ACVP_ASYNC_REQUESTS_MAX 64
+#define ACVP_ASYNC_POLL_MS      1000
 
 #define ACVP_SESSION_PARAMS_STR_LEN_MAX 256
 #define ACVP_PATH_SEGMENT_DEFAULT ""
@@ -667,8 +696,37 @@ struct acvp_alg_handler_t {
     char *name;
     char *mode; /** < Should be NULL unless using an asymmetric alg */
     const char *revision;
+    int reads_vs;   /* handler walks the test groups with an ACVP_VS_READER */
 };
 
+/*
+ * Walks the test groups of a vector set and the tests of each group.
+ * When the vector set was read with ctx->vs_reader on, "testGroups"
+ * holds the JSON text of the groups, and each group and test is parsed
+ * when it is reached and freed when the next one is, so that only one
+ * of each is in memory.  Otherwise they are taken from the tree.
+ */
+typedef enum acvp_vs_reader_state {
+    ACVP_VS_READER_GROUPS = 0, /* between two groups */
+    ACVP_VS_READER_TESTS,      /* in the tests of the current group */
+    ACVP_VS_READER_DONE
+} ACVP_VS_READER_STATE;
+
+typedef struct acvp_vs_reader_t {
+    ACVP_CTX *ctx;
+    JSON_Reader *reader;  /* NULL when the groups are in the tree */
+    size_t depth;         /* of the groups array in the text */
+    ACVP_VS_READER_STATE state;
+    JSON_Value *group;    /* current group, parsed from the text */
+    JSON_Value *test;     /* current test, parsed from the text */
+    JSON_Array *groups;   /* groups and tests in the tree */
+    JSON_Array *tests;
+    int group_idx;
+    int group_cnt;
+    int test_idx;
+    int test_cnt;
+} ACVP_VS_READER;
+
 typedef struct acvp_vs_list_t {
     int vs_id;
     struct acvp_vs_list_t *next;
@@ -1133,6 +1191,19 @@ struct acvp_ctx_t {
     int use_json;
 
     int is_sample;
+    int worker_count;       /* Number of threads used to process vector sets */
+    int pipeline_depth;     /* Queue depth between pipeline stages, 0 = no pipeline */
+    int result_concurrency; /* Vector set results fetched at once, 0 = poll session results */
+    int async_requests;     /* Vector sets in flight on the multi interface, 0 = blocking */
+    int compress;           /* gzip responses uploaded and accept compressed downloads */
+    int json_arena;         /* each vector set is parsed and answered in a JSON_Arena */
+    int vs_reader;          /* test groups are read one at a time, see ACVP_VS_READER */
+    int net_log_preview;    /* Bytes of each response logged, 0 = all */
+    FILE *net_log_file;     /* Receives every response in full, NULL = none */
+    FILE *net_record_file;  /* Receives every request and its response, NULL = none */
+    void *net_replay;       /* Capture the responses are served from, NULL = network */
+    ACVP_RETRY_POLICY retry; /* Resending of requests that failed transiently */
+    int *retry_budget;      /* Retries left in the session, shared with workers, NULL = no limit */
 
     /* test session data */
     ACVP_VS_LIST *vs_list;
@@ -1147,6 +1218,13 @@ struct acvp_ctx_t {
     /* Two-factor authentication callback */
     ACVP_RESULT (*totp_cb) (char **token, int token_max);
 
+    /* Receives the results of each vector set */
+    ACVP_RESULT (*result_cb) (const char *vsid_url, const char *disposition,
+                              const char *results, const char *expected);
+
+    /* Receives the timings of every request */
+    void (*net_timing_cb) (const ACVP_NET_TIMING *timing);
+
     /* Transitory values */
     int vs_id;      /* vs_id currently being processed */
 
@@ -1154,6 +1232,23 @@ struct acvp_ctx_t {
 
     char *curl_buf;       /**< Data buffer for inbound Curl messages */
     int curl_read_ctr;    /**< Total number of bytes written to the curl_buf */
+    int curl_buf_max;     /**< Allocated size of the curl_buf */
+    size_t rcv_len;       /**< Decoded body bytes received by the last request */
+    int rcv_stream;       /**< Parse the response to this request while it is received */
+    JSON_Stream_Parser *rcv_parser; /**< Parser fed by the write callback */
+    JSON_Value *rcv_val;  /**< Response parsed while it was received, instead of curl_buf */
+
+    /* Transport handle kept open for the whole session */
+    void *curl_hnd;       /**< Easy handle reused for every request on this ctx */
+    void *curl_share;     /**< Connection/TLS session cache shared with workers */
+    void *curl_multi;     /**< Multi handle driving the asynchronous requests */
+    void *net_hdrs;       /**< Request headers built for the current jwt */
+    unsigned int net_requests;    /**< Number of requests sent on curl_hnd */
+    unsigned int net_conn_reused; /**< Requests that reused an open connection */
+    ACVP_NET_ACTION net_action;   /**< Kind of the request being sent */
+    long long net_start_us;       /**< When the request was sent, see acvp_time_us() */
+    long long net_ttfb_us;        /**< First response byte, from net_start_us */
+    ACVP_NET_STATS net_stats[ACVP_NET_ACTION_MAX]; /**< Timings per kind of request */
 };
 
 ACVP_RESULT acvp_send_test_session_registration(ACVP_CTX *ctx, char *reg, int len);
@@ -1179,16 +1274,78 @@ ACVP_RESULT acvp_retrieve_vector_set_result(ACVP_CTX *ctx, char *vsid_url);
 
 ACVP_RESULT acvp_retrieve_expected_result(ACVP_CTX *ctx, char *api_url);
 
+/*
+ * Completion callback of an asynchronous request.  The body received
+ * from the server is only valid for the duration of the call and is
+ * NULL when the request was abandoned.  A vector set that was parsed
+ * while it was received is in ctx->rcv_val instead of the body.
+ */
+typedef void (*ACVP_NET_CB)(ACVP_CTX *ctx, ACVP_RESULT rv, const char *body, int body_len, void *arg);
+
+ACVP_RESULT acvp_async_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url,
+                                           ACVP_NET_CB cb, void *arg);
+
+ACVP_RESULT acvp_async_retrieve_vector_set_result(ACVP_CTX *ctx, char *api_url,
+                                                  ACVP_NET_CB cb, void *arg);
+
+ACVP_RESULT acvp_async_retrieve_expected_result(ACVP_CTX *ctx, char *api_url,
+                                                ACVP_NET_CB cb, void *arg);
+
+ACVP_RESULT acvp_async_submit_vector_responses(ACVP_CTX *ctx, char *vsid_url, JSON_Value *kat_resp,
+                                               ACVP_NET_CB cb, void *arg);
+
+ACVP_RESULT acvp_async_run(ACVP_CTX *ctx, long long timeout_ms);
+
+void acvp_async_cleanup(ACVP_CTX *ctx);
+
+void acvp_transport_share_init(ACVP_CTX *ctx);
+
+void acvp_transport_close(ACVP_CTX *ctx);
+
+void acvp_transport_reset_auth(ACVP_CTX *ctx);
+
+const char *acvp_transport_auth_hdr(ACVP_CTX *ctx);
+
+void acvp_transport_cleanup(ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_transport_replay_open(ACVP_CTX *ctx, const char *filename);
+
+void acvp_transport_replay_close(ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_transport_upload_body(ACVP_CTX *ctx, const JSON_Value *val,
+                                       char **body, int *body_len);
+
 ACVP_RESULT acvp_submit_vector_responses(ACVP_CTX *ctx, char *vsid_url);
 
 void acvp_log_msg(ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *format, ...);
 
+void acvp_log_json(ACVP_CTX *ctx, const char *func, int line, const JSON_Value *value);
+
+void acvp_log_json_msg(ACVP_CTX *ctx, const char *func, int line, const JSON_Value *value,
+                       const char *format, ...);
+
 ACVP_RESULT acvp_hexstr_to_bin(const char *src, unsigned char *dest, int dest_max, int *converted_len);
 
 ACVP_RESULT acvp_bin_to_bit(const unsigned char *in, int len, unsigned char *out);
 
 ACVP_RESULT acvp_bit_to_bin(const unsigned char *in, int len, unsigned char *out);
 
+long long acvp_time_ms(void);
+
+long long acvp_time_us(void);
+
+long long acvp_jitter_ms(long long range);
+
+void acvp_sleep_ms(long long ms);
+
+ACVP_RESULT acvp_vs_reader_open(ACVP_CTX *ctx, ACVP_VS_READER *vsr, JSON_Object *obj);
+
+ACVP_RESULT acvp_vs_reader_next_group(ACVP_VS_READER *vsr, JSON_Object **group);
+
+ACVP_RESULT acvp_vs_reader_next_test(ACVP_VS_READER *vsr, JSON_Object **test);
+
+void acvp_vs_reader_close(ACVP_VS_READER *vsr);
+
 /*
  * These are the handler routines for each KAT operation
  */
@@ -60,6 +60,22 @@ typedef void   (*JSON_Free_Function)(void *);
    from stdlib will be used for all allocations */
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun);
 
+/* Arenas: while an arena is current on a thread, the values parsed or created on that
+   thread are carved out of large blocks of it instead of being allocated one by one.
+   json_value_free() does nothing for them, they all go away at once with json_arena_free().
+   Objects and arrays keep growing in the arena they were created in, whichever arena is
+   current. A tree must not mix values of different arenas, or of an arena and the heap. */
+typedef struct json_arena_t JSON_Arena;
+
+JSON_Arena * json_arena_new(size_t block_size); /* 0 for the default block size */
+/* Makes arena current for the calling thread, NULL goes back to the heap.
+   Returns the arena that was current before. */
+JSON_Arena * json_arena_set(JSON_Arena *arena);
+JSON_Arena * json_arena_get(void);
+size_t       json_arena_used(const JSON_Arena *arena); /* bytes handed out */
+/* Frees every value allocated from arena, and makes the heap current if it was current */
+void         json_arena_free(JSON_Arena *arena);
+
 /* Parses first JSON value in a file, returns NULL in case of error */
 JSON_Value * json_parse_file(const char *filename);
 
@@ -78,6 +94,17 @@ JSON_Value * json_parse_string(const char *string);
 JSON_Value * json_parse_string_with_comments(const char *string);
 #endif
 
+/* Incremental parsing: feed a document in arbitrary chunks as it arrives and
+   collect the value at the end, without ever holding the whole text. */
+typedef struct json_stream_parser_t JSON_Stream_Parser;
+
+JSON_Stream_Parser * json_stream_parser_new(void);
+/* Returns JSONFailure as soon as the input can no longer be valid JSON */
+JSON_Status          json_stream_parser_feed(JSON_Stream_Parser *parser, const char *chunk, size_t len);
+/* Frees the parser and returns the parsed value, NULL if input was invalid or incomplete */
+JSON_Value *         json_stream_parser_finish(JSON_Stream_Parser *parser);
+void                 json_stream_parser_free(JSON_Stream_Parser *parser);
+
 /* Serialization */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
@@ -92,6 +119,54 @@ char *      json_serialize_to_string_pretty(const JSON_Value *value, int *len);
 
 void        json_free_serialized_string(char *string); /* frees string from json_serialize_to_string and json_serialize_to_string_pretty */
 
+/* Serialization into a sink, called with consecutive pieces of the text as
+   they are produced, so the whole of it never has to be in memory. A sink
+   returning JSONFailure stops the serialization. */
+typedef JSON_Status (*JSON_Sink_Function)(void *sink_ctx, const char *data, size_t len);
+
+JSON_Status json_serialize_to_sink(const JSON_Value *value, JSON_Sink_Function sink, void *sink_ctx);
+JSON_Status json_serialize_to_sink_pretty(const JSON_Value *value, JSON_Sink_Function sink, void *sink_ctx);
+
+/* Incremental serialization: read the compact serialization of a value in
+   chunks of any size, holding no more than one string of it at a time.
+   The value must not change until the writer is freed. */
+typedef struct json_stream_writer_t JSON_Stream_Writer;
+
+JSON_Stream_Writer * json_stream_writer_new(const JSON_Value *value);
+/* Returns the number of bytes copied to buf, 0 once everything was read, -1 on fail */
+int                  json_stream_writer_read(JSON_Stream_Writer *writer, char *buf, int len);
+void                 json_stream_writer_free(JSON_Stream_Writer *writer);
+
+/* Pull reading: walk a JSON text value by value, building trees only of the
+   values asked for. The text must not change until the reader is freed.
+   Skipped values are only checked for balanced brackets and quotes. */
+typedef struct json_reader_t JSON_Reader;
+
+#define JSONReaderEnd 0 /* returned by json_reader_next() after the last member */
+
+/* A member to come back to with json_reader_rewind() */
+typedef struct json_reader_mark_t {
+    size_t offset;
+    size_t depth;
+} JSON_Reader_Mark;
+
+JSON_Reader *    json_reader_new(const char *string);
+void             json_reader_free(JSON_Reader *reader);
+/* Moves to the root value, then to each member of the object or array entered
+   last, skipping what is left of the current one. Returns the type of the value
+   moved to, JSONReaderEnd when the object or array is done (reading goes on in
+   the one around it) or JSONError on invalid input. */
+JSON_Value_Type  json_reader_next(JSON_Reader *reader);
+const char *     json_reader_name(const JSON_Reader *reader); /* name of the current member, NULL in arrays */
+JSON_Status      json_reader_enter(JSON_Reader *reader); /* reads on inside the current object or array */
+JSON_Value *     json_reader_value(JSON_Reader *reader); /* parses the current value, NULL on fail */
+/* Moves past the current value and returns its text, len bytes long, NULL on fail */
+const char *     json_reader_text(JSON_Reader *reader, size_t *len);
+JSON_Reader_Mark json_reader_mark(const JSON_Reader *reader); /* the current member */
+/* The next json_reader_next() moves to the marked member again. The mark must be
+   in the object or array being read or in the one that just ended. */
+JSON_Status      json_reader_rewind(JSON_Reader *reader, const JSON_Reader_Mark *mark);
+
 /* Comparing */
 int  json_value_equals(const JSON_Value *a, const JSON_Value *b);
 
@@ -117,6 +192,22 @@ JSON_Array  * json_object_get_array  (const JSON_Object *object, const char *nam
 double        json_object_get_number (const JSON_Object *object, const char *name); /* returns 0 on fail */
 int           json_object_get_boolean(const JSON_Object *object, const char *name); /* returns -1 on fail */
 
+/* Interned keys hash and measure a name once, so lookups that repeat per test
+   case skip both. A key only points at name, which must outlive it. */
+typedef struct json_key_t {
+    const char    *name;
+    size_t         length;
+    unsigned long  hash;
+} JSON_Key;
+
+JSON_Key      json_key(const char *name);
+JSON_Value  * json_object_get_value_key  (const JSON_Object *object, const JSON_Key *key);
+const char  * json_object_get_string_key (const JSON_Object *object, const JSON_Key *key);
+JSON_Object * json_object_get_object_key (const JSON_Object *object, const JSON_Key *key);
+JSON_Array  * json_object_get_array_key  (const JSON_Object *object, const JSON_Key *key);
+double        json_object_get_number_key (const JSON_Object *object, const JSON_Key *key); /* returns 0 on fail */
+int           json_object_get_boolean_key(const JSON_Object *object, const JSON_Key *key); /* returns -1 on fail */
+
 /* dotget functions enable addressing values with dot notation in nested objects,
  just like in structs or c++/java/c# objects (e.g. objectA.objectB.value).
  Because valid names in JSON can contain dots, some values may be inaccessible
@@ -211,6 +302,7 @@ JSON_Status json_array_append_null(JSON_Array *array);
 JSON_Value * json_value_init_object (void);
 JSON_Value * json_value_init_array  (void);
 JSON_Value * json_value_init_string (const char *string); /* copies passed string */
+JSON_Value * json_value_init_string_with_len (const char *string, size_t len); /* copies len bytes of passed string */
 JSON_Value * json_value_init_number (double number);
 JSON_Value * json_value_init_boolean(int boolean);
 JSON_Value * json_value_init_null   (void);
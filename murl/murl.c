@@ -44,7 +44,13 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -61,6 +67,8 @@
 static unsigned int initialized = 0;
 #define DEBUGF(x) do { } while (0)
 
+static void murl_tls_reset(SessionHandle *ctx);
+
 /**
  * Global SSL init
  *
@@ -156,6 +164,11 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
     CURLcode result = CURLE_OK;
     SessionHandle *data = (SessionHandle*)ctx;
 
+    /*
+     * Options of the TLS layer are applied when the SSL context is
+     * built, so they drop the context, the saved TLS session and the
+     * connection kept open for the next request
+     */
     switch (option) {
     case CURLOPT_USERAGENT:
         /*
@@ -176,8 +189,30 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
         data->headers = va_arg(param, struct curl_slist *);
         break;
     case CURLOPT_POSTFIELDS:
+        /*
+         * Like Curl, the data is not copied and must stay valid until
+         * the transfer is done.  This keeps binary bodies intact.
+         */
         data->http_post = 1;
-        result = setstropt(&data->post_fields, va_arg(param, char *));
+        data->post_fields = va_arg(param, char *);
+        break;
+    case CURLOPT_POST:
+        data->http_post = (0 != va_arg(param, long)) ? 1 : 0;
+        break;
+    case CURLOPT_ACCEPT_ENCODING:
+        /*
+         * Content encodings the server may use for the response
+         */
+        result = setstropt(&data->accept_encoding, va_arg(param, char *));
+        break;
+    case CURLOPT_HTTPGET:
+        /*
+         * Revert a reused handle to GET requests
+         */
+        if (0 != va_arg(param, long)) {
+            data->http_post = 0;
+            data->post_field_size = 0;
+        }
         break;
     case CURLOPT_POSTFIELDSIZE_LARGE:
         /*
@@ -191,12 +226,14 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
          * Set CA info for SSL connection. Specify file name of the CA certificate
          */
         result = setstropt(&data->ca_file, va_arg(param, char *));
+        murl_tls_reset(data);
         break;
     case CURLOPT_SSL_VERIFYPEER:
         /*
          * Enable peer SSL verifying.
          */
         data->ssl_verify_peer = (0 != va_arg(param, long)) ? 1 : 0;
+        murl_tls_reset(data);
         break;
     case CURLOPT_CERTINFO:
         /*
@@ -209,6 +246,7 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
          * String that holds file name of the SSL certificate to use
          */
         result = setstropt(&data->ssl_cert_file, va_arg(param, char *));
+        murl_tls_reset(data);
         break;
     case CURLOPT_SSLCERTTYPE:
         /*
@@ -221,6 +259,7 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
          * String that holds file name of the SSL key to use
          */
         result = setstropt(&data->ssl_key_file, va_arg(param, char *));
+        murl_tls_reset(data);
         break;
     case CURLOPT_SSLKEYTYPE:
         /*
@@ -234,11 +273,18 @@ CURLcode Curl_setopt(CURL *ctx, CURLoption option, va_list param)
     case CURLOPT_WRITEFUNCTION:
         data->write_func = va_arg(param, curl_write_callback);
         break;
+    case CURLOPT_PRIVATE:
+        /*
+         * Set private data pointer.
+         */
+        data->private_data = va_arg(param, void *);
+        break;
     case CURLOPT_SSL_VERIFY_HOSTNAME:
         /*
          * Enable peer hostname verification.
          */
         data->ssl_verify_hostname = (0 != va_arg(param, long)) ? 1 : 0;
+        murl_tls_reset(data);
         break;
 
     default:
@@ -267,12 +313,36 @@ CURLcode curl_easy_setopt(CURL *curl, CURLoption tag, ...)
     return result;
 }
 
+/*
+ * Microseconds elapsed since start
+ */
+static curl_off_t elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (curl_off_t)(now.tv_sec - start->tv_sec) * 1000000 +
+           (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ * Switches a socket between blocking and non-blocking I/O
+ */
+static void murl_set_nonblock(int sock, int nonblock)
+{
+    int flags = fcntl(sock, F_GETFL, 0);
+
+    if (flags < 0) return;
+    fcntl(sock, F_SETFL, nonblock ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
 /*
  * This function simply opens a TCP connection using
  * the BIO interface. Returns the file descriptor for
- * the socket.
+ * the socket.  A non-blocking connect is still in
+ * progress on return, the TLS handshake finishes it.
  */
-static BIO *create_connection(char *server, int port)
+static BIO *create_connection(char *server, int port, int nonblock)
 {
     BIO *b = NULL;
     char pbuf[64];
@@ -284,8 +354,11 @@ static BIO *create_connection(char *server, int port)
     }
     sprintf(pbuf, "%d", port);
     BIO_set_conn_port(b, pbuf);
+    if (nonblock) {
+        BIO_set_nbio(b, 1);
+    }
 
-    if (BIO_do_connect(b) <= 0) {
+    if (BIO_do_connect(b) <= 0 && !(nonblock && BIO_should_retry(b))) {
         printf("TCP connect failed\n");
         BIO_free_all(b);
         return NULL;
@@ -300,7 +373,7 @@ static BIO *create_connection(char *server, int port)
  *	[2001:db8:85a3:8d3:1319:8a2e:370:7348]
  */
 #define IPV6_ADDRESS_MAX    41
-static BIO *create_connection_v6(char *address, int port)
+static BIO *create_connection_v6(char *address, int port, int nonblock)
 {
     BIO		    *conn = NULL;
     struct sockaddr_in6 si6;
@@ -333,7 +406,11 @@ static BIO *create_connection_v6(char *address, int port)
 	fprintf(stderr, "Unable to create v6 socket for address: %s\n", host);
 	return(NULL);
     }
-    if (connect(sock, (struct sockaddr *) &si6, sizeof(si6)) < 0 ) {
+    if (nonblock) {
+	murl_set_nonblock(sock, 1);
+    }
+    if (connect(sock, (struct sockaddr *) &si6, sizeof(si6)) < 0 &&
+	!(nonblock && errno == EINPROGRESS)) {
 	fprintf(stderr, "Unable to connect v6 socket to address: %s  [%s]\n", host, strerror(errno));
 	close(sock);
 	return(NULL);
@@ -646,54 +723,114 @@ static void murl_log_peer_cert(SSL *ssl)
 }
 
 
-#define TBUF_MAX 1024
-#define READ_CHUNK_SZ 16384
-CURLcode curl_easy_perform(CURL *curl)
+/*
+ * Writing to a connection the server has closed raises SIGPIPE, which
+ * would kill the application.  The signal is blocked in the calling
+ * thread while Murl uses a connection, and one raised meanwhile is
+ * discarded before the signal mask is restored.
+ */
+void murl_sigpipe_block(murl_sigpipe *sp)
 {
-    BIO *conn;
-    int rv;
-    int ssl_err;
-    int read_cnt = 0;
-    char *rbuf = NULL;
-    char tbuf[TBUF_MAX];
-    SSL *ssl = NULL;
-    SSL_CTX *ssl_ctx = NULL;
-    X509_VERIFY_PARAM *vpm = NULL;
-    int cl;
-    SessionHandle *ctx = (SessionHandle*)curl;
-    struct curl_slist *hdrs;
-    unsigned long ossl_err;
-    CURLcode crv;
+    sigset_t pipe_set, pending;
+
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    sigemptyset(&pending);
+    sigpending(&pending);
+    sp->was_pending = sigismember(&pending, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &sp->old_set);
+}
 
-    if (!ctx) {
-	return CURLE_UNKNOWN_OPTION;
+void murl_sigpipe_restore(murl_sigpipe *sp)
+{
+    sigset_t pipe_set, pending;
+    struct timespec zero = { 0, 0 };
+
+    if (!sp->was_pending) {
+        sigemptyset(&pending);
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE)) {
+            sigemptyset(&pipe_set);
+            sigaddset(&pipe_set, SIGPIPE);
+            sigtimedwait(&pipe_set, NULL, &zero);
+        }
     }
+    pthread_sigmask(SIG_SETMASK, &sp->old_set, NULL);
+}
 
-    /*
-     * Allocate some space to build the HTTP request
-     */
-    if (ctx->http_post && ctx->post_field_size) {
-        cl = ctx->post_field_size; 
-    } else if (ctx->http_post && ctx->post_fields) {
-        cl = strlen(ctx->post_fields); //FIXME: this is not safe
-    } else {
-        cl = 0;
+/*
+ * Closes the connection kept open by the handle, if any.  Its TLS
+ * session is saved first, so the next connection to the server can
+ * resume it instead of doing a full handshake.  A connection closed
+ * during its handshake has no session worth saving.
+ */
+static void murl_close_connection(SessionHandle *ctx)
+{
+    SSL_SESSION *sess;
+    murl_sigpipe sp;
+
+    if (!ctx->ssl) return;
+    /* Before the socket number can be reused by another connection */
+    murl_multi_unwatch(ctx);
+    if (SSL_is_init_finished(ctx->ssl)) {
+        sess = SSL_get1_session(ctx->ssl);
+        if (sess) {
+            if (ctx->ssl_session) SSL_SESSION_free(ctx->ssl_session);
+            ctx->ssl_session = sess;
+        }
+        murl_sigpipe_block(&sp);
+        SSL_shutdown(ctx->ssl);
+        murl_sigpipe_restore(&sp);
     }
-    if (cl > MURL_POST_MAX) {
-	fprintf(stderr, "POST data exceeds %d byte limit\n", MURL_POST_MAX);
-	return CURLE_FILESIZE_EXCEEDED;
+    SSL_free(ctx->ssl);
+    ctx->ssl = NULL;
+    ERR_clear_error();
+}
+
+/*
+ * Drops everything built from the TLS options of the handle.
+ */
+static void murl_tls_reset(SessionHandle *ctx)
+{
+    murl_close_connection(ctx);
+    if (ctx->ssl_session) {
+        SSL_SESSION_free(ctx->ssl_session);
+        ctx->ssl_session = NULL;
     }
-    rbuf = calloc(1, cl+MURL_HDR_MAX);
-    if (!rbuf) {
-        fprintf(stderr, "calloc failed.\n");
-        return CURLE_OUT_OF_MEMORY;
+    if (ctx->ssl_ctx) {
+        SSL_CTX_free(ctx->ssl_ctx);
+        ctx->ssl_ctx = NULL;
     }
+}
 
-    /*
-     * Split the URL into it's parts
-     */
-    crv = parseurl(ctx);
-    if (crv != CURLE_OK) goto easy_perform_cleanup;
+/*
+ * Tells whether the server closed a connection that was kept open.
+ * Nothing is expected on an idle connection, so anything readable
+ * is either the end of the stream or something Murl can't handle.
+ */
+static int murl_connection_dead(SSL *ssl)
+{
+    struct pollfd pfd;
+
+    if (SSL_pending(ssl)) return 1;
+    pfd.fd = SSL_get_fd(ssl);
+    if (pfd.fd < 0) return 1;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) != 0;
+}
+
+/*
+ * Builds the SSL context from the TLS options of the handle.  Loading
+ * the trust anchors and the client certificate and key takes file I/O
+ * and PEM parsing, so the context is kept in the handle and reused by
+ * every connection until a TLS option changes.
+ */
+static CURLcode murl_ssl_ctx_new(SessionHandle *ctx)
+{
+    SSL_CTX *ssl_ctx = NULL;
+    X509_VERIFY_PARAM *vpm = NULL;
+    CURLcode crv;
 
     /*
      * Setup OpenSSL API
@@ -702,8 +839,7 @@ CURLcode curl_easy_perform(CURL *curl)
     if (!ssl_ctx) {
         fprintf(stderr, "Failed to create SSL context.\n");
         ERR_print_errors_fp(stderr);
-        crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+        return CURLE_SSL_CONNECT_ERROR;
     }
     /*
      * This is optional.
@@ -713,6 +849,18 @@ CURLcode curl_easy_perform(CURL *curl)
      * the SSL socket.
      */
     SSL_CTX_set_mode(ssl_ctx, SSL_MODE_AUTO_RETRY);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    /*
+     * Servers often close the connection without a TLS close_notify,
+     * the HTTP parser tells whether the response is complete
+     */
+    SSL_CTX_set_options(ssl_ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+    /*
+     * Sessions are saved in the handle rather than the internal
+     * cache, see murl_close_connection()
+     */
+    SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
 
 
     /*
@@ -723,7 +871,7 @@ CURLcode curl_easy_perform(CURL *curl)
             fprintf(stderr, "Failed to set trust anchors.\n");
             ERR_print_errors_fp(stderr);
             crv = CURLE_SSL_CACERT_BADFILE;
-	    goto easy_perform_cleanup;
+	    goto ssl_ctx_err;
         }
         SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER|SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
     }
@@ -733,7 +881,7 @@ CURLcode curl_easy_perform(CURL *curl)
         fprintf(stderr, "Unable to allocate a verify parameter structure.\n");
         ERR_print_errors_fp(stderr);
         crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+	goto ssl_ctx_err;
     }
 #if 0
     /* TODO: Enable CRL checks */
@@ -742,9 +890,6 @@ CURLcode curl_easy_perform(CURL *curl)
 #endif
     X509_VERIFY_PARAM_set_depth(vpm, 7);
     X509_VERIFY_PARAM_set_purpose(vpm, X509_PURPOSE_SSL_SERVER);
-    if (ctx->ssl_verify_hostname) {
-	X509_VERIFY_PARAM_set1_host(vpm, ctx->host_name, strnlen(ctx->host_name, MURL_HOSTNAME_MAX));
-    }
     SSL_CTX_set1_param(ssl_ctx, vpm);
     X509_VERIFY_PARAM_free(vpm);
 
@@ -753,61 +898,181 @@ CURLcode curl_easy_perform(CURL *curl)
             fprintf(stderr,"Failed to load client certificate\n");
             ERR_print_errors_fp(stderr);
             crv = CURLE_SSL_CERTPROBLEM;
-	    goto easy_perform_cleanup;
+	    goto ssl_ctx_err;
         }
         if (SSL_CTX_use_PrivateKey_file(ssl_ctx, ctx->ssl_key_file, SSL_FILETYPE_PEM) != 1) {
             fprintf(stderr, "Failed to load client private key\n");
             ERR_print_errors_fp(stderr);
             crv = CURLE_SSL_CERTPROBLEM;
-	    goto easy_perform_cleanup;
+	    goto ssl_ctx_err;
         }
     }
 
+    ctx->ssl_ctx = ssl_ctx;
+    return CURLE_OK;
+
+ssl_ctx_err:
+    SSL_CTX_free(ssl_ctx);
+    return crv;
+}
+
+/*
+ * Opens a TCP connection with the server in the URL and sets up TLS
+ * over it.  The handshake is left to murl_transfer_step().
+ */
+static CURLcode murl_open_connection(SessionHandle *ctx)
+{
+    BIO *conn;
+    SSL *ssl = NULL;
+    CURLcode crv;
+
+    if (!ctx->ssl_ctx) {
+        crv = murl_ssl_ctx_new(ctx);
+        if (crv != CURLE_OK) return crv;
+    }
+
+    /*
+     * A saved session only resumes with the server it came from
+     */
+    if (ctx->ssl_session && (ctx->conn_port != ctx->server_port ||
+                             strncmp(ctx->conn_host, ctx->host_name, MURL_HOSTNAME_MAX))) {
+        SSL_SESSION_free(ctx->ssl_session);
+        ctx->ssl_session = NULL;
+    }
+
+    /*
+     * Remember where the connection goes before the IPv6 code
+     * strips the brackets from the host name
+     */
+    strncpy(ctx->conn_host, ctx->host_name, MURL_HOSTNAME_MAX - 1);
+    ctx->conn_port = ctx->server_port;
+
+    ssl = SSL_new(ctx->ssl_ctx);
+    if (!ssl) {
+        fprintf(stderr, "Failed to create SSL connection.\n");
+        ERR_print_errors_fp(stderr);
+        return CURLE_OUT_OF_MEMORY;
+    }
+    /*
+     * The server name to verify is per connection, the rest of the
+     * verify parameters come from the SSL context
+     */
+    if (ctx->ssl_verify_hostname) {
+	X509_VERIFY_PARAM_set1_host(SSL_get0_param(ssl), ctx->host_name, strnlen(ctx->host_name, MURL_HOSTNAME_MAX));
+    }
+    if (!SSL_set_tlsext_host_name(ssl, ctx->host_name)) {
+        fprintf(stderr, "Warning: SNI extension not set.\n");
+    }
+    if (ctx->ssl_session) {
+        SSL_set_session(ssl, ctx->ssl_session);
+    }
+
     /*
      * Open TCP connection with server
      */
     if (ctx->use_ipv6) {
-	conn = create_connection_v6(ctx->host_name, ctx->server_port);
+	conn = create_connection_v6(ctx->host_name, ctx->server_port, ctx->nonblock);
     } else {
-	conn = create_connection(ctx->host_name, ctx->server_port);
+	conn = create_connection(ctx->host_name, ctx->server_port, ctx->nonblock);
     }
-    //FIXME: do we need to free conn, or is this handled by SSL_free?
     if (conn == NULL) {
         fprintf(stderr, "Unable to open socket with server.\n");
-        crv = CURLE_COULDNT_CONNECT;
-	goto easy_perform_cleanup;
+        SSL_free(ssl);
+        return CURLE_COULDNT_CONNECT;
     }
-    ssl = SSL_new(ssl_ctx);
-    if (!SSL_set_tlsext_host_name(ssl, ctx->host_name)) {
-        fprintf(stderr, "Warning: SNI extension not set.\n");
+    ctx->num_connects++;
+    if (!ctx->nonblock) {
+        ctx->t_connect = elapsed_us(&ctx->start);
     }
+    /* The SSL object owns the BIO from here on */
     SSL_set_bio(ssl, conn, conn);
-    rv = SSL_connect(ssl);
-    if (rv <= 0) {
-        fprintf(stderr, "TLS handshake failed.\n");
-        ERR_print_errors_fp(stderr);
-        crv = CURLE_SSL_CONNECT_ERROR;
-	goto easy_perform_cleanup;
+    SSL_set_connect_state(ssl);
+
+    ctx->ssl = ssl;
+    return CURLE_OK;
+}
+
+/*
+ * Tells whether an SSL call has to wait for the socket, and for what
+ */
+static int murl_want(SessionHandle *ctx, int ssl_err)
+{
+    switch (ssl_err) {
+    case SSL_ERROR_WANT_READ:
+        ctx->want = POLLIN;
+        return 1;
+    case SSL_ERROR_WANT_WRITE:
+    case SSL_ERROR_WANT_CONNECT:
+        ctx->want = POLLOUT;
+        return 1;
+    default:
+        return 0;
     }
+}
+
+#define TBUF_MAX 1024
+#define READ_CHUNK_SZ 16384
+CURLcode murl_transfer_start(SessionHandle *ctx, int nonblock)
+{
+    char tbuf[TBUF_MAX];
+    int cl;
+    struct curl_slist *hdrs;
+    CURLcode crv;
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx->start);
+    ctx->http_status_code = 0;
+    ctx->recv_raw = 0;
+    ctx->sent = 0;
+    ctx->num_connects = 0;
+    ctx->t_connect = 0;
+    ctx->t_appconnect = 0;
+    ctx->t_starttransfer = 0;
+    ctx->t_total = 0;
+    ctx->nonblock = nonblock;
+    ctx->keep_alive = 0;
+    ctx->read_cnt = 0;
+    ctx->want = 0;
+    ctx->state = MURL_STATE_CONNECT;
 
     /*
-     * PSB requires we log the X509 distinguished name of the peer
+     * Allocate some space to build the HTTP request
      */
-    if (ctx->ssl_verify_peer) {
-	murl_log_peer_cert(ssl);
+    if (ctx->http_post && ctx->post_field_size) {
+        cl = ctx->post_field_size; 
+    } else if (ctx->http_post && ctx->post_fields) {
+        cl = strlen(ctx->post_fields); //FIXME: this is not safe
+    } else {
+        cl = 0;
+    }
+    if (cl > MURL_POST_MAX) {
+	fprintf(stderr, "POST data exceeds %d byte limit\n", MURL_POST_MAX);
+	return CURLE_FILESIZE_EXCEEDED;
+    }
+    ctx->body_len = cl;
+    /* The body is sent from the user's buffer */
+    ctx->req_buf = calloc(1, MURL_HDR_MAX);
+    if (!ctx->req_buf) {
+        fprintf(stderr, "calloc failed.\n");
+        return CURLE_OUT_OF_MEMORY;
     }
 
+    /*
+     * Split the URL into it's parts
+     */
+    crv = parseurl(ctx);
+    if (crv != CURLE_OK) return crv;
+
     /*
      * Build HTTP request
      */
     memset(tbuf, 0, sizeof(tbuf));
-    snprintf(tbuf, TBUF_MAX, "%s %s HTTP/1.0\r\n"
+    snprintf(tbuf, TBUF_MAX, "%s %s HTTP/1.1\r\n"
             "Host: %s:%d\r\n"
             "User-Agent: %s\r\n",
             (ctx->http_post ? "POST" : "GET"),
             ctx->path_segment, ctx->host_name, ctx->server_port,
             (ctx->user_agent ? ctx->user_agent : "Murl"));
-    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+    strcat(ctx->req_buf, tbuf); //FIXME: safe string handling needed
 
     /*
      * Add any custom headers requested by the user
@@ -817,115 +1082,282 @@ CURLcode curl_easy_perform(CURL *curl)
         while (hdrs) {
             memset(tbuf, 0, sizeof(tbuf));
             snprintf(tbuf, TBUF_MAX, "%s\r\n", hdrs->data);
-            strcat(rbuf, tbuf); //FIXME: safe string handling needed
+            strcat(ctx->req_buf, tbuf); //FIXME: safe string handling needed
             hdrs = hdrs->next;
         }
     }
 
+    /*
+     * Ask for a compressed response, an empty string stands for
+     * every encoding Murl can decode
+     */
+    if (ctx->accept_encoding) {
+        memset(tbuf, 0, sizeof(tbuf));
+        snprintf(tbuf, TBUF_MAX, "Accept-Encoding: %s\r\n",
+                 ctx->accept_encoding[0] ? ctx->accept_encoding : "gzip, deflate");
+        strcat(ctx->req_buf, tbuf); //FIXME: safe string handling needed
+    }
+
     /*
      * Set the Content-length header
      */
     memset(tbuf, 0, sizeof(tbuf));
     snprintf(tbuf, TBUF_MAX, "Content-Length: %d\r\n" "Accept: */*\r\n\r\n", cl);
-    strcat(rbuf, tbuf); //FIXME: safe string handling needed
+    strcat(ctx->req_buf, tbuf); //FIXME: safe string handling needed
+    ctx->req_len = strlen(ctx->req_buf);
 
     /*
-     * Send the HTTP request
+     * Reuse the connection of the previous request when it goes to
+     * the same server and the server hasn't closed it meanwhile
      */
-    SSL_write(ssl, rbuf, strlen(rbuf));
-    SSL_write(ssl, ctx->post_fields, cl);
+    if (ctx->ssl && (ctx->conn_port != ctx->server_port ||
+                     strncmp(ctx->conn_host, ctx->host_name, MURL_HOSTNAME_MAX) ||
+                     murl_connection_dead(ctx->ssl))) {
+        murl_close_connection(ctx);
+    }
+    if (ctx->ssl) {
+        murl_set_nonblock(SSL_get_fd(ctx->ssl), nonblock);
+    }
 
-    ERR_clear_error();
-    free(rbuf);
-    rbuf = NULL;
+    return CURLE_OK;
+}
 
-    /*
-     * Read the HTTP response
-     */
-    rv = 1;
-    while (rv) {
-	/*
-	 * Allocate some space to receive the response from the server
-	 */
-	rbuf = realloc(rbuf, read_cnt + READ_CHUNK_SZ);
-	if (!rbuf) {
-	    fprintf(stderr, "realloc failed (%s).\n", __FUNCTION__);
-	    crv = CURLE_OUT_OF_MEMORY;
-	    goto easy_perform_cleanup;
-	}
-	memset(rbuf+read_cnt, 0x0, READ_CHUNK_SZ);
-	
-	/*
-	 * Read the next chunk from the server
-	 */
-        rv = SSL_read(ssl, rbuf+read_cnt, READ_CHUNK_SZ);
-        if (rv <= 0) {
-            ssl_err = SSL_get_error(ssl, rv);
-            switch (ssl_err) {
-            case SSL_ERROR_NONE:
-            case SSL_ERROR_ZERO_RETURN:
-                //fprintf(stderr, "SSL_read finished\n");
+/*
+ * Moves the transfer along as far as the socket allows.  Returns
+ * CURLE_AGAIN with ctx->want set when it has to wait for the socket,
+ * which only happens to non-blocking transfers.
+ */
+CURLcode murl_transfer_step(SessionHandle *ctx)
+{
+    int rv;
+    int ssl_err;
+    char rbuf[READ_CHUNK_SZ];
+    unsigned long ossl_err;
+    CURLcode crv;
+
+    for (;;) {
+        switch (ctx->state) {
+        case MURL_STATE_CONNECT:
+            ctx->reused = (ctx->ssl != NULL);
+            if (ctx->reused) {
+                ctx->state = MURL_STATE_SEND;
                 break;
-            default:
-                ossl_err = ERR_get_error();
-                if ((rv < 0) || ossl_err) {
-                    fprintf(stderr, "SSL_read failed, rv=%d ssl_err=%d ossl_err=%d.\n",
-                            rv, ssl_err, (int)ossl_err);
-                    ERR_print_errors_fp(stderr);
-                    crv = CURLE_USE_SSL_FAILED;
-	            goto easy_perform_cleanup;
+            }
+            crv = murl_open_connection(ctx);
+            if (crv != CURLE_OK) return crv;
+            ctx->state = MURL_STATE_HANDSHAKE;
+            break;
+
+        case MURL_STATE_HANDSHAKE:
+            rv = SSL_connect(ctx->ssl);
+            if (rv <= 0) {
+                ssl_err = SSL_get_error(ctx->ssl, rv);
+                if (murl_want(ctx, ssl_err)) {
+                    /* Once TLS waits for the server, TCP is connected */
+                    if (ssl_err == SSL_ERROR_WANT_READ && !ctx->t_connect) {
+                        ctx->t_connect = elapsed_us(&ctx->start);
+                    }
+                    return CURLE_AGAIN;
+                }
+                fprintf(stderr, "TLS handshake failed.\n");
+                ERR_print_errors_fp(stderr);
+                murl_close_connection(ctx);
+                /* The session failed to resume or the server is gone */
+                if (ctx->ssl_session) {
+                    SSL_SESSION_free(ctx->ssl_session);
+                    ctx->ssl_session = NULL;
+                }
+                return CURLE_SSL_CONNECT_ERROR;
+            }
+            if (!ctx->t_connect) {
+                ctx->t_connect = elapsed_us(&ctx->start);
+            }
+            ctx->t_appconnect = elapsed_us(&ctx->start);
+
+            /*
+             * PSB requires we log the X509 distinguished name of the peer
+             */
+            if (ctx->ssl_verify_peer) {
+                murl_log_peer_cert(ctx->ssl);
+            }
+            ctx->state = MURL_STATE_SEND;
+            break;
+
+        case MURL_STATE_SEND:
+        case MURL_STATE_SEND_BODY:
+            /*
+             * Send the HTTP request.  A kept connection the server closed
+             * just now fails here or before anything was read, the request
+             * is then sent once more over a new connection.  OpenSSL wants
+             * a write that has to wait repeated with the same arguments.
+             */
+            if (ctx->state == MURL_STATE_SEND) {
+                rv = SSL_write(ctx->ssl, ctx->req_buf, ctx->req_len);
+            } else {
+                rv = SSL_write(ctx->ssl, ctx->post_fields, ctx->body_len);
+            }
+            if (rv <= 0) {
+                ssl_err = SSL_get_error(ctx->ssl, rv);
+                if (murl_want(ctx, ssl_err)) return CURLE_AGAIN;
+                murl_close_connection(ctx);
+                if (ctx->reused) {
+                    ctx->state = MURL_STATE_CONNECT;
+                    break;
                 }
+                fprintf(stderr, "SSL_write failed.\n");
+                ERR_print_errors_fp(stderr);
+                return CURLE_SEND_ERROR;
+            }
+            if (ctx->state == MURL_STATE_SEND && ctx->body_len) {
+                ctx->state = MURL_STATE_SEND_BODY;
                 break;
             }
+            ctx->sent = ctx->body_len;
+            ERR_clear_error();
+
+            ctx->parser = murl_http_response_init(ctx);
+            if (!ctx->parser) return CURLE_OUT_OF_MEMORY;
+            ctx->read_cnt = 0;
+            ctx->state = MURL_STATE_RECV;
+            break;
+
+        case MURL_STATE_RECV:
+            /*
+             * Read the HTTP response until the parser found its end, from the
+             * Content-Length or the chunked encoding, or the server closed
+             * the connection.  The parser passes the body to the write
+             * callback as it arrives.
+             */
+            rv = SSL_read(ctx->ssl, rbuf, READ_CHUNK_SZ);
+            if (rv <= 0) {
+                ssl_err = SSL_get_error(ctx->ssl, rv);
+                if (murl_want(ctx, ssl_err)) return CURLE_AGAIN;
+                ossl_err = ERR_get_error();
+                if (!ctx->read_cnt && ctx->reused) {
+                    murl_http_response_free(ctx->parser);
+                    ctx->parser = NULL;
+                    murl_close_connection(ctx);
+                    ctx->state = MURL_STATE_CONNECT;
+                    break;
+                }
+                switch (ssl_err) {
+                case SSL_ERROR_NONE:
+                case SSL_ERROR_ZERO_RETURN:
+                    break;
+                default:
+                    if ((rv < 0) || ossl_err) {
+                        fprintf(stderr, "SSL_read failed, rv=%d ssl_err=%d ossl_err=%d.\n",
+                                rv, ssl_err, (int)ossl_err);
+                        ERR_print_errors_fp(stderr);
+                        return CURLE_USE_SSL_FAILED;
+                    }
+                    break;
+                }
+                rv = 0;
+            }
+            if (rv > 0 && !ctx->t_starttransfer) {
+                ctx->t_starttransfer = elapsed_us(&ctx->start);
+            }
+            ctx->read_cnt += rv;
+
+            /*
+             * Make sure we're not receving too much data from the server.
+             */
+            if (ctx->read_cnt > MURL_RCV_MAX) {
+                return CURLE_FILESIZE_EXCEEDED;
+            }
+
+            rv = murl_http_response_parse(ctx->parser, rbuf, rv);
+            if (rv == MURL_HTTP_WRITE_ERROR) return CURLE_WRITE_ERROR;
+            if (rv == MURL_HTTP_ERROR) return CURLE_HTTP2;
+            if (rv == MURL_HTTP_DONE) {
+                ctx->keep_alive = murl_http_response_keep_alive(ctx->parser);
+                ctx->state = MURL_STATE_DONE;
+            }
+            break;
+
+        case MURL_STATE_DONE:
+            return CURLE_OK;
+
+        default:
+            return CURLE_FAILED_INIT;
         }
-        read_cnt += rv;
-	
-	/*
-	 * Make sure we're not receving too much data from the server.
-	 */
-	if (read_cnt > MURL_RCV_MAX) {
-	    crv = CURLE_FILESIZE_EXCEEDED;
-	    goto easy_perform_cleanup;
-	}
     }
+}
 
+void murl_transfer_done(SessionHandle *ctx, CURLcode crv)
+{
+    ctx->t_total = elapsed_us(&ctx->start);
     /*
-     * make sure the data is null terminated
-     */
-    rbuf[read_cnt] = 0;
-
-    /*
-     * Parse the HTTP response
+     * Only a connection that completed a response the server didn't
+     * mark as the last one is good for the next request
      */
-    if (murl_http_parse_response(ctx, rbuf)) {
-        crv = CURLE_HTTP2;
-	goto easy_perform_cleanup;
+    if (crv != CURLE_OK || !ctx->keep_alive) {
+        murl_close_connection(ctx);
+    }
+    murl_http_response_free(ctx->parser);
+    ctx->parser = NULL;
+    if (ctx->req_buf) {
+        free(ctx->req_buf);
+        ctx->req_buf = NULL;
     }
+    ctx->state = MURL_STATE_IDLE;
+}
 
-    /*
-     * Send the data back to the user
-     */
-    if (ctx->write_func) {
-        (ctx->write_func)(ctx->recv_buf, 1, ctx->recv_ctr, ctx->write_ctx);
+CURLcode curl_easy_perform(CURL *curl)
+{
+    SessionHandle *ctx = (SessionHandle*)curl;
+    struct pollfd pfd;
+    CURLcode crv;
+    murl_sigpipe sp;
+
+    if (!ctx) {
+	return CURLE_UNKNOWN_OPTION;
+    }
+    if (ctx->multi) {
+        /* The transfers of the handle are run by the multi handle */
+        return CURLE_FAILED_INIT;
     }
 
-    crv = CURLE_OK;
-easy_perform_cleanup:
-    if (ssl) {
-	SSL_shutdown(ssl);
-	SSL_free(ssl);
+    murl_sigpipe_block(&sp);
+    crv = murl_transfer_start(ctx, 0);
+    while (crv == CURLE_OK) {
+        crv = murl_transfer_step(ctx);
+        if (crv != CURLE_AGAIN) break;
+        /* Blocking sockets only get here when OpenSSL retries itself */
+        pfd.fd = SSL_get_fd(ctx->ssl);
+        pfd.events = ctx->want;
+        pfd.revents = 0;
+        poll(&pfd, 1, -1);
+        crv = CURLE_OK;
     }
-    if (ssl_ctx) SSL_CTX_free(ssl_ctx);
-    if (rbuf) free(rbuf);
+    murl_transfer_done(ctx, crv);
+    murl_sigpipe_restore(&sp);
     return crv;
 }
 
+static CURLcode getinfo_char(SessionHandle *data, CURLINFO info, char **param_charp)
+{
+    switch (info) {
+    case CURLINFO_PRIVATE:
+        *param_charp = (char *)data->private_data;
+        break;
+    default:
+        return CURLE_BAD_FUNCTION_ARGUMENT;
+    }
+
+    return CURLE_OK;
+}
+
 static CURLcode getinfo_long(SessionHandle *data, CURLINFO info, long *param_longp)
 {
     switch (info) {
     case CURLINFO_RESPONSE_CODE:
         *param_longp = data->http_status_code;
         break;
+    case CURLINFO_NUM_CONNECTS:
+        *param_longp = data->num_connects;
+        break;
     default:
         return CURLE_BAD_FUNCTION_ARGUMENT;
     }
@@ -934,12 +1366,46 @@ static CURLcode getinfo_long(SessionHandle *data, CURLINFO info, long *param_lon
 }
 
 
+static CURLcode getinfo_offt(SessionHandle *data, CURLINFO info, curl_off_t *param_offt)
+{
+    switch (info) {
+    case CURLINFO_SIZE_DOWNLOAD_T:
+        *param_offt = data->recv_raw;
+        break;
+    case CURLINFO_SIZE_UPLOAD_T:
+        *param_offt = data->sent;
+        break;
+    case CURLINFO_NAMELOOKUP_TIME_T:
+        /* resolved by BIO_do_connect(), so it is part of the connect time */
+        *param_offt = 0;
+        break;
+    case CURLINFO_CONNECT_TIME_T:
+        *param_offt = data->t_connect;
+        break;
+    case CURLINFO_APPCONNECT_TIME_T:
+    case CURLINFO_PRETRANSFER_TIME_T:
+        *param_offt = data->t_appconnect;
+        break;
+    case CURLINFO_STARTTRANSFER_TIME_T:
+        *param_offt = data->t_starttransfer;
+        break;
+    case CURLINFO_TOTAL_TIME_T:
+        *param_offt = data->t_total;
+        break;
+    default:
+        return CURLE_BAD_FUNCTION_ARGUMENT;
+    }
+
+    return CURLE_OK;
+}
+
 static CURLcode Curl_getinfo(SessionHandle *data, CURLINFO info, ...)
 {
     va_list arg;
     long *param_longp = NULL;
+    curl_off_t *param_offt = NULL;
     //double *param_doublep = NULL;
-    //char **param_charp = NULL;
+    char **param_charp = NULL;
     //struct curl_slist **param_slistp = NULL;
     int type;
     /* default return code is to error out! */
@@ -952,18 +1418,21 @@ static CURLcode Curl_getinfo(SessionHandle *data, CURLINFO info, ...)
 
     type = CURLINFO_TYPEMASK & (int)info;
     switch (type) {
-#if 0
     case CURLINFO_STRING:
         param_charp = va_arg(arg, char **);
         if (param_charp)
             result = getinfo_char(data, info, param_charp);
         break;
-#endif
     case CURLINFO_LONG:
         param_longp = va_arg(arg, long *);
         if (param_longp)
             result = getinfo_long(data, info, param_longp);
         break;
+    case CURLINFO_OFF_T:
+        param_offt = va_arg(arg, curl_off_t *);
+        if (param_offt)
+            result = getinfo_offt(data, info, param_offt);
+        break;
 #if 0
     case CURLINFO_DOUBLE:
         param_doublep = va_arg(arg, double *);
@@ -1116,15 +1585,16 @@ void curl_easy_cleanup(CURL *curl)
 {
     SessionHandle *data = (SessionHandle*)curl;
 
+    if (data->multi) curl_multi_remove_handle(data->multi, data);
     if (data->user_agent) free(data->user_agent);
     if (data->url) free(data->url);
-    if (data->post_fields) free(data->post_fields);
+    if (data->accept_encoding) free(data->accept_encoding);
     if (data->ca_file) free(data->ca_file);
     if (data->ssl_cert_file) free(data->ssl_cert_file);
     if (data->ssl_cert_type) free(data->ssl_cert_type);
     if (data->ssl_key_file) free(data->ssl_key_file);
     if (data->ssl_key_type) free(data->ssl_key_type);
-    if (data->recv_buf) free(data->recv_buf);
+    murl_tls_reset(data);
     //if (data->headers) curl_slist_free_all(data->headers);
 
     free(data);
@@ -293,6 +293,9 @@ typedef enum {
 
     CINIT(HEADERFUNCTION, FUNCTIONPOINT, 79),
 
+    /* Set the HTTP request method back to GET */
+    CINIT(HTTPGET, LONG, 80),
+
     /* Set if we should verify the Common name from the peer certificate in ssl
      * handshake, set 1 to check existence, 2 to ensure that it matches the
      * provided hostname. */
@@ -307,6 +310,12 @@ typedef enum {
     /* type of the file keeping your private SSL-key ("DER", "PEM", "ENG") */
     CINIT(SSLKEYTYPE, OBJECTPOINT, 88),
 
+    /* Set the Accept-Encoding string, "" asks for every supported encoding */
+    CINIT(ACCEPT_ENCODING, OBJECTPOINT, 102),
+
+    /* Data passed back by CURLINFO_PRIVATE */
+    CINIT(PRIVATE, OBJECTPOINT, 103),
+
     /* The _LARGE version of the standard POSTFIELDSIZE option */
     CINIT(POSTFIELDSIZE_LARGE, OFF_T, 120),
 
@@ -331,6 +340,7 @@ typedef enum {
 #define CURLINFO_LONG     0x200000
 #define CURLINFO_DOUBLE   0x300000
 #define CURLINFO_SLIST    0x400000
+#define CURLINFO_OFF_T    0x600000
 #define CURLINFO_MASK     0x0fffff
 #define CURLINFO_TYPEMASK 0xf00000
 
@@ -379,6 +389,14 @@ typedef enum {
     CURLINFO_LOCAL_IP = CURLINFO_STRING + 41,
     CURLINFO_LOCAL_PORT = CURLINFO_LONG   + 42,
     CURLINFO_TLS_SESSION = CURLINFO_SLIST  + 43,
+    CURLINFO_SIZE_UPLOAD_T = CURLINFO_OFF_T + 7,
+    CURLINFO_SIZE_DOWNLOAD_T = CURLINFO_OFF_T + 8,
+    CURLINFO_TOTAL_TIME_T = CURLINFO_OFF_T + 50,
+    CURLINFO_NAMELOOKUP_TIME_T = CURLINFO_OFF_T + 51,
+    CURLINFO_CONNECT_TIME_T = CURLINFO_OFF_T + 52,
+    CURLINFO_PRETRANSFER_TIME_T = CURLINFO_OFF_T + 53,
+    CURLINFO_STARTTRANSFER_TIME_T = CURLINFO_OFF_T + 54,
+    CURLINFO_APPCONNECT_TIME_T = CURLINFO_OFF_T + 56,
     /* Fill in new entries below here! */
 
     CURLINFO_LASTONE = 43
@@ -419,6 +437,58 @@ typedef size_t (*curl_write_callback)(char *buffer,
                                       size_t nitems,
                                       void *outstream);
 
+/*
+ * The multi interface runs several transfers at once on one thread
+ */
+typedef void CURLM;
+
+typedef enum {
+    CURLM_CALL_MULTI_PERFORM = -1, /* please call curl_multi_perform() soon */
+    CURLM_OK,
+    CURLM_BAD_HANDLE,      /* the passed-in handle is not a valid CURLM handle */
+    CURLM_BAD_EASY_HANDLE, /* an easy handle was not good/valid */
+    CURLM_OUT_OF_MEMORY,   /* if you ever get this, you're in deep sh*t */
+    CURLM_INTERNAL_ERROR,  /* this is a libcurl bug */
+    CURLM_BAD_SOCKET,      /* the passed in socket argument did not match */
+    CURLM_UNKNOWN_OPTION,  /* curl_multi_setopt() with unsupported option */
+    CURLM_ADDED_ALREADY,   /* an easy handle already added to a multi handle was
+                              attempted to get added - again */
+    CURLM_LAST
+} CURLMcode;
+
+typedef enum {
+    CURLMSG_NONE, /* first, not used */
+    CURLMSG_DONE, /* This easy handle has completed. 'result' contains
+                     the CURLcode of the transfer */
+    CURLMSG_LAST  /* last, not used */
+} CURLMSG;
+
+struct CURLMsg {
+    CURLMSG msg;       /* what this message means */
+    CURL *easy_handle; /* the handle it concerns */
+    union {
+        void *whatever;  /* message-specific data */
+        CURLcode result; /* return code for transfer */
+    } data;
+};
+typedef struct CURLMsg CURLMsg;
+
+struct curl_waitfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+CURL_EXTERN CURLM *curl_multi_init(void);
+CURL_EXTERN CURLMcode curl_multi_add_handle(CURLM *multi_handle, CURL *curl_handle);
+CURL_EXTERN CURLMcode curl_multi_remove_handle(CURLM *multi_handle, CURL *curl_handle);
+CURL_EXTERN CURLMcode curl_multi_perform(CURLM *multi_handle, int *running_handles);
+CURL_EXTERN CURLMcode curl_multi_wait(CURLM *multi_handle, struct curl_waitfd extra_fds[],
+                                      unsigned int extra_nfds, int timeout_ms, int *ret);
+CURL_EXTERN CURLMsg *curl_multi_info_read(CURLM *multi_handle, int *msgs_in_queue);
+CURL_EXTERN CURLMcode curl_multi_cleanup(CURLM *multi_handle);
+CURL_EXTERN const char *curl_multi_strerror(CURLMcode error);
+
 
 #ifdef  __cplusplus
 }
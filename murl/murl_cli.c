@@ -33,7 +33,7 @@ static size_t http_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
         return 0;
     }
 
-    printf("%s", (char *)ptr);
+    fwrite(ptr, 1, nmemb, stdout);
 
     return nmemb;
 }
@@ -51,6 +51,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <zlib.h>
 #include "murl_lcl.h"
 #include "http_parser.h"
 
@@ -61,7 +63,8 @@
 //       use cases.
 #define MAX_HEADERS 64
 #define MAX_ELEMENT_SIZE 64*1024
-#define MAX_BODY_SIZE 64*1024*1024
+/* Size of the buffer a compressed body is decoded into */
+#define INFLATE_CHUNK_SZ 16384
 
 /*
  * Using this global variable to track when all the HTTP data has been 
@@ -80,7 +83,6 @@ typedef struct message {
     char request_url[MAX_ELEMENT_SIZE];
     char fragment[MAX_ELEMENT_SIZE];
     char query_string[MAX_ELEMENT_SIZE];
-    char body[MAX_BODY_SIZE];
     size_t body_size;
     int num_headers;
     enum { NONE=0, FIELD, VALUE } last_header_element;
@@ -96,8 +98,17 @@ typedef struct message {
     int headers_complete_cb_called;
     int message_complete_cb_called;
     int message_complete_on_eof;
+
+    SessionHandle *ctx;  /* receives the body as it is parsed */
+    z_stream zs;  /* decodes a compressed body */
+    int inflating;
+    int inflate_done;
+    int failed;  /* the parser ignores errors returned by on_body */
+    int write_failed;
 } http_msg;
 
+static const char *murl_http_header (http_msg *msg, const char *name);
+
 int request_path_cb (http_parser *p, const char *buf, size_t len)
 {
     http_msg *msg = p->data;
@@ -189,17 +200,83 @@ int header_value_cb (http_parser *p, const char *buf, size_t len)
     return 0;
 }
 
+/*
+ * Passes decoded body bytes to the write callback of the handle.
+ *
+ * Returns 0 on success, non-zero on error.
+ */
+static int murl_http_deliver (http_msg *msg, const char *buf, size_t len)
+{
+    SessionHandle *ctx = msg->ctx;
+
+    if (!len) {
+        return 0;
+    }
+    if (ctx->recv_ctr + len > MURL_RCV_MAX) {
+        fprintf(stderr, "Maximum HTTP body size exceeded\n");
+        return 1;
+    }
+    ctx->recv_ctr += len;
+    if (ctx->write_func &&
+        (ctx->write_func)((char *)buf, 1, len, ctx->write_ctx) != len) {
+        msg->write_failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Decodes the next piece of a gzip or deflate encoded body and passes
+ * the result to the write callback.
+ *
+ * Returns 0 on success, non-zero on error.
+ */
+static int murl_http_inflate (http_msg *msg, const char *body, size_t len)
+{
+    char out[INFLATE_CHUNK_SZ];
+    int rv;
+
+    /* Anything after the end of the compressed stream is ignored */
+    if (msg->inflate_done) {
+        return 0;
+    }
+    msg->zs.next_in = (unsigned char *)body;
+    msg->zs.avail_in = len;
+    do {
+        msg->zs.next_out = (unsigned char *)out;
+        msg->zs.avail_out = sizeof(out);
+        rv = inflate(&msg->zs, Z_NO_FLUSH);
+        if (rv != Z_OK && rv != Z_STREAM_END && rv != Z_BUF_ERROR) {
+            fprintf(stderr, "Failed to decode HTTP body, rv=%d\n", rv);
+            return 1;
+        }
+        if (murl_http_deliver(msg, out, sizeof(out) - msg->zs.avail_out)) {
+            return 1;
+        }
+        if (rv == Z_STREAM_END) {
+            msg->inflate_done = 1;
+            break;
+        }
+    } while (msg->zs.avail_out == 0);
+
+    return 0;
+}
+
 int body_cb (http_parser *p, const char *buf, size_t len)
 {
     http_msg *msg = p->data;
 
-    if (msg->body_size + len >= MAX_BODY_SIZE) {
-        fprintf(stderr, "Maximum HTTP body size exceeded\n");
+    if (msg->failed) {
         return -1;
     }
-    strncat(msg->body, buf, len);
     msg->body_size += len;
-    return 0;
+    msg->ctx->recv_raw += len;
+    if (msg->inflating) {
+        msg->failed = murl_http_inflate(msg, buf, len);
+    } else {
+        msg->failed = murl_http_deliver(msg, buf, len);
+    }
+    return msg->failed ? -1 : 0;
 }
 
 int count_body_cb (http_parser *p, const char *buf, size_t len)
@@ -221,6 +298,7 @@ int message_begin_cb (http_parser *p)
 int headers_complete_cb (http_parser *p)
 {
     http_msg *msg = p->data;
+    const char *encoding;
 
     msg->method = p->method;
     msg->status_code = p->status_code;
@@ -228,6 +306,29 @@ int headers_complete_cb (http_parser *p)
     msg->http_minor = p->http_minor;
     msg->headers_complete_cb_called = 1;
     msg->should_keep_alive = http_should_keep_alive(p);
+
+    /*
+     * The status is known before the body, like with Curl
+     */
+    msg->ctx->http_status_code = p->status_code;
+
+    /*
+     * Set up decoding of a compressed body
+     */
+    encoding = murl_http_header(msg, "Content-Encoding");
+    if (encoding && strcasecmp(encoding, "identity")) {
+        if (strcasecmp(encoding, "gzip") && strcasecmp(encoding, "x-gzip") &&
+            strcasecmp(encoding, "deflate")) {
+            fprintf(stderr, "Unsupported content encoding: %s\n", encoding);
+            return -1;
+        }
+        /* 32 added to the window bits accepts both gzip and zlib headers */
+        if (inflateInit2(&msg->zs, 15 + 32) != Z_OK) {
+            fprintf(stderr, "inflateInit2 failed (%s)\n", __FUNCTION__);
+            return -1;
+        }
+        msg->inflating = 1;
+    }
     return 0;
 }
 
@@ -293,82 +394,110 @@ size_t murl_http_parse (http_parser *parser, const char *buf, size_t len)
 }
 
 /*
- * This routine will perform HTTP parsing on the data provided.
+ * Returns the value of a response header, or NULL when the
+ * server did not send it.
+ */
+static const char *murl_http_header (http_msg *msg, const char *name)
+{
+    int i;
+
+    for (i = 0; i < msg->num_headers; i++) {
+        if (!strcasecmp(msg->headers[i][0], name)) {
+            return msg->headers[i][1];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Starts parsing an HTTP response, the body is passed to the write
+ * callback of the Murl context as it is parsed.
  *
- * Returns 0 on success, non-zero on error.
+ * Returns the parser, or NULL when out of memory.
  */
-int murl_http_parse_response (SessionHandle *ctx, const char *buf)
+http_parser *murl_http_response_init (SessionHandle *ctx)
 {
-    size_t parsed;
-    int rv;
-    int len;
     http_parser *parser;
     http_msg *msg;
 
     msg = calloc(1, sizeof(http_msg));
     if (!msg) {
         fprintf(stderr, "malloc failed (%s)\n", __FUNCTION__);
-	return 1;
+	return NULL;
     }
+    msg->ctx = ctx;
 
-    /*
-     * Initialize the parser
-     */
     parser = murl_http_parser_init(HTTP_RESPONSE, msg);
     if (!parser) {
         fprintf(stderr, "murl_http_parser_init failed (%s)\n", __FUNCTION__);
 	free(msg);
-	return 1;
+	return NULL;
     }
+    ctx->recv_ctr = 0;
+    ctx->recv_raw = 0;
+    return parser;
+}
 
-    /*
-     * Parse the data
-     */
-    parsed = murl_http_parse(parser, buf, strlen(buf));
-
-    /*
-     * check that all of it was parsed
-     */
-    rv = (parsed == strlen(buf));
-    parsed = murl_http_parse(parser, NULL, 0);
-    rv &= (parsed == 0);
+/*
+ * Releases the parser of a response.
+ */
+void murl_http_response_free (http_parser *parser)
+{
+    http_msg *msg;
 
-    /*
-     * Save the HTTP status code sent by the server
-     */
-    ctx->http_status_code = parser->status_code;
+    if (!parser) return;
+    msg = parser->data;
+    if (msg->inflating) {
+        inflateEnd(&msg->zs);
+    }
+    free(msg);
     murl_http_parser_free(parser);
+}
 
-    if (!rv) {
-        fprintf(stderr, "HTTP parsing failed\n");
-	free(msg);
-        return 1;
-    }
+/*
+ * Feeds the next bytes received from the server to the parser.  A zero
+ * length tells the parser the server closed the connection, which ends
+ * a response that has neither a Content-Length nor chunked encoding.
+ *
+ * Returns MURL_HTTP_DONE once the whole response was parsed and
+ * MURL_HTTP_MORE when more data is needed.  MURL_HTTP_WRITE_ERROR
+ * tells the write callback stopped the transfer, MURL_HTTP_ERROR
+ * any other error.
+ */
+int murl_http_response_parse (http_parser *parser, const char *buf, size_t len)
+{
+    http_msg *msg = parser->data;
+    size_t parsed;
 
-    len = msg->body_size;
-    if (ctx->recv_buf) {
-	free(ctx->recv_buf); 
-	ctx->recv_buf = NULL;
-	ctx->recv_ctr = 0;
+    parsed = murl_http_parse(parser, buf, len);
+    if (msg->write_failed) {
+        return MURL_HTTP_WRITE_ERROR;
     }
-    ctx->recv_buf = calloc(1, len+1);
-    if (!ctx->recv_buf) {
-        fprintf(stderr, "\nmalloc failed in curl write reg func\n");
-	free(msg);
-        return 1;
+    if (msg->failed) {
+        return MURL_HTTP_ERROR;
     }
-
-    /*
-     * Copy the data to the Murl context
-     */
-    memcpy(ctx->recv_buf, msg->body, len);
-    ctx->recv_buf[len] = 0;
-    ctx->recv_ctr += len;
-    free(msg);
-
-    return 0;
+    if (msg->message_complete_cb_called) {
+        if (msg->inflating && !msg->inflate_done) {
+            fprintf(stderr, "Compressed HTTP body is truncated\n");
+            return MURL_HTTP_ERROR;
+        }
+        return MURL_HTTP_DONE;
+    }
+    if (parsed != len || !len) {
+        fprintf(stderr, "HTTP parsing failed\n");
+        return MURL_HTTP_ERROR;
+    }
+    return MURL_HTTP_MORE;
 }
 
+/*
+ * Tells whether the server allows the connection of a completely
+ * parsed response to be used for the next request.
+ */
+int murl_http_response_keep_alive (http_parser *parser)
+{
+    http_msg *msg = parser->data;
 
-
+    return msg->should_keep_alive;
+}
 
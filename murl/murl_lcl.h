@@ -29,8 +29,11 @@ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 extern "C" {
 #endif
 
+#include <time.h>
+#include <signal.h>
 #include <openssl/ssl.h>
 #include "murl.h"
+#include "http_parser.h"
 
 /* Maximum size of data that can be in HTTP POST */
 #define MURL_POST_MAX	64*1024*1024
@@ -40,6 +43,17 @@ extern "C" {
 
 #define MURL_HOSTNAME_MAX   256
 
+/* Where a transfer is, see murl_transfer_step() */
+#define MURL_STATE_IDLE         0  /* no transfer in progress */
+#define MURL_STATE_CONNECT      1
+#define MURL_STATE_HANDSHAKE    2
+#define MURL_STATE_SEND         3  /* request line and headers */
+#define MURL_STATE_SEND_BODY    4
+#define MURL_STATE_RECV         5
+#define MURL_STATE_DONE         6
+
+struct Curl_multi_;
+
 /*
  * Local murl context for a session
  */
@@ -50,6 +64,7 @@ typedef struct SessionHandle_ {
     int			    http_post; /* 1 to do POST, zero for GET */
     char		    *post_fields;
     int			    post_field_size;
+    char		    *accept_encoding; /* NULL to ask for an unencoded response */
     char		    *ca_file;
     int			    ssl_verify_peer; /* 1 to verify, zero to skip verification at SSL layer */
     int			    ssl_verify_hostname; /* 1 to verify server hostname against certfication */
@@ -62,18 +77,84 @@ typedef struct SessionHandle_ {
     struct curl_slist	    *headers;
     curl_write_callback	    write_func;
 
-    SSL	*ssl;
+    SSL_CTX		*ssl_ctx;  /* built from the TLS options by the first connection */
+    SSL_SESSION		*ssl_session;  /* of the last connection, resumed by the next one */
+    SSL	*ssl;  /* connection kept open for the next request, or NULL */
+    char		conn_host[MURL_HOSTNAME_MAX];  /* server the connection goes to */
+    int			conn_port;
 
     /* The following members are for HTTP parsing */
     int			http_status_code;  /* HTTP response from server */
-    char		*recv_buf;
-    int			recv_ctr;
+    int			num_connects;  /* new connections made by the last perform */
+    int			recv_ctr;  /* body bytes passed to write_func */
+    int			recv_raw;  /* body bytes received, before content decoding */
+    int			sent;  /* body bytes sent */
+
+    /* Timings of the last perform, in microseconds from its start */
+    curl_off_t		t_connect;
+    curl_off_t		t_appconnect;
+    curl_off_t		t_starttransfer;
+    curl_off_t		t_total;
     char		path_segment[256]; //FIXME: use a pointer
     char		host_name[MURL_HOSTNAME_MAX]; //FIXME: use a pointer
     int			server_port;
+
+    /* The following members are for the transfer in progress */
+    int			state;  /* MURL_STATE_* */
+    int			nonblock;  /* driven by a multi handle */
+    int			reused;  /* the request went out on a kept connection */
+    int			keep_alive;  /* the server keeps the connection open */
+    int			read_cnt;  /* response bytes read */
+    char		*req_buf;  /* request line and headers */
+    int			req_len;
+    int			body_len;
+    http_parser		*parser;
+    struct timespec	start;
+    short		want;  /* POLLIN or POLLOUT when a step returns CURLE_AGAIN */
+
+    /* The following members are for the multi interface */
+    void		*private_data;  /* CURLOPT_PRIVATE */
+    struct Curl_multi_	*multi;  /* the multi handle it was added to */
+    struct SessionHandle_ *multi_next;
+    int			sock;  /* socket watched by the multi handle, or -1 */
+    unsigned int	sock_events;
+    int			msg_pending;  /* msg waits for curl_multi_info_read() */
+    CURLMsg		msg;
 } SessionHandle;
 
-int murl_http_parse_response(SessionHandle *ctx, const char *buf);
+/*
+ * A transfer is started by murl_transfer_start() and moved along by
+ * murl_transfer_step() until that stops returning CURLE_AGAIN.
+ * murl_transfer_done() ends it whatever the outcome.
+ */
+CURLcode murl_transfer_start(SessionHandle *ctx, int nonblock);
+CURLcode murl_transfer_step(SessionHandle *ctx);
+void murl_transfer_done(SessionHandle *ctx, CURLcode crv);
+
+/*
+ * Writing to a connection the server has closed raises SIGPIPE, see
+ * murl_sigpipe_block()
+ */
+typedef struct murl_sigpipe_ {
+    sigset_t old_set;
+    int was_pending;
+} murl_sigpipe;
+
+void murl_sigpipe_block(murl_sigpipe *sp);
+void murl_sigpipe_restore(murl_sigpipe *sp);
+
+void murl_multi_unwatch(SessionHandle *ctx);
+
+/* Results of murl_http_response_parse() */
+#define MURL_HTTP_MORE          0
+#define MURL_HTTP_DONE          1
+#define MURL_HTTP_ERROR         -1
+#define MURL_HTTP_WRITE_ERROR   -2
+
+http_parser *murl_http_response_init(SessionHandle *ctx);
+int murl_http_response_parse(http_parser *parser, const char *buf, size_t len);
+int murl_http_response_keep_alive(http_parser *parser);
+void murl_http_response_free(http_parser *parser);
 
 #ifdef  __cplusplus
 }
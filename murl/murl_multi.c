@@ -0,0 +1,319 @@
+/*
+   Copyright (c) 2018, Cisco Systems, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification,
+   are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+   USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * The multi interface of Murl.  Every transfer added to a multi handle
+ * runs on a non-blocking socket and is moved along by
+ * curl_multi_perform().  The sockets the transfers wait on are watched
+ * with epoll, curl_multi_wait() sleeps until one of them is ready.
+ * Host names are still resolved with blocking calls when a transfer
+ * opens its connection.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <openssl/ssl.h>
+#include "murl.h"
+#include "murl_lcl.h"
+
+#define MURL_MULTI_EVENTS 64
+
+typedef struct Curl_multi_ {
+    int			epfd;
+    SessionHandle	*easy;  /* handles added, oldest first */
+} Curl_multi;
+
+CURLM *curl_multi_init(void)
+{
+    Curl_multi *m;
+
+    m = calloc(1, sizeof(Curl_multi));
+    if (!m) {
+        return NULL;
+    }
+    m->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m->epfd < 0) {
+        fprintf(stderr, "epoll_create1 failed: %s\n", strerror(errno));
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+/*
+ * Stops watching the socket of a handle.  Called before its
+ * connection is closed, or when the transfer no longer waits.
+ */
+void murl_multi_unwatch(SessionHandle *ctx)
+{
+    if (!ctx->multi || ctx->sock < 0) return;
+    epoll_ctl(ctx->multi->epfd, EPOLL_CTL_DEL, ctx->sock, NULL);
+    ctx->sock = -1;
+    ctx->sock_events = 0;
+}
+
+/*
+ * Watches the socket of a transfer for what the transfer waits on
+ */
+static int murl_multi_watch(Curl_multi *m, SessionHandle *ctx)
+{
+    struct epoll_event ev;
+    int sock = SSL_get_fd(ctx->ssl);
+    int op;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (ctx->want == POLLOUT) ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = ctx;
+    if (sock == ctx->sock && ev.events == ctx->sock_events) return 0;
+
+    if (ctx->sock >= 0 && ctx->sock != sock) {
+        murl_multi_unwatch(ctx);
+    }
+    op = (ctx->sock == sock) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(m->epfd, op, sock, &ev) < 0) {
+        fprintf(stderr, "epoll_ctl failed: %s\n", strerror(errno));
+        return -1;
+    }
+    ctx->sock = sock;
+    ctx->sock_events = ev.events;
+    return 0;
+}
+
+/*
+ * Ends a transfer and queues its message for curl_multi_info_read()
+ */
+static void murl_multi_done(SessionHandle *ctx, CURLcode crv)
+{
+    murl_multi_unwatch(ctx);
+    murl_transfer_done(ctx, crv);
+    ctx->msg.msg = CURLMSG_DONE;
+    ctx->msg.easy_handle = ctx;
+    ctx->msg.data.result = crv;
+    ctx->msg_pending = 1;
+}
+
+/*
+ * Adds a handle and starts its transfer.  The options of the handle
+ * must not change until the transfer is done.
+ */
+CURLMcode curl_multi_add_handle(CURLM *multi_handle, CURL *curl_handle)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+    SessionHandle *ctx = (SessionHandle *)curl_handle;
+    SessionHandle **pos;
+    CURLcode crv;
+
+    if (!m) return CURLM_BAD_HANDLE;
+    if (!ctx) return CURLM_BAD_EASY_HANDLE;
+    if (ctx->multi) return CURLM_ADDED_ALREADY;
+
+    for (pos = &m->easy; *pos; pos = &(*pos)->multi_next);
+    *pos = ctx;
+    ctx->multi_next = NULL;
+    ctx->multi = m;
+    ctx->sock = -1;
+    ctx->sock_events = 0;
+    ctx->msg_pending = 0;
+
+    crv = murl_transfer_start(ctx, 1);
+    if (crv != CURLE_OK) {
+        murl_multi_done(ctx, crv);
+    }
+    return CURLM_OK;
+}
+
+/*
+ * Removes a handle, a transfer still in progress is abandoned along
+ * with its connection
+ */
+CURLMcode curl_multi_remove_handle(CURLM *multi_handle, CURL *curl_handle)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+    SessionHandle *ctx = (SessionHandle *)curl_handle;
+    SessionHandle **pos;
+
+    if (!m) return CURLM_BAD_HANDLE;
+    if (!ctx) return CURLM_BAD_EASY_HANDLE;
+    if (ctx->multi != m) return CURLM_OK;
+
+    for (pos = &m->easy; *pos && *pos != ctx; pos = &(*pos)->multi_next);
+    if (*pos) *pos = ctx->multi_next;
+
+    murl_multi_unwatch(ctx);
+    if (ctx->state != MURL_STATE_IDLE) {
+        murl_transfer_done(ctx, CURLE_ABORTED_BY_CALLBACK);
+    }
+    ctx->multi = NULL;
+    ctx->multi_next = NULL;
+    ctx->msg_pending = 0;
+    return CURLM_OK;
+}
+
+/*
+ * Moves every transfer along as far as its socket allows, without
+ * blocking.  running_handles gets the number still in progress.
+ */
+CURLMcode curl_multi_perform(CURLM *multi_handle, int *running_handles)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+    SessionHandle *ctx;
+    CURLcode crv;
+    int running = 0;
+    murl_sigpipe sp;
+
+    if (!m) return CURLM_BAD_HANDLE;
+
+    murl_sigpipe_block(&sp);
+    for (ctx = m->easy; ctx; ctx = ctx->multi_next) {
+        if (ctx->state == MURL_STATE_IDLE) continue;
+
+        crv = murl_transfer_step(ctx);
+        if (crv == CURLE_AGAIN) {
+            if (murl_multi_watch(m, ctx) == 0) {
+                running++;
+                continue;
+            }
+            crv = CURLE_OUT_OF_MEMORY;
+        }
+        murl_multi_done(ctx, crv);
+    }
+    murl_sigpipe_restore(&sp);
+
+    if (running_handles) *running_handles = running;
+    return CURLM_OK;
+}
+
+/*
+ * Waits up to timeout_ms for the socket of a transfer to become
+ * ready.  Other file descriptors can't be waited on.
+ */
+CURLMcode curl_multi_wait(CURLM *multi_handle, struct curl_waitfd extra_fds[],
+                          unsigned int extra_nfds, int timeout_ms, int *ret)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+    SessionHandle *ctx;
+    struct epoll_event ev[MURL_MULTI_EVENTS];
+    int running = 0;
+    int n;
+
+    if (!m) return CURLM_BAD_HANDLE;
+    if (extra_fds && extra_nfds) return CURLM_BAD_SOCKET;
+    if (ret) *ret = 0;
+
+    for (ctx = m->easy; ctx; ctx = ctx->multi_next) {
+        if (ctx->state == MURL_STATE_IDLE) continue;
+        /*
+         * A transfer that hasn't waited on its socket yet, or has
+         * data buffered by OpenSSL, can go on right away
+         */
+        if (ctx->sock < 0 || (ctx->ssl && SSL_pending(ctx->ssl))) return CURLM_OK;
+        running++;
+    }
+    if (!running) return CURLM_OK;
+
+    n = epoll_wait(m->epfd, ev, MURL_MULTI_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return CURLM_OK;
+        fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+        return CURLM_INTERNAL_ERROR;
+    }
+    if (ret) *ret = n;
+    return CURLM_OK;
+}
+
+/*
+ * Returns the message of the next finished transfer, or NULL when
+ * there is none.  msgs_in_queue gets the number of messages left.
+ */
+CURLMsg *curl_multi_info_read(CURLM *multi_handle, int *msgs_in_queue)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+    SessionHandle *ctx;
+    CURLMsg *msg = NULL;
+    int left = 0;
+
+    if (msgs_in_queue) *msgs_in_queue = 0;
+    if (!m) return NULL;
+
+    for (ctx = m->easy; ctx; ctx = ctx->multi_next) {
+        if (!ctx->msg_pending) continue;
+        if (!msg) {
+            ctx->msg_pending = 0;
+            msg = &ctx->msg;
+        } else {
+            left++;
+        }
+    }
+    if (msgs_in_queue) *msgs_in_queue = left;
+    return msg;
+}
+
+/*
+ * Frees the multi handle.  The easy handles still added to it are
+ * removed, but not freed.
+ */
+CURLMcode curl_multi_cleanup(CURLM *multi_handle)
+{
+    Curl_multi *m = (Curl_multi *)multi_handle;
+
+    if (!m) return CURLM_BAD_HANDLE;
+
+    while (m->easy) {
+        curl_multi_remove_handle(m, m->easy);
+    }
+    close(m->epfd);
+    free(m);
+    return CURLM_OK;
+}
+
+const char *curl_multi_strerror(CURLMcode error)
+{
+    switch (error) {
+    case CURLM_CALL_MULTI_PERFORM:
+        return "Please call curl_multi_perform() soon";
+    case CURLM_OK:
+        return "No error";
+    case CURLM_BAD_HANDLE:
+        return "Invalid multi handle";
+    case CURLM_BAD_EASY_HANDLE:
+        return "Invalid easy handle";
+    case CURLM_OUT_OF_MEMORY:
+        return "Out of memory";
+    case CURLM_INTERNAL_ERROR:
+        return "Internal error";
+    case CURLM_BAD_SOCKET:
+        return "Invalid socket argument";
+    case CURLM_UNKNOWN_OPTION:
+        return "Unknown option";
+    case CURLM_ADDED_ALREADY:
+        return "The easy handle is already added to a multi handle";
+    default:
+        return "Unknown error";
+    }
+}
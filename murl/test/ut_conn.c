@@ -0,0 +1,249 @@
+/*
+Copyright (c) 2016, Cisco Systems, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <murl/murl.h>
+#include "ut_lcl.h"
+
+#define TEST_POST_DATA "{\"murl\": \"resend this body\"}"
+
+/*
+ * The body of the last response, it may arrive in several pieces
+ */
+static char conn_response[1024];
+static size_t conn_response_len;
+
+static size_t test_murl_conn_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    if (size != 1 || conn_response_len + nmemb >= sizeof(conn_response)) {
+        fprintf(stderr, "ERROR: unexpected response body (%s)\n", __FUNCTION__);
+        return 0;
+    }
+    memcpy(conn_response + conn_response_len, ptr, nmemb);
+    conn_response_len += nmemb;
+    conn_response[conn_response_len] = 0;
+    return nmemb;
+}
+
+CURL *test_murl_conn_handle(void)
+{
+    CURL *hnd;
+
+    hnd = curl_easy_init();
+    curl_easy_setopt(hnd, CURLOPT_URL, TEST_SERVER_URL);
+    curl_easy_setopt(hnd, CURLOPT_USERAGENT, "murl");
+    /* These tests are about the connection, not the certificate */
+    curl_easy_setopt(hnd, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &test_murl_conn_body_cb);
+    return hnd;
+}
+
+/*
+ * Sends a GET, or a POST when post is set, and checks the response.
+ * Also used by the other suites that run against the local server.
+ * connects is the number of new connections the request is expected
+ * to make, 0 when the kept one is reused.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+int test_murl_conn_request(CURL *hnd, const char *post, long connects)
+{
+    CURLcode crv;
+    long http_code = 0;
+    long num_connects = -1;
+
+    if (post) {
+        curl_easy_setopt(hnd, CURLOPT_POST, 1L);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, post);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)strlen(post));
+    } else {
+        curl_easy_setopt(hnd, CURLOPT_HTTPGET, 1L);
+    }
+
+    conn_response_len = 0;
+    conn_response[0] = 0;
+    crv = curl_easy_perform(hnd);
+    if (crv != CURLE_OK) {
+        printf("Request failed, crv=%d\n", crv);
+        return -1;
+    }
+
+    curl_easy_getinfo(hnd, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(hnd, CURLINFO_NUM_CONNECTS, &num_connects);
+    if (http_code != 200 || strcmp(conn_response, TEST_SERVER_BODY)) {
+        printf("Invalid HTTP response from server: %d %s\n", (int)http_code, conn_response);
+        return -1;
+    }
+    if (num_connects != connects) {
+        printf("Request made %ld new connections, expected %ld\n", num_connects, connects);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Checks what the server saw once it has stopped.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+int test_murl_conn_check(const TEST_SERVER_STATS *stats, int connections, int requests)
+{
+    if (stats->connections != connections || stats->requests != requests) {
+        printf("Server saw %d connections and %d requests, expected %d and %d\n",
+               stats->connections, stats->requests, connections, requests);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * This function sends three requests with the same handle.  The
+ * server keeps the connection open, so the second and third
+ * requests go over the connection made by the first.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_keep_alive(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl reuses a kept connection...\n");
+
+    if (test_murl_server_start(NULL)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1) &&
+        !test_murl_conn_request(hnd, NULL, 0) &&
+        !test_murl_conn_request(hnd, TEST_POST_DATA, 0)) {
+        rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_conn_check(&stats, 1, 3)) rv = -1;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * The server closes the connection after the first response, while
+ * the client is idle and without a Connection: close header.  Murl
+ * should notice before reusing it and connect again.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_closed_while_idle(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl reconnects when the server closed an idle connection...\n");
+
+    opts.close_after = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1)) {
+        /* Give the server time to hang up */
+        usleep(200000);
+        if (!test_murl_conn_request(hnd, NULL, 1)) rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_conn_check(&stats, 2, 2)) rv = -1;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * The server reads the second request on the kept connection and
+ * hangs up without answering, the way a connection that went stale
+ * while the request was on its way fails.  Murl should send the
+ * request, body included, once more over a new connection.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_resend_stale(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl resends a request a stale connection dropped...\n");
+
+    opts.drop_after = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1) &&
+        !test_murl_conn_request(hnd, TEST_POST_DATA, 1)) {
+        rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    /* The dropped request and the one sent again */
+    test_murl_server_stop(&stats);
+    if (test_murl_conn_check(&stats, 2, 3)) rv = -1;
+    if (stats.body_len != (int)strlen(TEST_POST_DATA)) {
+        printf("Server got a %d byte body, expected %d\n",
+               stats.body_len, (int)strlen(TEST_POST_DATA));
+        rv = -1;
+    }
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * This is the main entry point into the connection
+ * test suite, run against a local server.
+ *
+ * Returns zero on success, non-zero on any test
+ * failure.
+ */
+int test_murl_conn (void)
+{
+    int rv;
+    int any_failures = 0;
+
+    rv = test_murl_keep_alive();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_closed_while_idle();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_resend_stale();
+    if (rv) any_failures = 1;
+
+    return any_failures;
+}
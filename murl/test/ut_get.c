@@ -46,6 +46,8 @@ static int dumby_ctx = 0;
 
 static size_t test_murl_get_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
+    size_t len;
+    char *tmp;
     int *usr_ctx = (int *)userdata;
 
     /*
@@ -59,14 +61,18 @@ static size_t test_murl_get_body_cb(void *ptr, size_t size, size_t nmemb, void *
         return 0;
     }
 
-    if (http_response) free(http_response);
-    http_response = calloc(1, nmemb);
-    if (!http_response) {
+    /*
+     * The body may be passed in several pieces
+     */
+    len = http_response ? strlen(http_response) : 0;
+    tmp = realloc(http_response, len + nmemb + 1);
+    if (!tmp) {
 	fprintf(stderr, "malloc failed (%s)\n", __FUNCTION__);
 	exit(1);
     }
-
-    memcpy(http_response, ptr, nmemb);
+    http_response = tmp;
+    memcpy(http_response + len, ptr, nmemb);
+    http_response[len + nmemb] = 0;
 
     //printf("%s", (char *)ptr);
 
@@ -124,6 +130,8 @@ static int test_murl_http_get(char *url)
     /*
      * Send the HTTP GET request
      */
+    if (http_response) free(http_response);
+    http_response = NULL;
     curl_easy_perform(hnd);
 
     /*
@@ -279,6 +287,8 @@ static int test_murl_headers_get()
     /*
      * Send the HTTP GET request
      */
+    if (http_response) free(http_response);
+    http_response = NULL;
     curl_easy_perform(hnd);
 
     /*
@@ -0,0 +1,238 @@
+/*
+Copyright (c) 2016, Cisco Systems, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <murl/murl.h>
+#include "ut_lcl.h"
+
+/* Many times the 16 KB murl inflates into at once */
+#define TEST_GZIP_BODY_LEN 300000
+
+/*
+ * The decoded body of the last response and the number of
+ * pieces it was passed in
+ */
+static char *gzip_response;
+static int gzip_response_len;
+static int gzip_pieces;
+
+static size_t test_murl_gzip_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    char *tmp;
+
+    if (size != 1) {
+        fprintf(stderr, "ERROR: murl size not 1 (%s)\n", __FUNCTION__);
+        return 0;
+    }
+    tmp = realloc(gzip_response, gzip_response_len + nmemb);
+    if (!tmp) {
+        fprintf(stderr, "malloc failed (%s)\n", __FUNCTION__);
+        return 0;
+    }
+    gzip_response = tmp;
+    memcpy(gzip_response + gzip_response_len, ptr, nmemb);
+    gzip_response_len += nmemb;
+    gzip_pieces++;
+    return nmemb;
+}
+
+/*
+ * Fetches a TEST_GZIP_BODY_LEN byte body and checks it decoded
+ * to what the server compressed.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_gzip_fetch(CURL *hnd, long connects, const char *expected)
+{
+    CURLcode crv;
+    long http_code = 0;
+    long num_connects = -1;
+
+    free(gzip_response);
+    gzip_response = NULL;
+    gzip_response_len = 0;
+    gzip_pieces = 0;
+
+    crv = curl_easy_perform(hnd);
+    if (crv != CURLE_OK) {
+        printf("Request failed, crv=%d\n", crv);
+        return -1;
+    }
+    curl_easy_getinfo(hnd, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(hnd, CURLINFO_NUM_CONNECTS, &num_connects);
+    if (http_code != 200 || gzip_response_len != TEST_GZIP_BODY_LEN ||
+        memcmp(gzip_response, expected, TEST_GZIP_BODY_LEN)) {
+        printf("Invalid HTTP response from server: %d, %d bytes\n",
+               (int)http_code, gzip_response_len);
+        return -1;
+    }
+    if (gzip_pieces < 2) {
+        printf("Body was passed in one piece, expected it as it was decoded\n");
+        return -1;
+    }
+    if (num_connects != connects) {
+        printf("Request made %ld new connections, expected %ld\n", num_connects, connects);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * This function asks for any encoding murl can decode and gets
+ * a small gzip encoded body.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_gzip_small(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl decodes a gzip encoded response...\n");
+
+    opts.gzip = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    curl_easy_setopt(hnd, CURLOPT_ACCEPT_ENCODING, "");
+    if (!test_murl_conn_request(hnd, NULL, 1)) rv = 0;
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (stats.gzipped != 1) {
+        printf("Server sent %d gzip encoded responses, expected 1\n", stats.gzipped);
+        rv = -1;
+    }
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * A large gzip encoded body in chunks.  It spans many reads and
+ * inflates to many times the decode buffer, and the connection must
+ * be reusable after it, which needs the end of the body found.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_gzip_large(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    char *expected;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl decodes a large chunked gzip response...\n");
+
+    expected = malloc(TEST_GZIP_BODY_LEN);
+    if (!expected) return rv;
+    test_murl_server_body(expected, TEST_GZIP_BODY_LEN);
+
+    opts.gzip = 1;
+    opts.chunked = 1;
+    opts.body_len = TEST_GZIP_BODY_LEN;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        free(expected);
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    curl_easy_setopt(hnd, CURLOPT_ACCEPT_ENCODING, "gzip");
+    curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &test_murl_gzip_body_cb);
+    if (!test_murl_gzip_fetch(hnd, 1, expected) &&
+        !test_murl_gzip_fetch(hnd, 0, expected)) {
+        rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (stats.gzipped != 2) {
+        printf("Server sent %d gzip encoded responses, expected 2\n", stats.gzipped);
+        rv = -1;
+    }
+
+    free(expected);
+    free(gzip_response);
+    gzip_response = NULL;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * Without CURLOPT_ACCEPT_ENCODING the server isn't asked for a
+ * compressed body and doesn't send one.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_gzip_not_asked(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl only asks for gzip when told to...\n");
+
+    opts.gzip = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1)) rv = 0;
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (stats.gzipped != 0) {
+        printf("Server sent %d gzip encoded responses, expected none\n", stats.gzipped);
+        rv = -1;
+    }
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * This is the main entry point into the compressed
+ * response test suite, run against a local server.
+ *
+ * Returns zero on success, non-zero on any test
+ * failure.
+ */
+int test_murl_gzip (void)
+{
+    int rv;
+    int any_failures = 0;
+
+    rv = test_murl_gzip_small();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_gzip_large();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_gzip_not_asked();
+    if (rv) any_failures = 1;
+
+    return any_failures;
+}
@@ -24,12 +24,52 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 int test_murl_post(void);
 int test_murl_get(void);
 int test_murl_tls(void);
+int test_murl_conn(void);
+int test_murl_session(void);
+int test_murl_gzip(void);
+int test_murl_multi(void);
 
 /*
- * Utility functions 
+ * Utility functions
  */
 int test_murl_locate_ipv6_address(char *address, int max_addr);
 
+/*
+ * Local keep-alive TLS server, see ut_server.c
+ */
+#define TEST_SERVER_PORT 29517
+#define TEST_SERVER_URL "https://127.0.0.1:29517/index.html"
+#define TEST_SERVER_BODY "<HTML><BODY>murl test</BODY></HTML>"
+
+typedef struct test_server_opts {
+    int close_after;  /* responses before the connection is closed, 0 = keep it */
+    int drop_after;   /* responses before a request is read and not answered, 0 = never */
+    int body_len;     /* bytes of test_murl_server_body() sent, 0 = TEST_SERVER_BODY */
+    int gzip;         /* gzip the body when the client accepts it */
+    int chunked;      /* send the body with the chunked transfer encoding */
+    int hold;         /* connections open at once before responses are sent, 0 = don't wait */
+} TEST_SERVER_OPTS;
+
+typedef struct test_server_stats {
+    int connections;  /* TLS connections accepted */
+    int resumed;      /* of which resumed a TLS session */
+    int requests;     /* requests read, answered or not */
+    int gzipped;      /* responses sent gzip encoded */
+    int max_active;   /* most connections open at once */
+    int body_len;     /* body length of the last request */
+} TEST_SERVER_STATS;
+
+int test_murl_server_start(const TEST_SERVER_OPTS *opts);
+void test_murl_server_stop(TEST_SERVER_STATS *stats);
+void test_murl_server_body(char *buf, int len);
+
+/*
+ * Requests to the local server, see ut_conn.c
+ */
+CURL *test_murl_conn_handle(void);
+int test_murl_conn_request(CURL *hnd, const char *post, long connects);
+int test_murl_conn_check(const TEST_SERVER_STATS *stats, int connections, int requests);
+
 #endif
 
 
@@ -42,6 +42,34 @@ int main(int argc, char **argv)
 	rv = 1;
     }
 
+    /*
+     * Invoke the connection unit test suite, it needs no network
+     */
+    if (test_murl_conn()) {
+	rv = 1;
+    }
+
+    /*
+     * Invoke the TLS session resumption unit test suite
+     */
+    if (test_murl_session()) {
+	rv = 1;
+    }
+
+    /*
+     * Invoke the compressed response unit test suite
+     */
+    if (test_murl_gzip()) {
+	rv = 1;
+    }
+
+    /*
+     * Invoke the multi interface unit test suite
+     */
+    if (test_murl_multi()) {
+	rv = 1;
+    }
+
     /*
      * TODO: Invoke other unit test suites
      */
@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2016, Cisco Systems, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <murl/murl.h>
+#include "ut_lcl.h"
+
+#define TEST_MULTI_XFERS 2
+#define TEST_MULTI_WAIT_MS 100
+#define TEST_MULTI_MAX_WAITS 100
+
+/*
+ * One transfer run on the multi handle
+ */
+typedef struct test_multi_xfer {
+    CURL *hnd;
+    char body[1024];
+    size_t len;
+    int done;
+    CURLcode result;
+} TEST_MULTI_XFER;
+
+static size_t test_murl_multi_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    TEST_MULTI_XFER *x = (TEST_MULTI_XFER *)userdata;
+
+    if (size != 1 || x->len + nmemb >= sizeof(x->body)) {
+        fprintf(stderr, "ERROR: unexpected response body (%s)\n", __FUNCTION__);
+        return 0;
+    }
+    memcpy(x->body + x->len, ptr, nmemb);
+    x->len += nmemb;
+    x->body[x->len] = 0;
+    return nmemb;
+}
+
+static void test_murl_multi_xfer_init(TEST_MULTI_XFER *x)
+{
+    memset(x, 0, sizeof(TEST_MULTI_XFER));
+    x->hnd = test_murl_conn_handle();
+    curl_easy_setopt(x->hnd, CURLOPT_WRITEFUNCTION, &test_murl_multi_body_cb);
+    curl_easy_setopt(x->hnd, CURLOPT_WRITEDATA, x);
+    curl_easy_setopt(x->hnd, CURLOPT_PRIVATE, x);
+}
+
+/*
+ * Runs the transfers on the multi handle until they are all done,
+ * then checks each response.  connects is the number of new
+ * connections each transfer is expected to make.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_multi_run(CURLM *m, TEST_MULTI_XFER *xfers, int cnt, long connects)
+{
+    TEST_MULTI_XFER *x;
+    CURLMsg *msg;
+    int running = 0;
+    int queued;
+    int waits = 0;
+    int i;
+    int rv = 0;
+    long http_code;
+    long num_connects;
+
+    for (i = 0; i < cnt; i++) {
+        xfers[i].len = 0;
+        xfers[i].body[0] = 0;
+        xfers[i].done = 0;
+        if (curl_multi_add_handle(m, xfers[i].hnd) != CURLM_OK) {
+            printf("Unable to add transfer %d\n", i);
+            return -1;
+        }
+    }
+
+    do {
+        if (curl_multi_perform(m, &running) != CURLM_OK) {
+            printf("curl_multi_perform failed\n");
+            rv = -1;
+            break;
+        }
+        while ((msg = curl_multi_info_read(m, &queued))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&x);
+            x->done = 1;
+            x->result = msg->data.result;
+        }
+        if (running && curl_multi_wait(m, NULL, 0, TEST_MULTI_WAIT_MS, NULL) != CURLM_OK) {
+            printf("curl_multi_wait failed\n");
+            rv = -1;
+            break;
+        }
+    } while (running && ++waits < TEST_MULTI_MAX_WAITS);
+
+    for (i = 0; i < cnt; i++) {
+        x = &xfers[i];
+        curl_multi_remove_handle(m, x->hnd);
+        if (rv) continue;
+
+        http_code = 0;
+        num_connects = -1;
+        curl_easy_getinfo(x->hnd, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(x->hnd, CURLINFO_NUM_CONNECTS, &num_connects);
+        if (!x->done || x->result != CURLE_OK) {
+            printf("Transfer %d didn't finish, done=%d crv=%d\n", i, x->done, x->result);
+            rv = -1;
+        } else if (http_code != 200 || strcmp(x->body, TEST_SERVER_BODY)) {
+            printf("Invalid HTTP response from server: %d %s\n", (int)http_code, x->body);
+            rv = -1;
+        } else if (num_connects != connects) {
+            printf("Transfer %d made %ld new connections, expected %ld\n", i, num_connects, connects);
+            rv = -1;
+        }
+    }
+    return rv;
+}
+
+/*
+ * The server holds its responses back until both connections are
+ * open, so the two transfers only finish if the multi handle runs
+ * them at the same time.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_multi_concurrent(void)
+{
+    CURLM *m;
+    TEST_MULTI_XFER xfers[TEST_MULTI_XFERS];
+    int rv = -1;
+    int i;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl multi runs two transfers at once...\n");
+
+    opts.hold = TEST_MULTI_XFERS;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    m = curl_multi_init();
+    for (i = 0; i < TEST_MULTI_XFERS; i++) {
+        test_murl_multi_xfer_init(&xfers[i]);
+    }
+    if (m && !test_murl_multi_run(m, xfers, TEST_MULTI_XFERS, 1)) rv = 0;
+    for (i = 0; i < TEST_MULTI_XFERS; i++) {
+        curl_easy_cleanup(xfers[i].hnd);
+    }
+    curl_multi_cleanup(m);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_conn_check(&stats, TEST_MULTI_XFERS, TEST_MULTI_XFERS)) rv = -1;
+    if (stats.max_active != TEST_MULTI_XFERS) {
+        printf("Server had %d connections open at once, expected %d\n",
+               stats.max_active, TEST_MULTI_XFERS);
+        rv = -1;
+    }
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * A second round of transfers on the same handles goes over the
+ * connections kept from the first, with gzip encoded responses
+ * decoded on the non-blocking path.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_multi_reuse(void)
+{
+    CURLM *m;
+    TEST_MULTI_XFER xfers[TEST_MULTI_XFERS];
+    int rv = -1;
+    int i;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl multi reuses kept connections...\n");
+
+    opts.hold = TEST_MULTI_XFERS;
+    opts.gzip = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    m = curl_multi_init();
+    for (i = 0; i < TEST_MULTI_XFERS; i++) {
+        test_murl_multi_xfer_init(&xfers[i]);
+        curl_easy_setopt(xfers[i].hnd, CURLOPT_ACCEPT_ENCODING, "");
+    }
+    if (m && !test_murl_multi_run(m, xfers, TEST_MULTI_XFERS, 1) &&
+        !test_murl_multi_run(m, xfers, TEST_MULTI_XFERS, 0)) {
+        rv = 0;
+    }
+    for (i = 0; i < TEST_MULTI_XFERS; i++) {
+        curl_easy_cleanup(xfers[i].hnd);
+    }
+    curl_multi_cleanup(m);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_conn_check(&stats, TEST_MULTI_XFERS, 2 * TEST_MULTI_XFERS)) rv = -1;
+    if (stats.gzipped != 2 * TEST_MULTI_XFERS) {
+        printf("Server sent %d gzip encoded responses, expected %d\n",
+               stats.gzipped, 2 * TEST_MULTI_XFERS);
+        rv = -1;
+    }
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * This is the main entry point into the multi interface
+ * test suite, run against a local server.
+ *
+ * Returns zero on success, non-zero on any test
+ * failure.
+ */
+int test_murl_multi (void)
+{
+    int rv;
+    int any_failures = 0;
+
+    rv = test_murl_multi_concurrent();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_multi_reuse();
+    if (rv) any_failures = 1;
+
+    return any_failures;
+}
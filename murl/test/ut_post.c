@@ -26,19 +26,26 @@ static char *http_response = NULL;
 
 static size_t test_murl_post_body_cb(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
+    size_t len;
+    char *tmp;
+
     if (size != 1) {
         fprintf(stderr, "ERROR: murl size not 1 (%s)\n", __FUNCTION__);
         return 0;
     }
 
-    if (http_response) free(http_response);
-    http_response = calloc(1, nmemb);
-    if (!http_response) {
+    /*
+     * The body may be passed in several pieces
+     */
+    len = http_response ? strlen(http_response) : 0;
+    tmp = realloc(http_response, len + nmemb + 1);
+    if (!tmp) {
 	fprintf(stderr, "malloc failed (%s)\n", __FUNCTION__);
 	exit(1);
     }
-
-    memcpy(http_response, ptr, nmemb);
+    http_response = tmp;
+    memcpy(http_response + len, ptr, nmemb);
+    http_response[len + nmemb] = 0;
 
     //printf("%s", (char *)ptr);
 
@@ -79,6 +86,8 @@ static int test_murl_post_http_post(char *url, char *post_data)
     /*
      * Send the HTTP GET request
      */
+    if (http_response) free(http_response);
+    http_response = NULL;
     curl_easy_perform(hnd);
 
     /*
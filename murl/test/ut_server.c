@@ -0,0 +1,408 @@
+/*
+Copyright (c) 2016, Cisco Systems, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE /* strcasestr() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+#include <murl/murl.h>
+#include "ut_lcl.h"
+
+#define SERVER_CERT "test/certs/server1.pem"
+#define SERVER_KEY "test/certs/key1.pem"
+#define SERVER_MAX_CONN 16
+#define SERVER_REQ_MAX 16384
+#define SERVER_CHUNK_SZ 4000
+#define SERVER_HOLD_MS 3000
+
+/*
+ * A local TLS server for the test cases that need more than the
+ * single request served by the one in ut_tls.c.  Each connection
+ * gets its own thread and is kept open for as many HTTP/1.1
+ * requests as the client sends, unless the options say otherwise.
+ * Only one server runs at a time.
+ */
+static TEST_SERVER_OPTS server_opts;
+static TEST_SERVER_STATS server_stats;
+static SSL_CTX *server_ctx;
+static int server_sock = -1;
+static int server_stopping;
+static pthread_t accept_thread;
+static pthread_t conn_threads[SERVER_MAX_CONN];
+static int conn_cnt;
+static int conn_active;
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Fills buf with the body the server sends when opts.body_len is set
+ */
+void test_murl_server_body(char *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = 'a' + (i * 7 + i / 251) % 26;
+    }
+}
+
+/*
+ * Reads one HTTP request, the headers and a Content-Length body.
+ * Returns the body length, or -1 when the client closed the
+ * connection or sent something else.  gzip is set when the client
+ * accepts a gzip encoded response.
+ */
+static int server_read_request(SSL *ssl, char *buf, int max, int *gzip)
+{
+    int len = 0;
+    int rv;
+    int body_len = 0;
+    int have;
+    char *end = NULL;
+    char *cl;
+    char *ae;
+
+    while (!end) {
+        if (len >= max - 1) return -1;
+        rv = SSL_read(ssl, buf + len, max - 1 - len);
+        if (rv <= 0) return -1;
+        len += rv;
+        buf[len] = 0;
+        end = strstr(buf, "\r\n\r\n");
+    }
+    end += 4;
+
+    cl = strcasestr(buf, "\r\nContent-Length:");
+    if (cl && cl < end) {
+        body_len = atoi(cl + strlen("\r\nContent-Length:"));
+    }
+    ae = strcasestr(buf, "\r\nAccept-Encoding:");
+    *gzip = ae && ae < end && strstr(ae, "gzip") && strstr(ae, "gzip") < end;
+
+    /* The body doesn't have to fit, only its length is kept */
+    have = len - (int)(end - buf);
+    while (have < body_len) {
+        rv = SSL_read(ssl, buf, max - 1);
+        if (rv <= 0) return -1;
+        have += rv;
+    }
+    return body_len;
+}
+
+/*
+ * Holds a response back until opts.hold connections are open at
+ * once, or SERVER_HOLD_MS have passed, so that the transfers of a
+ * client that runs them one after the other can't overlap.
+ */
+static void server_hold(void)
+{
+    int waited;
+    int active;
+
+    for (waited = 0; waited < SERVER_HOLD_MS; waited += 10) {
+        pthread_mutex_lock(&server_lock);
+        active = conn_active;
+        pthread_mutex_unlock(&server_lock);
+        if (active >= server_opts.hold) return;
+        usleep(10000);
+    }
+}
+
+/*
+ * Compresses len bytes of body in gzip format.  Returns the
+ * compressed length, or -1 on failure.
+ */
+static int server_gzip(const char *body, int len, char **out)
+{
+    z_stream zs;
+    int max;
+
+    memset(&zs, 0, sizeof(zs));
+    /* 16 added to the window bits writes a gzip header */
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+    max = deflateBound(&zs, len);
+    *out = malloc(max);
+    if (!*out) {
+        deflateEnd(&zs);
+        return -1;
+    }
+    zs.next_in = (unsigned char *)body;
+    zs.avail_in = len;
+    zs.next_out = (unsigned char *)*out;
+    zs.avail_out = max;
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+    len = max - zs.avail_out;
+    deflateEnd(&zs);
+    return len;
+}
+
+/*
+ * Sends the body with a Content-Length, or in chunks of
+ * SERVER_CHUNK_SZ bytes when opts.chunked is set.
+ */
+static int server_send_body(SSL *ssl, const char *body, int len)
+{
+    char hdr[32];
+    int off;
+    int n;
+    int hlen;
+
+    if (!server_opts.chunked) {
+        return SSL_write(ssl, body, len) == len ? 0 : -1;
+    }
+    for (off = 0; off < len; off += n) {
+        n = len - off < SERVER_CHUNK_SZ ? len - off : SERVER_CHUNK_SZ;
+        hlen = snprintf(hdr, sizeof(hdr), "%x\r\n", n);
+        if (SSL_write(ssl, hdr, hlen) != hlen ||
+            SSL_write(ssl, body + off, n) != n ||
+            SSL_write(ssl, "\r\n", 2) != 2) {
+            return -1;
+        }
+    }
+    return SSL_write(ssl, "0\r\n\r\n", 5) == 5 ? 0 : -1;
+}
+
+static int server_send_response(SSL *ssl, int gzip)
+{
+    char hdr[256];
+    char *body = NULL;
+    char *zbody = NULL;
+    int len;
+    int hlen;
+    int rv = -1;
+
+    if (server_opts.body_len) {
+        len = server_opts.body_len;
+        body = malloc(len);
+        if (!body) return -1;
+        test_murl_server_body(body, len);
+    } else {
+        len = strlen(TEST_SERVER_BODY);
+        body = strdup(TEST_SERVER_BODY);
+        if (!body) return -1;
+    }
+
+    gzip = gzip && server_opts.gzip;
+    if (gzip) {
+        len = server_gzip(body, len, &zbody);
+        if (len < 0) goto end;
+        pthread_mutex_lock(&server_lock);
+        server_stats.gzipped++;
+        pthread_mutex_unlock(&server_lock);
+    }
+
+    hlen = snprintf(hdr, sizeof(hdr),
+                    "HTTP/1.1 200 OK\r\nServer: murltest\r\n"
+                    "Content-Type: text/html\r\n");
+    if (gzip) {
+        hlen += snprintf(hdr + hlen, sizeof(hdr) - hlen, "Content-Encoding: gzip\r\n");
+    }
+    if (server_opts.chunked) {
+        hlen += snprintf(hdr + hlen, sizeof(hdr) - hlen, "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+        hlen += snprintf(hdr + hlen, sizeof(hdr) - hlen, "Content-Length: %d\r\n\r\n", len);
+    }
+    if (SSL_write(ssl, hdr, hlen) != hlen) goto end;
+    rv = server_send_body(ssl, gzip ? zbody : body, len);
+
+end:
+    free(body);
+    free(zbody);
+    return rv;
+}
+
+static void *server_conn_thread(void *arg)
+{
+    int conn = (int)(long)arg;
+    SSL *ssl = NULL;
+    char *buf = NULL;
+    int served = 0;
+    int body_len;
+    int gzip = 0;
+    struct timeval tv = { 10, 0 };
+
+    /* A client that never comes back doesn't hold up the test */
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    buf = malloc(SERVER_REQ_MAX);
+    ssl = SSL_new(server_ctx);
+    if (!buf || !ssl) goto cleanup;
+    SSL_set_fd(ssl, conn);
+    if (SSL_accept(ssl) <= 0) {
+        printf("Test server failed to complete TLS handshake\n");
+        ERR_print_errors_fp(stderr);
+        goto cleanup;
+    }
+
+    pthread_mutex_lock(&server_lock);
+    server_stats.connections++;
+    if (SSL_session_reused(ssl)) server_stats.resumed++;
+    conn_active++;
+    if (conn_active > server_stats.max_active) server_stats.max_active = conn_active;
+    pthread_mutex_unlock(&server_lock);
+
+    for (;;) {
+        body_len = server_read_request(ssl, buf, SERVER_REQ_MAX, &gzip);
+        if (body_len < 0) break;
+
+        pthread_mutex_lock(&server_lock);
+        server_stats.requests++;
+        server_stats.body_len = body_len;
+        pthread_mutex_unlock(&server_lock);
+
+        /* Hang up on the request as if the connection had gone stale */
+        if (server_opts.drop_after && served == server_opts.drop_after) break;
+
+        if (server_opts.hold) server_hold();
+        if (server_send_response(ssl, gzip)) break;
+        served++;
+
+        /* Hang up without a Connection: close, while the client is idle */
+        if (server_opts.close_after && served == server_opts.close_after) break;
+    }
+    SSL_shutdown(ssl);
+
+    pthread_mutex_lock(&server_lock);
+    conn_active--;
+    pthread_mutex_unlock(&server_lock);
+
+cleanup:
+    if (ssl) SSL_free(ssl);
+    free(buf);
+    close(conn);
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    ERR_remove_thread_state(NULL);
+#endif
+    return NULL;
+}
+
+static void *server_accept_thread(void *arg)
+{
+    struct pollfd pfd;
+    int conn;
+
+    pfd.fd = server_sock;
+    pfd.events = POLLIN;
+    while (!server_stopping) {
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        conn = accept(server_sock, NULL, NULL);
+        if (conn < 0) continue;
+        if (conn_cnt == SERVER_MAX_CONN ||
+            pthread_create(&conn_threads[conn_cnt], NULL, server_conn_thread,
+                           (void *)(long)conn)) {
+            printf("Test server can't take another connection\n");
+            close(conn);
+            continue;
+        }
+        conn_cnt++;
+    }
+    return NULL;
+}
+
+/*
+ * Starts the server on TEST_SERVER_PORT.  It is listening when
+ * this returns.
+ *
+ * returns zero on success, non-zero on failure
+ */
+int test_murl_server_start(const TEST_SERVER_OPTS *opts)
+{
+    struct sockaddr_in addr;
+    int on = 1;
+
+    memset(&server_stats, 0, sizeof(server_stats));
+    memset(&server_opts, 0, sizeof(server_opts));
+    if (opts) server_opts = *opts;
+    server_stopping = 0;
+    conn_cnt = 0;
+    conn_active = 0;
+
+    /* Writing to a connection the client closed must not end the test */
+    signal(SIGPIPE, SIG_IGN);
+
+    server_ctx = SSL_CTX_new(SSLv23_server_method());
+    if (!server_ctx) {
+        printf("Failed to create SSL context\n");
+        return -1;
+    }
+    if (SSL_CTX_use_certificate_chain_file(server_ctx, SERVER_CERT) != 1 ||
+        SSL_CTX_use_PrivateKey_file(server_ctx, SERVER_KEY, SSL_FILETYPE_PEM) != 1) {
+        printf("Failed to load server certificate and key\n");
+        ERR_print_errors_fp(stderr);
+        goto err;
+    }
+
+    server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server_sock < 0) goto err;
+    setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_SERVER_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server_sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(server_sock, SERVER_MAX_CONN)) {
+        printf("Unable to listen on port %d\n", TEST_SERVER_PORT);
+        goto err;
+    }
+
+    if (pthread_create(&accept_thread, NULL, server_accept_thread, NULL)) goto err;
+    return 0;
+
+err:
+    if (server_sock >= 0) close(server_sock);
+    server_sock = -1;
+    SSL_CTX_free(server_ctx);
+    server_ctx = NULL;
+    return -1;
+}
+
+/*
+ * Stops the server once the clients have closed their connections,
+ * and returns what it saw in stats.
+ */
+void test_murl_server_stop(TEST_SERVER_STATS *stats)
+{
+    int i;
+
+    server_stopping = 1;
+    pthread_join(accept_thread, NULL);
+    for (i = 0; i < conn_cnt; i++) {
+        pthread_join(conn_threads[i], NULL);
+    }
+    close(server_sock);
+    server_sock = -1;
+    SSL_CTX_free(server_ctx);
+    server_ctx = NULL;
+
+    if (stats) *stats = server_stats;
+}
@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2016, Cisco Systems, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <murl/murl.h>
+#include "ut_lcl.h"
+
+/*
+ * Checks how many of the server's connections resumed a session.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_session_check(const TEST_SERVER_STATS *stats, int connections, int resumed)
+{
+    if (test_murl_conn_check(stats, connections, connections)) return -1;
+    if (stats->resumed != resumed) {
+        printf("Server resumed %d sessions, expected %d\n", stats->resumed, resumed);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * The server closes the connection after every response, so each
+ * request needs a new connection.  The handle keeps the session of
+ * the previous one and resumes it.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_session_resumed(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl resumes the TLS session on a new connection...\n");
+
+    opts.close_after = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1) &&
+        !test_murl_conn_request(hnd, NULL, 1) &&
+        !test_murl_conn_request(hnd, NULL, 1)) {
+        rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_session_check(&stats, 3, 2)) rv = -1;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * Sessions are saved in the handle, a second handle makes a full
+ * handshake.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_session_per_handle(void)
+{
+    CURL *hnd1, *hnd2;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl keeps TLS sessions per handle...\n");
+
+    opts.close_after = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd1 = test_murl_conn_handle();
+    hnd2 = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd1, NULL, 1) &&
+        !test_murl_conn_request(hnd2, NULL, 1)) {
+        rv = 0;
+    }
+    curl_easy_cleanup(hnd1);
+    curl_easy_cleanup(hnd2);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_session_check(&stats, 2, 0)) rv = -1;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * Setting a TLS option drops the saved session along with the SSL
+ * context it came from.
+ *
+ * Returns zero on success, non-zero on failure
+ */
+static int test_murl_session_reset(void)
+{
+    CURL *hnd;
+    int rv = -1;
+    TEST_SERVER_OPTS opts = { 0 };
+    TEST_SERVER_STATS stats;
+
+    printf("\nTesting Murl drops the TLS session when a TLS option is set...\n");
+
+    opts.close_after = 1;
+    if (test_murl_server_start(&opts)) {
+        printf("Unable to start test server, test case failed!\n");
+        return rv;
+    }
+
+    hnd = test_murl_conn_handle();
+    if (!test_murl_conn_request(hnd, NULL, 1)) {
+        curl_easy_setopt(hnd, CURLOPT_SSL_VERIFY_HOSTNAME, 0L);
+        if (!test_murl_conn_request(hnd, NULL, 1)) rv = 0;
+    }
+    curl_easy_cleanup(hnd);
+
+    test_murl_server_stop(&stats);
+    if (test_murl_session_check(&stats, 2, 0)) rv = -1;
+
+    LOG_RESULT(rv);
+    return rv;
+}
+
+/*
+ * This is the main entry point into the TLS session
+ * test suite, run against a local server.
+ *
+ * Returns zero on success, non-zero on any test
+ * failure.
+ */
+int test_murl_session (void)
+{
+    int rv;
+    int any_failures = 0;
+
+    rv = test_murl_session_resumed();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_session_per_handle();
+    if (rv) any_failures = 1;
+
+    rv = test_murl_session_reset();
+    if (rv) any_failures = 1;
+
+    return any_failures;
+}
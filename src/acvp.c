@@ -16,6 +16,7 @@
 #include <Windows.h>
 #else
 #include <unistd.h>
+#include <pthread.h>
 #endif
 #include "acvp.h"
 #include "acvp_lcl.h"
@@ -39,12 +40,22 @@ static ACVP_RESULT acvp_parse_dependencies(ACVP_CTX *ctx, ACVP_DEPENDENCY_LIST *
 
 static ACVP_RESULT acvp_parse_test_session_register(ACVP_CTX *ctx);
 
-static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url);
+static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url, JSON_Value *vs_val);
+
+static ACVP_RESULT acvp_get_vector_set(ACVP_CTX *ctx, char *vsid_url, JSON_Value **vs_val,
+                                       unsigned int *retry_period);
+
+static ACVP_RESULT acvp_parse_vector_set(ACVP_CTX *ctx, const char *body, JSON_Value **vs_val,
+                                         unsigned int *retry_period);
 
 static ACVP_RESULT acvp_process_vector_set(ACVP_CTX *ctx, JSON_Object *obj);
 
 static ACVP_RESULT acvp_dispatch_vector_set(ACVP_CTX *ctx, JSON_Object *obj);
 
+static ACVP_ALG_HANDLER *acvp_find_alg_handler(const char *alg, const char *mode);
+
+static JSON_Value *acvp_read_vector_set(const char *body);
+
 static void acvp_cap_free_sl(ACVP_SL_LIST *list);
 
 static void acvp_cap_free_nl(ACVP_NAME_LIST *list);
@@ -66,77 +77,77 @@ static ACVP_RESULT acvp_get_result_test_session(ACVP_CTX *ctx, char *session_url
  * This table is not sparse, it must contain ACVP_OP_MAX entries.
  */
 ACVP_ALG_HANDLER alg_tbl[ACVP_ALG_MAX] = {
-    { ACVP_AES_GCM,           &acvp_aes_kat_handler,          ACVP_ALG_AES_GCM,           NULL, ACVP_REV_AES_GCM},
-    { ACVP_AES_CCM,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CCM,           NULL, ACVP_REV_AES_CCM},
-    { ACVP_AES_ECB,           &acvp_aes_kat_handler,          ACVP_ALG_AES_ECB,           NULL, ACVP_REV_AES_ECB},
-    { ACVP_AES_CBC,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CBC,           NULL, ACVP_REV_AES_CBC},
-    { ACVP_AES_CFB1,          &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB1,          NULL, ACVP_REV_AES_CFB1},
-    { ACVP_AES_CFB8,          &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB8,          NULL, ACVP_REV_AES_CFB8},
-    { ACVP_AES_CFB128,        &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB128,        NULL, ACVP_REV_AES_CFB128},
-    { ACVP_AES_OFB,           &acvp_aes_kat_handler,          ACVP_ALG_AES_OFB,           NULL, ACVP_REV_AES_OFB},
-    { ACVP_AES_CTR,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CTR,           NULL, ACVP_REV_AES_CTR},
-    { ACVP_AES_XTS,           &acvp_aes_kat_handler,          ACVP_ALG_AES_XTS,           NULL, ACVP_REV_AES_XTS},
-    { ACVP_AES_KW,            &acvp_aes_kat_handler,          ACVP_ALG_AES_KW,            NULL, ACVP_REV_AES_KW},
-    { ACVP_AES_KWP,           &acvp_aes_kat_handler,          ACVP_ALG_AES_KWP,           NULL, ACVP_REV_AES_KWP},
-    { ACVP_TDES_ECB,          &acvp_des_kat_handler,          ACVP_ALG_TDES_ECB,          NULL, ACVP_REV_TDES_ECB},
-    { ACVP_TDES_CBC,          &acvp_des_kat_handler,          ACVP_ALG_TDES_CBC,          NULL, ACVP_REV_TDES_CBC},
-    { ACVP_TDES_CBCI,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CBCI,         NULL, ACVP_REV_TDES_CBCI},
-    { ACVP_TDES_OFB,          &acvp_des_kat_handler,          ACVP_ALG_TDES_OFB,          NULL, ACVP_REV_TDES_OFB},
-    { ACVP_TDES_OFBI,         &acvp_des_kat_handler,          ACVP_ALG_TDES_OFBI,         NULL, ACVP_REV_TDES_OFBI},
-    { ACVP_TDES_CFB1,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB1,         NULL, ACVP_REV_TDES_CFB1},
-    { ACVP_TDES_CFB8,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB8,         NULL, ACVP_REV_TDES_CFB8},
-    { ACVP_TDES_CFB64,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB64,        NULL, ACVP_REV_TDES_CFB64},
-    { ACVP_TDES_CFBP1,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP1,        NULL, ACVP_REV_TDES_CFBP1},
-    { ACVP_TDES_CFBP8,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP8,        NULL, ACVP_REV_TDES_CFBP8},
-    { ACVP_TDES_CFBP64,       &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP64,       NULL, ACVP_REV_TDES_CFBP64},
-    { ACVP_TDES_CTR,          &acvp_des_kat_handler,          ACVP_ALG_TDES_CTR,          NULL, ACVP_REV_TDES_CTR},
-    { ACVP_TDES_KW,           &acvp_des_kat_handler,          ACVP_ALG_TDES_KW,           NULL, ACVP_REV_TDES_KW},
-    { ACVP_HASH_SHA1,         &acvp_hash_kat_handler,         ACVP_ALG_SHA1,              NULL, ACVP_REV_HASH_SHA1},
-    { ACVP_HASH_SHA224,       &acvp_hash_kat_handler,         ACVP_ALG_SHA224,            NULL, ACVP_REV_HASH_SHA224},
-    { ACVP_HASH_SHA256,       &acvp_hash_kat_handler,         ACVP_ALG_SHA256,            NULL, ACVP_REV_HASH_SHA256},
-    { ACVP_HASH_SHA384,       &acvp_hash_kat_handler,         ACVP_ALG_SHA384,            NULL, ACVP_REV_HASH_SHA384},
-    { ACVP_HASH_SHA512,       &acvp_hash_kat_handler,         ACVP_ALG_SHA512,            NULL, ACVP_REV_HASH_SHA512},
-    { ACVP_HASHDRBG,          &acvp_drbg_kat_handler,         ACVP_ALG_HASHDRBG,          NULL, ACVP_REV_HASHDRBG},
-    { ACVP_HMACDRBG,          &acvp_drbg_kat_handler,         ACVP_ALG_HMACDRBG,          NULL, ACVP_REV_HMACDRBG},
-    { ACVP_CTRDRBG,           &acvp_drbg_kat_handler,         ACVP_ALG_CTRDRBG,           NULL, ACVP_REV_CTRDRBG},
-    { ACVP_HMAC_SHA1,         &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA1,         NULL, ACVP_REV_HMAC_SHA1},
-    { ACVP_HMAC_SHA2_224,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_224,     NULL, ACVP_REV_HMAC_SHA2_224},
-    { ACVP_HMAC_SHA2_256,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_256,     NULL, ACVP_REV_HMAC_SHA2_256},
-    { ACVP_HMAC_SHA2_384,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_384,     NULL, ACVP_REV_HMAC_SHA2_384},
-    { ACVP_HMAC_SHA2_512,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512,     NULL, ACVP_REV_HMAC_SHA2_512},
-    { ACVP_HMAC_SHA2_512_224, &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512_224, NULL, ACVP_REV_HMAC_SHA2_512_224},
-    { ACVP_HMAC_SHA2_512_256, &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512_256, NULL, ACVP_REV_HMAC_SHA2_512_256},
-    { ACVP_HMAC_SHA3_224,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_224,     NULL, ACVP_REV_HMAC_SHA3_224},
-    { ACVP_HMAC_SHA3_256,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_256,     NULL, ACVP_REV_HMAC_SHA3_256},
-    { ACVP_HMAC_SHA3_384,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_384,     NULL, ACVP_REV_HMAC_SHA3_384},
-    { ACVP_HMAC_SHA3_512,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_512,     NULL, ACVP_REV_HMAC_SHA3_512},
-    { ACVP_CMAC_AES,          &acvp_cmac_kat_handler,         ACVP_ALG_CMAC_AES,          NULL, ACVP_REV_CMAC_AES},
-    { ACVP_CMAC_TDES,         &acvp_cmac_kat_handler,         ACVP_ALG_CMAC_TDES,         NULL, ACVP_REV_CMAC_TDES},
-    { ACVP_DSA_KEYGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_KEYGEN, ACVP_REV_DSA},
-    { ACVP_DSA_PQGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGGEN, ACVP_REV_DSA},
-    { ACVP_DSA_PQGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGVER, ACVP_REV_DSA},
-    { ACVP_DSA_SIGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGGEN, ACVP_REV_DSA},
-    { ACVP_DSA_SIGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGVER, ACVP_REV_DSA},
-    { ACVP_RSA_KEYGEN,        &acvp_rsa_keygen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_KEYGEN, ACVP_REV_RSA},
-    { ACVP_RSA_SIGGEN,        &acvp_rsa_siggen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGGEN, ACVP_REV_RSA},
-    { ACVP_RSA_SIGVER,        &acvp_rsa_sigver_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGVER, ACVP_REV_RSA},
-    { ACVP_ECDSA_KEYGEN,      &acvp_ecdsa_keygen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYGEN, ACVP_REV_RSA},
-    { ACVP_ECDSA_KEYVER,      &acvp_ecdsa_keyver_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYVER, ACVP_REV_RSA},
-    { ACVP_ECDSA_SIGGEN,      &acvp_ecdsa_siggen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_SIGGEN, ACVP_REV_RSA},
-    { ACVP_ECDSA_SIGVER,      &acvp_ecdsa_sigver_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_SIGVER, ACVP_REV_RSA},
-    { ACVP_KDF135_TLS,        &acvp_kdf135_tls_kat_handler,   ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_TLS, ACVP_REV_KDF135_TLS},
-    { ACVP_KDF135_SNMP,       &acvp_kdf135_snmp_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SNMP, ACVP_REV_KDF135_SNMP},
-    { ACVP_KDF135_SSH,        &acvp_kdf135_ssh_kat_handler,   ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SSH, ACVP_REV_KDF135_SSH},
-    { ACVP_KDF135_SRTP,       &acvp_kdf135_srtp_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SRTP, ACVP_REV_KDF135_SRTP},
-    { ACVP_KDF135_IKEV2,      &acvp_kdf135_ikev2_kat_handler, ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_IKEV2, ACVP_REV_KDF135_IKEV2},
-    { ACVP_KDF135_IKEV1,      &acvp_kdf135_ikev1_kat_handler, ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_IKEV1, ACVP_REV_KDF135_IKEV1},
-    { ACVP_KDF135_X963,       &acvp_kdf135_x963_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_X963, ACVP_REV_KDF135_X963},
-    { ACVP_KDF108,            &acvp_kdf108_kat_handler,       ACVP_ALG_KDF108,            NULL, ACVP_REV_KDF108},
-    { ACVP_KAS_ECC_CDH,       &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_CDH, ACVP_REV_KAS_ECC},
-    { ACVP_KAS_ECC_COMP,      &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_COMP, ACVP_REV_KAS_ECC},
-    { ACVP_KAS_ECC_NOCOMP,    &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_NOCOMP, ACVP_REV_KAS_ECC},
-    { ACVP_KAS_FFC_COMP,      &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_COMP, ACVP_REV_KAS_FFC},
-    { ACVP_KAS_FFC_NOCOMP,    &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_NOCOMP, ACVP_REV_KAS_FFC}
+    { ACVP_AES_GCM,           &acvp_aes_kat_handler,          ACVP_ALG_AES_GCM,           NULL, ACVP_REV_AES_GCM, 0},
+    { ACVP_AES_CCM,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CCM,           NULL, ACVP_REV_AES_CCM, 0},
+    { ACVP_AES_ECB,           &acvp_aes_kat_handler,          ACVP_ALG_AES_ECB,           NULL, ACVP_REV_AES_ECB, 0},
+    { ACVP_AES_CBC,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CBC,           NULL, ACVP_REV_AES_CBC, 0},
+    { ACVP_AES_CFB1,          &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB1,          NULL, ACVP_REV_AES_CFB1, 0},
+    { ACVP_AES_CFB8,          &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB8,          NULL, ACVP_REV_AES_CFB8, 0},
+    { ACVP_AES_CFB128,        &acvp_aes_kat_handler,          ACVP_ALG_AES_CFB128,        NULL, ACVP_REV_AES_CFB128, 0},
+    { ACVP_AES_OFB,           &acvp_aes_kat_handler,          ACVP_ALG_AES_OFB,           NULL, ACVP_REV_AES_OFB, 0},
+    { ACVP_AES_CTR,           &acvp_aes_kat_handler,          ACVP_ALG_AES_CTR,           NULL, ACVP_REV_AES_CTR, 0},
+    { ACVP_AES_XTS,           &acvp_aes_kat_handler,          ACVP_ALG_AES_XTS,           NULL, ACVP_REV_AES_XTS, 0},
+    { ACVP_AES_KW,            &acvp_aes_kat_handler,          ACVP_ALG_AES_KW,            NULL, ACVP_REV_AES_KW, 0},
+    { ACVP_AES_KWP,           &acvp_aes_kat_handler,          ACVP_ALG_AES_KWP,           NULL, ACVP_REV_AES_KWP, 0},
+    { ACVP_TDES_ECB,          &acvp_des_kat_handler,          ACVP_ALG_TDES_ECB,          NULL, ACVP_REV_TDES_ECB, 0},
+    { ACVP_TDES_CBC,          &acvp_des_kat_handler,          ACVP_ALG_TDES_CBC,          NULL, ACVP_REV_TDES_CBC, 0},
+    { ACVP_TDES_CBCI,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CBCI,         NULL, ACVP_REV_TDES_CBCI, 0},
+    { ACVP_TDES_OFB,          &acvp_des_kat_handler,          ACVP_ALG_TDES_OFB,          NULL, ACVP_REV_TDES_OFB, 0},
+    { ACVP_TDES_OFBI,         &acvp_des_kat_handler,          ACVP_ALG_TDES_OFBI,         NULL, ACVP_REV_TDES_OFBI, 0},
+    { ACVP_TDES_CFB1,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB1,         NULL, ACVP_REV_TDES_CFB1, 0},
+    { ACVP_TDES_CFB8,         &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB8,         NULL, ACVP_REV_TDES_CFB8, 0},
+    { ACVP_TDES_CFB64,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFB64,        NULL, ACVP_REV_TDES_CFB64, 0},
+    { ACVP_TDES_CFBP1,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP1,        NULL, ACVP_REV_TDES_CFBP1, 0},
+    { ACVP_TDES_CFBP8,        &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP8,        NULL, ACVP_REV_TDES_CFBP8, 0},
+    { ACVP_TDES_CFBP64,       &acvp_des_kat_handler,          ACVP_ALG_TDES_CFBP64,       NULL, ACVP_REV_TDES_CFBP64, 0},
+    { ACVP_TDES_CTR,          &acvp_des_kat_handler,          ACVP_ALG_TDES_CTR,          NULL, ACVP_REV_TDES_CTR, 0},
+    { ACVP_TDES_KW,           &acvp_des_kat_handler,          ACVP_ALG_TDES_KW,           NULL, ACVP_REV_TDES_KW, 0},
+    { ACVP_HASH_SHA1,         &acvp_hash_kat_handler,         ACVP_ALG_SHA1,              NULL, ACVP_REV_HASH_SHA1, 1},
+    { ACVP_HASH_SHA224,       &acvp_hash_kat_handler,         ACVP_ALG_SHA224,            NULL, ACVP_REV_HASH_SHA224, 1},
+    { ACVP_HASH_SHA256,       &acvp_hash_kat_handler,         ACVP_ALG_SHA256,            NULL, ACVP_REV_HASH_SHA256, 1},
+    { ACVP_HASH_SHA384,       &acvp_hash_kat_handler,         ACVP_ALG_SHA384,            NULL, ACVP_REV_HASH_SHA384, 1},
+    { ACVP_HASH_SHA512,       &acvp_hash_kat_handler,         ACVP_ALG_SHA512,            NULL, ACVP_REV_HASH_SHA512, 1},
+    { ACVP_HASHDRBG,          &acvp_drbg_kat_handler,         ACVP_ALG_HASHDRBG,          NULL, ACVP_REV_HASHDRBG, 0},
+    { ACVP_HMACDRBG,          &acvp_drbg_kat_handler,         ACVP_ALG_HMACDRBG,          NULL, ACVP_REV_HMACDRBG, 0},
+    { ACVP_CTRDRBG,           &acvp_drbg_kat_handler,         ACVP_ALG_CTRDRBG,           NULL, ACVP_REV_CTRDRBG, 0},
+    { ACVP_HMAC_SHA1,         &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA1,         NULL, ACVP_REV_HMAC_SHA1, 0},
+    { ACVP_HMAC_SHA2_224,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_224,     NULL, ACVP_REV_HMAC_SHA2_224, 0},
+    { ACVP_HMAC_SHA2_256,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_256,     NULL, ACVP_REV_HMAC_SHA2_256, 0},
+    { ACVP_HMAC_SHA2_384,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_384,     NULL, ACVP_REV_HMAC_SHA2_384, 0},
+    { ACVP_HMAC_SHA2_512,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512,     NULL, ACVP_REV_HMAC_SHA2_512, 0},
+    { ACVP_HMAC_SHA2_512_224, &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512_224, NULL, ACVP_REV_HMAC_SHA2_512_224, 0},
+    { ACVP_HMAC_SHA2_512_256, &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA2_512_256, NULL, ACVP_REV_HMAC_SHA2_512_256, 0},
+    { ACVP_HMAC_SHA3_224,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_224,     NULL, ACVP_REV_HMAC_SHA3_224, 0},
+    { ACVP_HMAC_SHA3_256,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_256,     NULL, ACVP_REV_HMAC_SHA3_256, 0},
+    { ACVP_HMAC_SHA3_384,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_384,     NULL, ACVP_REV_HMAC_SHA3_384, 0},
+    { ACVP_HMAC_SHA3_512,     &acvp_hmac_kat_handler,         ACVP_ALG_HMAC_SHA3_512,     NULL, ACVP_REV_HMAC_SHA3_512, 0},
+    { ACVP_CMAC_AES,          &acvp_cmac_kat_handler,         ACVP_ALG_CMAC_AES,          NULL, ACVP_REV_CMAC_AES, 0},
+    { ACVP_CMAC_TDES,         &acvp_cmac_kat_handler,         ACVP_ALG_CMAC_TDES,         NULL, ACVP_REV_CMAC_TDES, 0},
+    { ACVP_DSA_KEYGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_KEYGEN, ACVP_REV_DSA, 0},
+    { ACVP_DSA_PQGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGGEN, ACVP_REV_DSA, 0},
+    { ACVP_DSA_PQGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_PQGVER, ACVP_REV_DSA, 0},
+    { ACVP_DSA_SIGGEN,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGGEN, ACVP_REV_DSA, 0},
+    { ACVP_DSA_SIGVER,        &acvp_dsa_kat_handler,          ACVP_ALG_DSA,               ACVP_ALG_DSA_SIGVER, ACVP_REV_DSA, 0},
+    { ACVP_RSA_KEYGEN,        &acvp_rsa_keygen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_KEYGEN, ACVP_REV_RSA, 0},
+    { ACVP_RSA_SIGGEN,        &acvp_rsa_siggen_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGGEN, ACVP_REV_RSA, 0},
+    { ACVP_RSA_SIGVER,        &acvp_rsa_sigver_kat_handler,   ACVP_ALG_RSA,               ACVP_MODE_SIGVER, ACVP_REV_RSA, 0},
+    { ACVP_ECDSA_KEYGEN,      &acvp_ecdsa_keygen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYGEN, ACVP_REV_RSA, 0},
+    { ACVP_ECDSA_KEYVER,      &acvp_ecdsa_keyver_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_KEYVER, ACVP_REV_RSA, 0},
+    { ACVP_ECDSA_SIGGEN,      &acvp_ecdsa_siggen_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_SIGGEN, ACVP_REV_RSA, 0},
+    { ACVP_ECDSA_SIGVER,      &acvp_ecdsa_sigver_kat_handler, ACVP_ALG_ECDSA,             ACVP_MODE_SIGVER, ACVP_REV_RSA, 0},
+    { ACVP_KDF135_TLS,        &acvp_kdf135_tls_kat_handler,   ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_TLS, ACVP_REV_KDF135_TLS, 0},
+    { ACVP_KDF135_SNMP,       &acvp_kdf135_snmp_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SNMP, ACVP_REV_KDF135_SNMP, 0},
+    { ACVP_KDF135_SSH,        &acvp_kdf135_ssh_kat_handler,   ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SSH, ACVP_REV_KDF135_SSH, 0},
+    { ACVP_KDF135_SRTP,       &acvp_kdf135_srtp_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_SRTP, ACVP_REV_KDF135_SRTP, 0},
+    { ACVP_KDF135_IKEV2,      &acvp_kdf135_ikev2_kat_handler, ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_IKEV2, ACVP_REV_KDF135_IKEV2, 0},
+    { ACVP_KDF135_IKEV1,      &acvp_kdf135_ikev1_kat_handler, ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_IKEV1, ACVP_REV_KDF135_IKEV1, 0},
+    { ACVP_KDF135_X963,       &acvp_kdf135_x963_kat_handler,  ACVP_KDF135_ALG_STR,        ACVP_ALG_KDF135_X963, ACVP_REV_KDF135_X963, 0},
+    { ACVP_KDF108,            &acvp_kdf108_kat_handler,       ACVP_ALG_KDF108,            NULL, ACVP_REV_KDF108, 0},
+    { ACVP_KAS_ECC_CDH,       &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_CDH, ACVP_REV_KAS_ECC, 0},
+    { ACVP_KAS_ECC_COMP,      &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_COMP, ACVP_REV_KAS_ECC, 0},
+    { ACVP_KAS_ECC_NOCOMP,    &acvp_kas_ecc_kat_handler,      ACVP_ALG_KAS_ECC,           ACVP_ALG_KAS_ECC_NOCOMP, ACVP_REV_KAS_ECC, 0},
+    { ACVP_KAS_FFC_COMP,      &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_COMP, ACVP_REV_KAS_FFC, 0},
+    { ACVP_KAS_FFC_NOCOMP,    &acvp_kas_ffc_kat_handler,      ACVP_ALG_KAS_FFC,           ACVP_ALG_KAS_FFC_NOCOMP, ACVP_REV_KAS_FFC, 0}
 };
 
 /*
@@ -579,6 +590,11 @@ ACVP_RESULT acvp_free_test_session(ACVP_CTX *ctx) {
     if (ctx) {
         if (ctx->kat_resp) { json_value_free(ctx->kat_resp); }
         if (ctx->curl_buf) { free(ctx->curl_buf); }
+        if (ctx->rcv_val) { json_value_free(ctx->rcv_val); }
+        acvp_transport_cleanup(ctx);
+        if (ctx->net_log_file) { fclose(ctx->net_log_file); }
+        if (ctx->net_record_file) { fclose(ctx->net_record_file); }
+        if (ctx->retry_budget) { free(ctx->retry_budget); }
         if (ctx->server_name) { free(ctx->server_name); }
         if (ctx->vendor_url) { free(ctx->vendor_url); }
         if (ctx->module_url) { free(ctx->module_url); }
@@ -1020,6 +1036,9 @@ ACVP_RESULT acvp_set_server(ACVP_CTX *ctx, char *server_name, int port) {
 
     ctx->server_port = port;
 
+    /* An open connection would point at the previous server */
+    acvp_transport_close(ctx);
+
     return ACVP_SUCCESS;
 }
 
@@ -1093,6 +1112,9 @@ ACVP_RESULT acvp_set_cacerts(ACVP_CTX *ctx, char *ca_file) {
     ctx->cacerts_file = calloc(ACVP_SESSION_PARAMS_STR_LEN_MAX + 1, sizeof(char));
     strcpy_s(ctx->cacerts_file, ACVP_SESSION_PARAMS_STR_LEN_MAX + 1, ca_file);
 
+    /* The transport handle picks up the new trust anchors when reopened */
+    acvp_transport_close(ctx);
+
     return ACVP_SUCCESS;
 }
 
@@ -1125,6 +1147,9 @@ ACVP_RESULT acvp_set_certkey(ACVP_CTX *ctx, char *cert_file, char *key_file) {
     ctx->tls_key = calloc(ACVP_SESSION_PARAMS_STR_LEN_MAX + 1, sizeof(char));
     strcpy_s(ctx->tls_key, ACVP_SESSION_PARAMS_STR_LEN_MAX + 1, key_file);
 
+    /* The transport handle picks up the new credentials when reopened */
+    acvp_transport_close(ctx);
+
     return ACVP_SUCCESS;
 }
 
@@ -1136,6 +1161,320 @@ ACVP_RESULT acvp_mark_as_sample(ACVP_CTX *ctx) {
     return ACVP_SUCCESS;
 }
 
+/*
+ * This function sets the callback that receives the results of
+ * each vector set from acvp_check_test_results().
+ */
+ACVP_RESULT acvp_set_result_callback(ACVP_CTX *ctx,
+                                     ACVP_RESULT (*result_cb)(const char *vsid_url,
+                                                              const char *disposition,
+                                                              const char *results,
+                                                              const char *expected)) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!result_cb) {
+        return ACVP_MISSING_ARG;
+    }
+    ctx->result_cb = result_cb;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function sets how many vector set results
+ * acvp_check_test_results() fetches at once.  A limit
+ * of 0 polls the session level results instead.
+ */
+ACVP_RESULT acvp_set_result_concurrency(ACVP_CTX *ctx, int limit) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (limit < 0 || limit > ACVP_WORKER_COUNT_MAX) {
+        ACVP_LOG_ERR("Result concurrency must be between 0 and %d", ACVP_WORKER_COUNT_MAX);
+        return ACVP_INVALID_ARG;
+    }
+    ctx->result_concurrency = limit;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function reports how many requests were sent to the
+ * server and how many of them reused an open connection.
+ */
+ACVP_RESULT acvp_get_connection_stats(ACVP_CTX *ctx, unsigned int *requests, unsigned int *reused) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!requests || !reused) {
+        return ACVP_MISSING_ARG;
+    }
+    *requests = ctx->net_requests;
+    *reused = ctx->net_conn_reused;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function sets the callback that receives the timings
+ * of every request sent to the server.
+ */
+ACVP_RESULT acvp_set_net_timing_callback(ACVP_CTX *ctx, void (*timing_cb)(const ACVP_NET_TIMING *timing)) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!timing_cb) {
+        return ACVP_MISSING_ARG;
+    }
+    ctx->net_timing_cb = timing_cb;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function returns the timings of the requests of one
+ * kind sent so far.
+ */
+ACVP_RESULT acvp_get_net_stats(ACVP_CTX *ctx, ACVP_NET_ACTION action, ACVP_NET_STATS *stats) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!stats) {
+        return ACVP_MISSING_ARG;
+    }
+    if (action < ACVP_NET_GET || action >= ACVP_NET_ACTION_MAX) {
+        ACVP_LOG_ERR("Invalid ACVP_NET_ACTION %d", action);
+        return ACVP_INVALID_ARG;
+    }
+    *stats = ctx->net_stats[action];
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function enables the download/compute/upload pipeline
+ * used by acvp_process_tests().  A depth of 0 disables it.
+ */
+ACVP_RESULT acvp_set_pipeline_depth(ACVP_CTX *ctx, int depth) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (depth < 0 || depth > ACVP_PIPELINE_DEPTH_MAX) {
+        ACVP_LOG_ERR("Pipeline depth must be between 0 and %d", ACVP_PIPELINE_DEPTH_MAX);
+        return ACVP_INVALID_ARG;
+    }
+#ifdef WIN32
+    if (depth) {
+        ACVP_LOG_WARN("Pipelining is not supported on this platform");
+        depth = 0;
+    }
+#endif
+    ctx->pipeline_depth = depth;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function sets how many vector sets acvp_process_tests()
+ * keeps in flight on the asynchronous transport.  A limit of 0
+ * goes back to blocking requests.
+ */
+ACVP_RESULT acvp_set_async_requests(ACVP_CTX *ctx, int limit) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (limit < 0 || limit > ACVP_ASYNC_REQUESTS_MAX) {
+        ACVP_LOG_ERR("Async requests must be between 0 and %d", ACVP_ASYNC_REQUESTS_MAX);
+        return ACVP_INVALID_ARG;
+    }
+    ctx->async_requests = limit;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function turns compression of the HTTP bodies on or off.
+ * The transport handle is reopened so that the next request
+ * picks up the new setting.
+ */
+ACVP_RESULT acvp_set_compression(ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (enable != 0 && enable != 1) {
+        ACVP_LOG_ERR("Compression must be 0 or 1");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->compress = enable;
+    acvp_transport_close(ctx);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function turns the per vector set JSON arena on or off.
+ */
+ACVP_RESULT acvp_set_json_arena(ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (enable != 0 && enable != 1) {
+        ACVP_LOG_ERR("JSON arena must be 0 or 1");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->json_arena = enable;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function turns the vector set reader on or off.
+ */
+ACVP_RESULT acvp_set_vs_reader(ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (enable != 0 && enable != 1) {
+        ACVP_LOG_ERR("Vector set reader must be 0 or 1");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->vs_reader = enable;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function sets how many bytes of each response from the
+ * server are logged.
+ */
+ACVP_RESULT acvp_set_net_log_preview(ACVP_CTX *ctx, int preview_len) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (preview_len < 0) {
+        ACVP_LOG_ERR("Log preview length must not be negative");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->net_log_preview = preview_len;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function opens the file that receives the responses from
+ * the server in full, closing the previous one.
+ */
+ACVP_RESULT acvp_set_net_log_file(ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (ctx->net_log_file) {
+        fclose(ctx->net_log_file);
+        ctx->net_log_file = NULL;
+    }
+    if (!filename) {
+        return ACVP_SUCCESS;
+    }
+    ctx->net_log_file = fopen(filename, "a");
+    if (!ctx->net_log_file) {
+        ACVP_LOG_ERR("Unable to open %s for the network log", filename);
+        return ACVP_INVALID_ARG;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function opens the file that receives every request and
+ * its response, closing the previous one.
+ */
+ACVP_RESULT acvp_set_net_record_file(ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (ctx->net_record_file) {
+        fclose(ctx->net_record_file);
+        ctx->net_record_file = NULL;
+    }
+    if (!filename) {
+        return ACVP_SUCCESS;
+    }
+    ctx->net_record_file = fopen(filename, "ab");
+    if (!ctx->net_record_file) {
+        ACVP_LOG_ERR("Unable to open %s for the network capture", filename);
+        return ACVP_INVALID_ARG;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function loads the capture the requests are answered from,
+ * replacing the previous one.
+ */
+ACVP_RESULT acvp_set_net_replay_file(ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    acvp_transport_replay_close(ctx);
+    if (!filename) {
+        return ACVP_SUCCESS;
+    }
+    return acvp_transport_replay_open(ctx, filename);
+}
+
+/*
+ * This function sets how requests that failed for a transient
+ * reason are resent.  The retry budget is shared by the worker
+ * contexts, so it is allocated here rather than kept in the ctx.
+ */
+ACVP_RESULT acvp_set_retry_policy(ACVP_CTX *ctx, const ACVP_RETRY_POLICY *policy) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!policy) {
+        return ACVP_MISSING_ARG;
+    }
+    if (policy->max_attempts < 1 || policy->max_attempts > ACVP_RETRY_ATTEMPTS_MAX) {
+        ACVP_LOG_ERR("Retry attempts must be between 1 and %d", ACVP_RETRY_ATTEMPTS_MAX);
+        return ACVP_INVALID_ARG;
+    }
+    if (policy->base_delay_ms < 0 || policy->max_delay_ms < policy->base_delay_ms ||
+        policy->max_delay_ms > ACVP_RETRY_DELAY_MAX_MS) {
+        ACVP_LOG_ERR("Retry delays must be between 0 and %d ms, base first", ACVP_RETRY_DELAY_MAX_MS);
+        return ACVP_INVALID_ARG;
+    }
+    if (policy->deadline_ms < 0 || policy->budget < 0) {
+        ACVP_LOG_ERR("Retry deadline and budget must not be negative");
+        return ACVP_INVALID_ARG;
+    }
+
+    if (policy->budget && !ctx->retry_budget) {
+        ctx->retry_budget = calloc(1, sizeof(int));
+        if (!ctx->retry_budget) {
+            return ACVP_MALLOC_FAIL;
+        }
+    } else if (!policy->budget && ctx->retry_budget) {
+        free(ctx->retry_budget);
+        ctx->retry_budget = NULL;
+    }
+    if (ctx->retry_budget) {
+        *ctx->retry_budget = policy->budget;
+    }
+    ctx->retry = *policy;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function sets the number of threads acvp_process_tests()
+ * will use to work through the vector sets of the test session.
+ */
+ACVP_RESULT acvp_set_worker_count(ACVP_CTX *ctx, int worker_count) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (worker_count < 1 || worker_count > ACVP_WORKER_COUNT_MAX) {
+        ACVP_LOG_ERR("Worker count must be between 1 and %d", ACVP_WORKER_COUNT_MAX);
+        return ACVP_INVALID_ARG;
+    }
+#ifdef WIN32
+    if (worker_count > 1) {
+        ACVP_LOG_WARN("Worker threads are not supported on this platform, using 1");
+        worker_count = 1;
+    }
+#endif
+    ctx->worker_count = worker_count;
+    return ACVP_SUCCESS;
+}
+
 /*
  * This function builds the JSON login message that
  * will be sent to the ACVP server. If enabled,
@@ -1468,6 +1807,7 @@ static ACVP_RESULT acvp_parse_login(ACVP_CTX *ctx) {
 
         ctx->jwt_token = calloc(ACVP_JWT_TOKEN_MAX + 1, sizeof(char));
         strcpy_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, jwt);
+        acvp_transport_reset_auth(ctx);
 
         ACVP_LOG_STATUS("JWT: %s", ctx->jwt_token);
     }
@@ -1691,6 +2031,7 @@ static ACVP_RESULT acvp_parse_test_session_register(ACVP_CTX *ctx) {
     access_token = json_object_get_string(obj, "accessToken");
     memzero_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1);
     strcpy_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, access_token);
+    acvp_transport_reset_auth(ctx);
 
     /*
      * Identify the VS identifiers provided by the server, save them for
@@ -1712,78 +2053,1288 @@ end:
 }
 
 /*
- * This function is used by the application after registration
- * to commence the testing.  All the testing will be handled
- * by libacvp.  This function will block the caller.  Therefore,
- * it should be run on a separate thread if needed.
+ * A vector set that is waiting to be downloaded.  The timer queue
+ * keeps these sorted by the time at which the server should next
+ * be asked for them.
  */
-ACVP_RESULT acvp_process_tests(ACVP_CTX *ctx) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
-    ACVP_STRING_LIST *vs_entry = NULL;
+typedef struct acvp_vs_timer_t {
+    char *vsid_url;         /* points into ctx->vsid_url_list */
+    int attempts;           /* "retry" responses received so far */
+    long long ready_ms;     /* earliest time for the next GET */
+    struct acvp_vs_timer_t *next;
+} ACVP_VS_TIMER;
 
-    if (!ctx) {
-        return ACVP_NO_CTX;
+/*
+ * Inserts the entry after any others that are due at the same time,
+ * so vector sets are otherwise handled in the order the server sent them.
+ */
+static void acvp_vs_timer_insert(ACVP_VS_TIMER **queue, ACVP_VS_TIMER *t) {
+    ACVP_VS_TIMER **pos = queue;
+
+    while (*pos && (*pos)->ready_ms <= t->ready_ms) {
+        pos = &(*pos)->next;
     }
+    t->next = *pos;
+    *pos = t;
+}
 
-    /*
-     * Iterate through the VS identifiers the server sent to us
-     * in the test session register response.  Process each vector set and
-     * return the results to the server.
-     */
-    vs_entry = ctx->vsid_url_list;
-    if (!vs_entry) {
-        return ACVP_MISSING_ARG;
+static ACVP_VS_TIMER *acvp_vs_timer_pop(ACVP_VS_TIMER **queue) {
+    ACVP_VS_TIMER *t = *queue;
+
+    if (t) {
+        *queue = t->next;
+        t->next = NULL;
     }
-    while (vs_entry) {
-        rv = acvp_process_vsid(ctx, vs_entry->string);
-        vs_entry = vs_entry->next;
+    return t;
+}
+
+static void acvp_vs_timer_free(ACVP_VS_TIMER *queue) {
+    ACVP_VS_TIMER *t = NULL;
+
+    while (queue) {
+        t = queue;
+        queue = queue->next;
+        free(t);
     }
+}
 
-    return rv;
+/*
+ * Builds the timer queue from the vsid_url_list, with every
+ * vector set due immediately.
+ */
+static ACVP_RESULT acvp_vs_timer_init(ACVP_CTX *ctx, ACVP_VS_TIMER **queue) {
+    ACVP_STRING_LIST *vs_entry = NULL;
+    ACVP_VS_TIMER *t = NULL;
+    long long now = acvp_time_ms();
+
+    *queue = NULL;
+    for (vs_entry = ctx->vsid_url_list; vs_entry; vs_entry = vs_entry->next) {
+        t = calloc(1, sizeof(ACVP_VS_TIMER));
+        if (!t) {
+            acvp_vs_timer_free(*queue);
+            *queue = NULL;
+            return ACVP_MALLOC_FAIL;
+        }
+        t->vsid_url = vs_entry->string;
+        t->ready_ms = now;
+        acvp_vs_timer_insert(queue, t);
+    }
+
+    return ACVP_SUCCESS;
 }
 
 /*
- * This is a minimal retry handler, which pauses for a specific time.
- * This allows the server time to generate the vectors on behalf of
- * the client.
+ * Schedules the next poll of a vector set that the server answered
+ * with "retry".  The server's hint is doubled each time the same set
+ * is still not ready, capped at ACVP_RETRY_TIME_MAX, and up to 25%
+ * jitter is added so the sets being polled don't stay in lock step.
  */
-static ACVP_RESULT acvp_retry_handler(ACVP_CTX *ctx, unsigned int retry_period) {
-    ACVP_LOG_STATUS("200 OK KAT values not ready, server requests we wait %u seconds and try again...", retry_period);
+static void acvp_vs_timer_backoff(ACVP_CTX *ctx, ACVP_VS_TIMER *t, unsigned int retry_period) {
+    long long delay_ms = 0;
+    int shift = t->attempts < ACVP_RETRY_BACKOFF_SHIFT_MAX ? t->attempts : ACVP_RETRY_BACKOFF_SHIFT_MAX;
+
+    ACVP_LOG_STATUS("200 OK %s not ready, server requests we wait %u seconds and try again...",
+                    t->vsid_url, retry_period);
     if (retry_period <= 0 || retry_period > ACVP_RETRY_TIME_MAX) {
         retry_period = ACVP_RETRY_TIME_MAX;
         ACVP_LOG_WARN("retry_period not found, using max retry period!");
     }
-    #ifdef WIN32
-    Sleep(retry_period);
-    #else
-    sleep(retry_period);
-    #endif
 
-    return ACVP_KAT_DOWNLOAD_RETRY;
+    delay_ms = ((long long)retry_period * 1000) << shift;
+    if (delay_ms > ACVP_RETRY_TIME_MAX * 1000) {
+        delay_ms = ACVP_RETRY_TIME_MAX * 1000;
+    }
+    delay_ms += acvp_jitter_ms(delay_ms / 4);
+    if (ctx->net_replay) {
+        /* The capture already holds the answer */
+        delay_ms = 0;
+    }
+
+    t->attempts++;
+    t->ready_ms = acvp_time_ms() + delay_ms;
+    ACVP_LOG_INFO("Polling %s again in %lld ms", t->vsid_url, delay_ms);
 }
 
 /*
- * This routine will iterate through all the vector sets, requesting
- * the test result from the server for each set.
+ * Downloads whichever pending vector set becomes ready first.  Sets
+ * the server isn't ready to hand out yet go back on the timer queue,
+ * so one slow set doesn't hold up the others.  On return *vsid_url is
+ * the vector set that was downloaded, or NULL once the queue is empty.
+ * The parsed vector set is returned in vs_val on ACVP_SUCCESS.
  */
-ACVP_RESULT acvp_check_test_results(ACVP_CTX *ctx) {
+static ACVP_RESULT acvp_vs_timer_next(ACVP_CTX *ctx, ACVP_VS_TIMER **queue,
+                                      char **vsid_url, JSON_Value **vs_val) {
     ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_VS_TIMER *t = NULL;
+    unsigned int retry_period = 0;
 
-    if (!ctx) {
-        return ACVP_NO_CTX;
+    *vsid_url = NULL;
+    while ((t = acvp_vs_timer_pop(queue))) {
+        acvp_sleep_ms(t->ready_ms - acvp_time_ms());
+
+        rv = acvp_get_vector_set(ctx, t->vsid_url, vs_val, &retry_period);
+        if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+            acvp_vs_timer_backoff(ctx, t, retry_period);
+            acvp_vs_timer_insert(queue, t);
+            continue;
+        }
+
+        *vsid_url = t->vsid_url;
+        free(t);
+        return rv;
     }
 
-    rv = acvp_get_result_test_session(ctx, ctx->session_url);
-    return rv;
+    return ACVP_SUCCESS;
 }
 
-/***************************************************************************************************************
-* Begin vector processing logic.  This code should probably go into another module.
-***************************************************************************************************************/
+/*
+ * A task that is run once for every vector set of the test session.
+ * When the server isn't ready for the vector set yet the task returns
+ * ACVP_KAT_DOWNLOAD_RETRY with the server's retry period, and the
+ * vector set is put back on the timer queue to be tried again later.
+ */
+typedef ACVP_RESULT (*ACVP_VS_TASK)(ACVP_CTX *ctx, char *vsid_url, unsigned int *retry_period);
 
-ACVP_RESULT acvp_refresh(ACVP_CTX *ctx) {
-    char *login = NULL;
-    int login_len = 0;
+/*
+ * Runs the task for each vector set on the caller's thread, in the
+ * order the vector sets become ready on the server.  Returns the
+ * first failure.
+ */
+static ACVP_RESULT acvp_run_vs_tasks_serial(ACVP_CTX *ctx, ACVP_VS_TASK task) {
+    ACVP_RESULT rv = ACVP_SUCCESS, result = ACVP_SUCCESS;
+    ACVP_VS_TIMER *queue = NULL, *t = NULL;
+    unsigned int retry_period = 0;
+
+    rv = acvp_vs_timer_init(ctx, &queue);
+    if (rv != ACVP_SUCCESS) return rv;
+
+    while ((t = acvp_vs_timer_pop(&queue))) {
+        acvp_sleep_ms(t->ready_ms - acvp_time_ms());
+
+        rv = task(ctx, t->vsid_url, &retry_period);
+        if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+            acvp_vs_timer_backoff(ctx, t, retry_period);
+            acvp_vs_timer_insert(&queue, t);
+            continue;
+        }
+        free(t);
+
+        if (rv != ACVP_SUCCESS && result == ACVP_SUCCESS) result = rv;
+    }
+
+    return result;
+}
+
+#ifndef WIN32
+/*
+ * State shared by the worker threads of acvp_run_vs_tasks().
+ * Each worker takes the next due vector set off the timer queue under
+ * the lock and runs the task for it on its own copy of the ACVP_CTX.
+ * A set the server isn't ready for yet goes back on the queue, so an
+ * idle worker waits for it rather than exiting while sets are in flight.
+ */
+typedef struct acvp_worker_pool_t {
+    ACVP_CTX *ctx;
+    ACVP_VS_TASK task;
+    ACVP_VS_TIMER *queue;   /* vector sets still to be handled */
+    int in_flight;          /* sets taken off the queue and not yet done */
+    ACVP_RESULT rv;         /* first failure seen by any worker */
+    pthread_mutex_t lock;
+    pthread_cond_t ready;   /* queue not empty or nothing left in flight */
+} ACVP_WORKER_POOL;
+
+/*
+ * Creates a worker context.  The session configuration, capabilities
+ * and callbacks are shared with the parent, while the transitory
+ * values (vs_id, kat_resp, curl_buf), the transport handle and the jwt
+ * are private to the worker so that it can download, process and
+ * upload independently.  The worker's connections and TLS sessions
+ * go through the parent's transport share when there is one.
+ */
+static ACVP_CTX *acvp_worker_ctx_new(ACVP_CTX *ctx) {
+    ACVP_CTX *wctx = NULL;
+
+    wctx = calloc(1, sizeof(ACVP_CTX));
+    if (!wctx) {
+        return NULL;
+    }
+    memcpy_s(wctx, sizeof(ACVP_CTX), ctx, sizeof(ACVP_CTX));
+
+    wctx->jwt_token = NULL;
+    wctx->vs_id = 0;
+    wctx->kat_resp = NULL;
+    wctx->curl_buf = NULL;
+    wctx->curl_read_ctr = 0;
+    wctx->curl_buf_max = 0;
+    wctx->rcv_stream = 0;
+    wctx->rcv_parser = NULL;
+    wctx->rcv_val = NULL;
+    wctx->curl_hnd = NULL;
+    wctx->curl_multi = NULL;
+    wctx->net_hdrs = NULL;
+    wctx->net_requests = 0;
+    wctx->net_conn_reused = 0;
+    memzero_s(wctx->net_stats, sizeof(wctx->net_stats));
+
+    if (ctx->jwt_token) {
+        wctx->jwt_token = calloc(ACVP_JWT_TOKEN_MAX + 1, sizeof(char));
+        if (!wctx->jwt_token) {
+            free(wctx);
+            return NULL;
+        }
+        strcpy_s(wctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, ctx->jwt_token);
+    }
+
+    return wctx;
+}
+
+/*
+ * Frees the fields owned by a worker context.  Everything else
+ * belongs to the parent and is released by acvp_free_test_session().
+ */
+static void acvp_worker_ctx_free(ACVP_CTX *wctx) {
+    if (!wctx) return;
+
+    if (wctx->jwt_token) { free(wctx->jwt_token); }
+    if (wctx->curl_buf) { free(wctx->curl_buf); }
+    if (wctx->kat_resp) { json_value_free(wctx->kat_resp); }
+    if (wctx->rcv_val) { json_value_free(wctx->rcv_val); }
+    acvp_transport_close(wctx);
+    free(wctx);
+}
+
+/*
+ * Adds the transport counters of a worker context to its parent.
+ * The caller serializes access to the parent.
+ */
+static void acvp_worker_ctx_merge(ACVP_CTX *ctx, ACVP_CTX *wctx) {
+    ACVP_NET_STATS *st = NULL, *wst = NULL;
+    int i = 0, j = 0;
+
+    if (!wctx) return;
+
+    ctx->net_requests += wctx->net_requests;
+    ctx->net_conn_reused += wctx->net_conn_reused;
+
+    for (i = ACVP_NET_GET; i < ACVP_NET_ACTION_MAX; i++) {
+        st = &ctx->net_stats[i];
+        wst = &wctx->net_stats[i];
+        st->count += wst->count;
+        st->failed += wst->failed;
+        st->retries += wst->retries;
+        st->namelookup_us += wst->namelookup_us;
+        st->connect_us += wst->connect_us;
+        st->appconnect_us += wst->appconnect_us;
+        st->ttfb_us += wst->ttfb_us;
+        st->total_us += wst->total_us;
+        if (wst->max_total_us > st->max_total_us) st->max_total_us = wst->max_total_us;
+        st->bytes_up += wst->bytes_up;
+        st->bytes_down += wst->bytes_down;
+        for (j = 0; j < ACVP_NET_HIST_BUCKETS; j++) {
+            st->ttfb_hist[j] += wst->ttfb_hist[j];
+            st->total_hist[j] += wst->total_hist[j];
+        }
+    }
+}
+
+static void *acvp_worker_thread(void *arg) {
+    ACVP_WORKER_POOL *pool = (ACVP_WORKER_POOL *)arg;
+    ACVP_VS_TIMER *t = NULL;
+    ACVP_CTX *wctx = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    unsigned int retry_period = 0;
+
+    wctx = acvp_worker_ctx_new(pool->ctx);
+    if (!wctx) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->rv == ACVP_SUCCESS) pool->rv = ACVP_MALLOC_FAIL;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        /* A set in flight may still come back for another retry */
+        while (!pool->queue && pool->in_flight) {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+        t = acvp_vs_timer_pop(&pool->queue);
+        if (t) pool->in_flight++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!t) break;
+
+        acvp_sleep_ms(t->ready_ms - acvp_time_ms());
+        rv = pool->task(wctx, t->vsid_url, &retry_period);
+        if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+            acvp_vs_timer_backoff(wctx, t, retry_period);
+            pthread_mutex_lock(&pool->lock);
+            acvp_vs_timer_insert(&pool->queue, t);
+            pool->in_flight--;
+            pthread_cond_signal(&pool->ready);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+        free(t);
+
+        pthread_mutex_lock(&pool->lock);
+        if (rv != ACVP_SUCCESS && pool->rv == ACVP_SUCCESS) pool->rv = rv;
+        pool->in_flight--;
+        if (!pool->in_flight && !pool->queue) {
+            /* Nothing left, let every waiting worker exit */
+            pthread_cond_broadcast(&pool->ready);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    acvp_worker_ctx_merge(pool->ctx, wctx);
+    pthread_mutex_unlock(&pool->lock);
+    acvp_worker_ctx_free(wctx);
+    return NULL;
+}
+#endif
+
+/*
+ * Runs the task for every vector set of the test session on up to
+ * worker_count threads.  Returns the first failure reported by a task.
+ */
+static ACVP_RESULT acvp_run_vs_tasks(ACVP_CTX *ctx, ACVP_VS_TASK task, int worker_count) {
+#ifndef WIN32
+    ACVP_WORKER_POOL pool;
+    pthread_t threads[ACVP_WORKER_COUNT_MAX];
+    int started = 0, i = 0;
+
+    if (worker_count <= 1) {
+        return acvp_run_vs_tasks_serial(ctx, task);
+    }
+
+    memzero_s(&pool, sizeof(ACVP_WORKER_POOL));
+    pool.ctx = ctx;
+    pool.task = task;
+    pool.rv = ACVP_SUCCESS;
+    if (pthread_mutex_init(&pool.lock, NULL)) {
+        ACVP_LOG_WARN("Unable to create worker pool lock, processing serially");
+        return acvp_run_vs_tasks_serial(ctx, task);
+    }
+    if (pthread_cond_init(&pool.ready, NULL)) {
+        ACVP_LOG_WARN("Unable to create worker pool condition, processing serially");
+        pthread_mutex_destroy(&pool.lock);
+        return acvp_run_vs_tasks_serial(ctx, task);
+    }
+    if (acvp_vs_timer_init(ctx, &pool.queue) != ACVP_SUCCESS) {
+        pthread_cond_destroy(&pool.ready);
+        pthread_mutex_destroy(&pool.lock);
+        return ACVP_MALLOC_FAIL;
+    }
+    acvp_transport_share_init(ctx);
+
+    for (i = 0; i < worker_count && i < ACVP_WORKER_COUNT_MAX; i++) {
+        if (pthread_create(&threads[i], NULL, acvp_worker_thread, &pool)) {
+            ACVP_LOG_WARN("Unable to start worker %d, continuing with %d", i, started);
+            break;
+        }
+        started++;
+    }
+
+    if (!started) {
+        /* Couldn't get any threads, do the work here */
+        acvp_vs_timer_free(pool.queue);
+        pthread_cond_destroy(&pool.ready);
+        pthread_mutex_destroy(&pool.lock);
+        return acvp_run_vs_tasks_serial(ctx, task);
+    }
+
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    acvp_vs_timer_free(pool.queue);
+    pthread_cond_destroy(&pool.ready);
+    pthread_mutex_destroy(&pool.lock);
+
+    return pool.rv;
+#else
+    return acvp_run_vs_tasks_serial(ctx, task);
+#endif
+}
+
+/*
+ * Creates the arena that the JSON of one vector set is allocated
+ * from while it is current, see acvp_set_json_arena().  Returns NULL
+ * when arenas are off, or couldn't be had, so that the heap is used.
+ */
+static JSON_Arena *acvp_vs_arena_new(ACVP_CTX *ctx) {
+    JSON_Arena *arena = NULL;
+
+    if (!ctx->json_arena) return NULL;
+
+    arena = json_arena_new(0);
+    if (!arena) {
+        ACVP_LOG_WARN("Unable to create JSON arena, using the heap");
+    }
+    return arena;
+}
+
+/*
+ * Drops the responses and results a vector set left in the ctx.
+ */
+static void acvp_vs_values_free(ACVP_CTX *ctx) {
+    if (ctx->kat_resp) {
+        json_value_free(ctx->kat_resp);
+        ctx->kat_resp = NULL;
+    }
+    if (ctx->rcv_val) {
+        json_value_free(ctx->rcv_val);
+        ctx->rcv_val = NULL;
+    }
+}
+
+/*
+ * Frees the arena of a vector set along with everything in it.  The
+ * values still held by the ctx came out of it and are dropped first.
+ */
+static void acvp_vs_arena_free(ACVP_CTX *ctx, JSON_Arena *arena) {
+    if (!arena) return;
+
+    acvp_vs_values_free(ctx);
+    ACVP_LOG_INFO("JSON arena released %lu bytes", (unsigned long)json_arena_used(arena));
+    json_arena_free(arena);
+}
+
+/*
+ * Task used by acvp_process_tests(): download the vector set,
+ * run the handler and upload the responses.
+ */
+static ACVP_RESULT acvp_vs_task_process(ACVP_CTX *ctx, char *vsid_url, unsigned int *retry_period) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    JSON_Arena *arena = NULL, *prev = NULL;
+
+    arena = acvp_vs_arena_new(ctx);
+    prev = json_arena_set(arena);
+
+    rv = acvp_get_vector_set(ctx, vsid_url, &val, retry_period);
+    if (rv == ACVP_SUCCESS) {
+        rv = acvp_process_vsid(ctx, vsid_url, val);
+    }
+
+    acvp_vs_arena_free(ctx, arena);
+    json_arena_set(prev);
+    return rv;
+}
+
+/*
+ * Parses the results of one vector set.  Returns ACVP_KAT_DOWNLOAD_RETRY
+ * along with a retry_period while the server is still grading it.
+ * Otherwise the parsed results are returned in res_val, which the
+ * caller frees, and disposition points into them.
+ */
+static ACVP_RESULT acvp_parse_vs_result(ACVP_CTX *ctx, const char *body, JSON_Value **res_val,
+                                        const char **disposition, unsigned int *retry_period) {
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    int diff = 1;
+
+    *res_val = NULL;
+    *disposition = NULL;
+    *retry_period = 0;
+
+    val = json_parse_string(body);
+    if (!val) {
+        ACVP_LOG_ERR("JSON parse error");
+        return ACVP_JSON_ERR;
+    }
+    obj = acvp_get_obj_from_rsp(val);
+
+    /*
+     * Check whether the server has finished grading this vector set
+     */
+    *retry_period = (unsigned int)json_object_get_number(obj, "retry");
+    *disposition = json_object_get_string(obj, "disposition");
+    if (*disposition) {
+        strcmp_s("incomplete", 10, *disposition, &diff);
+    }
+    if (!*retry_period && (!*disposition || !diff)) {
+        *retry_period = ACVP_RESULT_RETRY_TIME;
+    }
+    if (*retry_period) {
+        *disposition = NULL;
+        json_value_free(val);
+        return ACVP_KAT_DOWNLOAD_RETRY;
+    }
+
+    *res_val = val;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Task used by acvp_check_test_results(): fetch the results of one
+ * vector set, plus the expected answers in sample mode when it didn't
+ * pass, and hand them to the application's result callback.
+ */
+static ACVP_RESULT acvp_vs_task_result(ACVP_CTX *ctx, char *vsid_url, unsigned int *retry_period) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Value *val = NULL;
+    const char *disposition = NULL;
+    char *results = NULL;
+    int diff = 1, get_expected = 0;
+
+    *retry_period = 0;
+
+    rv = acvp_retrieve_vector_set_result(ctx, vsid_url);
+    if (rv != ACVP_SUCCESS) return rv;
+
+    rv = acvp_parse_vs_result(ctx, ctx->curl_buf, &val, &disposition, retry_period);
+    if (rv != ACVP_SUCCESS) return rv;
+
+    ACVP_LOG_STATUS("Vector set %s: %s", vsid_url, disposition);
+
+    /*
+     * Keep hold of the results, the expected answers
+     * will be received into the same buffer.
+     */
+    results = calloc(ctx->curl_read_ctr + 1, sizeof(char));
+    if (!results) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    memcpy_s(results, ctx->curl_read_ctr + 1, ctx->curl_buf, ctx->curl_read_ctr);
+
+    strcmp_s("passed", 6, disposition, &diff);
+    if (diff && ctx->is_sample) {
+        ACVP_LOG_STATUS("Getting expected results for failed Vector Set...");
+        rv = acvp_retrieve_expected_result(ctx, vsid_url);
+        if (rv != ACVP_SUCCESS) goto end;
+        get_expected = 1;
+    }
+
+    if (ctx->result_cb) {
+        rv = (ctx->result_cb)(vsid_url, disposition, results,
+                              get_expected ? ctx->curl_buf : NULL);
+    }
+
+end:
+    if (results) free(results);
+    json_value_free(val);
+    return rv;
+}
+
+/*
+ * State of acvp_run_vs_async().  Vector sets that are not due yet
+ * wait on the timer queue, the others have a request in flight on
+ * the ctx's curl multi handle.
+ */
+typedef struct acvp_async_loop_t ACVP_ASYNC_LOOP;
+
+/*
+ * A vector set with a request in flight.  The completion callback
+ * of each request starts the next one until the vector set is done.
+ */
+typedef struct acvp_async_op_t {
+    ACVP_ASYNC_LOOP *loop;
+    ACVP_VS_TIMER *t;
+    JSON_Value *res_val;    /* results, kept while the expected answers are fetched */
+    char *results;
+    JSON_Arena *arena;      /* the vector set and its responses, NULL = heap */
+} ACVP_ASYNC_OP;
+
+/*
+ * Starts the first request for the vector set of op.
+ */
+typedef ACVP_RESULT (*ACVP_ASYNC_START)(ACVP_CTX *ctx, ACVP_ASYNC_OP *op);
+
+struct acvp_async_loop_t {
+    ACVP_VS_TIMER *queue;
+    int in_flight;          /* vector sets with a request outstanding */
+    ACVP_RESULT rv;         /* first failure */
+};
+
+/*
+ * Finishes a vector set, recording the first failure.
+ */
+static void acvp_async_op_done(ACVP_CTX *ctx, ACVP_ASYNC_OP *op, ACVP_RESULT rv) {
+    ACVP_ASYNC_LOOP *loop = op->loop;
+
+    if (rv != ACVP_SUCCESS && loop->rv == ACVP_SUCCESS) loop->rv = rv;
+    loop->in_flight--;
+
+    free(op->t);
+    if (op->res_val) json_value_free(op->res_val);
+    if (op->results) free(op->results);
+    acvp_vs_arena_free(ctx, op->arena);
+    free(op);
+}
+
+/*
+ * The server isn't ready for this vector set, put it back
+ * on the timer queue.
+ */
+static void acvp_async_op_retry(ACVP_CTX *ctx, ACVP_ASYNC_OP *op, unsigned int retry_period) {
+    ACVP_ASYNC_LOOP *loop = op->loop;
+
+    acvp_vs_timer_backoff(ctx, op->t, retry_period);
+    acvp_vs_timer_insert(&loop->queue, op->t);
+    op->t = NULL;
+    acvp_async_op_done(ctx, op, ACVP_SUCCESS);
+}
+
+static void acvp_async_vs_uploaded(ACVP_CTX *ctx, ACVP_RESULT rv, const char *body, int body_len, void *arg) {
+    acvp_async_op_done(ctx, (ACVP_ASYNC_OP *)arg, rv);
+}
+
+/*
+ * A vector set has been downloaded: run the handler on this thread
+ * while the other transfers carry on, then upload the responses.
+ */
+static void acvp_async_vs_downloaded(ACVP_CTX *ctx, ACVP_RESULT rv, const char *body, int body_len, void *arg) {
+    ACVP_ASYNC_OP *op = (ACVP_ASYNC_OP *)arg;
+    JSON_Value *val = NULL, *kat_resp = NULL;
+    JSON_Arena *prev = NULL;
+    unsigned int retry_period = 0;
+
+    /* The responses go in the arena the download was parsed into */
+    prev = json_arena_set(op->arena);
+
+    if (rv != ACVP_SUCCESS) goto err;
+
+    rv = acvp_parse_vector_set(ctx, body, &val, &retry_period);
+    if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+        acvp_async_op_retry(ctx, op, retry_period);
+        json_arena_set(prev);
+        return;
+    }
+    if (rv != ACVP_SUCCESS) goto err;
+
+    rv = acvp_process_vector_set(ctx, acvp_get_obj_from_rsp(val));
+    json_value_free(val);
+    if (rv != ACVP_SUCCESS) goto err;
+
+    /*
+     * The responses travel with the request, leaving the ctx
+     * free for the next vector set.
+     */
+    kat_resp = ctx->kat_resp;
+    ctx->kat_resp = NULL;
+    ACVP_LOG_STATUS("POST vector set response vsId: %d", ctx->vs_id);
+    rv = acvp_async_submit_vector_responses(ctx, op->t->vsid_url, kat_resp,
+                                            acvp_async_vs_uploaded, op);
+    if (rv != ACVP_SUCCESS) goto err;
+    json_arena_set(prev);
+    return;
+
+err:
+    acvp_async_op_done(ctx, op, rv);
+    json_arena_set(prev);
+}
+
+/*
+ * The download request takes the arena of the vector set along, the
+ * body is parsed into it as it arrives.
+ */
+static ACVP_RESULT acvp_async_vs_start(ACVP_CTX *ctx, ACVP_ASYNC_OP *op) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    JSON_Arena *prev = NULL;
+
+    op->arena = acvp_vs_arena_new(ctx);
+    prev = json_arena_set(op->arena);
+    rv = acvp_async_retrieve_vector_set(ctx, op->t->vsid_url, acvp_async_vs_downloaded, op);
+    json_arena_set(prev);
+    return rv;
+}
+
+static void acvp_async_result_expected(ACVP_CTX *ctx, ACVP_RESULT rv, const char *body, int body_len, void *arg) {
+    ACVP_ASYNC_OP *op = (ACVP_ASYNC_OP *)arg;
+    const char *disposition = NULL;
+
+    if (rv == ACVP_SUCCESS && ctx->result_cb) {
+        disposition = json_object_get_string(acvp_get_obj_from_rsp(op->res_val), "disposition");
+        rv = (ctx->result_cb)(op->t->vsid_url, disposition, op->results, body);
+    }
+    acvp_async_op_done(ctx, op, rv);
+}
+
+/*
+ * The results of a vector set have arrived, see acvp_vs_task_result().
+ */
+static void acvp_async_result_received(ACVP_CTX *ctx, ACVP_RESULT rv, const char *body, int body_len, void *arg) {
+    ACVP_ASYNC_OP *op = (ACVP_ASYNC_OP *)arg;
+    const char *disposition = NULL;
+    unsigned int retry_period = 0;
+    int diff = 1;
+
+    if (rv != ACVP_SUCCESS) goto end;
+
+    rv = acvp_parse_vs_result(ctx, body, &op->res_val, &disposition, &retry_period);
+    if (rv == ACVP_KAT_DOWNLOAD_RETRY) {
+        acvp_async_op_retry(ctx, op, retry_period);
+        return;
+    }
+    if (rv != ACVP_SUCCESS) goto end;
+
+    ACVP_LOG_STATUS("Vector set %s: %s", op->t->vsid_url, disposition);
+
+    strcmp_s("passed", 6, disposition, &diff);
+    if (diff && ctx->is_sample) {
+        /*
+         * Keep hold of the results until the expected answers arrive
+         */
+        op->results = calloc(body_len + 1, sizeof(char));
+        if (!op->results) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        memcpy_s(op->results, body_len + 1, body, body_len);
+
+        ACVP_LOG_STATUS("Getting expected results for failed Vector Set...");
+        rv = acvp_async_retrieve_expected_result(ctx, op->t->vsid_url,
+                                                 acvp_async_result_expected, op);
+        if (rv != ACVP_SUCCESS) goto end;
+        return;
+    }
+
+    if (ctx->result_cb) {
+        rv = (ctx->result_cb)(op->t->vsid_url, disposition, body, NULL);
+    }
+
+end:
+    acvp_async_op_done(ctx, op, rv);
+}
+
+static ACVP_RESULT acvp_async_result_start(ACVP_CTX *ctx, ACVP_ASYNC_OP *op) {
+    return acvp_async_retrieve_vector_set_result(ctx, op->t->vsid_url,
+                                                 acvp_async_result_received, op);
+}
+
+/*
+ * Runs every vector set of the test session through the asynchronous
+ * transport on the caller's thread, with up to limit of them having a
+ * request in flight at once.  Vector sets are started as they become
+ * due on the timer queue, and moved along by the completion callbacks
+ * as their requests finish.  Returns the first failure.
+ */
+static ACVP_RESULT acvp_run_vs_async(ACVP_CTX *ctx, ACVP_ASYNC_START start, int limit) {
+    ACVP_ASYNC_LOOP loop;
+    ACVP_ASYNC_OP *op = NULL;
+    ACVP_VS_TIMER *t = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    long long wait_ms = 0;
+
+    memzero_s(&loop, sizeof(ACVP_ASYNC_LOOP));
+    loop.rv = ACVP_SUCCESS;
+    rv = acvp_vs_timer_init(ctx, &loop.queue);
+    if (rv != ACVP_SUCCESS) return rv;
+
+    /* Let new connections resume the TLS session */
+    acvp_transport_share_init(ctx);
+
+    while (loop.queue || loop.in_flight) {
+        while (loop.queue && loop.in_flight < limit &&
+               loop.queue->ready_ms <= acvp_time_ms()) {
+            t = acvp_vs_timer_pop(&loop.queue);
+            op = calloc(1, sizeof(ACVP_ASYNC_OP));
+            if (!op) {
+                free(t);
+                if (loop.rv == ACVP_SUCCESS) loop.rv = ACVP_MALLOC_FAIL;
+                continue;
+            }
+            op->loop = &loop;
+            op->t = t;
+            loop.in_flight++;
+
+            rv = start(ctx, op);
+            if (rv != ACVP_SUCCESS) {
+                acvp_async_op_done(ctx, op, rv);
+            }
+        }
+
+        /*
+         * Wake up for the next vector set that falls due,
+         * unless every slot is busy anyway.
+         */
+        wait_ms = ACVP_ASYNC_POLL_MS;
+        if (loop.queue && loop.in_flight < limit) {
+            wait_ms = loop.queue->ready_ms - acvp_time_ms();
+        }
+        if (!loop.in_flight) {
+            acvp_sleep_ms(wait_ms);
+            continue;
+        }
+
+        rv = acvp_async_run(ctx, wait_ms);
+        if (rv != ACVP_SUCCESS) {
+            /* Completes whatever is left in flight with an error */
+            acvp_async_cleanup(ctx);
+            if (loop.rv == ACVP_SUCCESS) loop.rv = rv;
+            break;
+        }
+    }
+
+    acvp_vs_timer_free(loop.queue);
+    return loop.rv;
+}
+
+#ifndef WIN32
+/*
+ * A unit of work passed between the stages of the pipeline.
+ */
+typedef struct acvp_vs_work_t {
+    char *vsid_url;         /* points into ctx->vsid_url_list */
+    int vs_id;
+    JSON_Value *vs_val;     /* vector set downloaded from the server */
+    JSON_Value *kat_resp;   /* responses produced by the handler */
+    JSON_Arena *arena;      /* vs_val and kat_resp live here, NULL = heap */
+    struct acvp_vs_work_t *next;
+} ACVP_VS_WORK;
+
+/*
+ * Bounded FIFO between two pipeline stages.  push() blocks while the
+ * queue is full and pop() blocks while it is empty, so at most depth
+ * vector sets are ever parked between stages.
+ */
+typedef struct acvp_vs_queue_t {
+    ACVP_VS_WORK *head;
+    ACVP_VS_WORK *tail;
+    int count;
+    int depth;
+    int closed;             /* producer is done, pop() drains then returns NULL */
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} ACVP_VS_QUEUE;
+
+typedef struct acvp_pipeline_t {
+    ACVP_VS_QUEUE downloaded;
+    ACVP_VS_QUEUE processed;
+    int computing;          /* compute stages still running */
+    ACVP_RESULT rv;         /* first failure seen by any stage */
+    pthread_mutex_t lock;
+} ACVP_PIPELINE;
+
+typedef struct acvp_pipeline_stage_t {
+    ACVP_PIPELINE *pipe;
+    ACVP_CTX *ctx;
+    pthread_t thread;
+} ACVP_PIPELINE_STAGE;
+
+static int acvp_vs_queue_init(ACVP_VS_QUEUE *q, int depth) {
+    memzero_s(q, sizeof(ACVP_VS_QUEUE));
+    q->depth = depth;
+    if (pthread_mutex_init(&q->lock, NULL)) return 1;
+    if (pthread_cond_init(&q->not_empty, NULL)) {
+        pthread_mutex_destroy(&q->lock);
+        return 1;
+    }
+    if (pthread_cond_init(&q->not_full, NULL)) {
+        pthread_cond_destroy(&q->not_empty);
+        pthread_mutex_destroy(&q->lock);
+        return 1;
+    }
+    return 0;
+}
+
+static void acvp_vs_work_free(ACVP_VS_WORK *work) {
+    if (!work) return;
+    if (work->vs_val) json_value_free(work->vs_val);
+    if (work->kat_resp) json_value_free(work->kat_resp);
+    json_arena_free(work->arena);
+    free(work);
+}
+
+static void acvp_vs_queue_destroy(ACVP_VS_QUEUE *q) {
+    ACVP_VS_WORK *work = NULL;
+
+    while (q->head) {
+        work = q->head;
+        q->head = work->next;
+        acvp_vs_work_free(work);
+    }
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+}
+
+static void acvp_vs_queue_push(ACVP_VS_QUEUE *q, ACVP_VS_WORK *work) {
+    work->next = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count >= q->depth) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    if (q->tail) {
+        q->tail->next = work;
+    } else {
+        q->head = work;
+    }
+    q->tail = work;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static ACVP_VS_WORK *acvp_vs_queue_pop(ACVP_VS_QUEUE *q) {
+    ACVP_VS_WORK *work = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->head && !q->closed) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    work = q->head;
+    if (work) {
+        q->head = work->next;
+        if (!q->head) q->tail = NULL;
+        q->count--;
+        work->next = NULL;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return work;
+}
+
+static void acvp_vs_queue_close(ACVP_VS_QUEUE *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void acvp_pipeline_fail(ACVP_PIPELINE *pipe, ACVP_RESULT rv) {
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->rv == ACVP_SUCCESS) pipe->rv = rv;
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+/*
+ * The last compute stage to finish closes the upload queue.
+ */
+static void acvp_pipeline_compute_done(ACVP_PIPELINE *pipe) {
+    int remaining = 0;
+
+    pthread_mutex_lock(&pipe->lock);
+    remaining = --pipe->computing;
+    pthread_mutex_unlock(&pipe->lock);
+
+    if (!remaining) acvp_vs_queue_close(&pipe->processed);
+}
+
+/*
+ * Compute stage: runs the handler for each downloaded vector set
+ * and hands the responses on to the upload stage.
+ */
+static void *acvp_pipeline_compute(void *arg) {
+    ACVP_PIPELINE_STAGE *stage = (ACVP_PIPELINE_STAGE *)arg;
+    ACVP_PIPELINE *pipe = stage->pipe;
+    ACVP_CTX *ctx = stage->ctx;
+    ACVP_VS_WORK *work = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    while ((work = acvp_vs_queue_pop(&pipe->downloaded))) {
+        json_arena_set(work->arena);
+        rv = acvp_process_vector_set(ctx, acvp_get_obj_from_rsp(work->vs_val));
+        json_value_free(work->vs_val);
+        work->vs_val = NULL;
+        json_arena_set(NULL);
+        if (rv != ACVP_SUCCESS) {
+            acvp_pipeline_fail(pipe, rv);
+            /* Unlike the serial path the loop goes on, don't leave
+               what the handler built for the next set to overwrite */
+            acvp_vs_values_free(ctx);
+            acvp_vs_arena_free(ctx, work->arena);
+            work->arena = NULL;
+            acvp_vs_work_free(work);
+            continue;
+        }
+
+        work->vs_id = ctx->vs_id;
+        work->kat_resp = ctx->kat_resp;
+        ctx->kat_resp = NULL;
+        acvp_vs_queue_push(&pipe->processed, work);
+    }
+
+    acvp_pipeline_compute_done(pipe);
+    return NULL;
+}
+
+/*
+ * Upload stage: POSTs the finished responses back to the server.
+ */
+static void *acvp_pipeline_upload(void *arg) {
+    ACVP_PIPELINE_STAGE *stage = (ACVP_PIPELINE_STAGE *)arg;
+    ACVP_PIPELINE *pipe = stage->pipe;
+    ACVP_CTX *ctx = stage->ctx;
+    ACVP_VS_WORK *work = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    while ((work = acvp_vs_queue_pop(&pipe->processed))) {
+        ctx->vs_id = work->vs_id;
+        ctx->kat_resp = work->kat_resp;
+        work->kat_resp = NULL;
+
+        ACVP_LOG_STATUS("POST vector set response vsId: %d", ctx->vs_id);
+        rv = acvp_submit_vector_responses(ctx, work->vsid_url);
+        if (rv != ACVP_SUCCESS) acvp_pipeline_fail(pipe, rv);
+
+        if (ctx->kat_resp) {
+            json_value_free(ctx->kat_resp);
+            ctx->kat_resp = NULL;
+        }
+        acvp_vs_work_free(work);
+    }
+
+    return NULL;
+}
+
+/*
+ * Runs the test session as a three stage pipeline.  The calling thread
+ * downloads the vector sets, ctx->worker_count threads run the handlers
+ * and one thread uploads the responses, so that network and crypto time
+ * overlap.  The stages are connected by queues of ctx->pipeline_depth
+ * entries.  Returns the first failure seen by any stage.
+ */
+static ACVP_RESULT acvp_process_tests_pipeline(ACVP_CTX *ctx) {
+    ACVP_PIPELINE pipe;
+    ACVP_PIPELINE_STAGE upload;
+    ACVP_PIPELINE_STAGE compute[ACVP_WORKER_COUNT_MAX];
+    ACVP_VS_TIMER *queue = NULL;
+    ACVP_CTX *dl_ctx = NULL;
+    ACVP_VS_WORK *work = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    int compute_cnt = ctx->worker_count > 1 ? ctx->worker_count : 1;
+    int started = 0, fallback = 0, i = 0;
+
+    memzero_s(&pipe, sizeof(ACVP_PIPELINE));
+    memzero_s(&upload, sizeof(ACVP_PIPELINE_STAGE));
+    memzero_s(compute, sizeof(compute));
+
+    /*
+     * Every stage gets its own context, created up front so that
+     * nothing can fail once the threads are running.
+     */
+    acvp_transport_share_init(ctx);
+    dl_ctx = acvp_worker_ctx_new(ctx);
+    upload.ctx = acvp_worker_ctx_new(ctx);
+    upload.pipe = &pipe;
+    if (!dl_ctx || !upload.ctx) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    rv = acvp_vs_timer_init(ctx, &queue);
+    if (rv != ACVP_SUCCESS) goto end;
+    for (i = 0; i < compute_cnt; i++) {
+        compute[i].pipe = &pipe;
+        compute[i].ctx = acvp_worker_ctx_new(ctx);
+        if (!compute[i].ctx) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+    }
+
+    if (pthread_mutex_init(&pipe.lock, NULL)) {
+        fallback = 1;
+        goto end;
+    }
+    if (acvp_vs_queue_init(&pipe.downloaded, ctx->pipeline_depth)) {
+        pthread_mutex_destroy(&pipe.lock);
+        fallback = 1;
+        goto end;
+    }
+    if (acvp_vs_queue_init(&pipe.processed, ctx->pipeline_depth)) {
+        acvp_vs_queue_destroy(&pipe.downloaded);
+        pthread_mutex_destroy(&pipe.lock);
+        fallback = 1;
+        goto end;
+    }
+
+    if (pthread_create(&upload.thread, NULL, acvp_pipeline_upload, &upload)) {
+        fallback = 1;
+        goto teardown;
+    }
+
+    pipe.computing = compute_cnt;
+    for (i = 0; i < compute_cnt; i++) {
+        if (pthread_create(&compute[i].thread, NULL, acvp_pipeline_compute, &compute[i])) {
+            ACVP_LOG_WARN("Unable to start compute stage %d, continuing with %d", i, started);
+            break;
+        }
+        started++;
+    }
+    if (started < compute_cnt) {
+        /* Account for the stages that never started */
+        pthread_mutex_lock(&pipe.lock);
+        pipe.computing -= compute_cnt - started;
+        pthread_mutex_unlock(&pipe.lock);
+        if (!started) {
+            acvp_vs_queue_close(&pipe.downloaded);
+            acvp_vs_queue_close(&pipe.processed);
+            pthread_join(upload.thread, NULL);
+            fallback = 1;
+            goto teardown;
+        }
+    }
+
+    /*
+     * Download stage, runs on the calling thread
+     */
+    while (queue) {
+        JSON_Value *val = NULL;
+        JSON_Arena *arena = NULL;
+        char *vsid_url = NULL;
+
+        /* The arena travels with the vector set through the stages */
+        arena = acvp_vs_arena_new(dl_ctx);
+        json_arena_set(arena);
+        rv = acvp_vs_timer_next(dl_ctx, &queue, &vsid_url, &val);
+        json_arena_set(NULL);
+        if (!vsid_url || rv != ACVP_SUCCESS) {
+            acvp_vs_arena_free(dl_ctx, arena);
+            if (!vsid_url) break;
+            acvp_pipeline_fail(&pipe, rv);
+            continue;
+        }
+
+        work = calloc(1, sizeof(ACVP_VS_WORK));
+        if (!work) {
+            json_value_free(val);
+            acvp_vs_arena_free(dl_ctx, arena);
+            acvp_pipeline_fail(&pipe, ACVP_MALLOC_FAIL);
+            break;
+        }
+        work->vsid_url = vsid_url;
+        work->vs_val = val;
+        work->arena = arena;
+        acvp_vs_queue_push(&pipe.downloaded, work);
+    }
+    acvp_vs_queue_close(&pipe.downloaded);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(compute[i].thread, NULL);
+    }
+    pthread_join(upload.thread, NULL);
+    rv = pipe.rv;
+
+teardown:
+    acvp_vs_queue_destroy(&pipe.processed);
+    acvp_vs_queue_destroy(&pipe.downloaded);
+    pthread_mutex_destroy(&pipe.lock);
+
+end:
+    acvp_vs_timer_free(queue);
+    for (i = 0; i < compute_cnt; i++) {
+        acvp_worker_ctx_merge(ctx, compute[i].ctx);
+        acvp_worker_ctx_free(compute[i].ctx);
+    }
+    acvp_worker_ctx_merge(ctx, upload.ctx);
+    acvp_worker_ctx_free(upload.ctx);
+    acvp_worker_ctx_merge(ctx, dl_ctx);
+    acvp_worker_ctx_free(dl_ctx);
+
+    if (fallback) {
+        ACVP_LOG_WARN("Unable to start the pipeline, processing serially");
+        return acvp_run_vs_tasks_serial(ctx, acvp_vs_task_process);
+    }
+    return rv;
+}
+#endif
+
+/*
+ * This function is used by the application after registration
+ * to commence the testing.  All the testing will be handled
+ * by libacvp.  This function will block the caller.  Therefore,
+ * it should be run on a separate thread if needed.
+ *
+ * When a worker count has been set with acvp_set_worker_count(),
+ * the vector sets are spread across that many threads.
+ */
+ACVP_RESULT acvp_process_tests(ACVP_CTX *ctx) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+
+    /*
+     * Iterate through the VS identifiers the server sent to us
+     * in the test session register response.  Process each vector set and
+     * return the results to the server.
+     */
+    if (!ctx->vsid_url_list) {
+        return ACVP_MISSING_ARG;
+    }
+
+    if (ctx->async_requests > 0) {
+        return acvp_run_vs_async(ctx, acvp_async_vs_start, ctx->async_requests);
+    }
+
+#ifndef WIN32
+    if (ctx->pipeline_depth > 0) {
+        return acvp_process_tests_pipeline(ctx);
+    }
+#endif
+
+    return acvp_run_vs_tasks(ctx, acvp_vs_task_process, ctx->worker_count);
+}
+
+/*
+ * This is a minimal retry handler, which pauses for a specific time.
+ * This allows the server time to generate the vectors on behalf of
+ * the client.
+ */
+static ACVP_RESULT acvp_retry_handler(ACVP_CTX *ctx, unsigned int retry_period) {
+    ACVP_LOG_STATUS("200 OK KAT values not ready, server requests we wait %u seconds and try again...", retry_period);
+    if (retry_period <= 0 || retry_period > ACVP_RETRY_TIME_MAX) {
+        retry_period = ACVP_RETRY_TIME_MAX;
+        ACVP_LOG_WARN("retry_period not found, using max retry period!");
+    }
+    if (ctx->net_replay) {
+        return ACVP_KAT_DOWNLOAD_RETRY;
+    }
+    #ifdef WIN32
+    Sleep(retry_period);
+    #else
+    sleep(retry_period);
+    #endif
+
+    return ACVP_KAT_DOWNLOAD_RETRY;
+}
+
+/*
+ * This routine will iterate through all the vector sets, requesting
+ * the test result from the server for each set.  By default the
+ * session level results are polled.  When a result concurrency has
+ * been set, the per vector set results are fetched in parallel and
+ * passed to the result callback as they arrive.
+ */
+ACVP_RESULT acvp_check_test_results(ACVP_CTX *ctx) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+
+    if (ctx->result_concurrency > 0) {
+        /*
+         * Fetch the results of each vector set on its own,
+         * as soon as the server has graded it.
+         */
+        if (!ctx->vsid_url_list) {
+            return ACVP_MISSING_ARG;
+        }
+        if (ctx->async_requests > 0) {
+            return acvp_run_vs_async(ctx, acvp_async_result_start, ctx->result_concurrency);
+        }
+        return acvp_run_vs_tasks(ctx, acvp_vs_task_result, ctx->result_concurrency);
+    }
+
+    rv = acvp_get_result_test_session(ctx, ctx->session_url);
+    return rv;
+}
+
+/***************************************************************************************************************
+* Begin vector processing logic.  This code should probably go into another module.
+***************************************************************************************************************/
+
+ACVP_RESULT acvp_refresh(ACVP_CTX *ctx) {
+    char *login = NULL;
+    int login_len = 0;
     ACVP_RESULT rv = ACVP_SUCCESS;
 
     if (!ctx) {
@@ -1815,71 +3366,223 @@ end:
 }
 
 /*
- * This function will process a single KAT vector set.  Each KAT
- * vector set has an identifier associated with it, called
- * the vs_id.  During registration, libacvp will receive the
- * list of vs_id's that need to be processed during the test
- * session.  This routine will execute the test flow for a single
- * vs_id.  The flow is:
- *	a) Download the KAT vector set from the server using the vs_id
- *	b) Parse the KAT vectors
- *	c) Process each test case in the KAT vector set
- *	d) Generate the response data
- *	e) Send the response data back to the ACVP server
- */
-static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url) {
+ * This function downloads a single KAT vector set.  If the server
+ * is still generating the vectors it answers with a "retry" period,
+ * which is returned in retry_period along with ACVP_KAT_DOWNLOAD_RETRY.
+ * On success the parsed vector set is returned in vs_val and must be
+ * freed by the caller.
+ */
+static ACVP_RESULT acvp_get_vector_set(ACVP_CTX *ctx, char *vsid_url, JSON_Value **vs_val,
+                                       unsigned int *retry_period) {
     ACVP_RESULT rv = ACVP_SUCCESS;
+
+    *vs_val = NULL;
+    *retry_period = 0;
+
+    /*
+     * Get the KAT vector set
+     */
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    if (rv != ACVP_SUCCESS) return rv;
+
+    rv = acvp_parse_vector_set(ctx, ctx->curl_buf, vs_val, retry_period);
+
+    /*
+     * A vector set read with ctx->vs_reader on holds its own copy of the
+     * test groups text.  Free the body now instead of when the next
+     * response arrives, so that the handler doesn't run with both.
+     */
+    if (ctx->vs_reader && ctx->curl_buf) {
+        free(ctx->curl_buf);
+        ctx->curl_buf = NULL;
+        ctx->curl_read_ctr = 0;
+        ctx->curl_buf_max = 0;
+    }
+    return rv;
+}
+
+/*
+ * This function parses a vector set received from the server,
+ * see acvp_get_vector_set().  When the transport already parsed the
+ * response while it was being received, that value is taken over
+ * and body is not looked at.
+ */
+static ACVP_RESULT acvp_parse_vector_set(ACVP_CTX *ctx, const char *body, JSON_Value **vs_val,
+                                         unsigned int *retry_period) {
     JSON_Value *val = NULL;
     JSON_Object *obj = NULL;
-    unsigned int retry_period = 0;
-    int retry = 1;
 
-    //TODO: do we want to limit the number of retries?
-    while (retry) {
-        /*
-         * Get the KAT vector set
-         */
-        rv = acvp_retrieve_vector_set(ctx, vsid_url);
-        if (rv != ACVP_SUCCESS) goto end;
+    *vs_val = NULL;
+    *retry_period = 0;
 
-        val = json_parse_string(ctx->curl_buf);
-        if (!val) {
-            ACVP_LOG_ERR("JSON parse error");
-            rv = ACVP_JSON_ERR;
-            goto end;
-        }
-        obj = acvp_get_obj_from_rsp(val);
+    if (ctx->rcv_val) {
+        val = ctx->rcv_val;
+        ctx->rcv_val = NULL;
+    } else if (ctx->vs_reader) {
+        val = acvp_read_vector_set(body);
+    } else {
+        val = json_parse_string(body);
+    }
+    if (!val) {
+        ACVP_LOG_ERR("JSON parse error");
+        return ACVP_JSON_ERR;
+    }
+    obj = acvp_get_obj_from_rsp(val);
 
-        /*
-         * Check if we received a retry response
-         */
-        retry_period = (unsigned int)json_object_get_number(obj, "retry");
-        if (retry_period) {
-            /*
-             * Wait and try again to retrieve the VectorSet
-             */
-            acvp_retry_handler(ctx, retry_period);
-            retry = 1;
-        } else {
-            /*
-             * Process the KAT VectorSet
-             */
-            rv = acvp_process_vector_set(ctx, obj);
-            retry = 0;
+    /*
+     * Check if we received a retry response
+     */
+    *retry_period = (unsigned int)json_object_get_number(obj, "retry");
+    if (*retry_period) {
+        json_value_free(val);
+        return ACVP_KAT_DOWNLOAD_RETRY;
+    }
+
+    *vs_val = val;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Parses a vector set for a handler that walks its test groups with an
+ * ACVP_VS_READER, see acvp_set_vs_reader().  Everything but the test
+ * groups is parsed, "testGroups" is kept as a string holding their
+ * JSON text.  Vector sets for the other handlers, retry responses and
+ * anything unexpected are parsed in full.
+ */
+static JSON_Value *acvp_read_vector_set(const char *body) {
+    JSON_Reader *reader = NULL;
+    JSON_Value *val = NULL, *member = NULL;
+    JSON_Object *vs_obj = NULL;
+    JSON_Value_Type type = JSONError;
+    ACVP_ALG_HANDLER *entry = NULL;
+    const char *groups = NULL, *name = NULL;
+    size_t groups_len = 0;
+    int diff = 1;
+
+    reader = json_reader_new(body);
+    if (!reader) goto full;
+
+    /* [{"acvVersion": ...}, {vector set}] */
+    if (json_reader_next(reader) != JSONArray ||
+        json_reader_enter(reader) != JSONSuccess ||
+        json_reader_next(reader) == JSONReaderEnd) {
+        goto full;
+    }
+    val = json_value_init_array();
+    if (!val) goto full;
+    member = json_reader_value(reader);
+    if (!member) goto full;
+    if (json_array_append_value(json_array(val), member) != JSONSuccess) {
+        json_value_free(member);
+        goto full;
+    }
+
+    if (json_reader_next(reader) != JSONObject ||
+        json_reader_enter(reader) != JSONSuccess) {
+        goto full;
+    }
+    member = json_value_init_object();
+    if (!member) goto full;
+    if (json_array_append_value(json_array(val), member) != JSONSuccess) {
+        json_value_free(member);
+        goto full;
+    }
+    vs_obj = json_object(member);
+    while ((type = json_reader_next(reader)) != JSONReaderEnd) {
+        if (type == JSONError) goto full;
+        name = json_reader_name(reader);
+        strcmp_s("testGroups", sizeof("testGroups"), name, &diff);
+        if (!diff) {
+            groups = json_reader_text(reader, &groups_len);
+            if (!groups) goto full;
+            continue;
         }
+        member = json_reader_value(reader);
+        if (!member) goto full;
+        if (json_object_set_value(vs_obj, name, member) != JSONSuccess) {
+            json_value_free(member);
+            goto full;
+        }
+    }
 
-        json_value_free(val);
-        if (rv != ACVP_SUCCESS) return rv;
+    entry = acvp_find_alg_handler(json_object_get_string(vs_obj, "algorithm"),
+                                  json_object_get_string(vs_obj, "mode"));
+    if (!groups || !entry || !entry->reads_vs) goto full;
+
+    member = json_value_init_string_with_len(groups, groups_len);
+    if (!member) goto full;
+    if (json_object_set_value(vs_obj, "testGroups", member) != JSONSuccess) {
+        json_value_free(member);
+        goto full;
     }
+    json_reader_free(reader);
+    return val;
+
+full:
+    json_value_free(val);
+    json_reader_free(reader);
+    return json_parse_string(body);
+}
+
+/*
+ * This function will process a single KAT vector set.  Each KAT
+ * vector set has an identifier associated with it, called
+ * the vs_id.  During registration, libacvp will receive the
+ * list of vs_id's that need to be processed during the test
+ * session.  This routine will execute the test flow for a single
+ * vs_id once it has been downloaded by acvp_get_vector_set().
+ * The flow is:
+ *	a) Process each test case in the KAT vector set
+ *	b) Generate the response data
+ *	c) Send the response data back to the ACVP server
+ *
+ * The vector set in vs_val is consumed.
+ */
+static ACVP_RESULT acvp_process_vsid(ACVP_CTX *ctx, char *vsid_url, JSON_Value *vs_val) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    /*
+     * Process the KAT VectorSet
+     */
+    rv = acvp_process_vector_set(ctx, acvp_get_obj_from_rsp(vs_val));
+    json_value_free(vs_val);
+    if (rv != ACVP_SUCCESS) return rv;
 
     /*
      * Send the responses to the ACVP server
      */
     ACVP_LOG_STATUS("POST vector set response vsId: %d", ctx->vs_id);
-    rv = acvp_submit_vector_responses(ctx, vsid_url);
+    return acvp_submit_vector_responses(ctx, vsid_url);
+}
 
-end:
-    return rv;
+/*
+ * Looks up the alg_tbl[] entry for the algorithm and mode of a vector
+ * set, mode is NULL when the vector set has none.
+ */
+static ACVP_ALG_HANDLER *acvp_find_alg_handler(const char *alg, const char *mode) {
+    int i;
+    int diff = 1;
+
+    for (i = 0; i < ACVP_ALG_MAX; i++) {
+        strcmp_s(alg_tbl[i].name,
+                 ACVP_ALG_NAME_MAX,
+                 alg, &diff);
+        if (!diff) {
+            if (mode == NULL) {
+                return &alg_tbl[i];
+            }
+
+            if (alg_tbl[i].mode != NULL) {
+                strcmp_s(alg_tbl[i].mode,
+                        ACVP_ALG_MODE_MAX,
+                        mode, &diff);
+                if (!diff) {
+                    return &alg_tbl[i];
+                }
+            }
+        }
+    }
+    return NULL;
 }
 
 /*
@@ -1889,14 +3592,12 @@ end:
  * is looked up in the alg_tbl[] and invoked here.
  */
 static ACVP_RESULT acvp_dispatch_vector_set(ACVP_CTX *ctx, JSON_Object *obj) {
-    int i;
     const char *alg = json_object_get_string(obj, "algorithm");
     const char *mode = json_object_get_string(obj, "mode");
     int vs_id = json_object_get_number(obj, "vsId");
-    int diff = 1;
+    ACVP_ALG_HANDLER *entry = NULL;
 
     ctx->vs_id = vs_id;
-    ACVP_RESULT rv;
 
     if (!alg) {
         ACVP_LOG_ERR("JSON parse error: ACV algorithm not found");
@@ -1907,28 +3608,10 @@ static ACVP_RESULT acvp_dispatch_vector_set(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_LOG_STATUS("ACV Operation: %s", alg);
     ACVP_LOG_INFO("ACV version: %s", json_object_get_string(obj, "acvVersion"));
 
-    for (i = 0; i < ACVP_ALG_MAX; i++) {
-        strcmp_s(alg_tbl[i].name,
-                 ACVP_ALG_NAME_MAX,
-                 alg, &diff);
-        if (!diff) {
-            if (mode == NULL) {
-                rv = (alg_tbl[i].handler)(ctx, obj);
-                return rv;
-            }
+    entry = acvp_find_alg_handler(alg, mode);
+    if (!entry) return ACVP_UNSUPPORTED_OP;
 
-            if (alg_tbl[i].mode != NULL) {
-                strcmp_s(alg_tbl[i].mode,
-                        ACVP_ALG_MODE_MAX,
-                        mode, &diff);
-                if (!diff) {
-                    rv = (alg_tbl[i].handler)(ctx, obj);
-                    return rv;
-                }
-            }
-        }
-    }
-    return ACVP_UNSUPPORTED_OP;
+    return (entry->handler)(ctx, obj);
 }
 
 /*
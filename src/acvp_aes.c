@@ -57,10 +57,10 @@ static ACVP_RESULT acvp_aes_release_tc(ACVP_SYM_CIPHER_TC *stc);
 #define IV_ROW_LEN 16
 #define TEXT_COL_LEN 1001
 #define TEXT_ROW_LEN 32
-static unsigned char key[KEY_COL_LEN][KEY_ROW_LEN];
-static unsigned char iv[IV_COL_LEN][IV_ROW_LEN];
-static unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
-static unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char key[KEY_COL_LEN][KEY_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char iv[IV_COL_LEN][IV_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
 
 #define gb(a, b) (((a)[(b) / 8] >> (7 - (b) % 8)) & 1)
 #define sb(a, b, v) ((a)[(b) / 8] = ((a)[(b) / 8] & ~(1 << (7 - (b) % 8))) | (!!(v) << (7 - (b) % 8)))
@@ -582,9 +582,14 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_TEST_CASE tc;
     ACVP_RESULT rv;
     unsigned int ovrflw_ctr = 0, incr_ctr = 0;  /* assume false */
-    char *json_result = NULL;
     const char *alg_str = NULL;
     ACVP_CIPHER alg_id = 0;
+    /* Names read once per test case, hashed up front */
+    JSON_Key tc_id_key = json_key("tcId"), key_key = json_key("key"),
+             payload_len_key = json_key("payloadLen"), pt_key = json_key("pt"),
+             ct_key = json_key("ct"), tag_key = json_key("tag"),
+             tweak_key = json_key("tweakValue"), iv_key = json_key("iv"),
+             aad_key = json_key("aad");
 
     if (!ctx) {
         ACVP_LOG_ERR("No ctx for handler operation");
@@ -841,9 +846,9 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             testval = json_array_get_value(tests, j);
             testobj = json_value_get_object(testval);
 
-            tc_id = (unsigned int)json_object_get_number(testobj, "tcId");
+            tc_id = (unsigned int)json_object_get_number_key(testobj, &tc_id_key);
 
-            key = json_object_get_string(testobj, "key");
+            key = json_object_get_string_key(testobj, &key_key);
             if (!key) {
                 ACVP_LOG_ERR("Server JSON missing 'key'");
                 rv = ACVP_MISSING_ARG;
@@ -856,7 +861,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             }
 
             if (alg_id == ACVP_AES_CFB1) {
-                datalen = (unsigned int)json_object_get_number(testobj, "payloadLen");
+                datalen = (unsigned int)json_object_get_number_key(testobj, &payload_len_key);
                 if (datalen > ACVP_SYM_PT_BIT_MAX) {
                     ACVP_LOG_ERR("'dataLen' too large (%u), max allowed=(%d)",
                                  datalen, ACVP_SYM_PT_BIT_MAX);
@@ -867,7 +872,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
 
             if (dir == ACVP_SYM_CIPH_DIR_ENCRYPT) {
                 unsigned int tmp_pt_len = 0;
-                pt = json_object_get_string(testobj, "pt");
+                pt = json_object_get_string_key(testobj, &pt_key);
                 if (!pt) {
                     ACVP_LOG_ERR("Server JSON missing 'pt'");
                     rv = ACVP_MISSING_ARG;
@@ -883,7 +888,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             } else {
                 unsigned int tmp_ct_len = 0;
 
-                ct = json_object_get_string(testobj, "ct");
+                ct = json_object_get_string_key(testobj, &ct_key);
                 if (!ct) {
                     ACVP_LOG_ERR("Server JSON missing 'ct'");
                     rv = ACVP_MISSING_ARG;
@@ -898,7 +903,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                 }
 
                 if (alg_id == ACVP_AES_GCM) {
-                    tag = json_object_get_string(testobj, "tag");
+                    tag = json_object_get_string_key(testobj, &tag_key);
                     if (!tag) {
                         ACVP_LOG_ERR("Server JSON missing 'tag'");
                         rv = ACVP_MISSING_ARG;
@@ -921,7 +926,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                            iv_gen == ACVP_SYM_CIPH_IVGEN_SRC_INT)) {
                 if (alg_id == ACVP_AES_XTS) {
                     /* XTS may call it tweak value, but we treat it as an IV */
-                    iv = json_object_get_string(testobj, "tweakValue");
+                    iv = json_object_get_string_key(testobj, &tweak_key);
                     if (!iv) {
                         ACVP_LOG_ERR("Server JSON missing 'tweakValue'");
                         rv = ACVP_MISSING_ARG;
@@ -934,7 +939,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
                         goto err;
                     }
                 } else {
-                    iv = json_object_get_string(testobj, "iv");
+                    iv = json_object_get_string_key(testobj, &iv_key);
                     if (!iv) {
                         ACVP_LOG_ERR("Server JSON missing 'iv'");
                         rv = ACVP_MISSING_ARG;
@@ -950,7 +955,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             }
 
             if (alg_id == ACVP_AES_GCM || alg_id == ACVP_AES_CCM) {
-                aad = json_object_get_string(testobj, "aad");
+                aad = json_object_get_string_key(testobj, &aad_key);
                 if (!aad) {
                     ACVP_LOG_ERR("Server JSON missing 'aad'");
                     rv = ACVP_MISSING_ARG;
@@ -1046,13 +1051,7 @@ ACVP_RESULT acvp_aes_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     json_array_append_value(reg_arry, r_vs_val);
     rv = ACVP_SUCCESS;
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    ACVP_LOG_INFO_JSON(ctx->kat_resp);
 
 err:
     if (rv != ACVP_SUCCESS) {
@@ -47,9 +47,9 @@ static ACVP_RESULT acvp_des_release_tc(ACVP_SYM_CIPHER_TC *stc);
 #define OLD_IV_LEN 8
 #define TEXT_COL_LEN 10001
 #define TEXT_ROW_LEN 8
-static unsigned char old_iv[OLD_IV_LEN];
-static unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
-static unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char old_iv[OLD_IV_LEN];
+static ACVP_THREAD_LOCAL unsigned char ptext[TEXT_COL_LEN][TEXT_ROW_LEN];
+static ACVP_THREAD_LOCAL unsigned char ctext[TEXT_COL_LEN][TEXT_ROW_LEN];
 
 static void shiftin(unsigned char *dst, int dst_max, unsigned char *src, int nbits) {
     int n = 0, move_bytes = 0, copy_bytes = 0;
@@ -627,7 +627,6 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_SYM_CIPH_TESTTYPE test_type = 0;
     ACVP_SYM_CIPH_DIR dir = 0;
     ACVP_CIPHER alg_id = 0;
-    char *json_result = NULL;
     const char *test_type_str = NULL, *dir_str = NULL;
     unsigned int tc_id = 0, keylen = 0;
     unsigned int ovrflw_ctr = 0, incr_ctr = 0;  /* assume false */
@@ -986,13 +985,7 @@ ACVP_RESULT acvp_des_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     json_array_append_value(reg_arry, r_vs_val);
     rv = ACVP_SUCCESS;
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    ACVP_LOG_INFO_JSON(ctx->kat_resp);
 
 err:
     if (rv != ACVP_SUCCESS) {
@@ -45,7 +45,6 @@ static ACVP_RESULT acvp_drbg_init_tc(ACVP_CTX *ctx,
 static ACVP_RESULT acvp_drbg_release_tc(ACVP_DRBG_TC *stc);
 
 ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
-    char *json_result = NULL;
 
     JSON_Value *reg_arry_val = NULL;
     JSON_Object *reg_obj = NULL;
@@ -264,9 +263,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             testval = json_array_get_value(tests, j);
             testobj = json_value_get_object(testval);
 
-            json_result = json_serialize_to_string_pretty(testval, NULL);
-            ACVP_LOG_INFO("json testval count: %d\n %s\n", i, json_result);
-            json_free_serialized_string(json_result);
+            ACVP_LOG_INFO_JSON_MSG(testval, "json testval count: %d", i);
 
             tc_id = (unsigned int)json_object_get_number(testobj, "tcId");
 
@@ -464,13 +461,7 @@ ACVP_RESULT acvp_drbg_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    ACVP_LOG_INFO_JSON(ctx->kat_resp);
 
     rv = ACVP_SUCCESS;
 err:
@@ -201,19 +201,15 @@ static ACVP_HASH_TESTTYPE read_test_type(const char *tt_str) {
 
 ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int tc_id, msglen;
-    JSON_Value *groupval;
+    ACVP_VS_READER vsr;
     JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
     JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
 
     JSON_Value *reg_arry_val = NULL;
     JSON_Object *reg_obj = NULL;
     JSON_Array *reg_arry = NULL;
 
-    int i, g_cnt;
-    int j, t_cnt;
+    int i, j;
 
     JSON_Value *r_vs_val = NULL;
     JSON_Object *r_vs = NULL;
@@ -226,7 +222,6 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
     JSON_Array *res_tarr = NULL; /* Response resultsArray */
     ACVP_RESULT rv = ACVP_SUCCESS;
     ACVP_CIPHER alg_id = 0;
-    char *json_result = NULL;
     const char *alg_str = NULL;
     const char *test_type_str, *msg = NULL;
 
@@ -278,14 +273,18 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
         return rv;
     }
 
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
+    /*
+     * The groups and tests are taken one at a time, see ACVP_VS_READER
+     */
+    rv = acvp_vs_reader_open(ctx, &vsr, obj);
+    if (rv != ACVP_SUCCESS) goto err;
+    for (i = 0; ; i++) {
         ACVP_HASH_TESTTYPE test_type = 0;
         int tgId = 0;
 
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
+        rv = acvp_vs_reader_next_group(&vsr, &groupobj);
+        if (rv != ACVP_SUCCESS) goto err;
+        if (!groupobj) break;
 
         /*
          * Create a new group in the response with the tgid
@@ -319,15 +318,14 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             goto err;
         }
 
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-
-        for (j = 0; j < t_cnt; j++) {
+        for (j = 0; ; j++) {
             unsigned int tmp_msg_len = 0;
 
+            rv = acvp_vs_reader_next_test(&vsr, &testobj);
+            if (rv != ACVP_SUCCESS) goto err;
+            if (!testobj) break;
+
             ACVP_LOG_INFO("Found new hash test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
 
             tc_id = (unsigned int)json_object_get_number(testobj, "tcId");
 
@@ -436,20 +434,16 @@ ACVP_RESULT acvp_hash_kat_handler(ACVP_CTX *ctx, JSON_Object *obj) {
             json_array_append_value(r_tarr, r_tval);
         }
         json_array_append_value(r_garr, r_gval);
+        r_gval = NULL;
     }
 
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp, NULL);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    ACVP_LOG_INFO_JSON(ctx->kat_resp);
     rv = ACVP_SUCCESS;
 
 err:
+    acvp_vs_reader_close(&vsr);
     if (rv != ACVP_SUCCESS) {
         acvp_release_json(r_vs_val, r_gval);
     }
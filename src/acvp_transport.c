@@ -17,6 +17,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <zlib.h>
+#ifndef WIN32
+# include <pthread.h>
+#endif
 #include "acvp.h"
 #include "acvp_lcl.h"
 #include "safe_lib.h"
@@ -26,21 +31,23 @@
  */
 #define HTTP_OK    200
 #define HTTP_UNAUTH    401
+#define HTTP_TOO_MANY_REQUESTS 429
 
-#define USER_AGENT_STR_MAX 32
+#define ACVP_USER_AGENT "libacvp/" ACVP_VERSION
 
 #define ACVP_AUTH_BEARER_TITLE_LEN 23
 
-typedef enum acvp_net_action {
-    ACVP_NET_GET = 1, /**< Generic (get) */
-    ACVP_NET_GET_VS, /**< Vector Set (get) */
-    ACVP_NET_GET_VS_RESULT, /**< Vector Set result (get) */
-    ACVP_NET_GET_VS_SAMPLE, /**< Sample (get) */
-    ACVP_NET_POST, /**< Generic (post) */
-    ACVP_NET_POST_LOGIN, /**< Login (post) */
-    ACVP_NET_POST_REG, /**< Registration (post) */
-    ACVP_NET_POST_VS_RESP /**< Vector set response (post) */
-} ACVP_NET_ACTION;
+/*
+ * Vector sets are parsed while they are received, unless the verbose
+ * log, the network log file, the capture or the vector set reader
+ * wants their raw text.
+ */
+#define ACVP_RCV_STREAM(ctx) ((ctx)->debug < ACVP_LOG_LVL_VERBOSE && !(ctx)->net_log_file && \
+                              !(ctx)->net_record_file && !(ctx)->vs_reader)
+#define ACVP_RCV_STREAMED "<parsed while it was received>"
+
+/* Bytes of JSON text serialized at a time when a body is compressed on the way */
+#define ACVP_UPLOAD_CHUNK 16384
 
 /*
  * Prototypes
@@ -48,11 +55,40 @@ typedef enum acvp_net_action {
 static ACVP_RESULT acvp_network_action(ACVP_CTX *ctx, ACVP_NET_ACTION action,
                                        char *url, char *data, int data_len);
 
-static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, struct curl_slist *slist) {
-    char *bearer = NULL;
-    char bearer_title[] = "Authorization: Bearer ";
-    int bearer_title_size = (int)sizeof(bearer_title) - 1;
-    int bearer_size = 0;
+static struct curl_slist *acvp_upload_headers(ACVP_CTX *ctx, struct curl_slist *slist);
+
+/*
+ * Header lists of a ctx.  They are built on first use and shared by
+ * every request, so sending a request allocates no headers.  A new
+ * jwt makes them stale, see acvp_transport_reset_auth(), and the
+ * next request builds a fresh set.  Stale sets are only freed when
+ * the transport is closed, since asynchronous requests still in
+ * flight may point at them.
+ */
+typedef struct acvp_net_hdrs_t {
+    struct curl_slist *get;     /* Authorization */
+    struct curl_slist *post;    /* Content-Type, Authorization */
+    struct curl_slist *upload;  /* Content-Type, upload headers, Authorization */
+    int stale;                  /* built for a previous jwt */
+    struct acvp_net_hdrs_t *retired;
+} ACVP_NET_HDRS;
+
+/*
+ * Appends a header.  On failure the list is freed and NULL returned,
+ * so a list is either complete or missing.
+ */
+static struct curl_slist *acvp_hdr_append(struct curl_slist *slist, const char *hdr) {
+    struct curl_slist *tmp = NULL;
+
+    tmp = curl_slist_append(slist, hdr);
+    if (!tmp && slist) {
+        curl_slist_free_all(slist);
+    }
+    return tmp;
+}
+
+static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, struct curl_slist *slist, int *failed) {
+    char bearer[ACVP_AUTH_BEARER_TITLE_LEN + ACVP_JWT_TOKEN_MAX];
 
     if (!ctx->jwt_token) {
         /*
@@ -61,25 +97,181 @@ static struct curl_slist *acvp_add_auth_hdr(ACVP_CTX *ctx, struct curl_slist *sl
         return slist;
     }
 
-    bearer_size = strnlen_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX) + bearer_title_size;
-    bearer = calloc(bearer_size + 1, sizeof(char));
-    if (!bearer) {
+    snprintf(bearer, sizeof(bearer), "Authorization: Bearer %s", ctx->jwt_token);
+    slist = acvp_hdr_append(slist, bearer);
+    if (!slist) *failed = 1;
+
+    return slist;
+}
+
+static void acvp_net_hdrs_free(ACVP_NET_HDRS *h) {
+    ACVP_NET_HDRS *next = NULL;
+
+    while (h) {
+        next = h->retired;
+        if (h->get) curl_slist_free_all(h->get);
+        if (h->post) curl_slist_free_all(h->post);
+        if (h->upload) curl_slist_free_all(h->upload);
+        free(h);
+        h = next;
+    }
+}
+
+/*
+ * Returns the header lists for the current jwt, building them when
+ * there are none yet or they are stale.  Returns NULL on failure.
+ */
+static ACVP_NET_HDRS *acvp_net_hdrs(ACVP_CTX *ctx) {
+    ACVP_NET_HDRS *h = (ACVP_NET_HDRS *)ctx->net_hdrs;
+    int failed = 0;
+
+    if (h && !h->stale) return h;
+
+    h = calloc(1, sizeof(ACVP_NET_HDRS));
+    if (!h) {
         ACVP_LOG_ERR("unable to allocate memory.");
-        return slist;
+        return NULL;
+    }
+
+    h->get = acvp_add_auth_hdr(ctx, NULL, &failed);
+    h->post = acvp_hdr_append(NULL, "Content-Type:application/json");
+    if (h->post) h->post = acvp_add_auth_hdr(ctx, h->post, &failed);
+    h->upload = acvp_hdr_append(NULL, "Content-Type:application/json");
+    h->upload = acvp_upload_headers(ctx, h->upload);
+    if (h->upload) h->upload = acvp_add_auth_hdr(ctx, h->upload, &failed);
+    if (failed || !h->post || !h->upload) {
+        ACVP_LOG_ERR("unable to allocate memory.");
+        acvp_net_hdrs_free(h);
+        return NULL;
     }
 
-    snprintf(bearer, bearer_size + 1, "%s%s", bearer_title, ctx->jwt_token);
-    slist = curl_slist_append(slist, bearer);
+    h->retired = (ACVP_NET_HDRS *)ctx->net_hdrs;
+    ctx->net_hdrs = h;
+    return h;
+}
 
-    free(bearer);
+/*
+ * Returns the Authorization header the next request carries, NULL
+ * when there is no jwt.  The headers are built first if needed.
+ */
+const char *acvp_transport_auth_hdr(ACVP_CTX *ctx) {
+    ACVP_NET_HDRS *h = NULL;
 
-    return slist;
+    if (!ctx) return NULL;
+
+    h = acvp_net_hdrs(ctx);
+    if (!h || !h->get) return NULL;
+    return h->get->data;
+}
+
+/*
+ * Called when ctx->jwt_token changes, the headers carrying the
+ * previous one are rebuilt before the next request.
+ */
+void acvp_transport_reset_auth(ACVP_CTX *ctx) {
+    if (ctx && ctx->net_hdrs) {
+        ((ACVP_NET_HDRS *)ctx->net_hdrs)->stale = 1;
+    }
+}
+
+/*
+ * Appends a chunk of the HTTP body to a receive buffer.  The buffer
+ * grows geometrically, starting at ACVP_CURL_BUF_INIT, and always has
+ * room left for the terminating NUL.  Only the used part is ever
+ * written, so a large buffer left over from an earlier response costs
+ * nothing on the next one.  Returns 0 on failure.
+ */
+static int acvp_rcv_buf_append(char **buf, int *len, int *max, const void *ptr, size_t n) {
+    size_t need = (size_t)*len + n + 1;
+    size_t new_max = 0;
+    char *tmp = NULL;
+
+    if (need > INT_MAX) {
+        fprintf(stderr, "\nServer response is too large\n");
+        return 0;
+    }
+
+    if (need > (size_t)*max) {
+        new_max = *max ? (size_t)*max : ACVP_CURL_BUF_INIT;
+        while (new_max < need) {
+            new_max *= 2;
+        }
+        if (new_max > INT_MAX) new_max = INT_MAX;
+
+        tmp = realloc(*buf, new_max);
+        if (!tmp) {
+            fprintf(stderr, "\nmalloc failed in curl write func\n");
+            return 0;
+        }
+        *buf = tmp;
+        *max = (int)new_max;
+    }
+
+    if (n) {
+        memcpy_s(*buf + *len, n, ptr, n);
+    }
+    *len += (int)n;
+    (*buf)[*len] = 0;
+
+    return 1;
+}
+
+/*
+ * Feeds a chunk of a response that is parsed while it is received.
+ * On the first chunk the status is checked: only the body of a
+ * successful response goes to the parser, anything else is left to
+ * the caller to buffer for inspect_http_code().  A parse error is
+ * only reported once the transfer is done, so the rest of the body
+ * is still read.  Returns 1 when the chunk was consumed.
+ */
+static int acvp_rcv_stream(CURL *hnd, int *stream, JSON_Stream_Parser **parser,
+                           const void *ptr, size_t n) {
+    long http_code = 0;
+
+    if (!*parser) {
+        curl_easy_getinfo(hnd, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != HTTP_OK) {
+            *stream = 0;
+            return 0;
+        }
+        *parser = json_stream_parser_new();
+        if (!*parser) {
+            *stream = 0;
+            return 0;
+        }
+    }
+    json_stream_parser_feed(*parser, ptr, n);
+
+    return 1;
+}
+
+/*
+ * Completes a response parsed while it was received, the value is
+ * left in ctx->rcv_val for the caller to take.  When the request
+ * failed (ok is 0) the body is dropped instead, whatever arrived.
+ */
+static void acvp_rcv_stream_finish(ACVP_CTX *ctx, JSON_Stream_Parser **parser, int ok) {
+    if (!*parser) return;
+
+    if (ctx->rcv_val) json_value_free(ctx->rcv_val);
+    ctx->rcv_val = NULL;
+    if (!ok) {
+        json_stream_parser_free(*parser);
+        *parser = NULL;
+        return;
+    }
+    ctx->rcv_val = json_stream_parser_finish(*parser);
+    *parser = NULL;
+    if (!ctx->rcv_val) {
+        ACVP_LOG_ERR("JSON parse error in streamed response");
+    }
 }
 
 /*
  * This is a callback used by curl to send the HTTP body
  * to the application (us).  We will store the HTTP body
- * in the ACVP_CTX curl_buf field.
+ * in the ACVP_CTX curl_buf field, unless the response is
+ * being parsed as it arrives.
  */
 static size_t acvp_curl_write_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
     ACVP_CTX *ctx = (ACVP_CTX *)userdata;
@@ -89,68 +281,115 @@ static size_t acvp_curl_write_callback(void *ptr, size_t size, size_t nmemb, voi
         return 0;
     }
 
-    if (!ctx->curl_buf) {
-        ctx->curl_buf = calloc(ACVP_CURL_BUF_MAX, sizeof(char));
-        if (!ctx->curl_buf) {
-            fprintf(stderr, "\nmalloc failed in curl write reg func\n");
-            return 0;
-        }
+    if (!ctx->net_ttfb_us) {
+        ctx->net_ttfb_us = acvp_time_us() - ctx->net_start_us;
+    }
+    ctx->rcv_len += nmemb;
+    if (ctx->rcv_stream &&
+        acvp_rcv_stream(ctx->curl_hnd, &ctx->rcv_stream, &ctx->rcv_parser, ptr, nmemb)) {
+        return nmemb;
     }
 
-    if ((ctx->curl_read_ctr + nmemb) > ACVP_CURL_BUF_MAX) {
-        fprintf(stderr, "\nServer response is too large\n");
+    if (!acvp_rcv_buf_append(&ctx->curl_buf, &ctx->curl_read_ctr,
+                             &ctx->curl_buf_max, ptr, nmemb)) {
         return 0;
     }
 
-    memcpy_s(&ctx->curl_buf[ctx->curl_read_ctr], (ACVP_CURL_BUF_MAX - ctx->curl_read_ctr), ptr, nmemb);
-    ctx->curl_buf[ctx->curl_read_ctr + nmemb] = 0;
-    ctx->curl_read_ctr += nmemb;
-
     return nmemb;
 }
 
+#if !defined USE_MURL && !defined WIN32
 /*
- * This function uses libcurl to send a simple HTTP GET
- * request with no Content-Type header.
- * TLS peer verification is enabled, but not HTTP authentication.
- * The parameters are:
- *
- * ctx: Ptr to ACVP_CTX, which contains the server name
- * url: URL to use for the GET request
- *
- * Return value is the HTTP status value from the server
- *	    (e.g. 200 for HTTP OK)
+ * Cache shared between the parent context and its worker contexts so
+ * that connections and TLS sessions established by one thread can be
+ * picked up by the others.  libcurl requires the application to
+ * serialize access to the shared data, one lock per data type.
  */
-static long acvp_curl_http_get(ACVP_CTX *ctx, char *url) {
-    long http_code = 0;
-    CURL *hnd;
-    struct curl_slist *slist;
-    char user_agent_str[USER_AGENT_STR_MAX + 1];
+typedef struct acvp_curl_share_t {
+    CURLSH *sh;
+    pthread_mutex_t lock[CURL_LOCK_DATA_LAST];
+} ACVP_CURL_SHARE;
+
+static void acvp_curl_share_lock(CURL *hnd, curl_lock_data data,
+                                 curl_lock_access access, void *userptr) {
+    ACVP_CURL_SHARE *share = (ACVP_CURL_SHARE *)userptr;
+
+    (void)hnd;
+    (void)access;
+    pthread_mutex_lock(&share->lock[data]);
+}
 
-    slist = NULL;
-    /*
-     * Create the Authorzation header if needed
-     */
-    slist = acvp_add_auth_hdr(ctx, slist);
+static void acvp_curl_share_unlock(CURL *hnd, curl_lock_data data, void *userptr) {
+    ACVP_CURL_SHARE *share = (ACVP_CURL_SHARE *)userptr;
 
-    ctx->curl_read_ctr = 0;
+    (void)hnd;
+    pthread_mutex_unlock(&share->lock[data]);
+}
+#endif
 
-    /*
-     * Create the HTTP User Agent value
-     */
-    snprintf(user_agent_str, USER_AGENT_STR_MAX, "libacvp/%s", ACVP_VERSION);
+/*
+ * Creates the cache of connections and TLS sessions that the worker
+ * contexts copied from this ctx will share.  This must be called from
+ * the thread owning ctx before any worker context is created.  Failure
+ * is not fatal, the workers simply keep their own connections.
+ */
+void acvp_transport_share_init(ACVP_CTX *ctx) {
+#if !defined USE_MURL && !defined WIN32
+    ACVP_CURL_SHARE *share = NULL;
+    int i = 0;
+
+    if (!ctx || ctx->curl_share) return;
+
+    share = calloc(1, sizeof(ACVP_CURL_SHARE));
+    if (!share) {
+        ACVP_LOG_WARN("Unable to allocate transport share, connections will not be shared");
+        return;
+    }
+    share->sh = curl_share_init();
+    if (!share->sh) {
+        ACVP_LOG_WARN("curl_share_init failed, connections will not be shared");
+        free(share);
+        return;
+    }
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share->lock[i], NULL);
+    }
+    curl_share_setopt(share->sh, CURLSHOPT_LOCKFUNC, acvp_curl_share_lock);
+    curl_share_setopt(share->sh, CURLSHOPT_UNLOCKFUNC, acvp_curl_share_unlock);
+    curl_share_setopt(share->sh, CURLSHOPT_USERDATA, share);
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    ctx->curl_share = share;
 
     /*
-     * Setup Curl
+     * A handle can't move its open connection into a share, so
+     * reopen it on the share the next time it is needed.
      */
-    hnd = curl_easy_init();
-    curl_easy_setopt(hnd, CURLOPT_URL, url);
+    acvp_transport_close(ctx);
+#else
+    (void)ctx;
+#endif
+}
+
+/*
+ * Sets the options that never change during the session on a new
+ * easy handle.  The per-request options are set by the callers.
+ */
+static void acvp_curl_set_opts(ACVP_CTX *ctx, CURL *hnd) {
     curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 1L);
-    curl_easy_setopt(hnd, CURLOPT_USERAGENT, user_agent_str);
+    curl_easy_setopt(hnd, CURLOPT_USERAGENT, ACVP_USER_AGENT);
     curl_easy_setopt(hnd, CURLOPT_TCP_KEEPALIVE, 1L);
     curl_easy_setopt(hnd, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
-    if (slist) {
-        curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, slist);
+
+    /*
+     * Let the server compress its answers, any encoding
+     * supported by the transport is accepted
+     */
+    if (ctx->compress) {
+        curl_easy_setopt(hnd, CURLOPT_ACCEPT_ENCODING, "");
     }
 
     /*
@@ -172,6 +411,33 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url) {
         curl_easy_setopt(hnd, CURLOPT_SSLKEY, ctx->tls_key);
     }
 
+#if !defined USE_MURL && !defined WIN32
+    if (ctx->curl_share) {
+        curl_easy_setopt(hnd, CURLOPT_SHARE, ((ACVP_CURL_SHARE *)ctx->curl_share)->sh);
+    }
+#endif
+}
+
+/*
+ * Returns the transport handle of this ctx, creating it on first use.
+ * The handle lives until acvp_transport_close() so that libcurl can keep
+ * the connection to the server open and resume the TLS session across
+ * requests.
+ */
+static CURL *acvp_curl_handle(ACVP_CTX *ctx) {
+    CURL *hnd;
+
+    if (ctx->curl_hnd) {
+        return (CURL *)ctx->curl_hnd;
+    }
+
+    hnd = curl_easy_init();
+    if (!hnd) {
+        ACVP_LOG_ERR("curl_easy_init failed");
+        return NULL;
+    }
+    acvp_curl_set_opts(ctx, hnd);
+
     /*
      * To record the HTTP data recieved from the server,
      * set the callback function.
@@ -179,23 +445,264 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url) {
     curl_easy_setopt(hnd, CURLOPT_WRITEDATA, ctx);
     curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &acvp_curl_write_callback);
 
+    ctx->curl_hnd = hnd;
+    return hnd;
+}
+
+/*
+ * Logs how much compression saved on a request body.
+ */
+static void acvp_log_snd_ratio(ACVP_CTX *ctx, size_t raw, size_t sent) {
+    ACVP_LOG_INFO("Request body compressed from %lu to %lu bytes (%.1f%%)",
+                  (unsigned long)raw, (unsigned long)sent, raw ? 100.0 * sent / raw : 0.0);
+}
+
+#ifdef USE_MURL
+/*
+ * Compresses a request body with gzip.  The compressed body is
+ * returned in out and must be freed by the caller.
+ */
+static ACVP_RESULT acvp_gzip(ACVP_CTX *ctx, const char *data, int data_len,
+                             char **out, int *out_len) {
+    z_stream zs;
+    char *buf = NULL;
+    uLong max = 0;
+    int rc = 0;
+
+    memzero_s(&zs, sizeof(zs));
+    /* 16 added to the window bits selects the gzip wrapper */
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        ACVP_LOG_ERR("deflateInit2 failed");
+        return ACVP_TRANSPORT_FAIL;
+    }
+
+    max = deflateBound(&zs, (uLong)data_len);
+    buf = malloc(max);
+    if (!buf) {
+        deflateEnd(&zs);
+        return ACVP_MALLOC_FAIL;
+    }
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)data_len;
+    zs.next_out = (Bytef *)buf;
+    zs.avail_out = (uInt)max;
+    rc = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) {
+        ACVP_LOG_ERR("gzip compression failed, rc=%d", rc);
+        free(buf);
+        return ACVP_TRANSPORT_FAIL;
+    }
+
+    *out = buf;
+    *out_len = (int)zs.total_out;
+    acvp_log_snd_ratio(ctx, (size_t)data_len, (size_t)*out_len);
+
+    return ACVP_SUCCESS;
+}
+#endif
+
+/*
+ * Logs how much a compressed response saved on the wire, decoded
+ * being the size of the body after decompression.
+ */
+static void acvp_log_rcv_ratio(ACVP_CTX *ctx, CURL *hnd, size_t decoded) {
+#if defined USE_MURL || LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t wire = 0;
+
+    if (!ctx->compress || !decoded) return;
+
+    if (curl_easy_getinfo(hnd, CURLINFO_SIZE_DOWNLOAD_T, &wire) == CURLE_OK &&
+        wire > 0 && (size_t)wire < decoded) {
+        ACVP_LOG_INFO("Response body compressed from %lu to %ld bytes (%.1f%%)",
+                      (unsigned long)decoded, (long)wire, 100.0 * wire / decoded);
+    }
+#else
+    (void)ctx;
+    (void)hnd;
+    (void)decoded;
+#endif
+}
+
+/*
+ * The timings are read in microseconds where curl supports it and
+ * converted from seconds with older versions.
+ */
+#if defined USE_MURL || LIBCURL_VERSION_NUM >= 0x073d00
+static long long acvp_net_getinfo(CURL *hnd, CURLINFO info) {
+    curl_off_t val = 0;
+
+    if (curl_easy_getinfo(hnd, info, &val) != CURLE_OK) return 0;
+    return (long long)val;
+}
+#define ACVP_NET_TIME(hnd, name) acvp_net_getinfo(hnd, CURLINFO_##name##_TIME_T)
+#define ACVP_NET_SIZE(hnd, name) acvp_net_getinfo(hnd, CURLINFO_SIZE_##name##_T)
+#else
+static long long acvp_net_getinfo(CURL *hnd, CURLINFO info, double scale) {
+    double val = 0;
+
+    if (curl_easy_getinfo(hnd, info, &val) != CURLE_OK) return 0;
+    return (long long)(val * scale);
+}
+#define ACVP_NET_TIME(hnd, name) acvp_net_getinfo(hnd, CURLINFO_##name##_TIME, 1000000.0)
+#define ACVP_NET_SIZE(hnd, name) acvp_net_getinfo(hnd, CURLINFO_SIZE_##name, 1.0)
+#endif
+
+/*
+ * Returns the histogram bucket of a time, see ACVP_NET_STATS.
+ */
+static int acvp_net_hist_bucket(long long us) {
+    long long ms = us / 1000;
+    int i = 0;
+
+    while (ms > 0 && i < ACVP_NET_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Adds the timings of one request to the stats of the session and
+ * hands them to the timing callback.
+ */
+static void acvp_net_timing_add(ACVP_CTX *ctx, const ACVP_NET_TIMING *t) {
+    ACVP_NET_STATS *st = &ctx->net_stats[t->action];
+
+    st->count++;
+    if (!t->http_code) st->failed++;
+    st->namelookup_us += t->namelookup_us;
+    st->connect_us += t->connect_us;
+    st->appconnect_us += t->appconnect_us;
+    st->ttfb_us += t->ttfb_us;
+    st->total_us += t->total_us;
+    if (t->total_us > st->max_total_us) st->max_total_us = t->total_us;
+    st->bytes_up += t->bytes_up;
+    st->bytes_down += t->bytes_down;
+    st->ttfb_hist[acvp_net_hist_bucket(t->ttfb_us)]++;
+    st->total_hist[acvp_net_hist_bucket(t->total_us)]++;
+
+    if (ctx->net_timing_cb) {
+        (ctx->net_timing_cb)(t);
+    }
+}
+
+/*
+ * Collects the timings of the transfer just completed on hnd and
+ * records them.
+ */
+static void acvp_net_timing_record(ACVP_CTX *ctx, ACVP_NET_ACTION action, CURL *hnd,
+                                   long http_code, long long ttfb_us) {
+    ACVP_NET_TIMING t;
+
+    if (action < ACVP_NET_GET || action >= ACVP_NET_ACTION_MAX) return;
+
+    memzero_s(&t, sizeof(t));
+    t.action = action;
+    t.http_code = http_code;
+    t.namelookup_us = ACVP_NET_TIME(hnd, NAMELOOKUP);
+    t.connect_us = ACVP_NET_TIME(hnd, CONNECT);
+    t.appconnect_us = ACVP_NET_TIME(hnd, APPCONNECT);
+    t.total_us = ACVP_NET_TIME(hnd, TOTAL);
+#ifdef USE_MURL
+    t.ttfb_us = ACVP_NET_TIME(hnd, STARTTRANSFER);
+#else
     /*
-     * Send the HTTP GET request
+     * curl starts its transfer timer when it starts sending a request
+     * body, so the first byte of the response is timed by the write
+     * callbacks instead.
+     */
+    t.ttfb_us = ttfb_us ? ttfb_us : ACVP_NET_TIME(hnd, STARTTRANSFER);
+    if (t.ttfb_us > t.total_us) t.ttfb_us = t.total_us;
+#endif
+    t.bytes_up = ACVP_NET_SIZE(hnd, UPLOAD);
+    t.bytes_down = ACVP_NET_SIZE(hnd, DOWNLOAD);
+
+    acvp_net_timing_add(ctx, &t);
+}
+
+/*
+ * Sends the request prepared on hnd and returns the HTTP status
+ * from the server.  The connection reuse counters and the timings
+ * of ctx->net_action are updated here.
+ */
+static long acvp_curl_perform(ACVP_CTX *ctx, CURL *hnd) {
+    long http_code = 0;
+    long new_conns = 0;
+    CURLcode crv;
+
+    ctx->rcv_len = 0;
+    ctx->net_start_us = acvp_time_us();
+    ctx->net_ttfb_us = 0;
+    crv = curl_easy_perform(hnd);
+    ctx->net_requests++;
+    if (crv != CURLE_OK) {
+        ACVP_LOG_ERR("Curl failed with code %d (%s)\n", crv, curl_easy_strerror(crv));
+        acvp_net_timing_record(ctx, ctx->net_action, hnd, 0, ctx->net_ttfb_us);
+        return 0;
+    }
+
+    /*
+     * No new connection means the request went over a connection
+     * that was left open by a previous one.
      */
-    curl_easy_perform(hnd);
+    if (curl_easy_getinfo(hnd, CURLINFO_NUM_CONNECTS, &new_conns) == CURLE_OK &&
+        new_conns == 0) {
+        ctx->net_conn_reused++;
+    }
+
+    acvp_log_rcv_ratio(ctx, hnd, ctx->rcv_len);
 
     /*
      * Get the HTTP reponse status code from the server
      */
     curl_easy_getinfo(hnd, CURLINFO_RESPONSE_CODE, &http_code);
+    acvp_net_timing_record(ctx, ctx->net_action, hnd, http_code, ctx->net_ttfb_us);
 
-    curl_easy_cleanup(hnd);
-    hnd = NULL;
-    if (slist) {
-        curl_slist_free_all(slist);
-        slist = NULL;
+    return http_code;
+}
+
+/*
+ * This function uses libcurl to send a simple HTTP GET
+ * request with no Content-Type header.
+ * TLS peer verification is enabled, but not HTTP authentication.
+ * The parameters are:
+ *
+ * ctx: Ptr to ACVP_CTX, which contains the server name
+ * url: URL to use for the GET request
+ * stream: parse a successful response into ctx->rcv_val while it
+ *         is received instead of buffering it in ctx->curl_buf
+ *
+ * Return value is the HTTP status value from the server
+ *	    (e.g. 200 for HTTP OK)
+ */
+static long acvp_curl_http_get(ACVP_CTX *ctx, char *url, int stream) {
+    long http_code = 0;
+    CURL *hnd;
+    ACVP_NET_HDRS *hdrs;
+
+    hnd = acvp_curl_handle(ctx);
+    hdrs = acvp_net_hdrs(ctx);
+    if (!hnd || !hdrs) {
+        return 0;
     }
 
+    ctx->curl_read_ctr = 0;
+    if (ctx->curl_buf) ctx->curl_buf[0] = 0;
+
+    curl_easy_setopt(hnd, CURLOPT_URL, url);
+    curl_easy_setopt(hnd, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, hdrs->get);
+
+    /*
+     * Send the HTTP GET request
+     */
+    ctx->rcv_stream = stream;
+    http_code = acvp_curl_perform(ctx, hnd);
+    ctx->rcv_stream = 0;
+    acvp_rcv_stream_finish(ctx, &ctx->rcv_parser, http_code == HTTP_OK);
+
     return http_code;
 }
 
@@ -208,8 +715,6 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url) {
  * ctx: Ptr to ACVP_CTX, which contains the server name
  * url: URL to use for the GET request
  * data: data to POST to the server
- * writefunc: Function pointer to handle writing the data
- *            from the HTTP body received from the server.
  *
  * Return value is the HTTP status value from the server
  *	    (e.g. 200 for HTTP OK)
@@ -217,88 +722,394 @@ static long acvp_curl_http_get(ACVP_CTX *ctx, char *url) {
 static long acvp_curl_http_post(ACVP_CTX *ctx, char *url, char *data, int data_len) {
     long http_code = 0;
     CURL *hnd;
-    CURLcode crv;
-    struct curl_slist *slist;
-    char user_agent_str[USER_AGENT_STR_MAX + 1];
+    ACVP_NET_HDRS *hdrs;
+
+    hnd = acvp_curl_handle(ctx);
+    hdrs = acvp_net_hdrs(ctx);
+    if (!hnd || !hdrs) {
+        return 0;
+    }
+
+    ctx->curl_read_ctr = 0;
+    if (ctx->curl_buf) ctx->curl_buf[0] = 0;
+
+    curl_easy_setopt(hnd, CURLOPT_URL, url);
+    curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, hdrs->post);
+    curl_easy_setopt(hnd, CURLOPT_POST, 1L);
+    curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, data);
+    curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)data_len);
 
     /*
-     * Set the Content-Type header in the HTTP request
+     * Send the HTTP POST request
      */
-    slist = NULL;
-    slist = curl_slist_append(slist, "Content-Type:application/json");
+    http_code = acvp_curl_perform(ctx, hnd);
+
+    return http_code;
+}
+
+#ifndef USE_MURL
+/*
+ * Source of a JSON request body that is serialized while it is being
+ * sent, so the body never exists as one string.  With compression on,
+ * the text is gzip'ed on the way.  The value must stay alive until
+ * the upload is freed.
+ */
+typedef struct acvp_upload_t {
+    ACVP_CTX *ctx;
+    JSON_Stream_Writer *writer;
+    curl_off_t size;             /* length of the body, -1 when unknown until sent */
+    int gzip;
+    z_stream zs;
+    char in[ACVP_UPLOAD_CHUNK];  /* serialized text waiting to be compressed */
+    int in_eof;
+    int done;                    /* the whole body was handed to curl */
+    size_t raw_len;              /* bytes of JSON text produced */
+    size_t sent_len;             /* bytes of body handed to curl */
+} ACVP_UPLOAD;
+
+static void acvp_upload_free(ACVP_UPLOAD *up) {
+    ACVP_CTX *ctx = NULL;
+
+    if (!up) return;
+
+    ctx = up->ctx;
+    if (up->gzip) {
+        if (up->done) acvp_log_snd_ratio(ctx, up->raw_len, up->sent_len);
+        deflateEnd(&up->zs);
+    }
+    if (up->writer) json_stream_writer_free(up->writer);
+    free(up);
+}
+
+static ACVP_UPLOAD *acvp_upload_new(ACVP_CTX *ctx, const JSON_Value *val) {
+    ACVP_UPLOAD *up = NULL;
+
+    up = calloc(1, sizeof(ACVP_UPLOAD));
+    if (!up) return NULL;
+    up->ctx = ctx;
+
+    up->writer = json_stream_writer_new(val);
+    if (!up->writer) {
+        ACVP_LOG_ERR("Failed to serialize the request body");
+        free(up);
+        return NULL;
+    }
+
+    if (!ctx->compress) {
+        /* The plain text is measured up front so it goes with a Content-Length */
+        up->size = (curl_off_t)json_serialization_size(val) - 1;
+        if (up->size < 0) {
+            ACVP_LOG_ERR("Failed to serialize the request body");
+            acvp_upload_free(up);
+            return NULL;
+        }
+        return up;
+    }
+
+    /* 16 added to the window bits selects the gzip wrapper */
+    if (deflateInit2(&up->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        ACVP_LOG_ERR("deflateInit2 failed");
+        acvp_upload_free(up);
+        return NULL;
+    }
+    up->gzip = 1;
+    up->size = -1;
+
+    return up;
+}
+
+/*
+ * Read callback used by curl to pull the next piece of the body.
+ */
+static size_t acvp_upload_read(char *buf, size_t size, size_t nitems, void *userdata) {
+    ACVP_UPLOAD *up = (ACVP_UPLOAD *)userdata;
+    size_t max = size * nitems;
+    int n = 0, rc = 0;
+
+    if (max > INT_MAX) max = INT_MAX;
+
+    if (!up->gzip) {
+        n = json_stream_writer_read(up->writer, buf, (int)max);
+        if (n < 0) return CURL_READFUNC_ABORT;
+        if (n == 0) up->done = 1;
+        up->raw_len += n;
+        up->sent_len += n;
+        return (size_t)n;
+    }
+
+    up->zs.next_out = (Bytef *)buf;
+    up->zs.avail_out = (uInt)max;
+    while (up->zs.avail_out > 0 && !up->done) {
+        if (up->zs.avail_in == 0 && !up->in_eof) {
+            n = json_stream_writer_read(up->writer, up->in, ACVP_UPLOAD_CHUNK);
+            if (n < 0) return CURL_READFUNC_ABORT;
+            if (n == 0) up->in_eof = 1;
+            up->raw_len += n;
+            up->zs.next_in = (Bytef *)up->in;
+            up->zs.avail_in = (uInt)n;
+        }
+        rc = deflate(&up->zs, up->in_eof ? Z_FINISH : Z_NO_FLUSH);
+        if (rc == Z_STREAM_END) {
+            up->done = 1;
+        } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            return CURL_READFUNC_ABORT;
+        }
+    }
+    up->sent_len += max - up->zs.avail_out;
+
+    return max - up->zs.avail_out;
+}
+
+/*
+ * Adds the headers of a gzip'ed body.  Its size is only known once it
+ * is sent, so it goes in chunks, and the empty Expect header stops
+ * curl from waiting on a "100 Continue" before it starts sending.  A
+ * plain body needs none of these, its Content-Length is known.
+ */
+static struct curl_slist *acvp_upload_headers(ACVP_CTX *ctx, struct curl_slist *slist) {
+    if (slist && ctx->compress) {
+        slist = acvp_hdr_append(slist, "Transfer-Encoding: chunked");
+        if (slist) slist = acvp_hdr_append(slist, "Expect:");
+        if (slist) slist = acvp_hdr_append(slist, "Content-Encoding: gzip");
+    }
+    return slist;
+}
+
+/*
+ * Points a handle at an upload, or detaches it again when up is NULL.
+ */
+static void acvp_upload_setopt(CURL *hnd, ACVP_UPLOAD *up) {
+    if (up) {
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, NULL);
+        curl_easy_setopt(hnd, CURLOPT_POST, 1L);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, up->size);
+        curl_easy_setopt(hnd, CURLOPT_READFUNCTION, &acvp_upload_read);
+        curl_easy_setopt(hnd, CURLOPT_READDATA, up);
+    } else {
+        curl_easy_setopt(hnd, CURLOPT_READFUNCTION, NULL);
+        curl_easy_setopt(hnd, CURLOPT_READDATA, NULL);
+    }
+}
+#else
+/*
+ * murl can't pull the body while it is sent, so the upload holds
+ * the whole body, serialized and gzip'ed up front.
+ */
+typedef struct acvp_upload_t {
+    char *body;
+    int body_len;
+    int gzip;
+} ACVP_UPLOAD;
+
+static void acvp_upload_free(ACVP_UPLOAD *up) {
+    if (!up) return;
+
+    if (up->body) {
+        if (up->gzip) {
+            free(up->body);
+        } else {
+            json_free_serialized_string(up->body);
+        }
+    }
+    free(up);
+}
+
+static ACVP_UPLOAD *acvp_upload_new(ACVP_CTX *ctx, const JSON_Value *val) {
+    ACVP_UPLOAD *up = NULL;
+    char *text = NULL;
+    int text_len = 0;
+
+    up = calloc(1, sizeof(ACVP_UPLOAD));
+    if (!up) return NULL;
+
+    text = json_serialize_to_string(val, &text_len);
+    if (!text) {
+        ACVP_LOG_ERR("Failed to serialize the request body");
+        free(up);
+        return NULL;
+    }
+    if (!ctx->compress) {
+        up->body = text;
+        up->body_len = text_len;
+        return up;
+    }
+
+    if (acvp_gzip(ctx, text, text_len, &up->body, &up->body_len) != ACVP_SUCCESS) {
+        json_free_serialized_string(text);
+        free(up);
+        return NULL;
+    }
+    json_free_serialized_string(text);
+    up->gzip = 1;
+
+    return up;
+}
+
+static struct curl_slist *acvp_upload_headers(ACVP_CTX *ctx, struct curl_slist *slist) {
+    if (slist && ctx->compress) {
+        slist = acvp_hdr_append(slist, "Content-Encoding: gzip");
+    }
+    return slist;
+}
+
+/*
+ * Points a handle at an upload, or detaches it again when up is NULL.
+ */
+static void acvp_upload_setopt(CURL *hnd, ACVP_UPLOAD *up) {
+    if (up) {
+        curl_easy_setopt(hnd, CURLOPT_POST, 1L);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, up->body);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)up->body_len);
+    } else {
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, NULL);
+        curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)0);
+    }
+}
+#endif
+
+/*
+ * This function POSTs a JSON value.  With curl it is serialized
+ * while it is sent, so memory use is independent of the size of the
+ * body.  Only a compressed body uses chunked transfer encoding.
+ */
+static long acvp_curl_http_post_json(ACVP_CTX *ctx, char *url, const JSON_Value *val) {
+    long http_code = 0;
+    CURL *hnd;
+    ACVP_NET_HDRS *hdrs;
+    ACVP_UPLOAD *up = NULL;
+
+    hnd = acvp_curl_handle(ctx);
+    hdrs = acvp_net_hdrs(ctx);
+    if (!hnd || !hdrs) {
+        return 0;
+    }
+
+    up = acvp_upload_new(ctx, val);
+    if (!up) {
+        return 0;
+    }
+
+    ctx->curl_read_ctr = 0;
+    if (ctx->curl_buf) ctx->curl_buf[0] = 0;
+
+    curl_easy_setopt(hnd, CURLOPT_URL, url);
+    curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, hdrs->upload);
+    acvp_upload_setopt(hnd, up);
 
     /*
-     * Create the Authorzation header if needed
+     * Send the HTTP POST request
      */
-    slist = acvp_add_auth_hdr(ctx, slist);
+    http_code = acvp_curl_perform(ctx, hnd);
 
-    ctx->curl_read_ctr = 0;
+    acvp_upload_setopt(hnd, NULL);
+    acvp_upload_free(up);
 
-    /*
-     * Create the HTTP User Agent value
-     */
-    snprintf(user_agent_str, USER_AGENT_STR_MAX, "libacvp/%s", ACVP_VERSION);
+    return http_code;
+}
 
-    /*
-     * Setup Curl
-     */
-    hnd = curl_easy_init();
-    curl_easy_setopt(hnd, CURLOPT_URL, url);
-    curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 1L);
-    curl_easy_setopt(hnd, CURLOPT_USERAGENT, user_agent_str);
-    curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, slist);
-    curl_easy_setopt(hnd, CURLOPT_CUSTOMREQUEST, "POST");
-    curl_easy_setopt(hnd, CURLOPT_POST, 1L);
-    curl_easy_setopt(hnd, CURLOPT_POSTFIELDS, data);
-    curl_easy_setopt(hnd, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)data_len);
-    curl_easy_setopt(hnd, CURLOPT_TCP_KEEPALIVE, 1L);
-    curl_easy_setopt(hnd, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+/*
+ * Sends the vector set responses held in ctx->kat_resp.
+ */
+static long acvp_post_vs_resp(ACVP_CTX *ctx, char *url) {
+    return acvp_curl_http_post_json(ctx, url, ctx->kat_resp);
+}
 
-    /*
-     * Always verify the server
-     */
-    curl_easy_setopt(hnd, CURLOPT_SSL_VERIFYPEER, 1L);
-    if (ctx->cacerts_file) {
-        curl_easy_setopt(hnd, CURLOPT_CAINFO, ctx->cacerts_file);
-        curl_easy_setopt(hnd, CURLOPT_CERTINFO, 1L);
-    }
+/*
+ * Produces the body an upload of val sends, gzip'ed when compression
+ * is on, in one buffer the caller must free.  With curl the body is
+ * pulled in small pieces, the way curl pulls it while sending.  This
+ * lets the uploads be checked without a server.
+ */
+ACVP_RESULT acvp_transport_upload_body(ACVP_CTX *ctx, const JSON_Value *val,
+                                       char **body, int *body_len) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    ACVP_UPLOAD *up = NULL;
+    char *buf = NULL;
+    int len = 0, max = 0;
+#ifndef USE_MURL
+    char chunk[1000];
+    size_t n = 0;
+#endif
 
-    /*
-     * Mutual-auth
-     */
-    if (ctx->tls_cert && ctx->tls_key) {
-        curl_easy_setopt(hnd, CURLOPT_SSLCERTTYPE, "PEM");
-        curl_easy_setopt(hnd, CURLOPT_SSLCERT, ctx->tls_cert);
-        curl_easy_setopt(hnd, CURLOPT_SSLKEYTYPE, "PEM");
-        curl_easy_setopt(hnd, CURLOPT_SSLKEY, ctx->tls_key);
+    if (!ctx) return ACVP_NO_CTX;
+    if (!val || !body || !body_len) return ACVP_MISSING_ARG;
+
+    up = acvp_upload_new(ctx, val);
+    if (!up) return ACVP_JSON_ERR;
+
+#ifndef USE_MURL
+    do {
+        n = acvp_upload_read(chunk, 1, sizeof(chunk), up);
+        if (n == CURL_READFUNC_ABORT) {
+            rv = ACVP_JSON_ERR;
+            goto err;
+        }
+        if (!acvp_rcv_buf_append(&buf, &len, &max, chunk, n)) {
+            rv = ACVP_MALLOC_FAIL;
+            goto err;
+        }
+    } while (n > 0);
+#else
+    if (!acvp_rcv_buf_append(&buf, &len, &max, up->body, (size_t)up->body_len)) {
+        rv = ACVP_MALLOC_FAIL;
+        goto err;
     }
+#endif
 
-    /*
-     * To record the HTTP data recieved from the server,
-     * set the callback function.
-     */
-    curl_easy_setopt(hnd, CURLOPT_WRITEDATA, ctx);
-    curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, &acvp_curl_write_callback);
+    *body = buf;
+    *body_len = len;
+    buf = NULL;
 
-    /*
-     * Send the HTTP POST request
-     */
-    crv = curl_easy_perform(hnd);
-    if (crv != CURLE_OK) {
-        ACVP_LOG_ERR("Curl failed with code %d (%s)\n", crv, curl_easy_strerror(crv));
+err:
+    if (buf) free(buf);
+    acvp_upload_free(up);
+    return rv;
+}
+
+/*
+ * Closes the transport handle of this ctx along with any connection
+ * it still holds open.  The shared cache is left alone since it may
+ * belong to a parent context.
+ */
+void acvp_transport_close(ACVP_CTX *ctx) {
+    if (!ctx) return;
+
+    if (ctx->curl_hnd) {
+        curl_easy_cleanup((CURL *)ctx->curl_hnd);
+        ctx->curl_hnd = NULL;
     }
+    acvp_net_hdrs_free((ACVP_NET_HDRS *)ctx->net_hdrs);
+    ctx->net_hdrs = NULL;
+}
 
-    /*
-     * Get the HTTP reponse status code from the server
-     */
-    curl_easy_getinfo(hnd, CURLINFO_RESPONSE_CODE, &http_code);
+/*
+ * Releases every transport resource owned by ctx, including the
+ * cache shared with its workers.  Workers must be gone by now.
+ */
+void acvp_transport_cleanup(ACVP_CTX *ctx) {
+#if !defined USE_MURL && !defined WIN32
+    ACVP_CURL_SHARE *share = NULL;
+    int i = 0;
+#endif
 
-    curl_easy_cleanup(hnd);
-    hnd = NULL;
-    curl_slist_free_all(slist);
-    slist = NULL;
+    if (!ctx) return;
 
-    return http_code;
+    acvp_async_cleanup(ctx);
+    acvp_transport_close(ctx);
+    acvp_transport_replay_close(ctx);
+
+#if !defined USE_MURL && !defined WIN32
+    share = (ACVP_CURL_SHARE *)ctx->curl_share;
+    if (share) {
+        curl_share_cleanup(share->sh);
+        for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&share->lock[i]);
+        }
+        free(share);
+    }
+#endif
+    ctx->curl_share = NULL;
 }
 
 #if 0
@@ -533,7 +1344,7 @@ ACVP_RESULT acvp_transport_get(ACVP_CTX *ctx, const char *url) {
 #define JWT_EXPIRED_STR_LEN 11
 #define JWT_INVALID_STR "JWT signature does not match"
 #define JWT_INVALID_STR_LEN 28
-static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code) {
+static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code, const char *body) {
     ACVP_RESULT result = ACVP_TRANSPORT_FAIL; /* Generic failure */
     JSON_Value *root_value = NULL;
     const JSON_Object *obj = NULL;
@@ -547,7 +1358,7 @@ static ACVP_RESULT inspect_http_code(ACVP_CTX *ctx, int code) {
     if (code == HTTP_UNAUTH) {
         int diff = 1;
 
-        root_value = json_parse_string(ctx->curl_buf);
+        root_value = json_parse_string(body);
 
         obj = json_value_get_object(root_value);
         if (!obj) {
@@ -580,23 +1391,377 @@ end:
     return result;
 }
 
-static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
-                                          ACVP_NET_ACTION action,
-                                          char *url,
-                                          char *data,
-                                          int data_len,
-                                          int *curl_code) {
-    ACVP_RESULT result = 0;
-    char *resp = NULL;
-    int resp_len = 0;
+/*
+ * Capture and replay
+ *
+ * A capture holds one exchange per request sent, failed attempts
+ * included:
+ *
+ *   >>>> POST /acvp/v1/login 42
+ *   <42 bytes of request body>
+ *   <<<< 200 1234
+ *   <1234 bytes of response body>
+ *
+ * Each body is followed by a newline.  Only the path of the URL is
+ * kept, so a capture can be replayed whatever the server name and
+ * port.  A status of 0 means the transfer failed, the body being
+ * whatever arrived before it did.
+ */
+#define ACVP_CAPTURE_REQ_FMT ">>>> %7s %2082s %d" /* path width is ACVP_ATTR_URL_MAX - 1 */
+#define ACVP_CAPTURE_RSP_FMT "<<<< %ld %d"
+
+typedef struct acvp_replay_entry_t {
+    int post;
+    char *path;
+    char *req;          /* request body that was sent */
+    int req_len;
+    long status;
+    char *body;         /* response body that was received */
+    int body_len;
+    int served;
+} ACVP_REPLAY_ENTRY;
+
+typedef struct acvp_replay_t {
+    ACVP_REPLAY_ENTRY *entries;
+    int count;
+    int first;          /* every entry before this one was served */
+#ifndef WIN32
+    pthread_mutex_t lock; /* worker threads share the capture */
+#endif
+} ACVP_REPLAY;
+
+/*
+ * Returns the path of an absolute URL, everything after the port
+ * with the leading slashes folded into one.
+ */
+static const char *acvp_url_path(const char *url) {
+    const char *p = strstr(url, "://");
+
+    if (!p) return url;
+    p = strchr(p + 3, '/');
+    if (!p) return "/";
+    while (p[1] == '/') {
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Gives the text of a request body, either data as is or val
+ * serialized.  *text must be released with
+ * json_free_serialized_string() when it differs from data.
+ */
+static void acvp_capture_req_text(const char *data, int data_len, const JSON_Value *val,
+                                  char **text, int *text_len) {
+    *text = (char *)data;
+    *text_len = data ? data_len : 0;
+    if (val) {
+        *text = json_serialize_to_string(val, text_len);
+        if (!*text) *text_len = 0;
+    }
+}
+
+/*
+ * Appends an exchange to the capture file.  The request body is
+ * data, or val when the body was serialized while it was sent.
+ */
+static void acvp_capture_record(ACVP_CTX *ctx,
+                                const char *url,
+                                int post,
+                                const char *data,
+                                int data_len,
+                                const JSON_Value *val,
+                                long status,
+                                const char *body,
+                                int body_len) {
+    FILE *fp = ctx->net_record_file;
+    char *req = NULL;
+    int req_len = 0;
+
+    acvp_capture_req_text(data, data_len, val, &req, &req_len);
+    if (!body) body_len = 0;
+
+#ifndef WIN32
+    /* Worker threads share the file */
+    flockfile(fp);
+#endif
+    fprintf(fp, ">>>> %s %s %d\n", post ? "POST" : "GET", acvp_url_path(url), req_len);
+    if (req_len > 0) fwrite(req, 1, (size_t)req_len, fp);
+    fprintf(fp, "\n<<<< %ld %d\n", status, body_len);
+    if (body_len > 0) fwrite(body, 1, (size_t)body_len, fp);
+    fputc('\n', fp);
+    fflush(fp);
+#ifndef WIN32
+    funlockfile(fp);
+#endif
+
+    if (req && req != data) json_free_serialized_string(req);
+}
+
+/*
+ * Reads a body of len bytes and the newline after it.
+ */
+static char *acvp_capture_read_body(FILE *fp, int len) {
+    char *buf = NULL;
+
+    if (len < 0) return NULL;
+    buf = calloc((size_t)len + 1, sizeof(char));
+    if (!buf) return NULL;
+
+    if ((len && fread(buf, 1, (size_t)len, fp) != (size_t)len) || fgetc(fp) != '\n') {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/*
+ * Loads a capture written by acvp_capture_record().
+ */
+ACVP_RESULT acvp_transport_replay_open(ACVP_CTX *ctx, const char *filename) {
+    ACVP_RESULT rv = ACVP_INVALID_ARG;
+    ACVP_REPLAY *rp = NULL;
+    ACVP_REPLAY_ENTRY *e = NULL, *tmp = NULL;
+    FILE *fp = NULL;
+    char line[ACVP_ATTR_URL_MAX + 64];
+    char method[8];
+    char path[ACVP_ATTR_URL_MAX];
+    int max = 0, diff = 1;
+    size_t len = 0;
+
+    fp = fopen(filename, "rb");
+    if (!fp) {
+        ACVP_LOG_ERR("Unable to open %s for replay", filename);
+        return ACVP_INVALID_ARG;
+    }
+
+    rp = calloc(1, sizeof(ACVP_REPLAY));
+    if (!rp) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+#ifndef WIN32
+    pthread_mutex_init(&rp->lock, NULL);
+#endif
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (rp->count == max) {
+            max = max ? max * 2 : 64;
+            tmp = realloc(rp->entries, (size_t)max * sizeof(ACVP_REPLAY_ENTRY));
+            if (!tmp) {
+                rv = ACVP_MALLOC_FAIL;
+                goto end;
+            }
+            rp->entries = tmp;
+        }
+        e = &rp->entries[rp->count];
+        memzero_s(e, sizeof(ACVP_REPLAY_ENTRY));
+
+        if (sscanf(line, ACVP_CAPTURE_REQ_FMT, method, path, &e->req_len) != 3) {
+            goto bad;
+        }
+        strcmp_s(method, sizeof(method), "POST", &diff);
+        e->post = !diff;
+        len = strnlen_s(path, sizeof(path)) + 1;
+        e->path = calloc(len, sizeof(char));
+        if (!e->path) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        strcpy_s(e->path, len, path);
+        rp->count++;
+
+        e->req = acvp_capture_read_body(fp, e->req_len);
+        if (!e->req || !fgets(line, sizeof(line), fp) ||
+            sscanf(line, ACVP_CAPTURE_RSP_FMT, &e->status, &e->body_len) != 2) {
+            goto bad;
+        }
+        e->body = acvp_capture_read_body(fp, e->body_len);
+        if (!e->body) {
+            goto bad;
+        }
+    }
+
+    ACVP_LOG_STATUS("Replaying %d requests from %s", rp->count, filename);
+    ctx->net_replay = rp;
+    rp = NULL;
+    rv = ACVP_SUCCESS;
+    goto end;
+
+bad:
+    ACVP_LOG_ERR("Malformed capture %s, exchange %d", filename, rp->count);
+
+end:
+    if (rp) {
+        ctx->net_replay = rp;
+        acvp_transport_replay_close(ctx);
+    }
+    fclose(fp);
+    return rv;
+}
+
+/*
+ * Releases the capture loaded by acvp_transport_replay_open().
+ */
+void acvp_transport_replay_close(ACVP_CTX *ctx) {
+    ACVP_REPLAY *rp = NULL;
+    int i = 0;
+
+    if (!ctx || !ctx->net_replay) return;
+
+    rp = (ACVP_REPLAY *)ctx->net_replay;
+    for (i = 0; i < rp->count; i++) {
+        free(rp->entries[i].path);
+        free(rp->entries[i].req);
+        free(rp->entries[i].body);
+    }
+    free(rp->entries);
+#ifndef WIN32
+    pthread_mutex_destroy(&rp->lock);
+#endif
+    free(rp);
+    ctx->net_replay = NULL;
+}
+
+/*
+ * Takes the first exchange of the capture for this method and URL
+ * that was not served yet.  Returns NULL, and logs it, when there
+ * is none left.  The request body is only used to tell whether the
+ * request differs from the recorded one.  The exchange goes into the
+ * timings of action with its status and sizes.
+ */
+static const ACVP_REPLAY_ENTRY *acvp_replay_take(ACVP_CTX *ctx,
+                                                 ACVP_NET_ACTION action,
+                                                 const char *url,
+                                                 int post,
+                                                 const char *data,
+                                                 int data_len,
+                                                 const JSON_Value *val) {
+    ACVP_REPLAY *rp = (ACVP_REPLAY *)ctx->net_replay;
+    ACVP_REPLAY_ENTRY *e = NULL;
+    ACVP_NET_TIMING t;
+    const char *path = acvp_url_path(url);
+    char *req = NULL;
+    int req_len = 0, i = 0, diff = 1;
+
+    /* Serialized like the live request would be */
+    acvp_capture_req_text(data, data_len, val, &req, &req_len);
+
+#ifndef WIN32
+    pthread_mutex_lock(&rp->lock);
+#endif
+    for (i = rp->first; i < rp->count; i++) {
+        if (rp->entries[i].served || rp->entries[i].post != post) continue;
+        strcmp_s(rp->entries[i].path, ACVP_ATTR_URL_MAX, path, &diff);
+        if (!diff) {
+            e = &rp->entries[i];
+            e->served = 1;
+            break;
+        }
+    }
+    while (rp->first < rp->count && rp->entries[rp->first].served) {
+        rp->first++;
+    }
+#ifndef WIN32
+    pthread_mutex_unlock(&rp->lock);
+#endif
+
+    if (!e) {
+        ACVP_LOG_ERR("No response left in the capture for %s %s", post ? "POST" : "GET", path);
+    } else if (post && (req_len != e->req_len || memcmp(req, e->req, (size_t)req_len))) {
+        ACVP_LOG_INFO("Request body differs from the capture: %s", path);
+    }
+
+    if (req && req != data) json_free_serialized_string(req);
+
+    /* Recorded like a request that took no time */
+    if (action >= ACVP_NET_GET && action < ACVP_NET_ACTION_MAX) {
+        memzero_s(&t, sizeof(t));
+        t.action = action;
+        if (e) {
+            t.http_code = e->status;
+            t.bytes_up = e->req_len;
+            t.bytes_down = e->body_len;
+        }
+        acvp_net_timing_add(ctx, &t);
+    }
+    return e;
+}
+
+/*
+ * Whether a response from the capture goes through the stream parser
+ * of a vector set download, as it would have when it was received.
+ * This includes the body of a transfer that failed part way.
+ */
+static int acvp_replay_streamed(const ACVP_REPLAY_ENTRY *e) {
+    return e->status == HTTP_OK || (e->status == 0 && e->body_len > 0);
+}
+
+/*
+ * Answers a request from the capture instead of sending it.  The
+ * response is left where curl would have left it, and a vector set
+ * is parsed the same way it is when it is received.
+ */
+static int acvp_replay_send(ACVP_CTX *ctx,
+                            ACVP_NET_ACTION action,
+                            char *url,
+                            char *data,
+                            int data_len) {
+    const ACVP_REPLAY_ENTRY *e = NULL;
+    JSON_Stream_Parser *parser = NULL;
+    int post = action != ACVP_NET_GET && action != ACVP_NET_GET_VS;
+
+    ctx->curl_read_ctr = 0;
+    if (ctx->curl_buf) ctx->curl_buf[0] = 0;
+    ctx->net_requests++;
+
+    /* The headers are built as for a live request */
+    if (!acvp_net_hdrs(ctx)) return 0;
+
+    e = acvp_replay_take(ctx, ctx->net_action, url, post, data, data_len,
+                         action == ACVP_NET_POST_VS_RESP ? ctx->kat_resp : NULL);
+    if (!e) return 0;
+
+    if (action == ACVP_NET_GET_VS && acvp_replay_streamed(e) && ACVP_RCV_STREAM(ctx)) {
+        parser = json_stream_parser_new();
+        if (parser) {
+            json_stream_parser_feed(parser, e->body, (size_t)e->body_len);
+            acvp_rcv_stream_finish(ctx, &parser, e->status == HTTP_OK);
+            return (int)e->status;
+        }
+    }
+
+    if (!acvp_rcv_buf_append(&ctx->curl_buf, &ctx->curl_read_ctr, &ctx->curl_buf_max,
+                             e->body, (size_t)e->body_len)) {
+        return 0;
+    }
+    return (int)e->status;
+}
+
+/*
+ * Sends one request for a generic action and returns the HTTP
+ * status, 0 when no response was received.
+ */
+static int acvp_net_send(ACVP_CTX *ctx,
+                         ACVP_NET_ACTION action,
+                         char *url,
+                         char *data,
+                         int data_len) {
     int rc = 0;
 
+    if (ctx->net_replay) {
+        return acvp_replay_send(ctx, action, url, data, data_len);
+    }
+
     switch(action) {
     case ACVP_NET_GET:
-    case ACVP_NET_GET_VS:
     case ACVP_NET_GET_VS_RESULT:
     case ACVP_NET_GET_VS_SAMPLE:
-        rc = acvp_curl_http_get(ctx, url);
+        rc = acvp_curl_http_get(ctx, url, 0);
+        break;
+
+    case ACVP_NET_GET_VS:
+        rc = acvp_curl_http_get(ctx, url, ACVP_RCV_STREAM(ctx));
         break;
 
     case ACVP_NET_POST:
@@ -606,20 +1771,165 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
         break;
 
     case ACVP_NET_POST_VS_RESP:
-        resp = json_serialize_to_string(ctx->kat_resp, &resp_len);
-
-        rc = acvp_curl_http_post(ctx, url, resp, resp_len);
-        json_value_free(ctx->kat_resp);
-        ctx->kat_resp = NULL;
+        rc = acvp_post_vs_resp(ctx, url);
         break;
 
-    default:
-        ACVP_LOG_ERR("Unknown ACVP_NET_ACTION");
-        return ACVP_INVALID_ARG;
-    }
+    case ACVP_NET_ACTION_MAX:
+    default:
+        ACVP_LOG_ERR("Unknown ACVP_NET_ACTION");
+        return 0;
+    }
+
+    if (ctx->net_record_file) {
+        acvp_capture_record(ctx, url, action != ACVP_NET_GET && action != ACVP_NET_GET_VS,
+                            data, data_len, action == ACVP_NET_POST_VS_RESP ? ctx->kat_resp : NULL,
+                            rc, ctx->curl_buf, ctx->curl_read_ctr);
+    }
+    return rc;
+}
+
+/*
+ * Failures worth another attempt: no response at all (connection
+ * reset, timeout), rate limiting and server errors.
+ */
+static int acvp_net_transient(long http_code) {
+    return http_code == 0 || http_code == HTTP_TOO_MANY_REQUESTS ||
+           (http_code >= 500 && http_code <= 599);
+}
+
+/*
+ * Takes one retry out of the session budget.  Worker threads
+ * share the budget, there are none on Windows.
+ */
+static int acvp_retry_take(ACVP_CTX *ctx) {
+    if (!ctx->retry_budget) return 1;
+#ifdef WIN32
+    return --(*ctx->retry_budget) >= 0;
+#else
+    return __sync_sub_and_fetch(ctx->retry_budget, 1) >= 0;
+#endif
+}
+
+/*
+ * Decides whether a request that failed on the given attempt is
+ * resent.  Returns the delay before the next attempt, or -1 to give
+ * up.  deadline is 0 or the time, see acvp_time_ms(), by which the
+ * request has to be done.
+ */
+static long long acvp_retry_delay(ACVP_CTX *ctx, ACVP_NET_ACTION action,
+                                  int attempt, long long deadline) {
+    ACVP_RETRY_POLICY *p = &ctx->retry;
+    long long delay = 0;
+    int i = 0;
+
+    if (attempt >= p->max_attempts) return -1;
+
+    delay = p->base_delay_ms;
+    for (i = 1; i < attempt && delay < p->max_delay_ms; i++) {
+        delay *= 2;
+    }
+    if (delay > p->max_delay_ms) delay = p->max_delay_ms;
+
+    /* Jitter, anywhere from half to all of the delay */
+    delay = delay / 2 + acvp_jitter_ms(delay / 2);
+
+    if (deadline && acvp_time_ms() + delay >= deadline) {
+        ACVP_LOG_WARN("No time left to retry the request");
+        return -1;
+    }
+    if (!acvp_retry_take(ctx)) {
+        ACVP_LOG_WARN("Retry budget of the session exhausted");
+        return -1;
+    }
+
+    if (action >= ACVP_NET_GET && action < ACVP_NET_ACTION_MAX) {
+        ctx->net_stats[action].retries++;
+    }
+    if (ctx->net_replay) {
+        /* Nothing to wait for when the answer comes from a capture */
+        delay = 0;
+    }
+    return delay;
+}
+
+/*
+ * Limits the next transfer on hnd to the time left until the
+ * deadline, 0 removes the limit.  murl has no timeouts.
+ */
+static void acvp_net_set_deadline(CURL *hnd, long long deadline) {
+#ifndef USE_MURL
+    long left = 0;
+
+    if (deadline) {
+        left = (long)(deadline - acvp_time_ms());
+        if (left < 1) left = 1;
+    }
+    curl_easy_setopt(hnd, CURLOPT_TIMEOUT_MS, left);
+#else
+    (void)hnd;
+    (void)deadline;
+#endif
+}
+
+/*
+ * Sends a request, and resends it as the retry policy allows
+ * while it fails for a transient reason.
+ */
+static int acvp_net_send_retry(ACVP_CTX *ctx,
+                               ACVP_NET_ACTION action,
+                               char *url,
+                               char *data,
+                               int data_len) {
+    ACVP_NET_ACTION timed_action = ctx->net_action;
+    CURL *hnd = NULL;
+    long long deadline = 0, delay = 0;
+    int attempt = 1;
+    int rc = 0;
+
+    if (ctx->retry.deadline_ms) {
+        deadline = acvp_time_ms() + ctx->retry.deadline_ms;
+    }
+
+    while (1) {
+        hnd = acvp_curl_handle(ctx);
+        if (hnd && deadline) acvp_net_set_deadline(hnd, deadline);
+
+        rc = acvp_net_send(ctx, action, url, data, data_len);
+        if (!acvp_net_transient(rc)) break;
+
+        delay = acvp_retry_delay(ctx, timed_action, attempt, deadline);
+        if (delay < 0) break;
+
+        ACVP_LOG_WARN("Request failed (HTTP %d), retry %d of %d in %lld ms: %s",
+                      rc, attempt, ctx->retry.max_attempts - 1, delay, url);
+        acvp_sleep_ms(delay);
+        if (ctx->rcv_val) {
+            json_value_free(ctx->rcv_val);
+            ctx->rcv_val = NULL;
+        }
+        attempt++;
+    }
+
+    if (deadline && ctx->curl_hnd) {
+        acvp_net_set_deadline((CURL *)ctx->curl_hnd, 0);
+    }
+    return rc;
+}
+
+static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
+                                          ACVP_NET_ACTION action,
+                                          char *url,
+                                          char *data,
+                                          int data_len,
+                                          int *curl_code) {
+    ACVP_RESULT result = 0;
+    ACVP_NET_ACTION timed_action = ctx->net_action;
+    int rc = 0;
+
+    rc = acvp_net_send_retry(ctx, action, url, data, data_len);
 
     /* Peek at the HTTP code */
-    result = inspect_http_code(ctx, rc);
+    result = inspect_http_code(ctx, rc, ctx->curl_buf);
 
     if (result != ACVP_SUCCESS) {
         if (result == ACVP_JWT_EXPIRED &&
@@ -640,30 +1950,11 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
                 goto end;
             }
 
-            /* Try action again after the refresh */
-            switch(action) {
-            case ACVP_NET_GET:
-            case ACVP_NET_GET_VS:
-            case ACVP_NET_GET_VS_RESULT:
-            case ACVP_NET_GET_VS_SAMPLE:
-                rc = acvp_curl_http_get(ctx, url);
-                break;
-
-            case ACVP_NET_POST:
-            case ACVP_NET_POST_REG:
-                rc = acvp_curl_http_post(ctx, url, data, data_len);
-                break;
-
-            case ACVP_NET_POST_VS_RESP:
-                rc = acvp_curl_http_post(ctx, url, resp, resp_len);
-                break;
-
-            case ACVP_NET_POST_LOGIN:
-                ACVP_LOG_ERR("We should never be here!");
-                break;
-            }
+            /* Try action again after the refresh, the login changed the timed action */
+            ctx->net_action = timed_action;
+            rc = acvp_net_send_retry(ctx, action, url, data, data_len);
 
-            result = inspect_http_code(ctx, rc);
+            result = inspect_http_code(ctx, rc, ctx->curl_buf);
             if (result != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Refreshed + retried, HTTP transport fails. curl rc=%d\n", rc);
                 goto end;
@@ -683,65 +1974,112 @@ static ACVP_RESULT execute_network_action(ACVP_CTX *ctx,
     result = ACVP_SUCCESS;
 
 end:
-    if (resp) json_free_serialized_string(resp);
+    if (action == ACVP_NET_POST_VS_RESP && ctx->kat_resp) {
+        json_value_free(ctx->kat_resp);
+        ctx->kat_resp = NULL;
+    }
 
     *curl_code = rc;
 
     return result;
 }
 
+/*
+ * Appends a response in full to the network log file.  The body is
+ * written as is, without going through any formatting.
+ */
+static void acvp_net_log_file(ACVP_CTX *ctx,
+                              const char *what,
+                              int curl_code,
+                              const char *url,
+                              const char *body,
+                              int body_len) {
+    FILE *fp = ctx->net_log_file;
+
+#ifndef WIN32
+    /* Worker threads share the file */
+    flockfile(fp);
+#endif
+    fprintf(fp, "==== %s status=%d url=%s len=%d\n", what, curl_code, url, body_len);
+    if (body_len > 0) {
+        fwrite(body, 1, (size_t)body_len, fp);
+    }
+    fputc('\n', fp);
+    fflush(fp);
+#ifndef WIN32
+    funlockfile(fp);
+#endif
+}
+
 static void log_network_status(ACVP_CTX *ctx,
                                ACVP_NET_ACTION action,
                                int curl_code,
-                               const char *url) {
+                               const char *url,
+                               const char *body,
+                               int body_len) {
+    const char *what = NULL;
+    int verbose = 0;    /* printed to stdout in verbose mode */
+    int shown = 0;
+    char more[48] = {0};
+
     switch(action) {
     case ACVP_NET_GET:
-        ACVP_LOG_STATUS("GET...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                        curl_code, url, ctx->curl_buf);
+        what = "GET";
         break;
     case ACVP_NET_GET_VS:
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("GET Vector Set...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                   curl_code, url, ctx->curl_buf);
-        } else {
-            ACVP_LOG_STATUS("GET Vector Set...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                            curl_code, url, ctx->curl_buf);
-        }
+        what = "GET Vector Set";
+        verbose = 1;
         break;
     case ACVP_NET_GET_VS_RESULT:
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("GET Vector Set Result...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                   curl_code, url, ctx->curl_buf);
-        } else {
-            ACVP_LOG_STATUS("GET Vector Set Result...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                            curl_code, url, ctx->curl_buf);
-        }
+        what = "GET Vector Set Result";
+        verbose = 1;
         break;
     case ACVP_NET_GET_VS_SAMPLE:
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("GET Vector Set Sample...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                   curl_code, url, ctx->curl_buf);
-        } else {
-            ACVP_LOG_STATUS("GET Vector Set Sample...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                            curl_code, url, ctx->curl_buf);
-        }
+        what = "GET Vector Set Sample";
+        verbose = 1;
         break;
     case ACVP_NET_POST:
-        ACVP_LOG_STATUS("POST...\n\tStatus: %d\n\tUrl: %s\n\tResp: %s\n",
-                        curl_code, url, ctx->curl_buf);
+        what = "POST";
         break;
     case ACVP_NET_POST_LOGIN:
-        ACVP_LOG_STATUS("POST Login...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                        curl_code, url, ctx->curl_buf);
+        what = "POST Login";
         break;
     case ACVP_NET_POST_REG:
-        ACVP_LOG_STATUS("POST Registration...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                        curl_code, url, ctx->curl_buf);
+        what = "POST Registration";
         break;
     case ACVP_NET_POST_VS_RESP:
-        ACVP_LOG_STATUS("POST Response Submission...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%s\n",
-                        curl_code, url, ctx->curl_buf);
+        what = "POST Response Submission";
         break;
+    case ACVP_NET_ACTION_MAX:
+        return;
+    }
+
+    if (!body) {
+        body = "";
+        body_len = 0;
+    }
+
+    if (ctx->net_log_file) {
+        acvp_net_log_file(ctx, what, curl_code, url, body, body_len);
+    }
+
+    /* Nothing is formatted when the message would be dropped */
+    if (ctx->debug < ACVP_LOG_LVL_STATUS) return;
+    verbose = verbose && ctx->debug == ACVP_LOG_LVL_VERBOSE;
+    if (!verbose && !ctx->test_progress_cb) return;
+
+    shown = body_len;
+    if (ctx->net_log_preview && body_len > ctx->net_log_preview) {
+        shown = ctx->net_log_preview;
+        snprintf(more, sizeof(more), "\n\t... %d more bytes", body_len - shown);
+    }
+
+    if (verbose) {
+        printf("%s...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%.*s%s\n",
+               what, curl_code, url, shown, body, more);
+    } else {
+        ACVP_LOG_STATUS("%s...\n\tStatus: %d\n\tUrl: %s\n\tResp:\n%.*s%s\n",
+                        what, curl_code, url, shown, body, more);
     }
 }
 
@@ -771,18 +2109,27 @@ static ACVP_RESULT acvp_network_action(ACVP_CTX *ctx,
     }
 
     if (ctx->curl_buf) {
-        /* Clear the HTTP buffer for next server response */
-        memzero_s(ctx->curl_buf, ACVP_CURL_BUF_MAX);
+        /* Empty the HTTP buffer for next server response */
+        ctx->curl_buf[0] = 0;
+    }
+    ctx->curl_read_ctr = 0;
+    if (ctx->rcv_val) {
+        json_value_free(ctx->rcv_val);
+        ctx->rcv_val = NULL;
     }
 
     switch (action) {
     case ACVP_NET_GET:
-    case ACVP_NET_GET_VS:
     case ACVP_NET_GET_VS_RESULT:
     case ACVP_NET_GET_VS_SAMPLE:
         generic_action = ACVP_NET_GET;
         break;
 
+    case ACVP_NET_GET_VS:
+        /* Kept apart, the vector set is parsed while it is received */
+        generic_action = ACVP_NET_GET_VS;
+        break;
+
     case ACVP_NET_POST:
     case ACVP_NET_POST_REG:
         check_data = 1;
@@ -793,6 +2140,7 @@ static ACVP_RESULT acvp_network_action(ACVP_CTX *ctx,
         /* Clear jwt if logging in */
         if (ctx->jwt_token) free(ctx->jwt_token);
         ctx->jwt_token = NULL;
+        acvp_transport_reset_auth(ctx);
         check_data = 1;
         generic_action = ACVP_NET_POST_LOGIN;
         break;
@@ -800,6 +2148,10 @@ static ACVP_RESULT acvp_network_action(ACVP_CTX *ctx,
     case ACVP_NET_POST_VS_RESP:
         generic_action = ACVP_NET_POST_VS_RESP;
         break;
+
+    default:
+        ACVP_LOG_ERR("Unknown ACVP_NET_ACTION");
+        return ACVP_INVALID_ARG;
     }
 
     if (check_data && (!data || !data_len)) {
@@ -807,12 +2159,605 @@ static ACVP_RESULT acvp_network_action(ACVP_CTX *ctx,
         return ACVP_NO_DATA;
     }
 
+    /* Timings are kept for the specific action */
+    ctx->net_action = action;
     rv = execute_network_action(ctx, generic_action, url,
                                 data, data_len, &curl_code);
 
     /* Log to the console */
-    log_network_status(ctx, action, curl_code, url);
+    if (ctx->rcv_val) {
+        log_network_status(ctx, action, curl_code, url,
+                           ACVP_RCV_STREAMED, (int)sizeof(ACVP_RCV_STREAMED) - 1);
+    } else {
+        log_network_status(ctx, action, curl_code, url, ctx->curl_buf, ctx->curl_read_ctr);
+    }
 
     return rv;
 }
 
+
+/*
+ * Asynchronous transport
+ *
+ * Requests started with the acvp_async_* functions are driven by a
+ * curl multi handle owned by the ctx, so that any number of them can
+ * be in flight on the caller's thread.  Each request has its own easy
+ * handle and receive buffer.  acvp_async_run() moves the transfers
+ * along and invokes the completion callback of every request that has
+ * finished.  The callback is invoked exactly once per request, and may
+ * start new requests.
+ */
+typedef struct acvp_net_req_t {
+    CURL *hnd;
+    ACVP_NET_ACTION action;
+    char url[ACVP_ATTR_URL_MAX];
+    JSON_Value *body;   /* POST body, owned by the request */
+    ACVP_UPLOAD *up;    /* serializes body while it is sent */
+    size_t rcv_len;     /* decoded body bytes received */
+    long long start_us; /* when the request was started, see acvp_time_us() */
+    long long ttfb_us;  /* first response byte, from start_us */
+    char *buf;          /* HTTP body received from the server */
+    int buf_len;
+    int buf_max;
+    int stream;         /* parse the body while it is received */
+    JSON_Stream_Parser *parser;
+    JSON_Arena *arena;  /* current when the request was started, the body is parsed into it */
+    int refreshed;      /* the jwt was already refreshed for this request */
+    int attempt;        /* attempts made so far, see ACVP_RETRY_POLICY */
+    long long deadline; /* see acvp_time_ms(), 0 = none */
+    long long retry_at; /* when a request in the waiting list is resent */
+    long replay_status; /* status of the response taken from the capture */
+    ACVP_NET_CB cb;
+    void *arg;
+    struct acvp_net_req_t *next;
+} ACVP_NET_REQ;
+
+typedef struct acvp_curl_multi_t {
+    CURLM *mh;
+    ACVP_NET_REQ *reqs;   /* requests added to mh */
+    ACVP_NET_REQ *waiting; /* requests waiting for their retry delay */
+    ACVP_NET_REQ *replayed; /* requests answered from the capture, in order */
+} ACVP_CURL_MULTI;
+
+/*
+ * Write callback of an asynchronous request, the body is
+ * accumulated in the request's own buffer or parsed as it
+ * arrives.
+ */
+static size_t acvp_net_req_write(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    ACVP_NET_REQ *req = (ACVP_NET_REQ *)userdata;
+    JSON_Arena *prev = NULL;
+    int consumed = 0;
+
+    if (size != 1) {
+        fprintf(stderr, "\ncurl size not 1\n");
+        return 0;
+    }
+
+    if (!req->ttfb_us) {
+        req->ttfb_us = acvp_time_us() - req->start_us;
+    }
+    req->rcv_len += nmemb;
+    if (req->stream) {
+        prev = json_arena_set(req->arena);
+        consumed = acvp_rcv_stream(req->hnd, &req->stream, &req->parser, ptr, nmemb);
+        json_arena_set(prev);
+        if (consumed) return nmemb;
+    }
+
+    if (!acvp_rcv_buf_append(&req->buf, &req->buf_len, &req->buf_max, ptr, nmemb)) {
+        return 0;
+    }
+
+    return nmemb;
+}
+
+/*
+ * Sets the per-request options.  Called again when a request
+ * is resent after the jwt has been refreshed.
+ */
+static ACVP_RESULT acvp_net_req_prepare(ACVP_CTX *ctx, ACVP_NET_REQ *req) {
+    ACVP_NET_HDRS *hdrs = NULL;
+
+    if (req->up) {
+        acvp_upload_free(req->up);
+        req->up = NULL;
+    }
+    req->buf_len = 0;
+    req->rcv_len = 0;
+    req->start_us = acvp_time_us();
+    req->ttfb_us = 0;
+    if (req->buf) req->buf[0] = 0;
+    if (req->parser) {
+        json_stream_parser_free(req->parser);
+        req->parser = NULL;
+    }
+    req->stream = req->action == ACVP_NET_GET_VS && ACVP_RCV_STREAM(ctx);
+
+    hdrs = acvp_net_hdrs(ctx);
+    if (!hdrs) return ACVP_MALLOC_FAIL;
+
+    /* Nothing is sent when the response comes from a capture */
+    if (ctx->net_replay) return ACVP_SUCCESS;
+    if (req->body) {
+        /* Start over, a resent request replays the body from the top */
+        req->up = acvp_upload_new(ctx, req->body);
+        if (!req->up) return ACVP_JSON_ERR;
+    }
+
+    curl_easy_setopt(req->hnd, CURLOPT_URL, req->url);
+    curl_easy_setopt(req->hnd, CURLOPT_HTTPHEADER, req->up ? hdrs->upload : hdrs->get);
+    if (req->deadline) acvp_net_set_deadline(req->hnd, req->deadline);
+    if (req->up) {
+        acvp_upload_setopt(req->hnd, req->up);
+    } else {
+        curl_easy_setopt(req->hnd, CURLOPT_HTTPGET, 1L);
+    }
+
+    return ACVP_SUCCESS;
+}
+
+static void acvp_net_req_free(ACVP_NET_REQ *req) {
+    if (req->hnd) curl_easy_cleanup(req->hnd);
+    acvp_upload_free(req->up);
+    if (req->body) json_value_free(req->body);
+    if (req->buf) free(req->buf);
+    if (req->parser) json_stream_parser_free(req->parser);
+    free(req);
+}
+
+/*
+ * Invokes the completion callback and frees the request.  The JSON
+ * held by the request goes first, the callback may free the arena
+ * it came from.
+ */
+static void acvp_net_req_done(ACVP_CTX *ctx, ACVP_NET_REQ *req, ACVP_RESULT rv,
+                              const char *body, int body_len) {
+    acvp_upload_free(req->up);
+    req->up = NULL;
+    if (req->body) {
+        json_value_free(req->body);
+        req->body = NULL;
+    }
+    if (req->parser) {
+        json_stream_parser_free(req->parser);
+        req->parser = NULL;
+    }
+
+    (req->cb)(ctx, rv, body, body_len, req->arg);
+    acvp_net_req_free(req);
+}
+
+static void acvp_net_req_unlink(ACVP_CURL_MULTI *m, ACVP_NET_REQ *req) {
+    ACVP_NET_REQ **pos = &m->reqs;
+
+    while (*pos && *pos != req) {
+        pos = &(*pos)->next;
+    }
+    if (*pos) *pos = req->next;
+    req->next = NULL;
+}
+
+/*
+ * Puts a prepared request on the multi handle, or answers it from
+ * the capture when replaying, in which case the next run completes
+ * it.  The request is linked into the matching list.
+ */
+static ACVP_RESULT acvp_async_add(ACVP_CTX *ctx, ACVP_CURL_MULTI *m, ACVP_NET_REQ *req) {
+    const ACVP_REPLAY_ENTRY *e = NULL;
+    ACVP_NET_REQ **pos = &m->replayed;
+
+    if (!ctx->net_replay) {
+        if (curl_multi_add_handle(m->mh, req->hnd) != CURLM_OK) {
+            ACVP_LOG_ERR("curl_multi_add_handle failed");
+            return ACVP_TRANSPORT_FAIL;
+        }
+        req->next = m->reqs;
+        m->reqs = req;
+        return ACVP_SUCCESS;
+    }
+
+    req->replay_status = 0;
+    e = acvp_replay_take(ctx, req->action, req->url, req->body != NULL, NULL, 0, req->body);
+    if (e) {
+        req->replay_status = e->status;
+        if (req->stream && acvp_replay_streamed(e)) {
+            JSON_Arena *prev = json_arena_set(req->arena);
+            req->parser = json_stream_parser_new();
+            json_arena_set(prev);
+        }
+        if (req->parser) {
+            json_stream_parser_feed(req->parser, e->body, (size_t)e->body_len);
+        } else if (!acvp_rcv_buf_append(&req->buf, &req->buf_len, &req->buf_max,
+                                        e->body, (size_t)e->body_len)) {
+            req->replay_status = 0;
+        }
+    }
+
+    while (*pos) {
+        pos = &(*pos)->next;
+    }
+    req->next = NULL;
+    *pos = req;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Starts a request.  The body, if any, is POSTed and is owned by
+ * the request from now on, even on failure.
+ */
+static ACVP_RESULT acvp_async_start(ACVP_CTX *ctx,
+                                    ACVP_NET_ACTION action,
+                                    const char *url,
+                                    JSON_Value *body,
+                                    ACVP_NET_CB cb,
+                                    void *arg) {
+    ACVP_CURL_MULTI *m = (ACVP_CURL_MULTI *)ctx->curl_multi;
+    ACVP_NET_REQ *req = NULL;
+
+    if (!m) {
+        m = calloc(1, sizeof(ACVP_CURL_MULTI));
+        if (!m) {
+            if (body) json_value_free(body);
+            return ACVP_MALLOC_FAIL;
+        }
+        m->mh = curl_multi_init();
+        if (!m->mh) {
+            ACVP_LOG_ERR("curl_multi_init failed");
+            free(m);
+            if (body) json_value_free(body);
+            return ACVP_TRANSPORT_FAIL;
+        }
+        ctx->curl_multi = m;
+    }
+
+    req = calloc(1, sizeof(ACVP_NET_REQ));
+    if (!req) {
+        if (body) json_value_free(body);
+        return ACVP_MALLOC_FAIL;
+    }
+    req->action = action;
+    req->body = body;
+    req->arena = json_arena_get();
+    req->cb = cb;
+    req->arg = arg;
+    req->attempt = 1;
+    if (ctx->retry.deadline_ms) {
+        req->deadline = acvp_time_ms() + ctx->retry.deadline_ms;
+    }
+    strcpy_s(req->url, ACVP_ATTR_URL_MAX, url);
+
+    req->hnd = curl_easy_init();
+    if (!req->hnd) {
+        ACVP_LOG_ERR("curl_easy_init failed");
+        acvp_net_req_free(req);
+        return ACVP_TRANSPORT_FAIL;
+    }
+    acvp_curl_set_opts(ctx, req->hnd);
+    curl_easy_setopt(req->hnd, CURLOPT_WRITEDATA, req);
+    curl_easy_setopt(req->hnd, CURLOPT_WRITEFUNCTION, &acvp_net_req_write);
+    curl_easy_setopt(req->hnd, CURLOPT_PRIVATE, req);
+    if (acvp_net_req_prepare(ctx, req) != ACVP_SUCCESS) {
+        acvp_net_req_free(req);
+        return ACVP_JSON_ERR;
+    }
+
+    if (acvp_async_add(ctx, m, req) != ACVP_SUCCESS) {
+        acvp_net_req_free(req);
+        return ACVP_TRANSPORT_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Handles a finished transfer: checks the HTTP status, resends the
+ * request once with a fresh jwt if it had expired, and otherwise
+ * hands the body to the completion callback.
+ */
+static void acvp_async_complete(ACVP_CTX *ctx, ACVP_NET_REQ *req, CURLcode crv) {
+    ACVP_CURL_MULTI *m = (ACVP_CURL_MULTI *)ctx->curl_multi;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    long http_code = 0;
+    long new_conns = 0;
+    long long delay = 0;
+
+    ctx->net_requests++;
+    if (ctx->net_replay) {
+        http_code = req->replay_status;
+        rv = inspect_http_code(ctx, http_code, req->buf);
+    } else if (crv != CURLE_OK) {
+        ACVP_LOG_ERR("Curl failed with code %d (%s)\n", crv, curl_easy_strerror(crv));
+        acvp_net_timing_record(ctx, req->action, req->hnd, 0, req->ttfb_us);
+        rv = ACVP_TRANSPORT_FAIL;
+    } else {
+        if (curl_easy_getinfo(req->hnd, CURLINFO_NUM_CONNECTS, &new_conns) == CURLE_OK &&
+            new_conns == 0) {
+            ctx->net_conn_reused++;
+        }
+        acvp_log_rcv_ratio(ctx, req->hnd, req->rcv_len);
+        curl_easy_getinfo(req->hnd, CURLINFO_RESPONSE_CODE, &http_code);
+        acvp_net_timing_record(ctx, req->action, req->hnd, http_code, req->ttfb_us);
+
+        rv = inspect_http_code(ctx, http_code, req->buf);
+    }
+
+    if (ctx->net_record_file && !ctx->net_replay) {
+        acvp_capture_record(ctx, req->url, req->body != NULL, NULL, 0, req->body,
+                            http_code, req->buf, req->buf_len);
+    }
+
+    if (rv == ACVP_JWT_EXPIRED && !req->refreshed) {
+        ACVP_LOG_ERR("JWT authorization has timed out, curl rc=%ld.\n"
+                     "Refreshing session...", http_code);
+        rv = acvp_refresh(ctx);
+        if (rv == ACVP_SUCCESS) {
+            /* Send it again with the new jwt */
+            req->refreshed = 1;
+            if (acvp_net_req_prepare(ctx, req) == ACVP_SUCCESS &&
+                acvp_async_add(ctx, m, req) == ACVP_SUCCESS) {
+                return;
+            }
+            rv = ACVP_TRANSPORT_FAIL;
+        } else {
+            ACVP_LOG_ERR("JWT refresh failed.");
+        }
+    }
+
+    /* Send it again later if the failure may go away */
+    if (rv != ACVP_SUCCESS && acvp_net_transient(http_code)) {
+        delay = acvp_retry_delay(ctx, req->action, req->attempt, req->deadline);
+        if (delay >= 0) {
+            ACVP_LOG_WARN("Request failed (HTTP %ld), retry %d of %d in %lld ms: %s",
+                          http_code, req->attempt, ctx->retry.max_attempts - 1, delay, req->url);
+            req->attempt++;
+            req->retry_at = acvp_time_ms() + delay;
+            req->next = m->waiting;
+            m->waiting = req;
+            return;
+        }
+    }
+
+    /*
+     * The callback finds a body parsed on arrival in ctx->rcv_val.  The
+     * body of a failed request is dropped here, the callback may free
+     * the arena it was parsed into.
+     */
+    acvp_rcv_stream_finish(ctx, &req->parser, rv == ACVP_SUCCESS);
+
+    if (ctx->rcv_val) {
+        log_network_status(ctx, req->action, http_code, req->url,
+                           ACVP_RCV_STREAMED, (int)sizeof(ACVP_RCV_STREAMED) - 1);
+    } else {
+        log_network_status(ctx, req->action, http_code, req->url, req->buf, req->buf_len);
+    }
+
+    acvp_net_req_done(ctx, req, rv, req->buf, req->buf_len);
+    if (ctx->rcv_val) {
+        json_value_free(ctx->rcv_val);
+        ctx->rcv_val = NULL;
+    }
+}
+
+/*
+ * Puts the requests whose retry delay has passed back on the multi
+ * handle.  Returns the time until the next one is due, or -1 when
+ * none is waiting.
+ */
+static long long acvp_async_resume(ACVP_CTX *ctx, ACVP_CURL_MULTI *m) {
+    ACVP_NET_REQ **pos = &m->waiting;
+    ACVP_NET_REQ *req = NULL;
+    long long now = acvp_time_ms(), next = -1;
+
+    while ((req = *pos)) {
+        if (req->retry_at > now) {
+            if (next < 0 || req->retry_at - now < next) next = req->retry_at - now;
+            pos = &req->next;
+            continue;
+        }
+        *pos = req->next;
+        req->next = NULL;
+        if (acvp_net_req_prepare(ctx, req) != ACVP_SUCCESS ||
+            acvp_async_add(ctx, m, req) != ACVP_SUCCESS) {
+            acvp_net_req_done(ctx, req, ACVP_TRANSPORT_FAIL, NULL, 0);
+        }
+    }
+
+    return next;
+}
+
+/*
+ * Waits up to timeout_ms for network activity, progresses every
+ * transfer and completes the requests that have finished.  Returns
+ * right away when no request is in flight.
+ */
+ACVP_RESULT acvp_async_run(ACVP_CTX *ctx, long long timeout_ms) {
+    ACVP_CURL_MULTI *m = NULL;
+    ACVP_NET_REQ *req = NULL, *done = NULL;
+    CURLMsg *msg = NULL;
+    int running = 0, left = 0;
+    long long next = 0;
+
+    if (!ctx) return ACVP_NO_CTX;
+
+    m = (ACVP_CURL_MULTI *)ctx->curl_multi;
+    if (!m || (!m->reqs && !m->waiting && !m->replayed)) return ACVP_SUCCESS;
+
+    if (timeout_ms < 0) timeout_ms = 0;
+    if (timeout_ms > ACVP_RETRY_TIME_MAX * 1000) timeout_ms = ACVP_RETRY_TIME_MAX * 1000;
+
+    next = acvp_async_resume(ctx, m);
+    if (next >= 0 && next < timeout_ms) timeout_ms = next;
+
+    if (m->replayed) {
+        /* Answered from the capture, the callbacks may add more for the next run */
+        done = m->replayed;
+        m->replayed = NULL;
+        while ((req = done)) {
+            done = req->next;
+            req->next = NULL;
+            acvp_async_complete(ctx, req, CURLE_OK);
+        }
+        return ACVP_SUCCESS;
+    }
+
+    if (!m->reqs) {
+        /* Only requests waiting to be retried */
+        acvp_sleep_ms(timeout_ms);
+        acvp_async_resume(ctx, m);
+        return ACVP_SUCCESS;
+    }
+
+    if (curl_multi_perform(m->mh, &running) != CURLM_OK ||
+        (running && curl_multi_wait(m->mh, NULL, 0, (int)timeout_ms, NULL) != CURLM_OK) ||
+        curl_multi_perform(m->mh, &running) != CURLM_OK) {
+        ACVP_LOG_ERR("curl multi interface failed");
+        return ACVP_TRANSPORT_FAIL;
+    }
+
+    while ((msg = curl_multi_info_read(m->mh, &left))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+        curl_multi_remove_handle(m->mh, req->hnd);
+        acvp_net_req_unlink(m, req);
+        acvp_async_complete(ctx, req, msg->data.result);
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Abandons every request still in flight, their callbacks are
+ * invoked with ACVP_TRANSPORT_FAIL, and releases the multi handle.
+ */
+void acvp_async_cleanup(ACVP_CTX *ctx) {
+    ACVP_CURL_MULTI *m = NULL;
+    ACVP_NET_REQ *req = NULL;
+
+    if (!ctx || !ctx->curl_multi) return;
+
+    m = (ACVP_CURL_MULTI *)ctx->curl_multi;
+    while ((req = m->reqs)) {
+        m->reqs = req->next;
+        curl_multi_remove_handle(m->mh, req->hnd);
+        acvp_net_req_done(ctx, req, ACVP_TRANSPORT_FAIL, NULL, 0);
+    }
+    while ((req = m->waiting)) {
+        m->waiting = req->next;
+        acvp_net_req_done(ctx, req, ACVP_TRANSPORT_FAIL, NULL, 0);
+    }
+    while ((req = m->replayed)) {
+        m->replayed = req->next;
+        acvp_net_req_done(ctx, req, ACVP_TRANSPORT_FAIL, NULL, 0);
+    }
+    curl_multi_cleanup(m->mh);
+    free(m);
+    ctx->curl_multi = NULL;
+}
+
+/*
+ * Asynchronous counterpart of acvp_retrieve_vector_set().
+ */
+ACVP_RESULT acvp_async_retrieve_vector_set(ACVP_CTX *ctx, char *vsid_url,
+                                           ACVP_NET_CB cb, void *arg) {
+    ACVP_RESULT rv = 0;
+    char url[ACVP_ATTR_URL_MAX] = {0};
+
+    rv = sanity_check_ctx(ctx);
+    if (ACVP_SUCCESS != rv) return rv;
+
+    if (!vsid_url || !cb) {
+        ACVP_LOG_ERR("Missing vsid_url or callback");
+        return ACVP_MISSING_ARG;
+    }
+
+    snprintf(url, ACVP_ATTR_URL_MAX - 1,
+            "https://%s:%d/%s",
+            ctx->server_name, ctx->server_port, vsid_url);
+
+    return acvp_async_start(ctx, ACVP_NET_GET_VS, url, NULL, cb, arg);
+}
+
+/*
+ * Asynchronous counterpart of acvp_retrieve_vector_set_result().
+ */
+ACVP_RESULT acvp_async_retrieve_vector_set_result(ACVP_CTX *ctx, char *api_url,
+                                                  ACVP_NET_CB cb, void *arg) {
+    ACVP_RESULT rv = 0;
+    char url[ACVP_ATTR_URL_MAX] = {0};
+
+    rv = sanity_check_ctx(ctx);
+    if (ACVP_SUCCESS != rv) return rv;
+
+    if (!api_url || !cb) {
+        ACVP_LOG_ERR("Missing api_url or callback");
+        return ACVP_MISSING_ARG;
+    }
+
+    snprintf(url, ACVP_ATTR_URL_MAX - 1,
+            "https://%s:%d/%s/results",
+            ctx->server_name, ctx->server_port, api_url);
+
+    return acvp_async_start(ctx, ACVP_NET_GET_VS_RESULT, url, NULL, cb, arg);
+}
+
+/*
+ * Asynchronous counterpart of acvp_retrieve_expected_result().
+ */
+ACVP_RESULT acvp_async_retrieve_expected_result(ACVP_CTX *ctx, char *api_url,
+                                                ACVP_NET_CB cb, void *arg) {
+    ACVP_RESULT rv = 0;
+    char url[ACVP_ATTR_URL_MAX] = {0};
+
+    rv = sanity_check_ctx(ctx);
+    if (ACVP_SUCCESS != rv) return rv;
+
+    if (!api_url || !cb) {
+        ACVP_LOG_ERR("Missing api_url or callback");
+        return ACVP_MISSING_ARG;
+    }
+
+    snprintf(url, ACVP_ATTR_URL_MAX - 1,
+            "https://%s:%d/%s/expected",
+            ctx->server_name, ctx->server_port, api_url);
+
+    return acvp_async_start(ctx, ACVP_NET_GET_VS_SAMPLE, url, NULL, cb, arg);
+}
+
+/*
+ * Asynchronous counterpart of acvp_submit_vector_responses().  The
+ * responses are taken from kat_resp, which is consumed, rather than
+ * from ctx->kat_resp so that the ctx can move on to the next vector set.
+ */
+ACVP_RESULT acvp_async_submit_vector_responses(ACVP_CTX *ctx, char *vsid_url, JSON_Value *kat_resp,
+                                               ACVP_NET_CB cb, void *arg) {
+    ACVP_RESULT rv = 0;
+    char url[ACVP_ATTR_URL_MAX] = {0};
+
+    rv = sanity_check_ctx(ctx);
+    if (ACVP_SUCCESS != rv) goto end;
+
+    if (!vsid_url || !cb) {
+        ACVP_LOG_ERR("Missing vsid_url or callback");
+        rv = ACVP_MISSING_ARG;
+        goto end;
+    }
+    if (!kat_resp) {
+        ACVP_LOG_ERR("No vector set responses to submit");
+        rv = ACVP_NO_DATA;
+        goto end;
+    }
+
+    snprintf(url, ACVP_ATTR_URL_MAX - 1,
+            "https://%s:%d/%s/results",
+            ctx->server_name, ctx->server_port, vsid_url);
+
+    /* The request serializes the responses while sending them */
+    rv = acvp_async_start(ctx, ACVP_NET_POST_VS_RESP, url, kat_resp, cb, arg);
+    kat_resp = NULL;
+
+end:
+    if (kat_resp) json_value_free(kat_resp);
+    return rv;
+}
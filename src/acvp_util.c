@@ -12,6 +12,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
 #include "acvp.h"
 #include "acvp_lcl.h"
 #include "safe_lib.h"
@@ -47,6 +53,84 @@ void acvp_log_msg(ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *format, ...) {
     }
 }
 
+typedef struct acvp_log_buf_t {
+    char *buf;
+    size_t len;
+    size_t max;
+} ACVP_LOG_BUF;
+
+/* Keeps as much text as one log message can carry, then stops the serializer */
+static JSON_Status acvp_log_buf_sink(void *sink_ctx, const char *data, size_t len) {
+    ACVP_LOG_BUF *lb = (ACVP_LOG_BUF *)sink_ctx;
+
+    if (len > lb->max - lb->len) {
+        len = lb->max - lb->len;
+    }
+    memcpy_s(lb->buf + lb->len, lb->max - lb->len, data, len);
+    lb->len += len;
+    return lb->len == lb->max ? JSONFailure : JSONSuccess;
+}
+
+static JSON_Status acvp_stdout_sink(void *sink_ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, stdout) == len ? JSONSuccess : JSONFailure;
+}
+
+/* Pretty prints the head of value that fits in buf */
+static void acvp_log_json_head(const JSON_Value *value, char *buf, size_t size) {
+    ACVP_LOG_BUF lb;
+
+    lb.buf = buf;
+    lb.len = 0;
+    lb.max = size - 1;
+    json_serialize_to_sink_pretty(value, acvp_log_buf_sink, &lb);
+    buf[lb.len] = '\0';
+}
+
+/*
+ * Logs the pretty printed value at INFO. At VERBOSE all of it is printed
+ * to stdout instead of the head that fits in a log message. Nothing is
+ * serialized when the log level drops the message.
+ */
+void acvp_log_json(ACVP_CTX *ctx, const char *func, int line, const JSON_Value *value) {
+    char tmp[1024 * 2];
+
+    if (!ctx || !value || ctx->debug < ACVP_LOG_LVL_INFO) {
+        return;
+    }
+    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
+        printf("\n\n");
+        json_serialize_to_sink_pretty(value, acvp_stdout_sink, NULL);
+        printf("\n\n");
+        return;
+    }
+    if (!ctx->test_progress_cb) {
+        return;
+    }
+    acvp_log_json_head(value, tmp, sizeof(tmp));
+    acvp_log_msg(ctx, ACVP_LOG_LVL_INFO, "***ACVP [INFO][%s:%d]--> \n\n%s\n\n\n", func, line, tmp);
+}
+
+/*
+ * Logs format followed by the pretty printed value as a single INFO
+ * message, through the log callback whatever the level.  Nothing is
+ * serialized when the log level drops the message.
+ */
+void acvp_log_json_msg(ACVP_CTX *ctx, const char *func, int line, const JSON_Value *value,
+                       const char *format, ...) {
+    va_list arguments;
+    char title[256];
+    char tmp[1024 * 2];
+
+    if (!ctx || !value || !ctx->test_progress_cb || ctx->debug < ACVP_LOG_LVL_INFO) {
+        return;
+    }
+    va_start(arguments, format);
+    vsnprintf(title, sizeof(title), format, arguments);
+    va_end(arguments);
+    acvp_log_json_head(value, tmp, sizeof(tmp));
+    acvp_log_msg(ctx, ACVP_LOG_LVL_INFO, "***ACVP [INFO][%s:%d]--> %s\n %s\n\n", func, line, title, tmp);
+}
+
 /*!
  *
  * @brief Free all memory in the libacvp library.
@@ -816,3 +900,262 @@ void acvp_release_json(JSON_Value *r_vs_val,
     if (r_vs_val) json_value_free(r_vs_val);
 }
 
+
+/*
+ * Returns a monotonic timestamp in milliseconds.  Only useful
+ * for measuring intervals.
+ */
+long long acvp_time_ms(void) {
+#ifdef WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/*
+ * Same as acvp_time_ms() in microseconds.
+ */
+long long acvp_time_us(void) {
+#ifdef WIN32
+    return (long long)GetTickCount64() * 1000;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/*
+ * Returns a pseudo random number of milliseconds from 0 to range, to
+ * spread out retries.  It is derived from the clock and the caller's
+ * stack, so it needs no state and is safe to call from any thread.
+ */
+long long acvp_jitter_ms(long long range) {
+    unsigned long long r = 0;
+
+    if (range <= 0) return 0;
+    r = ((unsigned long long)acvp_time_us() ^ (unsigned long long)(size_t)&r) *
+        0x9E3779B97F4A7C15ULL;
+    return (long long)((r >> 33) % (unsigned long long)(range + 1));
+}
+
+void acvp_sleep_ms(long long ms) {
+    if (ms <= 0) return;
+#ifdef WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+        /* Interrupted, sleep for the remainder */
+    }
+#endif
+}
+
+/*
+ * Starts walking the test groups of the vector set in obj, see
+ * ACVP_VS_READER.  The reader must be closed with acvp_vs_reader_close()
+ * whatever this returns.
+ */
+ACVP_RESULT acvp_vs_reader_open(ACVP_CTX *ctx, ACVP_VS_READER *vsr, JSON_Object *obj) {
+    JSON_Value *groups = NULL;
+
+    memzero_s(vsr, sizeof(ACVP_VS_READER));
+    vsr->ctx = ctx;
+
+    groups = json_object_get_value(obj, "testGroups");
+    if (json_value_get_type(groups) != JSONString) {
+        vsr->groups = json_value_get_array(groups);
+        vsr->group_cnt = json_array_get_count(vsr->groups);
+        return ACVP_SUCCESS;
+    }
+
+    vsr->reader = json_reader_new(json_value_get_string(groups));
+    if (!vsr->reader) {
+        ACVP_LOG_ERR("Unable to create JSON reader");
+        return ACVP_MALLOC_FAIL;
+    }
+    if (json_reader_next(vsr->reader) != JSONArray ||
+        json_reader_enter(vsr->reader) != JSONSuccess) {
+        ACVP_LOG_ERR("JSON parse error: testGroups is not an array");
+        vsr->state = ACVP_VS_READER_DONE;
+        return ACVP_MALFORMED_JSON;
+    }
+    vsr->depth = json_reader_mark(vsr->reader).depth;
+    return ACVP_SUCCESS;
+}
+
+static void acvp_vs_reader_release(ACVP_VS_READER *vsr) {
+    if (vsr->test) {
+        json_value_free(vsr->test);
+        vsr->test = NULL;
+    }
+    if (vsr->group) {
+        json_value_free(vsr->group);
+        vsr->group = NULL;
+    }
+}
+
+/*
+ * Moves to the next test group, group is set to NULL after the last
+ * one.  When reading the text, the group holds everything but its
+ * tests, which are read with acvp_vs_reader_next_test().  The groups
+ * and tests parsed from the text come from the heap even when a JSON
+ * arena is current, they are freed as the reader moves on.
+ */
+ACVP_RESULT acvp_vs_reader_next_group(ACVP_VS_READER *vsr, JSON_Object **group) {
+    ACVP_CTX *ctx = vsr->ctx;
+    JSON_Reader *reader = vsr->reader;
+    JSON_Reader_Mark tests = { 0, 0 };
+    JSON_Value_Type type = JSONError;
+    JSON_Value *member = NULL;
+    JSON_Arena *prev = NULL;
+    ACVP_RESULT rv = ACVP_MALFORMED_JSON;
+    int has_tests = 0, diff = 1;
+
+    *group = NULL;
+    vsr->tests = NULL;
+    vsr->test_idx = 0;
+    vsr->test_cnt = 0;
+
+    if (!reader) {
+        if (vsr->group_idx >= vsr->group_cnt) return ACVP_SUCCESS;
+        *group = json_array_get_object(vsr->groups, vsr->group_idx++);
+        if (!*group) {
+            ACVP_LOG_ERR("JSON parse error: test group is not an object");
+            return ACVP_MALFORMED_JSON;
+        }
+        vsr->tests = json_object_get_array(*group, "tests");
+        vsr->test_cnt = json_array_get_count(vsr->tests);
+        return ACVP_SUCCESS;
+    }
+
+    acvp_vs_reader_release(vsr);
+    if (vsr->state == ACVP_VS_READER_DONE) return ACVP_SUCCESS;
+
+    prev = json_arena_set(NULL);
+
+    /* Skip what is left of the previous group */
+    while (json_reader_mark(reader).depth > vsr->depth) {
+        if (json_reader_next(reader) == JSONError) goto end;
+    }
+
+    type = json_reader_next(reader);
+    if (type == JSONReaderEnd) {
+        vsr->state = ACVP_VS_READER_DONE;
+        rv = ACVP_SUCCESS;
+        goto end;
+    }
+    if (type != JSONObject || json_reader_enter(reader) != JSONSuccess) goto end;
+
+    vsr->group = json_value_init_object();
+    if (!vsr->group) {
+        rv = ACVP_MALLOC_FAIL;
+        goto end;
+    }
+    while ((type = json_reader_next(reader)) != JSONReaderEnd) {
+        if (type == JSONError) goto end;
+
+        /* The tests are read last, wherever they are in the group */
+        strcmp_s("tests", sizeof("tests"), json_reader_name(reader), &diff);
+        if (!diff) {
+            tests = json_reader_mark(reader);
+            has_tests = 1;
+            continue;
+        }
+        member = json_reader_value(reader);
+        if (!member) goto end;
+        if (json_object_set_value(json_object(vsr->group), json_reader_name(reader),
+                                  member) != JSONSuccess) {
+            json_value_free(member);
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+    }
+
+    if (has_tests) {
+        if (json_reader_rewind(reader, &tests) != JSONSuccess ||
+            json_reader_next(reader) != JSONArray ||
+            json_reader_enter(reader) != JSONSuccess) {
+            goto end;
+        }
+        vsr->state = ACVP_VS_READER_TESTS;
+    } else {
+        vsr->state = ACVP_VS_READER_GROUPS;
+    }
+    *group = json_object(vsr->group);
+    rv = ACVP_SUCCESS;
+
+end:
+    json_arena_set(prev);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("JSON parse error: malformed test group");
+        acvp_vs_reader_release(vsr);
+        vsr->state = ACVP_VS_READER_DONE;
+    }
+    return rv;
+}
+
+/*
+ * Moves to the next test of the current group, test is set to NULL
+ * after the last one.
+ */
+ACVP_RESULT acvp_vs_reader_next_test(ACVP_VS_READER *vsr, JSON_Object **test) {
+    ACVP_CTX *ctx = vsr->ctx;
+    JSON_Value_Type type = JSONError;
+    JSON_Arena *prev = NULL;
+    ACVP_RESULT rv = ACVP_MALFORMED_JSON;
+
+    *test = NULL;
+
+    if (!vsr->reader) {
+        if (vsr->test_idx >= vsr->test_cnt) return ACVP_SUCCESS;
+        *test = json_array_get_object(vsr->tests, vsr->test_idx++);
+        if (!*test) {
+            ACVP_LOG_ERR("JSON parse error: test is not an object");
+            return ACVP_MALFORMED_JSON;
+        }
+        return ACVP_SUCCESS;
+    }
+
+    if (vsr->test) {
+        json_value_free(vsr->test);
+        vsr->test = NULL;
+    }
+    if (vsr->state != ACVP_VS_READER_TESTS) return ACVP_SUCCESS;
+
+    prev = json_arena_set(NULL);
+    type = json_reader_next(vsr->reader);
+    if (type == JSONReaderEnd) {
+        vsr->state = ACVP_VS_READER_GROUPS;
+        rv = ACVP_SUCCESS;
+    } else if (type == JSONObject) {
+        vsr->test = json_reader_value(vsr->reader);
+        if (vsr->test) {
+            *test = json_object(vsr->test);
+            rv = ACVP_SUCCESS;
+        }
+    }
+    json_arena_set(prev);
+
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("JSON parse error: malformed test");
+        acvp_vs_reader_release(vsr);
+        vsr->state = ACVP_VS_READER_DONE;
+    }
+    return rv;
+}
+
+void acvp_vs_reader_close(ACVP_VS_READER *vsr) {
+    if (!vsr) return;
+    acvp_vs_reader_release(vsr);
+    json_reader_free(vsr->reader);
+    vsr->reader = NULL;
+}
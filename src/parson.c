@@ -41,8 +41,17 @@
 #define sscanf THINK_TWICE_ABOUT_USING_SSCANF
 
 #define STARTING_CAPACITY 16
+#define SERIALIZE_STARTING_CAPACITY 256
+#define SINK_CHUNK_SIZE   4096  /* bytes handed to a serialization sink at a time */
 #define MAX_NESTING       2048
 
+#define INDEX_THRESHOLD   8     /* objects with this many names get a hash index */
+#define NAME_NOT_FOUND    ((size_t)-1)
+
+#define ARENA_BLOCK_SIZE  65536 /* default size of the blocks an arena carves values out of */
+#define ARENA_ALIGNMENT   8
+#define ARENA_ALIGN(n)    (((n) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
 #define FLOAT_FORMAT "%1.17g" /* do not increase precision without incresing NUM_BUF_SIZE */
 #define NUM_BUF_SIZE 64 /* double printed with "%1.17g" shouldn't be longer than 25 bytes so let's be paranoid and use 64 */
 
@@ -50,6 +59,7 @@
 #define SKIP_CHAR(str)        ((*str)++)
 #define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
+#define MIN(a, b)             ((a) < (b) ? (a) : (b))
 
 #define STRING_VALUE_MAX 8000000 /* SAFEC arbitrarily set max string value to 8 MB */
 #define STRING_NAME_MAX 128 /* SAFEC arbitrarily set max limit for 'name' string */
@@ -63,9 +73,18 @@
 #define IS_NUMBER_INVALID(x) (((x) * 0.0) != 0.0)
 #endif
 
+#ifdef _MSC_VER
+#define PARSON_THREAD_LOCAL __declspec(thread)
+#else
+#define PARSON_THREAD_LOCAL __thread
+#endif
+
 static JSON_Malloc_Function parson_malloc = malloc;
 static JSON_Free_Function parson_free = free;
 
+/* Arena the values created on this thread come from, NULL for the heap */
+static PARSON_THREAD_LOCAL JSON_Arena *parson_arena = NULL;
+
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
 /* Type definitions */
@@ -81,30 +100,140 @@ typedef union json_value_value {
 struct json_value_t {
     JSON_Value      *parent;
     JSON_Value_Type  type;
+    int              in_arena; /* freed with its arena rather than by json_value_free() */
     JSON_Value_Value value;
 };
 
+typedef struct json_name_t {
+    char         *string;
+    size_t        length;
+    unsigned long hash;      /* see hash_name() */
+} JSON_Name;
+
 struct json_object_t {
     JSON_Value  *wrapping_value;
-    char       **names;
+    JSON_Arena  *arena;      /* names and arrays grow here, NULL for the heap */
+    JSON_Name   *names;
     JSON_Value **values;
+    size_t      *index;      /* open addressing table of positions + 1, NULL below INDEX_THRESHOLD */
+    size_t       index_capacity;
     size_t       count;
     size_t       capacity;
 };
 
 struct json_array_t {
     JSON_Value  *wrapping_value;
+    JSON_Arena  *arena;      /* items grow here, NULL for the heap */
     JSON_Value **items;
     size_t       count;
     size_t       capacity;
 };
 
+typedef struct json_arena_block_t {
+    struct json_arena_block_t *next;
+    size_t size;             /* usable bytes after the header */
+    size_t used;
+} JSON_Arena_Block;
+
+struct json_arena_t {
+    JSON_Arena_Block *blocks; /* the one being carved up first */
+    size_t block_size;
+    size_t used;
+};
+
+enum json_stream_state {
+    STREAM_VALUE,        /* a value must follow */
+    STREAM_VALUE_OR_END, /* just after '[' */
+    STREAM_KEY_OR_END,   /* just after '{' */
+    STREAM_KEY,          /* just after ',' inside an object */
+    STREAM_COLON,
+    STREAM_COMMA_OR_END,
+    STREAM_DONE
+};
+
+enum json_stream_token {
+    STREAM_TOKEN_NONE,
+    STREAM_TOKEN_STRING,
+    STREAM_TOKEN_NUMBER,
+    STREAM_TOKEN_LITERAL
+};
+
+struct json_stream_parser_t {
+    JSON_Arena  *arena;      /* where the values go, current when the parser was created */
+    JSON_Value  *root;
+    JSON_Value **stack;      /* open objects and arrays, innermost last */
+    size_t       depth;
+    size_t       stack_capacity;
+    char        *key;        /* name waiting for its value */
+    int          state;
+    int          token;      /* scalar currently being collected into buf */
+    int          escaped;    /* last string byte collected was a backslash */
+    char        *buf;
+    size_t       buf_len;
+    size_t       buf_capacity;
+    size_t       bom;        /* bytes of a leading UTF-8 BOM skipped */
+    int          failed;
+};
+
+typedef struct json_stream_frame_t {
+    const JSON_Value *value; /* object or array being written */
+    size_t            index; /* next member to write */
+} JSON_Stream_Frame;
+
+typedef struct json_reader_frame_t {
+    JSON_Value_Type type;    /* JSONObject or JSONArray */
+    int             first;   /* no member read yet */
+} JSON_Reader_Frame;
+
+struct json_reader_t {
+    const char  *text;
+    const char  *pos;
+    const char  *member;     /* start of the current member */
+    JSON_Reader_Frame *stack;
+    size_t       depth;
+    size_t       stack_capacity;
+    char        *name;       /* name of the current member */
+    JSON_Value_Type type;    /* of the current value */
+    int          pending;    /* current value not read yet */
+    int          started;
+    int          failed;
+};
+
+/* Where serialized text goes: a growable buffer, a fixed one or, through
+   a fixed chunk, a sink */
+typedef struct json_out_t {
+    char        *buf;
+    size_t       len;
+    size_t       capacity;
+    int          fixed;      /* buf can't grow */
+    JSON_Sink_Function sink; /* NULL keeps the text in buf */
+    void        *sink_ctx;
+    size_t       total;      /* bytes written so far */
+} JSON_Out;
+
+struct json_stream_writer_t {
+    const JSON_Value *root;
+    JSON_Stream_Frame *stack;
+    size_t       depth;
+    size_t       stack_capacity;
+    JSON_Out     out;        /* serialized text not read yet */
+    size_t       buf_pos;
+    int          started;
+    int          failed;
+};
+
+/* Arena */
+static void * arena_malloc(JSON_Arena *arena, size_t size);
+static void   arena_free(JSON_Arena *arena, void *ptr);
+static JSON_Value * json_value_alloc(JSON_Value_Type type);
+
 /* Various */
 static char * read_file(const char *filename);
 #if 0
 static void   remove_comments(char *string, const char *start_token, const char *end_token);
 #endif
-static char * parson_strndup(const char *string, size_t n);
+static char * parson_strndup(JSON_Arena *arena, const char *string, size_t n);
+static unsigned long hash_name(const char *name, size_t len);
 #if 0
 static char * parson_strdup(const char *string);
 #endif
@@ -121,6 +250,8 @@ static JSON_Status   json_object_add(JSON_Object *object, const char *name, JSON
 static JSON_Status   json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value);
 static JSON_Status   json_object_resize(JSON_Object *object, size_t new_capacity);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
+static size_t        json_object_find(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash);
+static JSON_Status   json_object_index(JSON_Object *object);
 static JSON_Status   json_object_remove_internal(JSON_Object *object, const char *name, int free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value);
 static void          json_object_free(JSON_Object *object);
@@ -147,15 +278,96 @@ static JSON_Value * parse_number_value(const char **string);
 static JSON_Value * parse_null_value(const char **string);
 static JSON_Value * parse_value(const char **string, size_t nesting);
 
+/* Stream parser */
+static JSON_Status stream_feed(JSON_Stream_Parser *parser, const char *chunk, size_t len);
+static JSON_Status stream_buf_append(JSON_Stream_Parser *parser, const char *data, size_t len);
+static JSON_Status stream_add_value(JSON_Stream_Parser *parser, JSON_Value *value);
+static JSON_Status stream_close(JSON_Stream_Parser *parser, char c);
+static JSON_Status stream_end_string(JSON_Stream_Parser *parser);
+static JSON_Status stream_end_scalar(JSON_Stream_Parser *parser);
+static JSON_Status stream_start_value(JSON_Stream_Parser *parser, char c);
+
+/* Stream writer */
+static JSON_Status writer_append(JSON_Stream_Writer *writer, const char *string);
+static JSON_Status writer_append_string(JSON_Stream_Writer *writer, const char *string, size_t len);
+static JSON_Status writer_value(JSON_Stream_Writer *writer, const JSON_Value *value);
+static JSON_Status writer_next(JSON_Stream_Writer *writer);
+
+/* Reader */
+static JSON_Value_Type reader_peek_type(char c);
+static JSON_Status     reader_skip_value(const char **string);
+static JSON_Value_Type reader_fail(JSON_Reader *reader);
+
 /* Serialization */
-static int    json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf);
-static int    json_serialize_string(const char *string, char *buf);
-static int    append_indent(char *buf, int level);
-static int    append_string(char *buf, const char *string);
+static JSON_Status out_grow(JSON_Out *out, size_t len);
+static JSON_Status out_flush(JSON_Out *out);
+static JSON_Status out_write(JSON_Out *out, const char *data, size_t len);
+static JSON_Status out_indent(JSON_Out *out, int level);
+static JSON_Status json_serialize_to_out_r(const JSON_Value *value, JSON_Out *out, int level, int is_pretty);
+static JSON_Status json_serialize_string(const char *string, size_t len, JSON_Out *out);
+static JSON_Status json_serialize_out(const JSON_Value *value, int is_pretty, JSON_Out *out);
+static JSON_Status null_sink(void *sink_ctx, const char *data, size_t len);
+static JSON_Status file_sink(void *sink_ctx, const char *data, size_t len);
+static JSON_Status json_serialize_to_sink_r(const JSON_Value *value, int is_pretty, JSON_Sink_Function sink, void *sink_ctx);
+static size_t      serialization_size(const JSON_Value *value, int is_pretty);
+static JSON_Status serialize_to_buffer(const JSON_Value *value, int is_pretty, char *buf, size_t buf_size_in_bytes);
+static JSON_Status serialize_to_file(const JSON_Value *value, int is_pretty, const char *filename);
+static char *      serialize_to_string(const JSON_Value *value, int is_pretty, int *len);
+
+/* Arena */
+static void * arena_malloc(JSON_Arena *arena, size_t size) {
+    JSON_Arena_Block *block = NULL;
+    size_t header = ARENA_ALIGN(sizeof(JSON_Arena_Block)), block_size = 0;
+    void *ptr = NULL;
+    if (arena == NULL) {
+        return parson_malloc(size);
+    }
+    size = ARENA_ALIGN(size ? size : 1);
+    block = arena->blocks;
+    if (block == NULL || block->size - block->used < size) {
+        /* Big requests get a block of their own so the current one keeps going */
+        block_size = size > arena->block_size / 4 ? size : arena->block_size;
+        block = (JSON_Arena_Block*)parson_malloc(header + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        if (arena->blocks && block_size != arena->block_size) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+    ptr = (char*)block + header + block->used;
+    block->used += size;
+    arena->used += size;
+    return ptr;
+}
+
+static void arena_free(JSON_Arena *arena, void *ptr) {
+    if (arena == NULL) {
+        parson_free(ptr);
+    }
+}
+
+/* A value of the given type with nothing in it, from the current arena */
+static JSON_Value * json_value_alloc(JSON_Value_Type type) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(parson_arena, sizeof(JSON_Value));
+    if (new_value == NULL) {
+        return NULL;
+    }
+    new_value->parent = NULL;
+    new_value->type = type;
+    new_value->in_arena = parson_arena != NULL;
+    return new_value;
+}
 
 /* Various */
-static char * parson_strndup(const char *string, size_t n) {
-    char *output_string = (char*)parson_malloc(n + 1);
+static char * parson_strndup(JSON_Arena *arena, const char *string, size_t n) {
+    char *output_string = (char*)arena_malloc(arena, n + 1);
     if (!output_string) {
         return NULL;
     }
@@ -166,10 +378,21 @@ static char * parson_strndup(const char *string, size_t n) {
 
 #if 0
 static char * parson_strdup(const char *string) {
-    return parson_strndup(string, strlen(string));
+    return parson_strndup(parson_arena, string, strlen(string));
 }
 #endif
 
+/* FNV-1a */
+static unsigned long hash_name(const char *name, size_t len) {
+    unsigned long hash = 2166136261UL;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
 static int hex_char_to_int(char c) {
     if (c >= '0' && c <= '9') {
         return c - '0';
@@ -365,13 +588,16 @@ static void remove_comments(char *string, const char *start_token, const char *e
 
 /* JSON Object */
 static JSON_Object * json_object_init(JSON_Value *wrapping_value) {
-    JSON_Object *new_obj = (JSON_Object*)parson_malloc(sizeof(JSON_Object));
+    JSON_Object *new_obj = (JSON_Object*)arena_malloc(parson_arena, sizeof(JSON_Object));
     if (new_obj == NULL) {
         return NULL;
     }
     new_obj->wrapping_value = wrapping_value;
-    new_obj->names = (char**)NULL;
+    new_obj->arena = parson_arena;
+    new_obj->names = (JSON_Name*)NULL;
     new_obj->values = (JSON_Value**)NULL;
+    new_obj->index = (size_t*)NULL;
+    new_obj->index_capacity = 0;
     new_obj->capacity = 0;
     new_obj->count = 0;
     return new_obj;
@@ -385,11 +611,13 @@ static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_V
 }
 
 static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value) {
-    size_t index = 0;
+    size_t index = 0, mask = 0, slot = 0;
+    unsigned long hash = 0;
     if (object == NULL || name == NULL || value == NULL) {
         return JSONFailure;
     }
-    if (json_object_getn_value(object, name, name_len) != NULL) {
+    hash = hash_name(name, name_len);
+    if (json_object_find(object, name, name_len, hash) != NAME_NOT_FOUND) {
         return JSONFailure;
     }
     if (object->count >= object->capacity) {
@@ -399,18 +627,27 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
         }
     }
     index = object->count;
-    object->names[index] = parson_strndup(name, name_len);
-    if (object->names[index] == NULL) {
+    object->names[index].string = parson_strndup(object->arena, name, name_len);
+    if (object->names[index].string == NULL) {
         return JSONFailure;
     }
+    object->names[index].length = name_len;
+    object->names[index].hash = hash;
     value->parent = json_object_get_wrapping_value(object);
     object->values[index] = value;
     object->count++;
+    if (object->index != NULL && object->count * 2 <= object->index_capacity) {
+        mask = object->index_capacity - 1;
+        for (slot = hash & mask; object->index[slot]; slot = (slot + 1) & mask);
+        object->index[slot] = index + 1;
+    } else if (object->count >= INDEX_THRESHOLD) {
+        json_object_index(object); /* lookups still work without it */
+    }
     return JSONSuccess;
 }
 
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity) {
-    char **temp_names = NULL;
+    JSON_Name *temp_names = NULL;
     JSON_Value **temp_values = NULL;
 
     if ((object->names == NULL && object->values != NULL) ||
@@ -418,24 +655,24 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
         new_capacity == 0) {
             return JSONFailure; /* Shouldn't happen */
     }
-    temp_names = (char**)parson_malloc(new_capacity * sizeof(char*));
+    temp_names = (JSON_Name*)arena_malloc(object->arena, new_capacity * sizeof(JSON_Name));
     if (temp_names == NULL) {
         return JSONFailure;
     }
-    temp_values = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    temp_values = (JSON_Value**)arena_malloc(object->arena, new_capacity * sizeof(JSON_Value*));
     if (temp_values == NULL) {
-        parson_free(temp_names);
+        arena_free(object->arena, temp_names);
         return JSONFailure;
     }
     if (object->names != NULL && object->values != NULL && object->count > 0) {
         /* SAFEC */
-        memcpy_s(temp_names, new_capacity * sizeof(char*),
-                 object->names, object->count * sizeof(char*));
+        memcpy_s(temp_names, new_capacity * sizeof(JSON_Name),
+                 object->names, object->count * sizeof(JSON_Name));
         memcpy_s(temp_values, new_capacity * sizeof(JSON_Value*),
                  object->values, object->count * sizeof(JSON_Value*));
     }
-    parson_free(object->names);
-    parson_free(object->values);
+    arena_free(object->arena, object->names);
+    arena_free(object->arena, object->values);
     object->names = temp_names;
     object->values = temp_values;
     object->capacity = new_capacity;
@@ -443,44 +680,110 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
 }
 
 static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
-    size_t i, name_length;
-    int diff = 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        name_length = strnlen_s(object->names[i], STRING_NAME_MAX);
-        if (name_length != name_len) {
-            continue;
+    size_t i;
+    if (object == NULL) {
+        return NULL;
+    }
+    i = json_object_find(object, name, name_len, hash_name(name, name_len));
+    return i == NAME_NOT_FOUND ? NULL : object->values[i];
+}
+
+/* Returns the position of name, or NAME_NOT_FOUND. Names are told apart by
+   their hash and length before any of the text is compared. */
+static size_t json_object_find(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash) {
+    const JSON_Name *candidate = NULL;
+    size_t i = 0, mask = 0, slot = 0;
+    int diff = 0;
+    if (object->index != NULL) {
+        mask = object->index_capacity - 1;
+        for (slot = hash & mask; object->index[slot]; slot = (slot + 1) & mask) {
+            i = object->index[slot] - 1;
+            candidate = &object->names[i];
+            if (candidate->hash == hash && candidate->length == name_len) {
+                diff = 0;
+                if (name_len) {
+                    memcmp_s(candidate->string, name_len, name, name_len, &diff); /* SAFEC */
+                }
+                if (!diff) {
+                    return i;
+                }
+            }
         }
-        strcmp_s(name, name_len, object->names[i], &diff); /* SAFEC */
-        if (!diff) {
-            return object->values[i];
+        return NAME_NOT_FOUND;
+    }
+    for (i = 0; i < object->count; i++) {
+        candidate = &object->names[i];
+        if (candidate->hash == hash && candidate->length == name_len) {
+            diff = 0;
+            if (name_len) {
+                memcmp_s(candidate->string, name_len, name, name_len, &diff); /* SAFEC */
+            }
+            if (!diff) {
+                return i;
+            }
         }
     }
-    return NULL;
+    return NAME_NOT_FOUND;
+}
+
+/* (Re)builds the hash index of an object, or drops it when the object got small */
+static JSON_Status json_object_index(JSON_Object *object) {
+    size_t i = 0, mask = 0, slot = 0, new_capacity = INDEX_THRESHOLD * 2;
+    size_t *new_index = NULL;
+    if (object->count < INDEX_THRESHOLD) {
+        arena_free(object->arena, object->index);
+        object->index = NULL;
+        object->index_capacity = 0;
+        return JSONSuccess;
+    }
+    while (new_capacity < object->count * 2) {
+        new_capacity *= 2;
+    }
+    if (new_capacity != object->index_capacity) {
+        new_index = (size_t*)arena_malloc(object->arena, new_capacity * sizeof(size_t));
+        if (new_index == NULL) {
+            arena_free(object->arena, object->index);
+            object->index = NULL;
+            object->index_capacity = 0;
+            return JSONFailure;
+        }
+        arena_free(object->arena, object->index);
+        object->index = new_index;
+        object->index_capacity = new_capacity;
+    }
+    memset(object->index, 0, object->index_capacity * sizeof(size_t));
+    mask = object->index_capacity - 1;
+    for (i = 0; i < object->count; i++) {
+        for (slot = object->names[i].hash & mask; object->index[slot]; slot = (slot + 1) & mask);
+        object->index[slot] = i + 1;
+    }
+    return JSONSuccess;
 }
 
 static JSON_Status json_object_remove_internal(JSON_Object *object, const char *name, int free_value) {
-    size_t i = 0, last_item_index = 0;
-    if (object == NULL || json_object_get_value(object, name) == NULL) {
+    size_t i = 0, last_item_index = 0, name_len = 0;
+    if (object == NULL || name == NULL) {
+        return JSONFailure;
+    }
+    name_len = strnlen_s(name, STRING_NAME_MAX); /* SAFEC */
+    i = json_object_find(object, name, name_len, hash_name(name, name_len));
+    if (i == NAME_NOT_FOUND) {
         return JSONFailure;
     }
     last_item_index = json_object_get_count(object) - 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        int diff = 1;
-        strcmp_s(object->names[i], STRING_NAME_MAX, name, &diff); /* SAFEC */
-        if (!diff) {
-            parson_free(object->names[i]);
-            if (free_value) {
-                json_value_free(object->values[i]);
-            }
-            if (i != last_item_index) { /* Replace key value pair with one from the end */
-                object->names[i] = object->names[last_item_index];
-                object->values[i] = object->values[last_item_index];
-            }
-            object->count -= 1;
-            return JSONSuccess;
-        }
+    arena_free(object->arena, object->names[i].string);
+    if (free_value) {
+        json_value_free(object->values[i]);
+    }
+    if (i != last_item_index) { /* Replace key value pair with one from the end */
+        object->names[i] = object->names[last_item_index];
+        object->values[i] = object->values[last_item_index];
+    }
+    object->count -= 1;
+    if (object->index != NULL) {
+        json_object_index(object); /* positions moved */
     }
-    return JSONFailure; /* No execution path should end here */
+    return JSONSuccess;
 }
 
 static JSON_Status json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value) {
@@ -507,21 +810,23 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object, const cha
 static void json_object_free(JSON_Object *object) {
     size_t i;
     for (i = 0; i < object->count; i++) {
-        parson_free(object->names[i]);
+        parson_free(object->names[i].string);
         json_value_free(object->values[i]);
     }
     parson_free(object->names);
     parson_free(object->values);
+    parson_free(object->index);
     parson_free(object);
 }
 
 /* JSON Array */
 static JSON_Array * json_array_init(JSON_Value *wrapping_value) {
-    JSON_Array *new_array = (JSON_Array*)parson_malloc(sizeof(JSON_Array));
+    JSON_Array *new_array = (JSON_Array*)arena_malloc(parson_arena, sizeof(JSON_Array));
     if (new_array == NULL) {
         return NULL;
     }
     new_array->wrapping_value = wrapping_value;
+    new_array->arena = parson_arena;
     new_array->items = (JSON_Value**)NULL;
     new_array->capacity = 0;
     new_array->count = 0;
@@ -546,7 +851,7 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
     if (new_capacity == 0) {
         return JSONFailure;
     }
-    new_items = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    new_items = (JSON_Value**)arena_malloc(array->arena, new_capacity * sizeof(JSON_Value*));
     if (new_items == NULL) {
         return JSONFailure;
     }
@@ -554,7 +859,7 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
         memcpy_s(new_items, new_capacity * sizeof(JSON_Value*),
                  array->items, array->count * sizeof(JSON_Value*)); /* SAFEC */
     }
-    parson_free(array->items);
+    arena_free(array->arena, array->items);
     array->items = new_items;
     array->capacity = new_capacity;
     return JSONSuccess;
@@ -571,12 +876,10 @@ static void json_array_free(JSON_Array *array) {
 
 /* JSON Value */
 static JSON_Value * json_value_init_string_no_copy(char *string) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = json_value_alloc(JSONString);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONString;
     new_value->value.string = string;
     return new_value;
 }
@@ -656,7 +959,7 @@ static char* process_string(const char *input, size_t len) {
     size_t initial_size = (len + 1) * sizeof(char);
     size_t final_size = 0;
     char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char*)parson_malloc(initial_size);
+    output = (char*)arena_malloc(parson_arena, initial_size);
     if (output == NULL) {
         goto error;
     }
@@ -690,6 +993,9 @@ static char* process_string(const char *input, size_t len) {
         input_ptr++;
     }
     *output_ptr = '\0';
+    if (parson_arena != NULL) {
+        return output; /* an arena can't take back the unused tail */
+    }
     /* resize to new length */
     final_size = (size_t)(output_ptr-output) + 1;
     /* todo: don't resize if final_size == initial_size */
@@ -701,7 +1007,7 @@ static char* process_string(const char *input, size_t len) {
     parson_free(output);
     return resized_output;
 error:
-    parson_free(output);
+    arena_free(parson_arena, output);
     return NULL;
 }
 
@@ -770,24 +1076,24 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
         }
         SKIP_WHITESPACES(string);
         if (**string != ':') {
-            parson_free(new_key);
+            arena_free(parson_arena, new_key);
             json_value_free(output_value);
             return NULL;
         }
         SKIP_CHAR(string);
         new_value = parse_value(string, nesting);
         if (new_value == NULL) {
-            parson_free(new_key);
+            arena_free(parson_arena, new_key);
             json_value_free(output_value);
             return NULL;
         }
         if (json_object_add(output_object, new_key, new_value) == JSONFailure) {
-            parson_free(new_key);
+            arena_free(parson_arena, new_key);
             json_value_free(new_value);
             json_value_free(output_value);
             return NULL;
         }
-        parson_free(new_key);
+        arena_free(parson_arena, new_key);
         SKIP_WHITESPACES(string);
         if (**string != ',') {
             break;
@@ -796,8 +1102,9 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
         SKIP_WHITESPACES(string);
     }
     SKIP_WHITESPACES(string);
-    if (**string != '}' || /* Trim object after parsing is over */
-        json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure) {
+    if (**string != '}' || /* Trim object after parsing is over, not worth it in an arena */
+        (output_object->arena == NULL &&
+         json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure)) {
             json_value_free(output_value);
             return NULL;
     }
@@ -842,8 +1149,9 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         SKIP_WHITESPACES(string);
     }
     SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure) {
+    if (**string != ']' || /* Trim array after parsing is over, not worth it in an arena */
+        (output_array->arena == NULL &&
+         json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure)) {
             json_value_free(output_value);
             return NULL;
     }
@@ -859,7 +1167,7 @@ static JSON_Value * parse_string_value(const char **string) {
     }
     value = json_value_init_string_no_copy(new_string);
     if (value == NULL) {
-        parson_free(new_string);
+        arena_free(parson_arena, new_string);
         return NULL;
     }
     return value;
@@ -906,25 +1214,90 @@ static JSON_Value * parse_null_value(const char **string) {
 }
 
 /* Serialization */
-#define APPEND_STRING(str) do { written = append_string(buf, (str));\
-                                if (written < 0) { return -1; }\
-                                if (buf != NULL) { buf += written; }\
-                                written_total += written; } while(0)
+static JSON_Status out_grow(JSON_Out *out, size_t len) {
+    size_t new_capacity = MAX(out->capacity * 2, SERIALIZE_STARTING_CAPACITY);
+    char *new_buf = NULL;
+    while (new_capacity < out->len + len + 1) {
+        new_capacity *= 2;
+    }
+    new_buf = (char*)parson_malloc(new_capacity);
+    if (new_buf == NULL) {
+        return JSONFailure;
+    }
+    if (out->len) {
+        memcpy_s(new_buf, new_capacity, out->buf, out->len); /* SAFEC */
+    }
+    parson_free(out->buf);
+    out->buf = new_buf;
+    out->capacity = new_capacity;
+    return JSONSuccess;
+}
+
+static JSON_Status out_flush(JSON_Out *out) {
+    if (out->len && out->sink(out->sink_ctx, out->buf, out->len) == JSONFailure) {
+        return JSONFailure;
+    }
+    out->len = 0;
+    return JSONSuccess;
+}
+
+/* Appends len bytes, handing full chunks to the sink if there is one.
+   The text in buf is always terminated. */
+static JSON_Status out_write(JSON_Out *out, const char *data, size_t len) {
+    size_t room = 0;
+    out->total += len;
+    while (out->len + len + 1 > out->capacity) {
+        if (out->sink != NULL) {
+            room = out->capacity - out->len - 1;
+            if (room) {
+                memcpy_s(out->buf + out->len, room, data, room); /* SAFEC */
+            }
+            out->len += room;
+            data += room;
+            len -= room;
+            if (out_flush(out) == JSONFailure) {
+                return JSONFailure;
+            }
+        } else if (out->fixed || out_grow(out, len) == JSONFailure) {
+            return JSONFailure;
+        }
+    }
+    if (len) {
+        memcpy_s(out->buf + out->len, out->capacity - out->len, data, len); /* SAFEC */
+    }
+    out->len += len;
+    out->buf[out->len] = '\0';
+    return JSONSuccess;
+}
+
+#define APPEND_STRING(str) do { if (out_write(out, (str), sizeof(str) - 1) == JSONFailure) {\
+                                    return JSONFailure; } } while(0)
 
-#define APPEND_INDENT(level) do { written = append_indent(buf, (level));\
-                                  if (written < 0) { return -1; }\
-                                  if (buf != NULL) { buf += written; }\
-                                  written_total += written; } while(0)
+#define APPEND_INDENT(level) do { if (out_indent(out, (level)) == JSONFailure) {\
+                                      return JSONFailure; } } while(0)
+
+/* Four spaces per level, written a few dozen levels at a time */
+static JSON_Status out_indent(JSON_Out *out, int level) {
+    static const char spaces[] = "                                                                ";
+    size_t len = (size_t)level * 4, n = 0;
+    while (len > 0) {
+        n = MIN(len, sizeof(spaces) - 1);
+        if (out_write(out, spaces, n) == JSONFailure) {
+            return JSONFailure;
+        }
+        len -= n;
+    }
+    return JSONSuccess;
+}
 
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf)
+static JSON_Status json_serialize_to_out_r(const JSON_Value *value, JSON_Out *out, int level, int is_pretty)
 {
-    const char *key = NULL, *string = NULL;
-    JSON_Value *temp_value = NULL;
+    const char *string = NULL;
     JSON_Array *array = NULL;
     JSON_Object *object = NULL;
     size_t i = 0, count = 0;
-    double num = 0.0;
-    int written = -1, written_total = 0;
+    char num_buf[NUM_BUF_SIZE];
+    int written = -1;
 
     switch (json_value_get_type(value)) {
         case JSONArray:
@@ -938,15 +1311,9 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 if (is_pretty) {
                     APPEND_INDENT(level+1);
                 }
-                temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_out_r(json_array_get_value(array, i), out, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -958,7 +1325,7 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 APPEND_INDENT(level);
             }
             APPEND_STRING("]");
-            return written_total;
+            return JSONSuccess;
         case JSONObject:
             object = json_value_get_object(value);
             count  = json_object_get_count(object);
@@ -967,34 +1334,19 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 APPEND_STRING("\n");
             }
             for (i = 0; i < count; i++) {
-                key = json_object_get_name(object, i);
-                if (key == NULL) {
-                    return -1;
-                }
                 if (is_pretty) {
                     APPEND_INDENT(level+1);
                 }
-                written = json_serialize_string(key, buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_string(object->names[i].string, object->names[i].length, out) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 APPEND_STRING(":");
                 if (is_pretty) {
                     APPEND_STRING(" ");
                 }
-                temp_value = json_object_get_value(object, key);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
-                }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_out_r(object->values[i], out, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
                     APPEND_STRING(",");
                 }
@@ -1006,62 +1358,52 @@ static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int le
                 APPEND_INDENT(level);
             }
             APPEND_STRING("}");
-            return written_total;
+            return JSONSuccess;
         case JSONString:
             string = json_value_get_string(value);
             if (string == NULL) {
-                return -1;
-            }
-            written = json_serialize_string(string, buf);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            return json_serialize_string(string, strnlen_s(string, STRING_VALUE_MAX), out); /* SAFEC */
         case JSONBoolean:
             if (json_value_get_boolean(value)) {
                 APPEND_STRING("true");
             } else {
                 APPEND_STRING("false");
             }
-            return written_total;
+            return JSONSuccess;
         case JSONNumber:
-            num = json_value_get_number(value);
-            if (buf != NULL) {
-                num_buf = buf;
-            }
-            written = sprintf(num_buf, FLOAT_FORMAT, num);
+            written = sprintf(num_buf, FLOAT_FORMAT, json_value_get_number(value));
             if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            return out_write(out, num_buf, (size_t)written);
         case JSONNull:
             APPEND_STRING("null");
-            return written_total;
+            return JSONSuccess;
         case JSONError:
-            return -1;
+            return JSONFailure;
         default:
-            return -1;
+            return JSONFailure;
     }
 }
 
-static int json_serialize_string(const char *string, char *buf) {
-    size_t i = 0, len = 0;
-    char c = '\0';
-    int written = -1, written_total = 0;
-
-    len = strnlen_s(string, STRING_VALUE_MAX); /* SAFEC */
+/* Copies runs of plain characters in one go and escapes the rest */
+static JSON_Status json_serialize_string(const char *string, size_t len, JSON_Out *out) {
+    size_t i = 0, run = 0;
+    unsigned char c = 0;
+    char escaped[8];
 
     APPEND_STRING("\"");
     for (i = 0; i < len; i++) {
-        c = string[i];
+        c = (unsigned char)string[i];
+        if (c >= 0x20 && c != '\"' && c != '\\' && c != '/') {
+            continue;
+        }
+        if (out_write(out, string + run, i - run) == JSONFailure) {
+            return JSONFailure;
+        }
+        run = i + 1;
         switch (c) {
             case '\"': APPEND_STRING("\\\""); break;
             case '\\': APPEND_STRING("\\\\"); break;
@@ -1071,69 +1413,54 @@ static int json_serialize_string(const char *string, char *buf) {
             case '\n': APPEND_STRING("\\n"); break;
             case '\r': APPEND_STRING("\\r"); break;
             case '\t': APPEND_STRING("\\t"); break;
-            case '\x00': APPEND_STRING("\\u0000"); break;
-            case '\x01': APPEND_STRING("\\u0001"); break;
-            case '\x02': APPEND_STRING("\\u0002"); break;
-            case '\x03': APPEND_STRING("\\u0003"); break;
-            case '\x04': APPEND_STRING("\\u0004"); break;
-            case '\x05': APPEND_STRING("\\u0005"); break;
-            case '\x06': APPEND_STRING("\\u0006"); break;
-            case '\x07': APPEND_STRING("\\u0007"); break;
-            /* '\x08' duplicate: '\b' */
-            /* '\x09' duplicate: '\t' */
-            /* '\x0a' duplicate: '\n' */
-            case '\x0b': APPEND_STRING("\\u000b"); break;
-            /* '\x0c' duplicate: '\f' */
-            /* '\x0d' duplicate: '\r' */
-            case '\x0e': APPEND_STRING("\\u000e"); break;
-            case '\x0f': APPEND_STRING("\\u000f"); break;
-            case '\x10': APPEND_STRING("\\u0010"); break;
-            case '\x11': APPEND_STRING("\\u0011"); break;
-            case '\x12': APPEND_STRING("\\u0012"); break;
-            case '\x13': APPEND_STRING("\\u0013"); break;
-            case '\x14': APPEND_STRING("\\u0014"); break;
-            case '\x15': APPEND_STRING("\\u0015"); break;
-            case '\x16': APPEND_STRING("\\u0016"); break;
-            case '\x17': APPEND_STRING("\\u0017"); break;
-            case '\x18': APPEND_STRING("\\u0018"); break;
-            case '\x19': APPEND_STRING("\\u0019"); break;
-            case '\x1a': APPEND_STRING("\\u001a"); break;
-            case '\x1b': APPEND_STRING("\\u001b"); break;
-            case '\x1c': APPEND_STRING("\\u001c"); break;
-            case '\x1d': APPEND_STRING("\\u001d"); break;
-            case '\x1e': APPEND_STRING("\\u001e"); break;
-            case '\x1f': APPEND_STRING("\\u001f"); break;
             default:
-                if (buf != NULL) {
-                    buf[0] = c;
-                    buf += 1;
+                sprintf(escaped, "\\u%04x", c);
+                if (out_write(out, escaped, 6) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += 1;
                 break;
         }
     }
+    if (out_write(out, string + run, len - run) == JSONFailure) {
+        return JSONFailure;
+    }
     APPEND_STRING("\"");
-    return written_total;
+    return JSONSuccess;
 }
 
-static int append_indent(char *buf, int level) {
-    int i;
-    int written = -1, written_total = 0;
-    for (i = 0; i < level; i++) {
-        APPEND_STRING("    ");
+#undef APPEND_STRING
+#undef APPEND_INDENT
+
+/* Serializes value in one pass: into a sink through a stack buffer, or
+   else into out as set up by the caller */
+static JSON_Status json_serialize_out(const JSON_Value *value, int is_pretty, JSON_Out *out) {
+    char chunk[SINK_CHUNK_SIZE];
+    if (out->sink != NULL) {
+        out->buf = chunk;
+        out->capacity = sizeof(chunk);
+        out->fixed = 1;
+    }
+    if (json_serialize_to_out_r(value, out, 0, is_pretty) == JSONFailure ||
+        (out->sink != NULL && out_flush(out) == JSONFailure)) {
+        if (out->sink != NULL) {
+            out->buf = NULL;
+        }
+        return JSONFailure;
     }
-    return written_total;
+    if (out->sink != NULL) {
+        out->buf = NULL;
+    }
+    return JSONSuccess;
 }
 
-static int append_string(char *buf, const char *string) {
-    if (buf == NULL) {
-        return (int)strnlen_s(string, STRING_VALUE_MAX); /* SAFEC */
-    }
-    return sprintf(buf, "%s", string);
+static JSON_Status null_sink(void *sink_ctx, const char *data, size_t len) {
+    (void)sink_ctx; (void)data; (void)len;
+    return JSONSuccess;
 }
 
-#undef APPEND_STRING
-#undef APPEND_INDENT
+static JSON_Status file_sink(void *sink_ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE*)sink_ctx) == len ? JSONSuccess : JSONFailure;
+}
 
 /* Parser API */
 JSON_Value * json_parse_file(const char *filename) {
@@ -1187,42 +1514,825 @@ JSON_Value * json_parse_string_with_comments(const char *string) {
 }
 #endif
 
-/* JSON Object API */
-
-JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
-    if (object == NULL || name == NULL) {
+/* Stream parser API */
+JSON_Stream_Parser * json_stream_parser_new(void) {
+    JSON_Stream_Parser *parser = (JSON_Stream_Parser*)parson_malloc(sizeof(JSON_Stream_Parser));
+    if (parser == NULL) {
         return NULL;
     }
-    return json_object_getn_value(object, name, strnlen_s(name, STRING_NAME_MAX)); /* SAFEC */
+    memset(parser, 0, sizeof(JSON_Stream_Parser));
+    parser->arena = parson_arena;
+    parser->state = STREAM_VALUE;
+    parser->token = STREAM_TOKEN_NONE;
+    return parser;
 }
 
-const char * json_object_get_string(const JSON_Object *object, const char *name) {
-    return json_value_get_string(json_object_get_value(object, name));
+void json_stream_parser_free(JSON_Stream_Parser *parser) {
+    if (parser == NULL) {
+        return;
+    }
+    json_value_free(parser->root); /* open containers are already part of root */
+    parson_free(parser->stack);
+    arena_free(parser->arena, parser->key);
+    parson_free(parser->buf);
+    parson_free(parser);
 }
 
-double json_object_get_number(const JSON_Object *object, const char *name) {
-    return json_value_get_number(json_object_get_value(object, name));
+JSON_Status json_stream_parser_feed(JSON_Stream_Parser *parser, const char *chunk, size_t len) {
+    JSON_Arena *arena = parson_arena;
+    JSON_Status status = JSONFailure;
+    if (parser == NULL) {
+        return JSONFailure;
+    }
+    /* The values go to the arena that was current when the parse started */
+    parson_arena = parser->arena;
+    status = stream_feed(parser, chunk, len);
+    parson_arena = arena;
+    return status;
 }
 
-JSON_Object * json_object_get_object(const JSON_Object *object, const char *name) {
-    return json_value_get_object(json_object_get_value(object, name));
+static JSON_Status stream_feed(JSON_Stream_Parser *parser, const char *chunk, size_t len) {
+    size_t i = 0, run = 0;
+    char c;
+    if (parser->failed) {
+        return JSONFailure;
+    }
+    if (chunk == NULL) {
+        return len ? JSONFailure : JSONSuccess;
+    }
+    while (i < len) {
+        if (parser->token == STREAM_TOKEN_STRING) {
+            /* Collect up to the closing quote in one go, escapes are
+               resolved by process_string() once the string is complete */
+            for (run = i; run < len; run++) {
+                if (parser->escaped) {
+                    parser->escaped = 0;
+                } else if (chunk[run] == '\\') {
+                    parser->escaped = 1;
+                } else if (chunk[run] == '\"') {
+                    break;
+                }
+            }
+            if (stream_buf_append(parser, chunk + i, run - i) == JSONFailure) {
+                goto error;
+            }
+            if (run == len) {
+                return JSONSuccess;
+            }
+            i = run + 1;
+            if (stream_end_string(parser) == JSONFailure) {
+                goto error;
+            }
+            continue;
+        }
+        c = chunk[i];
+        if (parser->token == STREAM_TOKEN_NUMBER || parser->token == STREAM_TOKEN_LITERAL) {
+            if ((parser->token == STREAM_TOKEN_NUMBER && (isdigit((unsigned char)c) ||
+                 c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) ||
+                (parser->token == STREAM_TOKEN_LITERAL && c >= 'a' && c <= 'z')) {
+                if (stream_buf_append(parser, &c, 1) == JSONFailure) {
+                    goto error;
+                }
+                i++;
+                continue;
+            }
+            /* c terminates the token and is looked at again below */
+            if (stream_end_scalar(parser) == JSONFailure) {
+                goto error;
+            }
+        }
+        if (parser->root == NULL && parser->bom < 3 && c == "\xEF\xBB\xBF"[parser->bom]) {
+            parser->bom++; /* Support for UTF-8 BOM */
+            i++;
+            continue;
+        }
+        i++;
+        if (isspace((unsigned char)c)) {
+            continue;
+        }
+        switch (parser->state) {
+            case STREAM_DONE:
+                return JSONSuccess; /* like json_parse_string, ignore what follows the value */
+            case STREAM_VALUE_OR_END:
+                if (c == ']') {
+                    if (stream_close(parser, c) == JSONFailure) {
+                        goto error;
+                    }
+                    break;
+                }
+                /* fall through */
+            case STREAM_VALUE:
+                if (stream_start_value(parser, c) == JSONFailure) {
+                    goto error;
+                }
+                break;
+            case STREAM_KEY_OR_END:
+                if (c == '}') {
+                    if (stream_close(parser, c) == JSONFailure) {
+                        goto error;
+                    }
+                    break;
+                }
+                /* fall through */
+            case STREAM_KEY:
+                if (c != '\"') {
+                    goto error;
+                }
+                parser->token = STREAM_TOKEN_STRING;
+                parser->buf_len = 0;
+                break;
+            case STREAM_COLON:
+                if (c != ':') {
+                    goto error;
+                }
+                parser->state = STREAM_VALUE;
+                break;
+            case STREAM_COMMA_OR_END:
+                if (c == ',') {
+                    if (json_value_get_type(parser->stack[parser->depth - 1]) == JSONObject) {
+                        parser->state = STREAM_KEY;
+                    } else {
+                        parser->state = STREAM_VALUE;
+                    }
+                } else if (stream_close(parser, c) == JSONFailure) {
+                    goto error;
+                }
+                break;
+            default:
+                goto error;
+        }
+    }
+    return JSONSuccess;
+error:
+    parser->failed = 1;
+    return JSONFailure;
 }
 
-JSON_Array * json_object_get_array(const JSON_Object *object, const char *name) {
-    return json_value_get_array(json_object_get_value(object, name));
+JSON_Value * json_stream_parser_finish(JSON_Stream_Parser *parser) {
+    JSON_Value *output_value = NULL;
+    JSON_Arena *arena = parson_arena;
+    if (parser == NULL) {
+        return NULL;
+    }
+    /* A number or literal at the top level only ends with the input */
+    parson_arena = parser->arena;
+    if (!parser->failed && parser->depth == 0 &&
+        (parser->token == STREAM_TOKEN_NUMBER || parser->token == STREAM_TOKEN_LITERAL) &&
+        stream_end_scalar(parser) == JSONFailure) {
+        parser->failed = 1;
+    }
+    parson_arena = arena;
+    if (!parser->failed && parser->state == STREAM_DONE) {
+        output_value = parser->root;
+        parser->root = NULL;
+    }
+    json_stream_parser_free(parser);
+    return output_value;
 }
 
-int json_object_get_boolean(const JSON_Object *object, const char *name) {
-    return json_value_get_boolean(json_object_get_value(object, name));
+static JSON_Status stream_buf_append(JSON_Stream_Parser *parser, const char *data, size_t len) {
+    size_t new_capacity = 0;
+    char *new_buf = NULL;
+    if (parser->buf_len + len + 1 > parser->buf_capacity) {
+        new_capacity = MAX(parser->buf_capacity * 2, STARTING_CAPACITY);
+        while (new_capacity < parser->buf_len + len + 1) {
+            new_capacity *= 2;
+        }
+        if (new_capacity > STRING_VALUE_MAX) {
+            return JSONFailure;
+        }
+        new_buf = (char*)parson_malloc(new_capacity);
+        if (new_buf == NULL) {
+            return JSONFailure;
+        }
+        if (parser->buf_len) {
+            memcpy_s(new_buf, new_capacity, parser->buf, parser->buf_len); /* SAFEC */
+        }
+        parson_free(parser->buf);
+        parser->buf = new_buf;
+        parser->buf_capacity = new_capacity;
+    }
+    if (len) {
+        memcpy_s(parser->buf + parser->buf_len, len, data, len); /* SAFEC */
+    }
+    parser->buf_len += len;
+    parser->buf[parser->buf_len] = '\0';
+    return JSONSuccess;
 }
 
-JSON_Value * json_object_dotget_value(const JSON_Object *object, const char *name) {
-    char *dot_position = NULL;
-    int name_len = 0;
-
-    /* SAFEC modified to use _s */
-    name_len = strnlen_s(name, STRING_NAME_MAX);
-    strstr_s((char *)name, name_len, ".", 1, &dot_position);
+/* Attaches a finished value to the innermost open container, or makes it the
+   root, and opens it when it is a container itself. */
+static JSON_Status stream_add_value(JSON_Stream_Parser *parser, JSON_Value *value) {
+    JSON_Value *parent = NULL, **new_stack = NULL;
+    JSON_Value_Type type;
+    size_t new_capacity = 0;
+    JSON_Status status = JSONFailure;
+    if (value == NULL) {
+        return JSONFailure;
+    }
+    if (parser->depth == 0) {
+        parser->root = value;
+    } else {
+        parent = parser->stack[parser->depth - 1];
+        if (json_value_get_type(parent) == JSONObject) {
+            status = json_object_add(json_value_get_object(parent), parser->key, value);
+            arena_free(parser->arena, parser->key);
+            parser->key = NULL;
+        } else {
+            status = json_array_add(json_value_get_array(parent), value);
+        }
+        if (status == JSONFailure) {
+            json_value_free(value);
+            return JSONFailure;
+        }
+    }
+    type = json_value_get_type(value);
+    if (type != JSONObject && type != JSONArray) {
+        parser->state = parser->depth ? STREAM_COMMA_OR_END : STREAM_DONE;
+        return JSONSuccess;
+    }
+    if (parser->depth >= MAX_NESTING) {
+        return JSONFailure;
+    }
+    if (parser->depth == parser->stack_capacity) {
+        new_capacity = MAX(parser->stack_capacity * 2, STARTING_CAPACITY);
+        new_stack = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+        if (new_stack == NULL) {
+            return JSONFailure;
+        }
+        if (parser->depth) {
+            memcpy_s(new_stack, new_capacity * sizeof(JSON_Value*),
+                     parser->stack, parser->depth * sizeof(JSON_Value*)); /* SAFEC */
+        }
+        parson_free(parser->stack);
+        parser->stack = new_stack;
+        parser->stack_capacity = new_capacity;
+    }
+    parser->stack[parser->depth++] = value;
+    parser->state = type == JSONObject ? STREAM_KEY_OR_END : STREAM_VALUE_OR_END;
+    return JSONSuccess;
+}
+
+static JSON_Status stream_close(JSON_Stream_Parser *parser, char c) {
+    JSON_Value *top = NULL;
+    JSON_Status status = JSONFailure;
+    if (parser->depth == 0) {
+        return JSONFailure;
+    }
+    top = parser->stack[parser->depth - 1];
+    /* Trim the container now that it is complete */
+    if (c == '}' && json_value_get_type(top) == JSONObject) {
+        JSON_Object *object = json_value_get_object(top);
+        status = json_object_get_count(object) && object->arena == NULL ?
+                 json_object_resize(object, json_object_get_count(object)) : JSONSuccess;
+    } else if (c == ']' && json_value_get_type(top) == JSONArray) {
+        JSON_Array *array = json_value_get_array(top);
+        status = json_array_get_count(array) && array->arena == NULL ?
+                 json_array_resize(array, json_array_get_count(array)) : JSONSuccess;
+    }
+    if (status == JSONFailure) {
+        return JSONFailure;
+    }
+    parser->depth--;
+    parser->state = parser->depth ? STREAM_COMMA_OR_END : STREAM_DONE;
+    return JSONSuccess;
+}
+
+static JSON_Status stream_end_string(JSON_Stream_Parser *parser) {
+    JSON_Value *value = NULL;
+    char *new_string = process_string(parser->buf, parser->buf_len);
+    parser->token = STREAM_TOKEN_NONE;
+    if (new_string == NULL) {
+        return JSONFailure;
+    }
+    if (parser->state == STREAM_KEY_OR_END || parser->state == STREAM_KEY) {
+        parser->key = new_string;
+        parser->state = STREAM_COLON;
+        return JSONSuccess;
+    }
+    value = json_value_init_string_no_copy(new_string);
+    if (value == NULL) {
+        arena_free(parser->arena, new_string);
+        return JSONFailure;
+    }
+    return stream_add_value(parser, value);
+}
+
+static JSON_Status stream_end_scalar(JSON_Stream_Parser *parser) {
+    JSON_Value *value = NULL;
+    char *end = NULL;
+    double number = 0;
+    int diff = 1;
+    if (parser->token == STREAM_TOKEN_NUMBER) {
+        errno = 0;
+        number = strtod(parser->buf, &end);
+        if (errno || end != parser->buf + parser->buf_len ||
+            !is_decimal(parser->buf, parser->buf_len)) {
+            return JSONFailure;
+        }
+        value = json_value_init_number(number);
+    } else if (parser->buf_len == SIZEOF_TOKEN("true")) {
+        strncmp_s("true", SIZEOF_TOKEN("true"), parser->buf, parser->buf_len, &diff); /* SAFEC */
+        if (!diff) {
+            value = json_value_init_boolean(1);
+        } else {
+            strncmp_s("null", SIZEOF_TOKEN("null"), parser->buf, parser->buf_len, &diff);
+            if (!diff) {
+                value = json_value_init_null();
+            }
+        }
+    } else if (parser->buf_len == SIZEOF_TOKEN("false")) {
+        strncmp_s("false", SIZEOF_TOKEN("false"), parser->buf, parser->buf_len, &diff); /* SAFEC */
+        if (!diff) {
+            value = json_value_init_boolean(0);
+        }
+    }
+    parser->token = STREAM_TOKEN_NONE;
+    return stream_add_value(parser, value);
+}
+
+static JSON_Status stream_start_value(JSON_Stream_Parser *parser, char c) {
+    parser->buf_len = 0;
+    switch (c) {
+        case '{':
+            return stream_add_value(parser, json_value_init_object());
+        case '[':
+            return stream_add_value(parser, json_value_init_array());
+        case '\"':
+            parser->token = STREAM_TOKEN_STRING;
+            return JSONSuccess;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            parser->token = STREAM_TOKEN_NUMBER;
+            return stream_buf_append(parser, &c, 1);
+        case 't': case 'f': case 'n':
+            parser->token = STREAM_TOKEN_LITERAL;
+            return stream_buf_append(parser, &c, 1);
+        default:
+            return JSONFailure;
+    }
+}
+
+/* Stream writer API */
+JSON_Stream_Writer * json_stream_writer_new(const JSON_Value *value) {
+    JSON_Stream_Writer *writer = NULL;
+    if (value == NULL) {
+        return NULL;
+    }
+    writer = (JSON_Stream_Writer*)parson_malloc(sizeof(JSON_Stream_Writer));
+    if (writer == NULL) {
+        return NULL;
+    }
+    memset(writer, 0, sizeof(JSON_Stream_Writer));
+    writer->root = value;
+    return writer;
+}
+
+void json_stream_writer_free(JSON_Stream_Writer *writer) {
+    if (writer == NULL) {
+        return;
+    }
+    parson_free(writer->stack);
+    parson_free(writer->out.buf);
+    parson_free(writer);
+}
+
+int json_stream_writer_read(JSON_Stream_Writer *writer, char *buf, int len) {
+    int written_total = 0;
+    size_t n = 0;
+    if (writer == NULL || buf == NULL || len < 0 || writer->failed) {
+        return -1;
+    }
+    while (written_total < len) {
+        if (writer->buf_pos == writer->out.len) {
+            if (writer->started && writer->depth == 0) {
+                break; /* all of it was read */
+            }
+            if (writer_next(writer) == JSONFailure) {
+                writer->failed = 1;
+                return -1;
+            }
+            continue;
+        }
+        n = writer->out.len - writer->buf_pos;
+        if (n > (size_t)(len - written_total)) {
+            n = (size_t)(len - written_total);
+        }
+        memcpy_s(buf + written_total, len - written_total, writer->out.buf + writer->buf_pos, n); /* SAFEC */
+        writer->buf_pos += n;
+        written_total += (int)n;
+    }
+    return written_total;
+}
+
+static JSON_Status writer_append(JSON_Stream_Writer *writer, const char *string) {
+    return out_write(&writer->out, string, strnlen_s(string, STRING_VALUE_MAX)); /* SAFEC */
+}
+
+static JSON_Status writer_append_string(JSON_Stream_Writer *writer, const char *string, size_t len) {
+    return json_serialize_string(string, len, &writer->out);
+}
+
+/* Writes a scalar, or opens an object or array to be written member by member */
+static JSON_Status writer_value(JSON_Stream_Writer *writer, const JSON_Value *value) {
+    const char *string = NULL;
+    JSON_Stream_Frame *new_stack = NULL;
+    size_t new_capacity = 0;
+    char num_buf[NUM_BUF_SIZE];
+    switch (json_value_get_type(value)) {
+        case JSONArray:
+        case JSONObject:
+            if (writer->depth == writer->stack_capacity) {
+                new_capacity = MAX(writer->stack_capacity * 2, STARTING_CAPACITY);
+                new_stack = (JSON_Stream_Frame*)parson_malloc(new_capacity * sizeof(JSON_Stream_Frame));
+                if (new_stack == NULL) {
+                    return JSONFailure;
+                }
+                if (writer->depth) {
+                    memcpy_s(new_stack, new_capacity * sizeof(JSON_Stream_Frame),
+                             writer->stack, writer->depth * sizeof(JSON_Stream_Frame)); /* SAFEC */
+                }
+                parson_free(writer->stack);
+                writer->stack = new_stack;
+                writer->stack_capacity = new_capacity;
+            }
+            writer->stack[writer->depth].value = value;
+            writer->stack[writer->depth].index = 0;
+            writer->depth++;
+            return writer_append(writer, json_value_get_type(value) == JSONArray ? "[" : "{");
+        case JSONString:
+            string = json_value_get_string(value);
+            if (string == NULL) {
+                return JSONFailure;
+            }
+            return writer_append_string(writer, string, strnlen_s(string, STRING_VALUE_MAX)); /* SAFEC */
+        case JSONBoolean:
+            return writer_append(writer, json_value_get_boolean(value) ? "true" : "false");
+        case JSONNumber:
+            if (sprintf(num_buf, FLOAT_FORMAT, json_value_get_number(value)) < 0) {
+                return JSONFailure;
+            }
+            return writer_append(writer, num_buf);
+        case JSONNull:
+            return writer_append(writer, "null");
+        default:
+            return JSONFailure;
+    }
+}
+
+/* Serializes the next piece of the value: a member with its separator
+   and name, or the end of the innermost object or array. */
+static JSON_Status writer_next(JSON_Stream_Writer *writer) {
+    JSON_Stream_Frame *top = NULL;
+    JSON_Object *object = NULL;
+    JSON_Array *array = NULL;
+    const JSON_Value *value = NULL;
+    size_t count = 0, index = 0;
+    writer->out.len = 0;
+    writer->buf_pos = 0;
+    if (!writer->started) {
+        writer->started = 1;
+        return writer_value(writer, writer->root);
+    }
+    top = &writer->stack[writer->depth - 1];
+    object = json_value_get_object(top->value);
+    array = json_value_get_array(top->value);
+    count = object ? json_object_get_count(object) : json_array_get_count(array);
+    if (top->index == count) {
+        writer->depth--;
+        return writer_append(writer, object ? "}" : "]");
+    }
+    index = top->index++;
+    if (index > 0 && writer_append(writer, ",") == JSONFailure) {
+        return JSONFailure;
+    }
+    if (object) {
+        if (writer_append_string(writer, object->names[index].string, object->names[index].length) == JSONFailure ||
+            writer_append(writer, ":") == JSONFailure) {
+            return JSONFailure;
+        }
+        value = json_object_get_value_at(object, index);
+    } else {
+        value = json_array_get_value(array, index);
+    }
+    return writer_value(writer, value);
+}
+
+/* Reader */
+JSON_Reader * json_reader_new(const char *string) {
+    JSON_Reader *reader = NULL;
+    if (string == NULL) {
+        return NULL;
+    }
+    reader = (JSON_Reader*)parson_malloc(sizeof(JSON_Reader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    memset(reader, 0, sizeof(JSON_Reader));
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    reader->text = string;
+    reader->pos = string;
+    reader->type = JSONError;
+    return reader;
+}
+
+void json_reader_free(JSON_Reader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+    parson_free(reader->stack);
+    parson_free(reader->name);
+    parson_free(reader);
+}
+
+JSON_Value_Type json_reader_next(JSON_Reader *reader) {
+    JSON_Reader_Frame *frame = NULL;
+    JSON_Arena *prev = NULL;
+    if (reader == NULL || reader->failed) {
+        return JSONError;
+    }
+    if (reader->pending && reader_skip_value(&reader->pos) == JSONFailure) {
+        return reader_fail(reader);
+    }
+    reader->pending = 0;
+    reader->type = JSONError;
+    parson_free(reader->name);
+    reader->name = NULL;
+    SKIP_WHITESPACES(&reader->pos);
+    if (!reader->started) {
+        reader->started = 1;
+    } else if (reader->depth == 0) {
+        return JSONReaderEnd; /* anything after the root value is ignored */
+    } else {
+        frame = &reader->stack[reader->depth - 1];
+        if (*reader->pos == (frame->type == JSONObject ? '}' : ']')) {
+            SKIP_CHAR(&reader->pos);
+            reader->depth--;
+            return JSONReaderEnd;
+        }
+        if (!frame->first) {
+            if (*reader->pos != ',') {
+                return reader_fail(reader);
+            }
+            SKIP_CHAR(&reader->pos);
+            SKIP_WHITESPACES(&reader->pos);
+        }
+        frame->first = 0;
+    }
+    reader->member = reader->pos;
+    if (frame != NULL && frame->type == JSONObject) {
+        /* Names are the reader's own, whatever arena is current */
+        prev = parson_arena;
+        parson_arena = NULL;
+        reader->name = get_quoted_string(&reader->pos);
+        parson_arena = prev;
+        if (reader->name == NULL) {
+            return reader_fail(reader);
+        }
+        SKIP_WHITESPACES(&reader->pos);
+        if (*reader->pos != ':') {
+            return reader_fail(reader);
+        }
+        SKIP_CHAR(&reader->pos);
+        SKIP_WHITESPACES(&reader->pos);
+    }
+    reader->type = reader_peek_type(*reader->pos);
+    if (reader->type == JSONError) {
+        return reader_fail(reader);
+    }
+    reader->pending = 1;
+    return reader->type;
+}
+
+const char * json_reader_name(const JSON_Reader *reader) {
+    return reader ? reader->name : NULL;
+}
+
+JSON_Status json_reader_enter(JSON_Reader *reader) {
+    JSON_Reader_Frame *new_stack = NULL;
+    size_t new_capacity = 0;
+    if (reader == NULL || reader->failed || !reader->pending ||
+        (reader->type != JSONObject && reader->type != JSONArray)) {
+        return JSONFailure;
+    }
+    if (reader->depth == MAX_NESTING) {
+        reader_fail(reader);
+        return JSONFailure;
+    }
+    if (reader->depth == reader->stack_capacity) {
+        new_capacity = MAX(reader->stack_capacity * 2, STARTING_CAPACITY);
+        new_stack = (JSON_Reader_Frame*)parson_malloc(new_capacity * sizeof(JSON_Reader_Frame));
+        if (new_stack == NULL) {
+            return JSONFailure;
+        }
+        if (reader->depth) {
+            memcpy_s(new_stack, new_capacity * sizeof(JSON_Reader_Frame),
+                     reader->stack, reader->depth * sizeof(JSON_Reader_Frame)); /* SAFEC */
+        }
+        parson_free(reader->stack);
+        reader->stack = new_stack;
+        reader->stack_capacity = new_capacity;
+    }
+    reader->stack[reader->depth].type = reader->type;
+    reader->stack[reader->depth].first = 1;
+    reader->depth++;
+    reader->pending = 0;
+    SKIP_CHAR(&reader->pos);
+    return JSONSuccess;
+}
+
+JSON_Value * json_reader_value(JSON_Reader *reader) {
+    JSON_Value *value = NULL;
+    if (reader == NULL || reader->failed || !reader->pending) {
+        return NULL;
+    }
+    value = parse_value(&reader->pos, reader->depth);
+    reader->pending = 0;
+    if (value == NULL) {
+        reader_fail(reader);
+    }
+    return value;
+}
+
+const char * json_reader_text(JSON_Reader *reader, size_t *len) {
+    const char *start = NULL;
+    if (reader == NULL || reader->failed || !reader->pending || len == NULL) {
+        return NULL;
+    }
+    start = reader->pos;
+    reader->pending = 0;
+    if (reader_skip_value(&reader->pos) == JSONFailure) {
+        reader_fail(reader);
+        return NULL;
+    }
+    *len = (size_t)(reader->pos - start);
+    return start;
+}
+
+JSON_Reader_Mark json_reader_mark(const JSON_Reader *reader) {
+    JSON_Reader_Mark mark;
+    mark.offset = reader && reader->member ? (size_t)(reader->member - reader->text) : 0;
+    mark.depth = reader ? reader->depth : 0;
+    return mark;
+}
+
+JSON_Status json_reader_rewind(JSON_Reader *reader, const JSON_Reader_Mark *mark) {
+    if (reader == NULL || mark == NULL || reader->failed || mark->depth == 0 ||
+        (mark->depth != reader->depth && mark->depth != reader->depth + 1) ||
+        mark->depth > reader->stack_capacity) {
+        return JSONFailure;
+    }
+    reader->depth = mark->depth;
+    reader->stack[reader->depth - 1].first = 1; /* no comma before the member */
+    reader->pos = reader->text + mark->offset;
+    reader->pending = 0;
+    reader->type = JSONError;
+    parson_free(reader->name);
+    reader->name = NULL;
+    return JSONSuccess;
+}
+
+static JSON_Value_Type reader_peek_type(char c) {
+    switch (c) {
+        case '{':
+            return JSONObject;
+        case '[':
+            return JSONArray;
+        case '\"':
+            return JSONString;
+        case 'f': case 't':
+            return JSONBoolean;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return JSONNumber;
+        case 'n':
+            return JSONNull;
+        default:
+            return JSONError;
+    }
+}
+
+/* Moves past a value, matching brackets and quotes only */
+static JSON_Status reader_skip_value(const char **string) {
+    size_t depth = 0;
+    SKIP_WHITESPACES(string);
+    if (**string == '\"') {
+        return skip_quotes(string);
+    }
+    if (**string != '{' && **string != '[') {
+        while (**string != '\0' && **string != ',' && **string != '}' && **string != ']' &&
+               !isspace((unsigned char)**string)) {
+            SKIP_CHAR(string);
+        }
+        return JSONSuccess;
+    }
+    do {
+        switch (**string) {
+            case '\0':
+                return JSONFailure;
+            case '\"':
+                if (skip_quotes(string) == JSONFailure) {
+                    return JSONFailure;
+                }
+                continue;
+            case '{': case '[':
+                depth++;
+                break;
+            case '}': case ']':
+                depth--;
+                break;
+            default:
+                break;
+        }
+        SKIP_CHAR(string);
+    } while (depth > 0);
+    return JSONSuccess;
+}
+
+static JSON_Value_Type reader_fail(JSON_Reader *reader) {
+    reader->failed = 1;
+    reader->pending = 0;
+    reader->type = JSONError;
+    return JSONError;
+}
+
+/* JSON Object API */
+
+JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
+    if (object == NULL || name == NULL) {
+        return NULL;
+    }
+    return json_object_getn_value(object, name, strnlen_s(name, STRING_NAME_MAX)); /* SAFEC */
+}
+
+const char * json_object_get_string(const JSON_Object *object, const char *name) {
+    return json_value_get_string(json_object_get_value(object, name));
+}
+
+double json_object_get_number(const JSON_Object *object, const char *name) {
+    return json_value_get_number(json_object_get_value(object, name));
+}
+
+JSON_Object * json_object_get_object(const JSON_Object *object, const char *name) {
+    return json_value_get_object(json_object_get_value(object, name));
+}
+
+JSON_Array * json_object_get_array(const JSON_Object *object, const char *name) {
+    return json_value_get_array(json_object_get_value(object, name));
+}
+
+int json_object_get_boolean(const JSON_Object *object, const char *name) {
+    return json_value_get_boolean(json_object_get_value(object, name));
+}
+
+JSON_Key json_key(const char *name) {
+    JSON_Key key;
+    key.name = name;
+    key.length = name ? strnlen_s(name, STRING_NAME_MAX) : 0; /* SAFEC */
+    key.hash = hash_name(name ? name : "", key.length);
+    return key;
+}
+
+JSON_Value * json_object_get_value_key(const JSON_Object *object, const JSON_Key *key) {
+    size_t i = 0;
+    if (object == NULL || key == NULL || key->name == NULL) {
+        return NULL;
+    }
+    i = json_object_find(object, key->name, key->length, key->hash);
+    return i == NAME_NOT_FOUND ? NULL : object->values[i];
+}
+
+const char * json_object_get_string_key(const JSON_Object *object, const JSON_Key *key) {
+    return json_value_get_string(json_object_get_value_key(object, key));
+}
+
+double json_object_get_number_key(const JSON_Object *object, const JSON_Key *key) {
+    return json_value_get_number(json_object_get_value_key(object, key));
+}
+
+JSON_Object * json_object_get_object_key(const JSON_Object *object, const JSON_Key *key) {
+    return json_value_get_object(json_object_get_value_key(object, key));
+}
+
+JSON_Array * json_object_get_array_key(const JSON_Object *object, const JSON_Key *key) {
+    return json_value_get_array(json_object_get_value_key(object, key));
+}
+
+int json_object_get_boolean_key(const JSON_Object *object, const JSON_Key *key) {
+    return json_value_get_boolean(json_object_get_value_key(object, key));
+}
+
+JSON_Value * json_object_dotget_value(const JSON_Object *object, const char *name) {
+    char *dot_position = NULL;
+    int name_len = 0;
+
+    /* SAFEC modified to use _s */
+    name_len = strnlen_s(name, STRING_NAME_MAX);
+    strstr_s((char *)name, name_len, ".", 1, &dot_position);
 
     if (!dot_position) {
         return json_object_get_value(object, name);
@@ -1259,7 +2369,7 @@ const char * json_object_get_name(const JSON_Object *object, size_t index) {
     if (object == NULL || index >= json_object_get_count(object)) {
         return NULL;
     }
-    return object->names[index];
+    return object->names[index].string;
 }
 
 JSON_Value * json_object_get_value_at(const JSON_Object *object, size_t index) {
@@ -1357,6 +2467,9 @@ JSON_Value * json_value_get_parent (const JSON_Value *value) {
 }
 
 void json_value_free(JSON_Value *value) {
+    if (value == NULL || value->in_arena) {
+        return; /* goes with its arena */
+    }
     switch (json_value_get_type(value)) {
         case JSONObject:
             json_object_free(value->value.object);
@@ -1374,30 +2487,26 @@ void json_value_free(JSON_Value *value) {
 }
 
 JSON_Value * json_value_init_object(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = json_value_alloc(JSONObject);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONObject;
     new_value->value.object = json_object_init(new_value);
     if (!new_value->value.object) {
-        parson_free(new_value);
+        arena_free(parson_arena, new_value);
         return NULL;
     }
     return new_value;
 }
 
 JSON_Value * json_value_init_array(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = json_value_alloc(JSONArray);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONArray;
     new_value->value.array = json_array_init(new_value);
     if (!new_value->value.array) {
-        parson_free(new_value);
+        arena_free(parson_arena, new_value);
         return NULL;
     }
     return new_value;
@@ -1414,13 +2523,32 @@ JSON_Value * json_value_init_string(const char *string) {
     if (!is_valid_utf8(string, string_len)) {
         return NULL;
     }
-    copy = parson_strndup(string, string_len);
+    copy = parson_strndup(parson_arena, string, string_len);
     if (copy == NULL) {
         return NULL;
     }
     value = json_value_init_string_no_copy(copy);
     if (value == NULL) {
-        parson_free(copy);
+        arena_free(parson_arena, copy);
+    }
+    return value;
+}
+
+JSON_Value * json_value_init_string_with_len(const char *string, size_t len) {
+    char *copy = NULL;
+    JSON_Value *value;
+    if (string == NULL || !is_valid_utf8(string, len)) {
+        return NULL;
+    }
+    copy = (char*)arena_malloc(parson_arena, len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy_s(copy, len + 1, string, len); /* SAFEC */
+    copy[len] = '\0';
+    value = json_value_init_string_no_copy(copy);
+    if (value == NULL) {
+        arena_free(parson_arena, copy);
     }
     return value;
 }
@@ -1430,34 +2558,28 @@ JSON_Value * json_value_init_number(double number) {
     if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    new_value = json_value_alloc(JSONNumber);
     if (new_value == NULL) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONNumber;
     new_value->value.number = number;
     return new_value;
 }
 
 JSON_Value * json_value_init_boolean(int boolean) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = json_value_alloc(JSONBoolean);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONBoolean;
     new_value->value.boolean = boolean ? 1 : 0;
     return new_value;
 }
 
 JSON_Value * json_value_init_null(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = json_value_alloc(JSONNull);
     if (!new_value) {
         return NULL;
     }
-    new_value->parent = NULL;
-    new_value->type = JSONNull;
     return new_value;
 }
 
@@ -1529,7 +2651,7 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
             }
             return_value = json_value_init_string_no_copy(temp_string_copy);
             if (return_value == NULL) {
-                parson_free(temp_string_copy);
+                arena_free(parson_arena, temp_string_copy);
             }
             return return_value;
         case JSONNull:
@@ -1542,138 +2664,104 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
 }
 #endif
 
-size_t json_serialization_size(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 0, num_buf);
-    return res < 0 ? 0 : (size_t)(res + 1);
+static size_t serialization_size(const JSON_Value *value, int is_pretty) {
+    JSON_Out out;
+    memset(&out, 0, sizeof(JSON_Out));
+    out.sink = null_sink;
+    if (json_serialize_out(value, is_pretty, &out) == JSONFailure) {
+        return 0;
+    }
+    return out.total + 1;
 }
 
-JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+static JSON_Status serialize_to_buffer(const JSON_Value *value, int is_pretty, char *buf, size_t buf_size_in_bytes) {
+    JSON_Out out;
+    if (buf == NULL || buf_size_in_bytes == 0) {
         return JSONFailure;
     }
-    written = json_serialize_to_buffer_r(value, buf, 0, 0, NULL);
-    if (written < 0) {
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    memset(&out, 0, sizeof(JSON_Out));
+    out.buf = buf;
+    out.capacity = buf_size_in_bytes;
+    out.fixed = 1;
+    return json_serialize_out(value, is_pretty, &out);
 }
 
-JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename) {
+static JSON_Status serialize_to_file(const JSON_Value *value, int is_pretty, const char *filename) {
     JSON_Status return_code = JSONSuccess;
     FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string(value, NULL);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
     fp = fopen(filename, "w");
     if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
         return JSONFailure;
     }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
+    return_code = json_serialize_to_sink_r(value, is_pretty, file_sink, fp);
     if (fclose(fp) == EOF) {
         return_code = JSONFailure;
     }
-    json_free_serialized_string(serialized_string);
     return return_code;
 }
 
-char * json_serialize_to_string(const JSON_Value *value, int *len) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
+static char * serialize_to_string(const JSON_Value *value, int is_pretty, int *len) {
+    JSON_Out out;
+    memset(&out, 0, sizeof(JSON_Out));
+    if (json_serialize_out(value, is_pretty, &out) == JSONFailure) {
+        parson_free(out.buf);
         return NULL;
     }
     if (len != NULL) {
-        /*
-         * The user wants to be provided with the string length
-         * Subtract by 1 to get string length (ommitting the added NULL byte).
-         */
-        *len = buf_size_bytes - 1;
-    }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
+        *len = (int)out.len;
     }
-    serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
+    return out.buf;
+}
+
+static JSON_Status json_serialize_to_sink_r(const JSON_Value *value, int is_pretty, JSON_Sink_Function sink, void *sink_ctx) {
+    JSON_Out out;
+    if (sink == NULL) {
+        return JSONFailure;
     }
-    return buf;
+    memset(&out, 0, sizeof(JSON_Out));
+    out.sink = sink;
+    out.sink_ctx = sink_ctx;
+    return json_serialize_out(value, is_pretty, &out);
+}
+
+size_t json_serialization_size(const JSON_Value *value) {
+    return serialization_size(value, 0);
+}
+
+JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
+    return serialize_to_buffer(value, 0, buf, buf_size_in_bytes);
+}
+
+JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename) {
+    return serialize_to_file(value, 0, filename);
+}
+
+char * json_serialize_to_string(const JSON_Value *value, int *len) {
+    return serialize_to_string(value, 0, len);
+}
+
+JSON_Status json_serialize_to_sink(const JSON_Value *value, JSON_Sink_Function sink, void *sink_ctx) {
+    return json_serialize_to_sink_r(value, 0, sink, sink_ctx);
 }
 
 size_t json_serialization_size_pretty(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 1, num_buf);
-    return res < 0 ? 0 : (size_t)(res + 1);
+    return serialization_size(value, 1);
 }
 
 JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 1, NULL);
-    if (written < 0) {
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    return serialize_to_buffer(value, 1, buf, buf_size_in_bytes);
 }
 
 JSON_Status json_serialize_to_file_pretty(const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string_pretty(value, NULL);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
-        return JSONFailure;
-    }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return serialize_to_file(value, 1, filename);
 }
 
 char * json_serialize_to_string_pretty(const JSON_Value *value, int *len) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
-    }
-    if (len != NULL) {
-        /*
-         * The user wants to be provided with the string length
-         * Subtract by 1 to get string length (ommitting the added NULL byte).
-         */
-        *len = buf_size_bytes - 1;
-    }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
-    }
-    serialization_result = json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
-    }
-    return buf;
+    return serialize_to_string(value, 1, len);
+}
+
+JSON_Status json_serialize_to_sink_pretty(const JSON_Value *value, JSON_Sink_Function sink, void *sink_ctx) {
+    return json_serialize_to_sink_r(value, 1, sink, sink_ctx);
 }
 
 void json_free_serialized_string(char *string) {
@@ -1820,26 +2908,20 @@ JSON_Status json_array_append_null(JSON_Array *array) {
 }
 
 JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Value *value) {
-    size_t i = 0;
-    JSON_Value *old_value;
+    size_t i = 0, name_len = 0;
     if (object == NULL || name == NULL || value == NULL || value->parent != NULL) {
         return JSONFailure;
     }
-    old_value = json_object_get_value(object, name);
-    if (old_value != NULL) { /* free and overwrite old value */
-        json_value_free(old_value);
-        for (i = 0; i < json_object_get_count(object); i++) {
-            int diff = 1;
-            strcmp_s(object->names[i], STRING_NAME_MAX, name, &diff); /* SAFEC */
-            if (!diff) {
-                value->parent = json_object_get_wrapping_value(object);
-                object->values[i] = value;
-                return JSONSuccess;
-            }
-        }
+    name_len = strnlen_s(name, STRING_NAME_MAX); /* SAFEC */
+    i = json_object_find(object, name, name_len, hash_name(name, name_len));
+    if (i != NAME_NOT_FOUND) { /* free and overwrite old value */
+        json_value_free(object->values[i]);
+        value->parent = json_object_get_wrapping_value(object);
+        object->values[i] = value;
+        return JSONSuccess;
     }
     /* add new key value pair */
-    return json_object_add(object, name, value);
+    return json_object_addn(object, name, name_len, value);
 }
 
 JSON_Status json_object_set_string(JSON_Object *object, const char *name, const char *string) {
@@ -1966,10 +3048,11 @@ JSON_Status json_object_clear(JSON_Object *object) {
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(object->names[i]);
+        arena_free(object->arena, object->names[i].string);
         json_value_free(object->values[i]);
     }
     object->count = 0;
+    json_object_index(object);
     return JSONSuccess;
 }
 
@@ -2127,3 +3210,45 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Fu
     parson_malloc = malloc_fun;
     parson_free = free_fun;
 }
+
+/* Arena API */
+JSON_Arena * json_arena_new(size_t block_size) {
+    JSON_Arena *arena = (JSON_Arena*)parson_malloc(sizeof(JSON_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->blocks = NULL;
+    arena->block_size = block_size ? ARENA_ALIGN(block_size) : ARENA_BLOCK_SIZE;
+    arena->used = 0;
+    return arena;
+}
+
+JSON_Arena * json_arena_set(JSON_Arena *arena) {
+    JSON_Arena *previous = parson_arena;
+    parson_arena = arena;
+    return previous;
+}
+
+JSON_Arena * json_arena_get(void) {
+    return parson_arena;
+}
+
+size_t json_arena_used(const JSON_Arena *arena) {
+    return arena ? arena->used : 0;
+}
+
+void json_arena_free(JSON_Arena *arena) {
+    JSON_Arena_Block *block = NULL;
+    if (arena == NULL) {
+        return;
+    }
+    if (parson_arena == arena) {
+        parson_arena = NULL;
+    }
+    while (arena->blocks) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        parson_free(block);
+    }
+    parson_free(arena);
+}
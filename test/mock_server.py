@@ -0,0 +1,433 @@
+#!/usr/bin/env python3
+"""
+* Copyright (c) 2019, Cisco Systems, Inc.
+*
+* Licensed under the Apache License 2.0 (the "License").  You may not use
+* this file except in compliance with the License.  You can obtain a copy
+* in the file LICENSE in the source distribution or at
+* https://github.com/cisco/libacvp/LICENSE
+*
+"""
+#
+# Local stand-in for the ACVP server, to run acvp_register(),
+# acvp_process_tests() and acvp_check_test_results() end to end without
+# network access.  The vector sets are the clean files of the json
+# directory, picked by the algorithm and mode of each registered
+# capability.  Every answer can be delayed, throttled, answered with a
+# "retry" period or failed, so transport and orchestration changes can be
+# measured the same way every time.  The answers are not graded, every
+# vector set gets the disposition given on the command line.
+#
+import os
+import re
+import ssl
+import sys
+import glob
+import gzip
+import json
+import time
+import random
+import socket
+import logging
+import argparse
+import threading
+from http.server import HTTPServer, BaseHTTPRequestHandler
+from socketserver import ThreadingMixIn
+
+ACV_VERSION = {"acvVersion": "1.0"}
+JWT_EXPIRED = "JWT expired"
+JWT_INVALID = "JWT signature does not match"
+SEND_CHUNK = 16384
+
+logger = logging.getLogger(__name__)
+
+
+class Fixtures():
+    """
+    The vector sets served by the server, keyed by (algorithm, mode).
+    Files named with a trailing number are the corrupt variants used by
+    the unit tests, they are left out.
+    """
+    def __init__(self, json_dir, overrides):
+        self.sets = {}
+        for path in sorted(glob.glob(os.path.join(json_dir, "*", "*.json"))):
+            name = os.path.splitext(os.path.basename(path))[0]
+            if re.search(r"\d+$", name) or name.endswith("_reg_good"):
+                continue
+            self.add(path)
+        for spec in overrides:
+            key, _, path = spec.partition("=")
+            if not path:
+                raise ValueError("--vector-set wants ALGORITHM[:MODE]=FILE, got %s" % spec)
+            alg, _, mode = key.partition(":")
+            self.add(path, (alg, mode or None))
+
+    def add(self, path, key=None):
+        try:
+            with open(path) as f:
+                val = json.load(f)
+        except (OSError, ValueError) as e:
+            logger.warning("Skipping %s: %s", path, e)
+            return
+        if not isinstance(val, list) or len(val) < 2 or "testGroups" not in val[1]:
+            return
+        vs = val[1]
+        if key is None:
+            key = (vs.get("algorithm"), vs.get("mode"))
+        self.sets[key] = vs
+        logger.info("Vector set for %s: %s", "/".join(k for k in key if k), path)
+
+    def find(self, alg, mode):
+        return self.sets.get((alg, mode)) or self.sets.get((alg, None))
+
+
+class State():
+    """
+    Everything the server remembers, shared by the connection threads
+    """
+    def __init__(self, args, fixtures):
+        self.args = args
+        self.fixtures = fixtures
+        self.lock = threading.Lock()
+        self.rand = random.Random(args.seed)
+        self.tokens = {}        # token -> time issued
+        self.next_id = 1
+        self.sessions = {}      # session id -> list of vsIds
+        self.vector_sets = {}   # vsId -> {"vs", "gets", "result_gets", "answered"}
+        self.stats = {}         # route -> [count, bytes in, bytes out]
+        self.started = time.time()
+
+    def new_id(self):
+        with self.lock:
+            n = self.next_id
+            self.next_id += 1
+            return n
+
+    def new_token(self):
+        with self.lock:
+            tok = "mock-%d-%016x" % (len(self.tokens) + 1, self.rand.getrandbits(64))
+            self.tokens[tok] = time.time()
+            return tok
+
+    def chance(self, rate):
+        if rate <= 0:
+            return False
+        with self.lock:
+            return self.rand.random() < rate
+
+    def count(self, route, bytes_in, bytes_out):
+        with self.lock:
+            st = self.stats.setdefault(route, [0, 0, 0])
+            st[0] += 1
+            st[1] += bytes_in
+            st[2] += bytes_out
+
+    def report(self):
+        elapsed = time.time() - self.started
+        total = [0, 0, 0]
+        print("\n%-20s %8s %12s %12s" % ("route", "requests", "bytes in", "bytes out"))
+        for route in sorted(self.stats):
+            st = self.stats[route]
+            total = [a + b for a, b in zip(total, st)]
+            print("%-20s %8d %12d %12d" % (route, st[0], st[1], st[2]))
+        print("%-20s %8d %12d %12d" % ("total", total[0], total[1], total[2]))
+        if elapsed > 0:
+            print("%.1f requests/s over %.1f s" % (total[0] / elapsed, elapsed))
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    state = None
+
+    def log_message(self, fmt, *args):
+        logger.debug("%s " + fmt, self.address_string(), *args)
+
+    def read_body(self):
+        """
+        Reads the request body, chunked or not, and undoes the gzip
+        content encoding.  Returns the body and its size on the wire.
+        """
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            body = b""
+            while True:
+                n = int(self.rfile.readline().split(b";")[0].strip(), 16)
+                if n == 0:
+                    while self.rfile.readline() not in (b"\r\n", b"\n", b""):
+                        pass
+                    break
+                body += self.rfile.read(n)
+                self.rfile.readline()
+        else:
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        wire = len(body)
+        if self.headers.get("Content-Encoding", "").lower() == "gzip":
+            body = gzip.decompress(body)
+        return body, wire
+
+    def send_json(self, route, val, code=200, bytes_in=0):
+        """
+        Sends a JSON answer after the configured latency, at no more
+        than the configured rate
+        """
+        args = self.state.args
+        delay = args.latency + (self.state.rand.uniform(0, args.jitter) if args.jitter else 0)
+        if delay:
+            time.sleep(delay / 1000.0)
+
+        body = json.dumps(val).encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        if not args.no_gzip and "gzip" in self.headers.get("Accept-Encoding", ""):
+            body = gzip.compress(body)
+            self.send_header("Content-Encoding", "gzip")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+
+        if not args.rate:
+            self.wfile.write(body)
+        else:
+            for i in range(0, len(body), SEND_CHUNK):
+                chunk = body[i:i + SEND_CHUNK]
+                self.wfile.write(chunk)
+                self.wfile.flush()
+                time.sleep(len(chunk) / (args.rate * 1024.0))
+        self.state.count(route, bytes_in, len(body))
+
+    def inject_failure(self, route, bytes_in):
+        """
+        Fails the request on purpose, with a 503 or by dropping the
+        connection.  Returns True when it did.
+        """
+        args = self.state.args
+        if self.state.chance(args.drop_rate):
+            logger.info("Dropping the connection of %s %s", self.command, self.path)
+            self.state.count(route + "/drop", bytes_in, 0)
+            self.close_connection = True
+            try:
+                self.connection.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+            return True
+        if self.state.chance(args.fail_rate):
+            logger.info("Failing %s %s with 503", self.command, self.path)
+            self.send_json(route + "/503", {"error": "Service Unavailable"}, 503, bytes_in)
+            return True
+        return False
+
+    def check_token(self, route, bytes_in):
+        """
+        Answers with 401 unless the request carries a valid token
+        """
+        auth = self.headers.get("Authorization", "")
+        tok = auth[len("Bearer "):] if auth.startswith("Bearer ") else None
+        with self.state.lock:
+            issued = self.state.tokens.get(tok)
+        if issued is None:
+            self.send_json(route + "/401", {"error": JWT_INVALID}, 401, bytes_in)
+            return False
+        lifetime = self.state.args.jwt_lifetime
+        if lifetime and time.time() - issued > lifetime:
+            self.send_json(route + "/401", {"error": JWT_EXPIRED}, 401, bytes_in)
+            return False
+        return True
+
+    def do_POST(self):
+        body, wire = self.read_body()
+        path = self.path.lstrip("/")
+        prefix = path.rsplit("/", 1)[0] + "/" if "/" in path else ""
+
+        if path.endswith("login"):
+            if self.inject_failure("login", wire):
+                return
+            return self.send_json("login", [ACV_VERSION, {"accessToken": self.state.new_token()}],
+                                  bytes_in=wire)
+
+        m = re.search(r"(vendors|modules|oes|dependencies)$", path)
+        if m:
+            if not self.check_token(m.group(1), wire) or self.inject_failure(m.group(1), wire):
+                return
+            url = "%s%s/%d" % (prefix, m.group(1), self.state.new_id())
+            return self.send_json(m.group(1), [ACV_VERSION, {"url": url}], bytes_in=wire)
+
+        if path.endswith("testSessions"):
+            if not self.check_token("testSessions", wire) or self.inject_failure("testSessions", wire):
+                return
+            return self.new_session(prefix, body, wire)
+
+        m = re.search(r"vectorSets/(\d+)/results$", path)
+        if m:
+            if not self.check_token("submit", wire) or self.inject_failure("submit", wire):
+                return
+            with self.state.lock:
+                vs = self.state.vector_sets.get(int(m.group(1)))
+                if vs:
+                    vs["answered"] = True
+            if not vs:
+                return self.send_json("submit", {"error": "No such vector set"}, 404, wire)
+            return self.send_json("submit", [ACV_VERSION, {}], bytes_in=wire)
+
+        self.send_json("unknown", {"error": "Not found"}, 404, wire)
+
+    def new_session(self, prefix, body, wire):
+        args = self.state.args
+        try:
+            algs = json.loads(body)[1]["algorithms"]
+        except (ValueError, LookupError, TypeError):
+            return self.send_json("testSessions", {"error": "Bad registration"}, 400, wire)
+
+        sid = self.state.new_id()
+        url = "%stestSessions/%d" % (prefix, sid)
+        vs_ids = []
+        for cap in algs:
+            vs = self.state.fixtures.find(cap.get("algorithm"), cap.get("mode"))
+            if not vs:
+                logger.warning("No vector set for %s %s, skipped",
+                               cap.get("algorithm"), cap.get("mode") or "")
+                continue
+            for i in range(args.copies):
+                vs_id = self.state.new_id()
+                with self.state.lock:
+                    self.state.vector_sets[vs_id] = {"vs": vs, "gets": 0, "result_gets": 0,
+                                                     "answered": False}
+                vs_ids.append(vs_id)
+        with self.state.lock:
+            self.state.sessions[sid] = vs_ids
+        logger.info("Test session %d with %d vector sets", sid, len(vs_ids))
+
+        return self.send_json("testSessions", [ACV_VERSION, {
+            "url": url,
+            "accessToken": self.state.new_token(),
+            "vectorSetUrls": ["%s/vectorSets/%d" % (url, n) for n in vs_ids]}],
+            bytes_in=wire)
+
+    def do_GET(self):
+        path = self.path.lstrip("/").split("?")[0]
+        args = self.state.args
+
+        m = re.search(r"testSessions/(\d+)/vectorSets/(\d+)(/results|/expected)?$", path)
+        if m:
+            route = "vectorSet" if not m.group(3) else m.group(3)[1:]
+            if not self.check_token(route, 0) or self.inject_failure(route, 0):
+                return
+            vs_id = int(m.group(2))
+            with self.state.lock:
+                vs = self.state.vector_sets.get(vs_id)
+                if vs and not m.group(3):
+                    vs["gets"] += 1
+                if vs and m.group(3) == "/results":
+                    vs["result_gets"] += 1
+            if not vs:
+                return self.send_json(route, {"error": "No such vector set"}, 404)
+            if not m.group(3):
+                if vs["gets"] <= args.retry:
+                    return self.send_json(route, [ACV_VERSION, {"retry": args.retry_period}])
+                val = dict(vs["vs"], vsId=vs_id)
+                return self.send_json(route, [ACV_VERSION, val])
+            if m.group(3) == "/results" and (not vs["answered"] or vs["result_gets"] <= args.retry):
+                return self.send_json(route, [ACV_VERSION, {"vsId": vs_id, "disposition": "incomplete"}])
+            return self.send_json(route, [ACV_VERSION, {"vsId": vs_id, "disposition": args.disposition,
+                                                        "tests": []}])
+
+        m = re.search(r"testSessions/(\d+)/results$", path)
+        if m:
+            if not self.check_token("sessionResults", 0) or self.inject_failure("sessionResults", 0):
+                return
+            prefix = path[:m.start()]
+            with self.state.lock:
+                vs_ids = self.state.sessions.get(int(m.group(1)))
+            if vs_ids is None:
+                return self.send_json("sessionResults", {"error": "No such test session"}, 404)
+            status = "pass" if args.disposition == "passed" else "fail"
+            results = [{"vectorSetUrl": "%stestSessions/%s/vectorSets/%d" % (prefix, m.group(1), n),
+                        "status": status} for n in vs_ids]
+            return self.send_json("sessionResults", [ACV_VERSION, {"passed": status == "pass",
+                                                                   "results": results}])
+
+        self.send_json("unknown", {"error": "Not found"}, 404)
+
+
+class Server(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description='Local stand-in for the ACVP server, serving the vector sets ' +
+                    'of the json directory.'
+    )
+    parser.add_argument('--cert', required=True,
+                        help='PEM certificate of the server, the client must trust it.')
+    parser.add_argument('--key', required=True,
+                        help='PEM private key of the server.')
+    parser.add_argument('--port', type=int, default=8443,
+                        help='Port to listen on (default 8443).')
+    parser.add_argument('--bind', default='127.0.0.1',
+                        help='Address to listen on (default 127.0.0.1).')
+    parser.add_argument('--json-dir',
+                        default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'json'),
+                        help='Directory holding the vector set files.')
+    parser.add_argument('--vector-set', action='append', default=[], metavar='ALG[:MODE]=FILE',
+                        help='Serve FILE for the given algorithm, may be repeated.')
+    parser.add_argument('--copies', type=int, default=1,
+                        help='Vector sets per registered capability (default 1).')
+    parser.add_argument('--latency', type=float, default=0,
+                        help='Milliseconds added before every answer.')
+    parser.add_argument('--jitter', type=float, default=0,
+                        help='Up to this many more milliseconds, at random.')
+    parser.add_argument('--rate', type=float, default=0,
+                        help='Send answers at no more than this many KB/s per connection.')
+    parser.add_argument('--retry', type=int, default=0,
+                        help='Answer "retry" to the first N requests for each vector set and ' +
+                             'its results.')
+    parser.add_argument('--retry-period', type=int, default=1,
+                        help='Seconds to wait given in "retry" answers (default 1).')
+    parser.add_argument('--fail-rate', type=float, default=0,
+                        help='Fraction of the requests answered with 503.')
+    parser.add_argument('--drop-rate', type=float, default=0,
+                        help='Fraction of the requests whose connection is dropped.')
+    parser.add_argument('--jwt-lifetime', type=float, default=0,
+                        help='Seconds after which a token has expired, 0 for never.')
+    parser.add_argument('--disposition', choices=['passed', 'failed'], default='passed',
+                        help='Result of every vector set (default passed).')
+    parser.add_argument('--no-gzip', action='store_true',
+                        help='Never compress the answers.')
+    parser.add_argument('--seed', type=int, default=0,
+                        help='Seed of the random failures and jitter.')
+    parser.add_argument('-l',
+                        dest='log_level',
+                        choices=['debug', 'info', 'warning', 'error'],
+                        default='warning',
+                        help='Set the logging level.')
+    args = parser.parse_args()
+
+    logging.basicConfig(
+        level=getattr(logging, args.log_level.upper()),
+        format="%(levelname)s - %(asctime)s --> %(message)s",
+    )
+
+    try:
+        fixtures = Fixtures(args.json_dir, args.vector_set)
+    except ValueError as e:
+        logger.error("%s", e)
+        sys.exit(1)
+    if not fixtures.sets:
+        logger.error("No vector sets found in %s", args.json_dir)
+        sys.exit(1)
+
+    Handler.state = State(args, fixtures)
+    server = Server((args.bind, args.port), Handler)
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(args.cert, args.key)
+    # The handshake is done by the connection's thread, not by accept()
+    server.socket = ctx.wrap_socket(server.socket, server_side=True,
+                                    do_handshake_on_connect=False)
+
+    print("Mock ACVP server on https://%s:%d/ with %d vector sets, Ctrl-C to stop" %
+          (args.bind, args.port, len(fixtures.sets)))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        Handler.state.report()
+        server.server_close()
@@ -499,6 +499,411 @@ Test(SET_SESSION_PARAMS, mark_as_sample_null_ctx, .init = setup, .fini = teardow
     cr_assert(rv == ACVP_NO_CTX);
 }
 
+/*
+ * This test sets the worker count
+ */
+Test(SET_SESSION_PARAMS, set_worker_count_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_worker_count(ctx, 4);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_worker_count(ctx, 1);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the worker count with bad params
+ */
+Test(SET_SESSION_PARAMS, set_worker_count_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_worker_count(NULL, 4);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_worker_count(ctx, 0);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    rv = acvp_set_worker_count(ctx, 33);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+static ACVP_RESULT result_cb(const char *vsid_url, const char *disposition,
+                             const char *results, const char *expected) {
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This test sets the result callback
+ */
+Test(SET_SESSION_PARAMS, set_result_callback_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_result_callback(ctx, &result_cb);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the result callback with null params
+ */
+Test(SET_SESSION_PARAMS, set_result_callback_null_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_result_callback(NULL, &result_cb);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_result_callback(ctx, NULL);
+    cr_assert(rv == ACVP_MISSING_ARG);
+}
+
+/*
+ * This test sets the result concurrency
+ */
+Test(SET_SESSION_PARAMS, set_result_concurrency_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_result_concurrency(ctx, 8);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_result_concurrency(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the result concurrency with bad params
+ */
+Test(SET_SESSION_PARAMS, set_result_concurrency_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_result_concurrency(NULL, 8);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_result_concurrency(ctx, -1);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    rv = acvp_set_result_concurrency(ctx, 33);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test sets the pipeline depth
+ */
+Test(SET_SESSION_PARAMS, set_pipeline_depth_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_pipeline_depth(ctx, 2);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_pipeline_depth(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the pipeline depth with bad params
+ */
+Test(SET_SESSION_PARAMS, set_pipeline_depth_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_pipeline_depth(NULL, 2);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_pipeline_depth(ctx, -1);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    rv = acvp_set_pipeline_depth(ctx, 17);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test sets the number of async requests
+ */
+Test(SET_SESSION_PARAMS, set_async_requests_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_async_requests(ctx, 8);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_async_requests(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the number of async requests with bad params
+ */
+Test(SET_SESSION_PARAMS, set_async_requests_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_async_requests(NULL, 8);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_async_requests(ctx, -1);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    rv = acvp_set_async_requests(ctx, 65);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test turns compression on and off
+ */
+Test(SET_SESSION_PARAMS, set_compression_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_compression(ctx, 1);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_compression(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets compression with bad params
+ */
+Test(SET_SESSION_PARAMS, set_compression_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_compression(NULL, 1);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_compression(ctx, 2);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test turns the JSON arena on and off
+ */
+Test(SET_SESSION_PARAMS, set_json_arena_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_json_arena(ctx, 1);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_json_arena(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the JSON arena with bad params
+ */
+Test(SET_SESSION_PARAMS, set_json_arena_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_json_arena(NULL, 1);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_json_arena(ctx, 2);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test turns the vector set reader on and off
+ */
+Test(SET_SESSION_PARAMS, set_vs_reader_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_vs_reader(ctx, 1);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_vs_reader(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the vector set reader with bad params
+ */
+Test(SET_SESSION_PARAMS, set_vs_reader_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_vs_reader(NULL, 1);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_vs_reader(ctx, 2);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test sets the network log preview size
+ */
+Test(SET_SESSION_PARAMS, set_net_log_preview_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_log_preview(ctx, 256);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_log_preview(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the network log preview size with bad params
+ */
+Test(SET_SESSION_PARAMS, set_net_log_preview_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_log_preview(NULL, 256);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_net_log_preview(ctx, -1);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test opens and closes the network log file
+ */
+Test(SET_SESSION_PARAMS, set_net_log_file_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_log_file(ctx, "net_log.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_log_file(ctx, NULL);
+    cr_assert(rv == ACVP_SUCCESS);
+    remove("net_log.txt");
+}
+
+/*
+ * This test sets the network log file with bad params
+ */
+Test(SET_SESSION_PARAMS, set_net_log_file_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_log_file(NULL, "net_log.txt");
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_net_log_file(ctx, "no/such/dir/net_log.txt");
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test opens and closes the network capture file
+ */
+Test(SET_SESSION_PARAMS, set_net_record_file_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_record_file(ctx, "net_capture.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_record_file(ctx, NULL);
+    cr_assert(rv == ACVP_SUCCESS);
+    remove("net_capture.txt");
+}
+
+/*
+ * This test sets the network capture file with bad params
+ */
+Test(SET_SESSION_PARAMS, set_net_record_file_bad_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_record_file(NULL, "net_capture.txt");
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_net_record_file(ctx, "no/such/dir/net_capture.txt");
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test loads and drops a capture to replay
+ */
+Test(SET_SESSION_PARAMS, set_net_replay_file_good, .init = setup, .fini = teardown) {
+    FILE *fp = fopen("net_replay.txt", "wb");
+
+    cr_assert(fp != NULL);
+    fputs(">>>> POST /acvp/v1/login 2\n{}\n<<<< 200 2\n{}\n", fp);
+    fclose(fp);
+
+    rv = acvp_set_net_replay_file(ctx, "net_replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "net_replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, NULL);
+    cr_assert(rv == ACVP_SUCCESS);
+    remove("net_replay.txt");
+}
+
+/*
+ * This test sets the capture to replay with bad params
+ */
+Test(SET_SESSION_PARAMS, set_net_replay_file_bad_params, .init = setup, .fini = teardown) {
+    FILE *fp = NULL;
+
+    rv = acvp_set_net_replay_file(NULL, "net_replay.txt");
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_net_replay_file(ctx, "no/such/dir/net_replay.txt");
+    cr_assert(rv == ACVP_INVALID_ARG);
+
+    /* Truncated body */
+    fp = fopen("net_replay.txt", "wb");
+    cr_assert(fp != NULL);
+    fputs(">>>> POST /acvp/v1/login 2\n{}\n<<<< 200 20\n{}\n", fp);
+    fclose(fp);
+    rv = acvp_set_net_replay_file(ctx, "net_replay.txt");
+    cr_assert(rv == ACVP_INVALID_ARG);
+    remove("net_replay.txt");
+}
+
+/*
+ * This test sets a good retry policy
+ */
+Test(SET_SESSION_PARAMS, set_retry_policy_good, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 4, 100, 2000, 0, 0 };
+
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_SUCCESS);
+    policy.deadline_ms = 60000;
+    policy.budget = 10;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_SUCCESS);
+    policy.max_attempts = 1;
+    policy.base_delay_ms = 0;
+    policy.max_delay_ms = 0;
+    policy.deadline_ms = 0;
+    policy.budget = 0;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the retry policy with bad params
+ */
+Test(SET_SESSION_PARAMS, set_retry_policy_bad_params, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 4, 100, 2000, 0, 0 };
+
+    rv = acvp_set_retry_policy(NULL, &policy);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_retry_policy(ctx, NULL);
+    cr_assert(rv == ACVP_MISSING_ARG);
+    policy.max_attempts = 0;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    policy.max_attempts = ACVP_RETRY_ATTEMPTS_MAX + 1;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    policy.max_attempts = 4;
+    policy.base_delay_ms = 3000;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    policy.base_delay_ms = 100;
+    policy.max_delay_ms = ACVP_RETRY_DELAY_MAX_MS + 1;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    policy.max_delay_ms = 2000;
+    policy.deadline_ms = -1;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    policy.deadline_ms = 0;
+    policy.budget = -1;
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
+/*
+ * This test reads the connection stats of a fresh session
+ */
+Test(SET_SESSION_PARAMS, get_connection_stats_good, .init = setup, .fini = teardown) {
+    unsigned int requests = 1, reused = 1;
+
+    rv = acvp_get_connection_stats(ctx, &requests, &reused);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(requests == 0);
+    cr_assert(reused == 0);
+}
+
+/*
+ * This test reads the connection stats with null params
+ */
+Test(SET_SESSION_PARAMS, get_connection_stats_null_params, .init = setup, .fini = teardown) {
+    unsigned int requests = 0, reused = 0;
+
+    rv = acvp_get_connection_stats(NULL, &requests, &reused);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_get_connection_stats(ctx, NULL, &reused);
+    cr_assert(rv == ACVP_MISSING_ARG);
+    rv = acvp_get_connection_stats(ctx, &requests, NULL);
+    cr_assert(rv == ACVP_MISSING_ARG);
+}
+
+static void timing_cb(const ACVP_NET_TIMING *timing) {
+    return;
+}
+
+/*
+ * This test sets the network timing callback
+ */
+Test(SET_SESSION_PARAMS, set_net_timing_callback_good, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_timing_callback(ctx, &timing_cb);
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * This test sets the network timing callback with null params
+ */
+Test(SET_SESSION_PARAMS, set_net_timing_callback_null_params, .init = setup, .fini = teardown) {
+    rv = acvp_set_net_timing_callback(NULL, &timing_cb);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_set_net_timing_callback(ctx, NULL);
+    cr_assert(rv == ACVP_MISSING_ARG);
+}
+
+/*
+ * This test reads the network stats of a fresh session
+ */
+Test(SET_SESSION_PARAMS, get_net_stats_good, .init = setup, .fini = teardown) {
+    ACVP_NET_STATS stats;
+
+    stats.count = 1;
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 0);
+    cr_assert(stats.total_us == 0);
+}
+
+/*
+ * This test reads the network stats with bad params
+ */
+Test(SET_SESSION_PARAMS, get_net_stats_bad_params, .init = setup, .fini = teardown) {
+    ACVP_NET_STATS stats;
+
+    rv = acvp_get_net_stats(NULL, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, NULL);
+    cr_assert(rv == ACVP_MISSING_ARG);
+    rv = acvp_get_net_stats(ctx, 0, &stats);
+    cr_assert(rv == ACVP_INVALID_ARG);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_ACTION_MAX, &stats);
+    cr_assert(rv == ACVP_INVALID_ARG);
+}
+
 /*
  * This test frees ctx
  */
@@ -621,6 +1026,16 @@ Test(CHECK_RESULTS, no_vs_list, .init = setup, .fini = teardown) {
     cr_assert(rv == ACVP_MISSING_ARG);
 }
 
+/*
+ * Check per vector set results with empty ctx
+ */
+Test(CHECK_RESULTS, concurrent_no_vs_list, .init = setup, .fini = teardown) {
+    rv = acvp_set_result_concurrency(ctx, 4);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_check_test_results(ctx);
+    cr_assert(rv == ACVP_MISSING_ARG);
+}
+
 /*
  * Process tests with full ctx - should return ACVP_MISSING_ARG for
  * now, at least until mock server is set up (because we didn't receive
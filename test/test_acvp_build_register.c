@@ -1477,7 +1477,7 @@ Test(BUILD_VENDORS, good_vendors_output, .init = setup_empty_with_vendor_and_mod
         return;
     }
 
-    cr_assert(json_value_equals((JSON_Value *)known_good_obj, (JSON_Value *)generated_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(known_good_obj), json_object_get_wrapping_value(generated_obj)));
 }
 
 /*
@@ -1501,7 +1501,7 @@ Test(BUILD_MODULES, good_modules_output, .init = setup_empty_with_vendor_and_mod
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)known_good_obj, (JSON_Value *)generated_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(known_good_obj), json_object_get_wrapping_value(generated_obj)));
 }
 
 /*
@@ -1525,7 +1525,7 @@ Test(BUILD_OES, good_oes_output, .init = setup_empty_with_vendor_and_module_info
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)known_good_obj, (JSON_Value *)generated_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(known_good_obj), json_object_get_wrapping_value(generated_obj)));
 }
 
 /*
@@ -1549,7 +1549,7 @@ Test(BUILD_DEPS, good_deps_output, .init = setup_empty_with_vendor_and_module_in
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *) known_good_obj, (JSON_Value *) generated_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(known_good_obj), json_object_get_wrapping_value(generated_obj)));
 }
 #endif
 
@@ -1593,7 +1593,7 @@ Test(BUILD_TEST_SESSION, good_aes_output, .init = setup_empty_with_vendor_and_mo
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1677,7 +1677,7 @@ Test(BUILD_TEST_SESSION, good_hash, .init = setup_empty_with_vendor_and_module_i
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1702,7 +1702,7 @@ Test(BUILD_TEST_SESSION, good_drbg, .init = setup_empty_with_vendor_and_module_i
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1740,7 +1740,7 @@ Test(BUILD_TEST_SESSION, good_cmac_output, .init = setup_empty_with_vendor_and_m
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1805,7 +1805,7 @@ Test(BUILD_TEST_SESSION, good_hmac, .init = setup_empty_with_vendor_and_module_i
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1830,7 +1830,7 @@ Test(BUILD_TEST_SESSION, good_dsa, .init = setup_empty_with_vendor_and_module_in
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1936,7 +1936,7 @@ Test(BUILD_TEST_SESSION, good_des_output, .init = setup_empty_with_vendor_and_mo
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1961,7 +1961,7 @@ Test(BUILD_TEST_SESSION, good_rsa, .init = setup_empty_with_vendor_and_module_in
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -1999,7 +1999,7 @@ Test(BUILD_TEST_SESSION, good_ecdsa, .init = setup_empty_with_vendor_and_module_
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -2037,7 +2037,7 @@ Test(BUILD_TEST_SESSION, good_kdf, .init = setup_empty_with_vendor_and_module_in
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -2148,7 +2148,7 @@ Test(BUILD_TEST_SESSION, good_kas_ecc, .init = setup_empty_with_vendor_and_modul
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
@@ -2186,7 +2186,7 @@ Test(BUILD_TEST_SESSION, good_kas_ffc, .init = setup_empty_with_vendor_and_modul
         return;
     }
     
-    cr_assert(json_value_equals((JSON_Value *)generated_obj, (JSON_Value *)known_good_obj) == JSONSuccess);
+    cr_assert(json_value_equals(json_object_get_wrapping_value(generated_obj), json_object_get_wrapping_value(known_good_obj)));
 }
 
 /*
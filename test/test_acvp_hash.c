@@ -142,6 +142,50 @@ Test(HASH_HANDLER, good, .init = setup, .fini = teardown) {
     json_value_free(val);
 }
 
+/*
+ * This is a good JSON with the test groups left as text,
+ * the way acvp_set_vs_reader() hands them to the handler.
+ * Expecting success.
+ */
+Test(HASH_HANDLER, good_vs_reader, .init = setup, .fini = teardown) {
+    char *groups = NULL;
+
+    val = json_parse_file("json/hash/hash.json");
+
+    obj = ut_get_obj_from_rsp(val);
+    if (!obj) {
+        ACVP_LOG_ERR("JSON obj parse error");
+        return;
+    }
+    groups = json_serialize_to_string(json_object_get_value(obj, "testGroups"), NULL);
+    cr_assert(groups != NULL);
+    json_object_set_string(obj, "testGroups", groups);
+    json_free_serialized_string(groups);
+
+    rv = acvp_hash_kat_handler(ctx, obj);
+    cr_assert(rv == ACVP_SUCCESS);
+    json_value_free(val);
+}
+
+/*
+ * The test groups left as text are cut short.
+ */
+Test(HASH_HANDLER, truncated_vs_reader, .init = setup, .fini = teardown) {
+    val = json_parse_file("json/hash/hash.json");
+
+    obj = ut_get_obj_from_rsp(val);
+    if (!obj) {
+        ACVP_LOG_ERR("JSON obj parse error");
+        return;
+    }
+    json_object_set_string(obj, "testGroups",
+                           "[{\"tgId\": 1, \"testType\": \"AFT\", \"tests\": [{\"tcId\": 1, \"msg\": \"00\"}");
+
+    rv = acvp_hash_kat_handler(ctx, obj);
+    cr_assert(rv == ACVP_MALFORMED_JSON);
+    json_value_free(val);
+}
+
 
 /*
  * The value for key:"algorithm" is wrong.
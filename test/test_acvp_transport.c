@@ -11,6 +11,7 @@
 
 #include "ut_common.h"
 #include "acvp_lcl.h"
+#include <zlib.h>
 
 char *vsid_url = "/acvp/v1/testSessions/0/vectorSets/0";
 ACVP_CTX *ctx = NULL;
@@ -105,7 +106,6 @@ static void add_hash_details_good(void) {
     cr_assert(rv == ACVP_SUCCESS);
 }
 
-#ifdef TEST_TRANSPORT
 static void setup(void) {
     setup_empty_ctx(&ctx);
 }
@@ -115,6 +115,7 @@ static void teardown(void) {
     ctx = NULL;
 }
 
+#ifdef TEST_TRANSPORT
 /*
  * ctx has not set server and port
  */
@@ -491,3 +492,419 @@ Test(TRANSPORT_SEND_OE_REG, good, .init = setup, .fini = teardown) {
 #endif
 
 #endif
+
+/*
+ * Writes a capture with a login and one vector set, the vector set
+ * taking a failed attempt before it is served.
+ */
+static void write_capture(const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+
+    cr_assert(fp != NULL);
+    fprintf(fp, ">>>> POST /acvp/v1/login %d\n%s\n", (int)strlen(login_reg), login_reg);
+    fputs("<<<< 200 26\n{\"accessToken\": \"aaa.bbb\"}\n", fp);
+    fprintf(fp, ">>>> GET %s 0\n\n<<<< 503 0\n\n", vsid_url);
+    fprintf(fp, ">>>> GET %s 0\n\n<<<< 200 13\n{\"vsId\": 123}\n", vsid_url);
+    fclose(fp);
+}
+
+/*
+ * The responses come from the capture, no server is involved
+ */
+Test(TRANSPORT_REPLAY, good, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 2, 1000, 1000, 0, 0 };
+
+    write_capture("replay.txt");
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_path_segment(ctx, "/acvp/v1/");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    rv = acvp_send_login(ctx, login_reg, strlen(login_reg));
+    cr_assert(rv == ACVP_SUCCESS);
+    /* The 503 is retried right away */
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+    remove("replay.txt");
+}
+
+/*
+ * Every response of the capture is served once
+ */
+Test(TRANSPORT_REPLAY, exhausted, .init = setup, .fini = teardown) {
+    write_capture("replay.txt");
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_TRANSPORT_FAIL);
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_TRANSPORT_FAIL);
+    remove("replay.txt");
+}
+
+static int timing_calls;
+static long timing_codes[4];
+
+static void timing_cb(const ACVP_NET_TIMING *timing) {
+    if (timing_calls < 4) timing_codes[timing_calls] = timing->http_code;
+    timing_calls++;
+}
+
+/*
+ * Every replayed request reaches the timing callback and the stats
+ */
+Test(TRANSPORT_REPLAY, timing, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 2, 1000, 1000, 0, 0 };
+    ACVP_NET_STATS stats;
+
+    write_capture("replay.txt");
+    timing_calls = 0;
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_path_segment(ctx, "/acvp/v1/");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_retry_policy(ctx, &policy);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_timing_callback(ctx, &timing_cb);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    rv = acvp_send_login(ctx, login_reg, strlen(login_reg));
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+
+    cr_assert(timing_calls == 3);
+    cr_assert(timing_codes[0] == 200);
+    cr_assert(timing_codes[1] == 503);
+    cr_assert(timing_codes[2] == 200);
+
+    rv = acvp_get_net_stats(ctx, ACVP_NET_POST_LOGIN, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 1);
+    cr_assert(stats.bytes_up == (long long)strlen(login_reg));
+    cr_assert(stats.bytes_down == 26);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 2);
+    cr_assert(stats.failed == 0);
+    cr_assert(stats.bytes_down == 13);
+    remove("replay.txt");
+}
+
+/*
+ * Writes a capture answering the vector set with each of the
+ * statuses in turn.
+ */
+static void write_vs_capture(const char *filename, const int *codes, int count) {
+    FILE *fp = fopen(filename, "wb");
+    int i;
+
+    cr_assert(fp != NULL);
+    for (i = 0; i < count; i++) {
+        if (codes[i] == 200) {
+            fprintf(fp, ">>>> GET %s 0\n\n<<<< 200 13\n{\"vsId\": 123}\n", vsid_url);
+        } else {
+            fprintf(fp, ">>>> GET %s 0\n\n<<<< %d 0\n\n", vsid_url, codes[i]);
+        }
+    }
+    fclose(fp);
+}
+
+static void setup_replay(const ACVP_RETRY_POLICY *policy) {
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_retry_policy(ctx, policy);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+}
+
+/*
+ * Each retry is counted, and a request gives up after max_attempts
+ */
+Test(TRANSPORT_REPLAY, retry_count, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 3, 1000, 1000, 0, 0 };
+    int codes[] = { 503, 429, 200, 500, 502, 503, 200 };
+    ACVP_NET_STATS stats;
+
+    write_vs_capture("replay.txt", codes, 7);
+    setup_replay(&policy);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 3);
+    cr_assert(stats.retries == 2);
+
+    /* Three failures use up the attempts */
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_TRANSPORT_FAIL);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 6);
+    cr_assert(stats.retries == 4);
+    remove("replay.txt");
+}
+
+/*
+ * Errors that won't go away are not retried
+ */
+Test(TRANSPORT_REPLAY, no_retry, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 3, 1000, 1000, 0, 0 };
+    int codes[] = { 400, 200 };
+    ACVP_NET_STATS stats;
+
+    write_vs_capture("replay.txt", codes, 2);
+    setup_replay(&policy);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv != ACVP_SUCCESS);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 1);
+    cr_assert(stats.retries == 0);
+    remove("replay.txt");
+}
+
+/*
+ * Once the session budget is spent, failures are no longer retried
+ */
+Test(TRANSPORT_REPLAY, budget_exhausted, .init = setup, .fini = teardown) {
+    ACVP_RETRY_POLICY policy = { 3, 1000, 1000, 0, 2 };
+    int codes[] = { 503, 200, 503, 503, 200 };
+    ACVP_NET_STATS stats;
+
+    write_vs_capture("replay.txt", codes, 5);
+    setup_replay(&policy);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+    /* One retry left in the budget, the second failure is final */
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_TRANSPORT_FAIL);
+    rv = acvp_get_net_stats(ctx, ACVP_NET_GET_VS, &stats);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(stats.count == 4);
+    cr_assert(stats.retries == 2);
+    remove("replay.txt");
+}
+
+/*
+ * With compression on, a vector set response is uploaded as gzip
+ * of the same JSON text
+ */
+Test(TRANSPORT_UPLOAD, compressed, .init = setup, .fini = teardown) {
+    JSON_Value *val = NULL;
+    z_stream zs;
+    char *body = NULL, *text = NULL, *plain = NULL;
+    int body_len = 0, text_len = 0;
+
+    val = json_parse_file("json/hash/hash.json");
+    cr_assert(val != NULL);
+    text = json_serialize_to_string(val, &text_len);
+    cr_assert(text != NULL);
+
+    rv = acvp_set_compression(ctx, 1);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_transport_upload_body(ctx, val, &body, &body_len);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(body_len > 2 && body_len < text_len);
+    cr_assert((unsigned char)body[0] == 0x1f && (unsigned char)body[1] == 0x8b);
+
+    plain = calloc(text_len + 1, sizeof(char));
+    cr_assert(plain != NULL);
+    memset(&zs, 0, sizeof(zs));
+    cr_assert(inflateInit2(&zs, 15 + 16) == Z_OK);
+    zs.next_in = (Bytef *)body;
+    zs.avail_in = (uInt)body_len;
+    zs.next_out = (Bytef *)plain;
+    zs.avail_out = (uInt)text_len + 1;
+    cr_assert(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    cr_assert(zs.total_out == (uLong)text_len);
+    cr_assert(zs.total_in == (uLong)body_len);
+    inflateEnd(&zs);
+    cr_assert(!memcmp(plain, text, text_len));
+
+    free(plain);
+    free(body);
+    json_free_serialized_string(text);
+    json_value_free(val);
+}
+
+/*
+ * Without compression, a vector set response is uploaded as the
+ * exact text json_serialize_to_string() gives
+ */
+Test(TRANSPORT_UPLOAD, plain, .init = setup, .fini = teardown) {
+    char *files[] = { "json/hash/hash.json", "json/aes/aes.json", "json/drbg/drbg.json" };
+    JSON_Value *val = NULL;
+    char *body = NULL, *text = NULL;
+    int body_len = 0, text_len = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        val = json_parse_file(files[i]);
+        cr_assert(val != NULL);
+        text = json_serialize_to_string(val, &text_len);
+        cr_assert(text != NULL);
+
+        rv = acvp_transport_upload_body(ctx, val, &body, &body_len);
+        cr_assert(rv == ACVP_SUCCESS);
+        cr_assert(body_len == text_len);
+        cr_assert(!memcmp(body, text, text_len));
+
+        free(body);
+        json_free_serialized_string(text);
+        json_value_free(val);
+    }
+}
+
+/*
+ * Missing arguments
+ */
+Test(TRANSPORT_UPLOAD, missing_args, .init = setup, .fini = teardown) {
+    JSON_Value *val = json_value_init_object();
+    char *body = NULL;
+    int body_len = 0;
+
+    rv = acvp_transport_upload_body(NULL, val, &body, &body_len);
+    cr_assert(rv == ACVP_NO_CTX);
+    rv = acvp_transport_upload_body(ctx, NULL, &body, &body_len);
+    cr_assert(rv == ACVP_MISSING_ARG);
+    rv = acvp_transport_upload_body(ctx, val, NULL, &body_len);
+    cr_assert(rv == ACVP_MISSING_ARG);
+    json_value_free(val);
+}
+
+/*
+ * An expired jwt is refreshed, and the request is resent with
+ * headers carrying the new one
+ */
+Test(TRANSPORT_REPLAY, auth_rebuilt, .init = setup, .fini = teardown) {
+    const char *hdr = NULL, *old_hdr = NULL;
+    const char *expired = "{\"error\": \"JWT expired\"}";
+    const char *login = "[{\"acvVersion\": \"1.0\"}, {\"accessToken\": \"ccc.ddd\"}]";
+    FILE *fp = NULL;
+
+    fp = fopen("replay.txt", "wb");
+    cr_assert(fp != NULL);
+    fprintf(fp, ">>>> GET %s 0\n\n<<<< 401 %d\n%s\n", vsid_url, (int)strlen(expired), expired);
+    fprintf(fp, ">>>> POST /acvp/v1/login 0\n\n<<<< 200 %d\n%s\n", (int)strlen(login), login);
+    fprintf(fp, ">>>> GET %s 0\n\n<<<< 200 13\n{\"vsId\": 123}\n", vsid_url);
+    fclose(fp);
+
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_path_segment(ctx, "/acvp/v1/");
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    /* No jwt, no Authorization */
+    cr_assert(acvp_transport_auth_hdr(ctx) == NULL);
+
+    ctx->jwt_token = calloc(ACVP_JWT_TOKEN_MAX + 1, sizeof(char));
+    cr_assert(ctx->jwt_token != NULL);
+    strcpy_s(ctx->jwt_token, ACVP_JWT_TOKEN_MAX + 1, "aaa.bbb");
+    acvp_transport_reset_auth(ctx);
+    old_hdr = acvp_transport_auth_hdr(ctx);
+    cr_assert(old_hdr != NULL);
+    cr_assert(!strcmp(old_hdr, "Authorization: Bearer aaa.bbb"));
+    /* Built once per jwt */
+    cr_assert(acvp_transport_auth_hdr(ctx) == old_hdr);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_SUCCESS);
+
+    hdr = acvp_transport_auth_hdr(ctx);
+    cr_assert(hdr != NULL && hdr != old_hdr);
+    cr_assert(!strcmp(hdr, "Authorization: Bearer ccc.ddd"));
+    /* The stale headers stay valid until the transport is closed */
+    cr_assert(!strcmp(old_hdr, "Authorization: Bearer aaa.bbb"));
+    remove("replay.txt");
+}
+
+/*
+ * Writes a capture where the vector set arrives in full but the
+ * transfer fails after it
+ */
+static void write_broken_capture(const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+
+    cr_assert(fp != NULL);
+    fprintf(fp, ">>>> GET %s 0\n\n<<<< 0 13\n{\"vsId\": 123}\n", vsid_url);
+    fclose(fp);
+}
+
+/*
+ * A vector set whose transfer failed is not left behind for the
+ * next download
+ */
+Test(TRANSPORT_REPLAY, stream_then_fail, .init = setup, .fini = teardown) {
+    write_broken_capture("replay.txt");
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    rv = acvp_retrieve_vector_set(ctx, vsid_url);
+    cr_assert(rv == ACVP_TRANSPORT_FAIL);
+    cr_assert(ctx->rcv_val == NULL);
+    remove("replay.txt");
+}
+
+static JSON_Arena *cb_arena;
+static int cb_calls;
+static int cb_saw_val;
+static ACVP_RESULT cb_rv;
+
+static void broken_cb(ACVP_CTX *cb_ctx, ACVP_RESULT cb_result, const char *body, int body_len, void *arg) {
+    cb_calls++;
+    cb_rv = cb_result;
+    cb_saw_val = cb_ctx->rcv_val != NULL;
+    /* Like a vector set that is given up, its arena goes */
+    json_arena_free(cb_arena);
+    cb_arena = NULL;
+}
+
+/*
+ * The callback of a failed asynchronous download can free the arena
+ * the body was parsed into
+ */
+Test(TRANSPORT_REPLAY, async_stream_then_fail, .init = setup, .fini = teardown) {
+    JSON_Arena *prev = NULL;
+
+    write_broken_capture("replay.txt");
+    rv = acvp_set_server(ctx, "no.such.server", 443);
+    cr_assert(rv == ACVP_SUCCESS);
+    rv = acvp_set_net_replay_file(ctx, "replay.txt");
+    cr_assert(rv == ACVP_SUCCESS);
+
+    cb_calls = 0;
+    cb_arena = json_arena_new(0);
+    cr_assert(cb_arena != NULL);
+    prev = json_arena_set(cb_arena);
+    rv = acvp_async_retrieve_vector_set(ctx, vsid_url, &broken_cb, NULL);
+    json_arena_set(prev);
+    cr_assert(rv == ACVP_SUCCESS);
+
+    rv = acvp_async_run(ctx, 0);
+    cr_assert(rv == ACVP_SUCCESS);
+    cr_assert(cb_calls == 1);
+    cr_assert(cb_rv == ACVP_TRANSPORT_FAIL);
+    cr_assert(!cb_saw_val);
+    cr_assert(ctx->rcv_val == NULL);
+    remove("replay.txt");
+}
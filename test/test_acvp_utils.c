@@ -33,4 +33,58 @@ Test(LookupCipherIndex, null_param) {
 Test(LookupRSARandPQIndex, null_param) {
     int rv = acvp_lookup_rsa_randpq_index(NULL);
     cr_assert(!rv);
-}
\ No newline at end of file
+}
+Test(JitterMs, range) {
+    long long jitter = 0;
+    int i;
+
+    cr_assert(acvp_jitter_ms(0) == 0);
+    cr_assert(acvp_jitter_ms(-5) == 0);
+    for (i = 0; i < 1000; i++) {
+        jitter = acvp_jitter_ms(250);
+        cr_assert(jitter >= 0 && jitter <= 250);
+    }
+}
+
+static int log_calls;
+static char log_last[1024 * 2];
+
+static ACVP_RESULT log_capture(char *msg) {
+    log_calls++;
+    strcpy_s(log_last, sizeof(log_last), msg);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * The title and the value go out as one message through the
+ * callback, at INFO and VERBOSE alike
+ */
+Test(LogJsonMsg, one_message) {
+    ACVP_LOG_LVL levels[] = { ACVP_LOG_LVL_INFO, ACVP_LOG_LVL_VERBOSE };
+    JSON_Value *val = json_parse_string("{\"tcId\": 7}");
+    ACVP_RESULT rv;
+    size_t i;
+
+    cr_assert(val != NULL);
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        rv = acvp_create_test_session(&ctx, &log_capture, levels[i]);
+        cr_assert(rv == ACVP_SUCCESS);
+        log_calls = 0;
+        acvp_log_json_msg(ctx, "handler", 42, val, "json testval count: %d", 3);
+        cr_assert(log_calls == 1);
+        cr_assert(strstr(log_last, "[INFO][handler:42]--> json testval count: 3\n {") != NULL);
+        cr_assert(strstr(log_last, "\"tcId\": 7") != NULL);
+        acvp_free_test_session(ctx);
+        ctx = NULL;
+    }
+
+    /* Dropped below INFO */
+    rv = acvp_create_test_session(&ctx, &log_capture, ACVP_LOG_LVL_STATUS);
+    cr_assert(rv == ACVP_SUCCESS);
+    log_calls = 0;
+    acvp_log_json_msg(ctx, "handler", 42, val, "json testval count: %d", 3);
+    cr_assert(log_calls == 0);
+    acvp_free_test_session(ctx);
+    ctx = NULL;
+    json_value_free(val);
+}
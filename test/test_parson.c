@@ -0,0 +1,652 @@
+/** @file */
+/*
+ * Copyright (c) 2019, Cisco Systems, Inc.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://github.com/cisco/libacvp/LICENSE
+ */
+
+
+#include "ut_common.h"
+
+static char *doc = "[{\"acvVersion\": \"1.0\"}, {\"vsId\": 42, \"algorithm\": \"SHA2-256\","
+                   " \"escaped\": \"tab\\t quote\\\" slash\\/ \\u00e9\\ud83d\\ude00\","
+                   " \"numbers\": [0, -1, 3.25, 1e3, -2.5E-2], \"flags\": [true, false, null],"
+                   " \"empty\": {}, \"none\": [], \"testGroups\": [{\"tgId\": 1, \"tests\":"
+                   " [{\"tcId\": 1, \"msg\": \"\"}, {\"tcId\": 2, \"msg\": \"EC\"}]}]}]";
+
+static char *files[] = {
+    "json/hash/hash.json",
+    "json/aes/aes.json",
+    "json/drbg/drbg.json"
+};
+
+/*
+ * Reads a whole file into a string
+ */
+static char *read_file(const char *filename) {
+    FILE *fp = NULL;
+    char *text = NULL;
+    long len = 0;
+
+    fp = fopen(filename, "rb");
+    cr_assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    text = calloc(len + 1, sizeof(char));
+    cr_assert(text != NULL);
+    cr_assert(fread(text, 1, len, fp) == (size_t)len);
+    fclose(fp);
+    return text;
+}
+
+/*
+ * Feeds len bytes of text to a stream parser in chunks of at most
+ * chunk_max bytes, random sizes when random is set.
+ */
+static JSON_Value *stream_parse(const char *text, size_t len, size_t chunk_max, int random) {
+    JSON_Stream_Parser *parser = NULL;
+    size_t pos = 0, n = 0;
+
+    parser = json_stream_parser_new();
+    cr_assert(parser != NULL);
+    while (pos < len) {
+        n = random ? (size_t)rand() % chunk_max + 1 : chunk_max;
+        if (n > len - pos) n = len - pos;
+        if (json_stream_parser_feed(parser, text + pos, n) != JSONSuccess) break;
+        pos += n;
+    }
+    return json_stream_parser_finish(parser);
+}
+
+static void check_same(const char *text, size_t chunk_max, int random) {
+    JSON_Value *expected = NULL, *val = NULL;
+
+    expected = json_parse_string(text);
+    cr_assert(expected != NULL);
+    val = stream_parse(text, strlen(text), chunk_max, random);
+    cr_assert(val != NULL);
+    cr_assert(json_value_equals(expected, val));
+    json_value_free(val);
+    json_value_free(expected);
+}
+
+/*
+ * Fed one byte at a time, the result matches json_parse_string()
+ */
+Test(STREAM_PARSER, one_byte_chunks) {
+    char *text = NULL;
+    size_t i;
+
+    check_same(doc, 1, 0);
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        text = read_file(files[i]);
+        check_same(text, 1, 0);
+        free(text);
+    }
+}
+
+/*
+ * Fed in chunks of random sizes, the result matches json_parse_string()
+ */
+Test(STREAM_PARSER, random_chunks) {
+    char *text = NULL;
+    size_t i;
+    int seed;
+
+    for (seed = 1; seed <= 20; seed++) {
+        srand(seed);
+        check_same(doc, 64, 1);
+        for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+            text = read_file(files[i]);
+            check_same(text, 4096, 1);
+            free(text);
+        }
+    }
+}
+
+/*
+ * A top level number only ends with the input
+ */
+Test(STREAM_PARSER, scalar) {
+    JSON_Value *val = NULL;
+
+    val = stream_parse("12345", 5, 1, 0);
+    cr_assert(val != NULL);
+    cr_assert(json_value_get_number(val) == 12345);
+    json_value_free(val);
+
+    val = stream_parse("\"abc\"", 5, 1, 0);
+    cr_assert(val != NULL);
+    cr_assert(!strcmp(json_value_get_string(val), "abc"));
+    json_value_free(val);
+}
+
+/*
+ * Every proper prefix of the document is incomplete
+ */
+Test(STREAM_PARSER, truncated) {
+    JSON_Value *val = NULL;
+    size_t len = strlen(doc), cut;
+
+    for (cut = 0; cut < len; cut++) {
+        val = stream_parse(doc, cut, 7, 0);
+        cr_assert(val == NULL);
+    }
+}
+
+/*
+ * Input that can't be JSON fails
+ */
+Test(STREAM_PARSER, invalid) {
+    char *bad[] = {
+        "[1,,2]",
+        "[1 2]",
+        "{\"a\" 1}",
+        "{\"a\": tru}",
+        "{1: 2}",
+        "[\"unterminated]",
+        "]",
+        "[-]",
+        "{\"a\": 1,}"
+    };
+    JSON_Value *val = NULL;
+    size_t i;
+
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        cr_assert(json_parse_string(bad[i]) == NULL);
+        val = stream_parse(bad[i], strlen(bad[i]), 1, 0);
+        cr_assert(val == NULL);
+        val = stream_parse(bad[i], strlen(bad[i]), strlen(bad[i]), 0);
+        cr_assert(val == NULL);
+    }
+}
+
+/*
+ * Feeding stops at the first byte that can't be JSON
+ */
+Test(STREAM_PARSER, feed_fails) {
+    JSON_Stream_Parser *parser = NULL;
+
+    parser = json_stream_parser_new();
+    cr_assert(parser != NULL);
+    cr_assert(json_stream_parser_feed(parser, "[1, ", 4) == JSONSuccess);
+    cr_assert(json_stream_parser_feed(parser, "}", 1) == JSONFailure);
+    cr_assert(json_stream_parser_feed(parser, "2]", 2) == JSONFailure);
+    cr_assert(json_stream_parser_finish(parser) == NULL);
+}
+
+/*
+ * Finishing an incomplete document gives no value
+ */
+Test(STREAM_PARSER, finish_incomplete) {
+    JSON_Stream_Parser *parser = NULL;
+
+    parser = json_stream_parser_new();
+    cr_assert(parser != NULL);
+    cr_assert(json_stream_parser_finish(parser) == NULL);
+
+    parser = json_stream_parser_new();
+    cr_assert(parser != NULL);
+    cr_assert(json_stream_parser_feed(parser, "{\"a\": [1, 2", 11) == JSONSuccess);
+    cr_assert(json_stream_parser_finish(parser) == NULL);
+
+    parser = json_stream_parser_new();
+    cr_assert(parser != NULL);
+    cr_assert(json_stream_parser_feed(parser, "{\"a\": \"b", 8) == JSONSuccess);
+    cr_assert(json_stream_parser_finish(parser) == NULL);
+}
+
+/*
+ * NULL parser
+ */
+Test(STREAM_PARSER, null_parser) {
+    cr_assert(json_stream_parser_feed(NULL, "[]", 2) == JSONFailure);
+    cr_assert(json_stream_parser_finish(NULL) == NULL);
+    json_stream_parser_free(NULL);
+}
+
+/*
+ * Reads a stream writer dry, len bytes at a time
+ */
+static char *stream_write(const JSON_Value *val, int len, int *total) {
+    JSON_Stream_Writer *writer = NULL;
+    char *text = NULL;
+    int max = 1024, n = 0;
+
+    writer = json_stream_writer_new(val);
+    cr_assert(writer != NULL);
+    text = malloc(max);
+    cr_assert(text != NULL);
+    *total = 0;
+    do {
+        while (*total + len > max) {
+            max *= 2;
+            text = realloc(text, max);
+            cr_assert(text != NULL);
+        }
+        n = json_stream_writer_read(writer, text + *total, len);
+        cr_assert(n >= 0 && n <= len);
+        *total += n;
+    } while (n > 0);
+    json_stream_writer_free(writer);
+    return text;
+}
+
+/*
+ * Read in pieces of any size, the writer gives the text of
+ * json_serialize_to_string()
+ */
+Test(STREAM_WRITER, same_text) {
+    int lens[] = { 1, 2, 7, 64, 1000, 65536 };
+    JSON_Value *val = NULL;
+    char *expected = NULL, *text = NULL;
+    int expected_len = 0, text_len = 0;
+    size_t i, j;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]) + 1; i++) {
+        val = i ? json_parse_file(files[i - 1]) : json_parse_string(doc);
+        cr_assert(val != NULL);
+        expected = json_serialize_to_string(val, &expected_len);
+        cr_assert(expected != NULL);
+        for (j = 0; j < sizeof(lens) / sizeof(lens[0]); j++) {
+            text = stream_write(val, lens[j], &text_len);
+            cr_assert(text_len == expected_len);
+            cr_assert(!memcmp(text, expected, expected_len));
+            free(text);
+        }
+        json_free_serialized_string(expected);
+        json_value_free(val);
+    }
+}
+
+/*
+ * NULL value and writer
+ */
+Test(STREAM_WRITER, null_args) {
+    char buf[8];
+
+    cr_assert(json_stream_writer_new(NULL) == NULL);
+    cr_assert(json_stream_writer_read(NULL, buf, sizeof(buf)) < 0);
+    json_stream_writer_free(NULL);
+}
+
+/*
+ * A document parsed into an arena is the same as one parsed on the
+ * heap, and json_value_free() leaves it alone
+ */
+Test(JSON_ARENA, parse_free) {
+    JSON_Arena *arena = NULL, *prev = NULL;
+    JSON_Value *expected = NULL, *val = NULL;
+    size_t i;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        expected = json_parse_file(files[i]);
+        cr_assert(expected != NULL);
+
+        arena = json_arena_new(0);
+        cr_assert(arena != NULL);
+        prev = json_arena_set(arena);
+        cr_assert(prev == NULL);
+        cr_assert(json_arena_get() == arena);
+        val = json_parse_file(files[i]);
+        json_arena_set(prev);
+        cr_assert(json_arena_get() == NULL);
+
+        cr_assert(val != NULL);
+        cr_assert(json_arena_used(arena) > 0);
+        cr_assert(json_value_equals(expected, val));
+
+        /* A no-op, the arena still holds the value */
+        json_value_free(val);
+        cr_assert(json_value_equals(expected, val));
+
+        json_arena_free(arena);
+        json_value_free(expected);
+    }
+}
+
+/*
+ * Blocks smaller than the values they hold
+ */
+Test(JSON_ARENA, small_blocks) {
+    JSON_Arena *arena = NULL;
+    JSON_Value *expected = NULL, *val = NULL;
+    char *text = NULL;
+
+    text = read_file("json/hash/hash.json");
+    expected = json_parse_string(text);
+    cr_assert(expected != NULL);
+
+    arena = json_arena_new(64);
+    cr_assert(arena != NULL);
+    json_arena_set(arena);
+    val = json_parse_string(text);
+    json_arena_set(NULL);
+    cr_assert(val != NULL);
+    cr_assert(json_value_equals(expected, val));
+
+    json_arena_free(arena);
+    json_value_free(expected);
+    free(text);
+}
+
+/*
+ * Streamed input, and values built one by one, go in the arena too
+ */
+Test(JSON_ARENA, stream_and_build) {
+    JSON_Arena *arena = NULL;
+    JSON_Value *expected = NULL, *val = NULL, *obj_val = NULL;
+    JSON_Object *obj = NULL;
+    char name[16];
+    size_t used = 0;
+    int i;
+
+    expected = json_parse_string(doc);
+    cr_assert(expected != NULL);
+
+    arena = json_arena_new(0);
+    cr_assert(arena != NULL);
+    json_arena_set(arena);
+    val = stream_parse(doc, strlen(doc), 5, 0);
+    cr_assert(val != NULL);
+    cr_assert(json_value_equals(expected, val));
+
+    obj_val = json_value_init_object();
+    cr_assert(obj_val != NULL);
+    used = json_arena_used(arena);
+    json_arena_set(NULL);
+
+    /* The object keeps growing in its own arena */
+    obj = json_value_get_object(obj_val);
+    for (i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "n%d", i);
+        cr_assert(json_object_set_string(obj, name, "value") == JSONSuccess);
+    }
+    cr_assert(json_arena_used(arena) > used);
+    cr_assert(json_object_get_count(obj) == 100);
+    json_value_free(obj_val);
+    cr_assert(!strcmp(json_object_get_string(obj, "n99"), "value"));
+
+    json_arena_free(arena);
+    json_value_free(expected);
+}
+
+/*
+ * Freeing the current arena makes the heap current again
+ */
+Test(JSON_ARENA, free_current) {
+    JSON_Arena *arena = NULL;
+    JSON_Value *val = NULL;
+
+    arena = json_arena_new(0);
+    cr_assert(arena != NULL);
+    json_arena_set(arena);
+    cr_assert(json_parse_string("[1, 2, 3]") != NULL);
+    json_arena_free(arena);
+    cr_assert(json_arena_get() == NULL);
+
+    /* On the heap, freed as usual */
+    val = json_parse_string("[1, 2, 3]");
+    cr_assert(val != NULL);
+    json_value_free(val);
+
+    cr_assert(json_arena_used(NULL) == 0);
+    json_arena_free(NULL);
+}
+
+#define KEY_NAMES 20
+
+static char key_names[KEY_NAMES][16];
+
+/*
+ * Checks every lookup by key against the lookup by name, present[i]
+ * telling whether name i is expected in obj
+ */
+static void check_keys(const JSON_Object *obj, const int *present) {
+    JSON_Key key;
+    int i;
+
+    for (i = 0; i < KEY_NAMES; i++) {
+        key = json_key(key_names[i]);
+        cr_assert(json_object_get_value_key(obj, &key) == json_object_get_value(obj, key_names[i]));
+        if (present[i]) {
+            cr_assert(json_object_get_value_key(obj, &key) != NULL);
+            cr_assert(json_object_get_number_key(obj, &key) == i);
+        } else {
+            cr_assert(json_object_get_value_key(obj, &key) == NULL);
+        }
+    }
+}
+
+/*
+ * Lookups by key find the same values as by name, below and above
+ * the size where objects get a hash index, as names come and go
+ */
+Test(JSON_KEY, set_get_remove) {
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    int present[KEY_NAMES] = { 0 };
+    int i;
+
+    for (i = 0; i < KEY_NAMES; i++) {
+        snprintf(key_names[i], sizeof(key_names[i]), "name%d", i);
+    }
+    val = json_value_init_object();
+    obj = json_value_get_object(val);
+
+    for (i = 0; i < KEY_NAMES; i++) {
+        cr_assert(json_object_set_number(obj, key_names[i], i) == JSONSuccess);
+        present[i] = 1;
+        check_keys(obj, present);
+    }
+
+    /* Replacing a value keeps the name where it is */
+    cr_assert(json_object_set_number(obj, key_names[3], 3) == JSONSuccess);
+    cr_assert(json_object_get_count(obj) == KEY_NAMES);
+    check_keys(obj, present);
+
+    /* Removals move names around, down to no index at all */
+    for (i = 0; i < KEY_NAMES; i += 2) {
+        cr_assert(json_object_remove(obj, key_names[i]) == JSONSuccess);
+        present[i] = 0;
+        check_keys(obj, present);
+    }
+    cr_assert(json_object_remove(obj, key_names[0]) == JSONFailure);
+    for (i = 1; i < KEY_NAMES - 4; i += 2) {
+        cr_assert(json_object_remove(obj, key_names[i]) == JSONSuccess);
+        present[i] = 0;
+        check_keys(obj, present);
+    }
+    cr_assert(json_object_get_count(obj) == 2);
+
+    /* And back above the threshold */
+    for (i = 0; i < KEY_NAMES; i += 2) {
+        cr_assert(json_object_set_number(obj, key_names[i], i) == JSONSuccess);
+        present[i] = 1;
+        check_keys(obj, present);
+    }
+    json_value_free(val);
+}
+
+/*
+ * The typed lookups of a parsed object with many names
+ */
+Test(JSON_KEY, typed) {
+    JSON_Value *val = NULL;
+    JSON_Object *obj = NULL;
+    JSON_Key k_str = json_key("str"), k_obj = json_key("obj"), k_arr = json_key("arr");
+    JSON_Key k_num = json_key("num"), k_bool = json_key("bool"), k_none = json_key("none");
+    JSON_Key k_empty = json_key("");
+
+    val = json_parse_string("{\"a\": 1, \"b\": 2, \"c\": 3, \"d\": 4, \"e\": 5, \"f\": 6,"
+                            " \"str\": \"text\", \"obj\": {}, \"arr\": [], \"num\": 2.5,"
+                            " \"bool\": true, \"\": 0}");
+    cr_assert(val != NULL);
+    obj = json_value_get_object(val);
+    cr_assert(json_object_get_count(obj) > 8);
+
+    cr_assert(!strcmp(json_object_get_string_key(obj, &k_str), "text"));
+    cr_assert(json_object_get_object_key(obj, &k_obj) != NULL);
+    cr_assert(json_object_get_array_key(obj, &k_arr) != NULL);
+    cr_assert(json_object_get_number_key(obj, &k_num) == 2.5);
+    cr_assert(json_object_get_boolean_key(obj, &k_bool) == 1);
+    cr_assert(json_object_get_value_key(obj, &k_empty) != NULL);
+
+    /* Wrong type or missing */
+    cr_assert(json_object_get_string_key(obj, &k_num) == NULL);
+    cr_assert(json_object_get_object_key(obj, &k_arr) == NULL);
+    cr_assert(json_object_get_number_key(obj, &k_none) == 0);
+    cr_assert(json_object_get_boolean_key(obj, &k_none) == -1);
+    cr_assert(json_object_get_value_key(NULL, &k_str) == NULL);
+    cr_assert(json_object_get_value_key(obj, NULL) == NULL);
+    json_value_free(val);
+}
+
+typedef struct sink_buf_t {
+    char *text;
+    size_t len;
+    size_t max;
+    size_t limit;   /* fail once this many bytes were taken, 0 for none */
+    int calls_after_stop;
+    int stopped;
+} SINK_BUF;
+
+static JSON_Status buf_sink(void *sink_ctx, const char *data, size_t len) {
+    SINK_BUF *b = (SINK_BUF *)sink_ctx;
+
+    if (b->stopped) {
+        b->calls_after_stop++;
+        return JSONFailure;
+    }
+    if (b->limit && b->len + len > b->limit) {
+        b->stopped = 1;
+        return JSONFailure;
+    }
+    while (b->len + len + 1 > b->max) {
+        b->max = b->max ? b->max * 2 : 256;
+        b->text = realloc(b->text, b->max);
+        cr_assert(b->text != NULL);
+    }
+    memcpy(b->text + b->len, data, len);
+    b->len += len;
+    b->text[b->len] = 0;
+    return JSONSuccess;
+}
+
+/*
+ * The sink gets the same text as json_serialize_to_string(), compact
+ * and pretty
+ */
+Test(JSON_SINK, same_text) {
+    JSON_Value *val = NULL;
+    SINK_BUF b;
+    char *expected = NULL;
+    int expected_len = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]) + 1; i++) {
+        val = i ? json_parse_file(files[i - 1]) : json_parse_string(doc);
+        cr_assert(val != NULL);
+
+        memset(&b, 0, sizeof(b));
+        cr_assert(json_serialize_to_sink(val, &buf_sink, &b) == JSONSuccess);
+        expected = json_serialize_to_string(val, &expected_len);
+        cr_assert(expected != NULL);
+        cr_assert(b.len == (size_t)expected_len);
+        cr_assert(!memcmp(b.text, expected, expected_len));
+        cr_assert(json_serialization_size(val) == b.len + 1);
+        json_free_serialized_string(expected);
+        free(b.text);
+
+        memset(&b, 0, sizeof(b));
+        cr_assert(json_serialize_to_sink_pretty(val, &buf_sink, &b) == JSONSuccess);
+        expected = json_serialize_to_string_pretty(val, &expected_len);
+        cr_assert(expected != NULL);
+        cr_assert(b.len == (size_t)expected_len);
+        cr_assert(!memcmp(b.text, expected, expected_len));
+        cr_assert(json_serialization_size_pretty(val) == b.len + 1);
+        json_free_serialized_string(expected);
+        free(b.text);
+
+        json_value_free(val);
+    }
+}
+
+/*
+ * A buffer fits the text only when it has room for the NUL too
+ */
+Test(JSON_SINK, buffer_size) {
+    JSON_Value *val = NULL;
+    char *expected = NULL, *buf = NULL;
+    size_t size = 0;
+
+    val = json_parse_string(doc);
+    cr_assert(val != NULL);
+    expected = json_serialize_to_string(val, NULL);
+    cr_assert(expected != NULL);
+    size = json_serialization_size(val);
+    cr_assert(size == strlen(expected) + 1);
+
+    buf = malloc(size);
+    cr_assert(buf != NULL);
+    cr_assert(json_serialize_to_buffer(val, buf, size) == JSONSuccess);
+    cr_assert(!strcmp(buf, expected));
+    cr_assert(json_serialize_to_buffer(val, buf, size - 1) == JSONFailure);
+    cr_assert(json_serialize_to_buffer(val, buf, 1) == JSONFailure);
+    cr_assert(json_serialize_to_buffer(val, buf, 0) == JSONFailure);
+    cr_assert(json_serialize_to_buffer(val, NULL, size) == JSONFailure);
+    free(buf);
+    json_free_serialized_string(expected);
+
+    size = json_serialization_size_pretty(val);
+    buf = malloc(size);
+    cr_assert(buf != NULL);
+    cr_assert(json_serialize_to_buffer_pretty(val, buf, size) == JSONSuccess);
+    cr_assert(strlen(buf) == size - 1);
+    cr_assert(json_serialize_to_buffer_pretty(val, buf, size - 1) == JSONFailure);
+    free(buf);
+
+    json_value_free(val);
+}
+
+/*
+ * A sink that gives up stops the serialization, what it took being
+ * the start of the text
+ */
+Test(JSON_SINK, sink_stops) {
+    JSON_Value *val = NULL;
+    char *expected = NULL;
+    size_t limits[] = { 1, 2, 10, 100, 1000 };
+    SINK_BUF b;
+    size_t i;
+
+    val = json_parse_string(doc);
+    cr_assert(val != NULL);
+    expected = json_serialize_to_string(val, NULL);
+    cr_assert(expected != NULL);
+
+    for (i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+        memset(&b, 0, sizeof(b));
+        b.limit = limits[i];
+        if (limits[i] < strlen(expected)) {
+            cr_assert(json_serialize_to_sink(val, &buf_sink, &b) == JSONFailure);
+            cr_assert(b.stopped);
+            cr_assert(b.calls_after_stop == 0);
+            cr_assert(b.len <= limits[i]);
+            cr_assert(!b.len || !memcmp(b.text, expected, b.len));
+        } else {
+            cr_assert(json_serialize_to_sink(val, &buf_sink, &b) == JSONSuccess);
+            cr_assert(!strcmp(b.text, expected));
+        }
+        free(b.text);
+    }
+
+    cr_assert(json_serialize_to_sink(NULL, &buf_sink, &b) == JSONFailure);
+    cr_assert(json_serialize_to_sink(val, NULL, NULL) == JSONFailure);
+    json_free_serialized_string(expected);
+    json_value_free(val);
+}